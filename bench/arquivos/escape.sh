@@ -0,0 +1,206 @@
+#!/bin/sh
+# A linha de File.lines aponta para o buffer do leitor e só vale até a próxima
+# volta do laço: guardá-la (push, set, new, campo, variável de fora, inclusive
+# pelo retorno de uma função que a devolve), devolvê-la ou mandá-la para outra
+# tarefa tem que ser erro semântico. Usá-la dentro da volta (inclusive por
+# variáveis do próprio laço) continua compilando, e geradores do programa
+# guardados em variáveis não são confundidos com File.lines. O byte[] de
+# File.map é só leitura: escrever nele, direto ou por uma função, também é erro.
+# Uso: bench/arquivos/escape.sh (a partir da raiz, após make) ou make escape-linhas
+set -e
+DIR=$(cd "$(dirname "$0")" && pwd)
+RUJO=${RUJO:-$DIR/../../rujo}
+TMP=$(mktemp -d)
+trap 'rm -rf "$TMP"' EXIT
+cd "$TMP"
+printf 'a\nbb\nccc\n' > in.txt
+
+falhas=0
+
+# caso descricao esperado: compila o programa lido da entrada padrão;
+# esperado é a saída do programa ou "erro" (a linha escaparia ou o mapa seria escrito)
+caso() {
+    descricao=$1
+    esperado=$2
+    cat > caso.rj
+    if "$RUJO" run caso.rj > run.log 2>&1; then
+        obtida=$(grep -v '^Sucesso' run.log | tr '\n' ' ')
+    elif grep -q 'escaparia do laco\|File.map e so leitura' run.log; then
+        obtida=erro
+    else
+        obtida="build falhou: $(tr '\n' ' ' < run.log)"
+    fi
+    if [ "$obtida" = "$esperado" ]; then
+        printf "ok    %s\n" "$descricao"
+    else
+        printf "FALHA %s: '%s' (esperado '%s')\n" "$descricao" "$obtida" "$esperado"
+        falhas=$((falhas + 1))
+    fi
+}
+
+caso "uso dentro da volta" "a bb ccc 3 " <<'RJ'
+fn conta(string p): Result<int,string> {
+    int n = 0;
+    for (string l in File.lines(p)?) {
+        string atual = l;
+        string ultima = "";
+        ultima = atual;
+        print(ultima);
+        n = n + 1;
+    }
+    return Ok(n);
+}
+print(conta("in.txt").unwrap());
+RJ
+
+caso "push numa List" erro <<'RJ'
+List<string> todas = new List<string>();
+for (string l in File.lines("in.txt").unwrap()) {
+    todas.push(l);
+}
+RJ
+
+caso "chave de Map" erro <<'RJ'
+Map<string, int> vistas = new Map<string, int>();
+for (string l in File.lines("in.txt").unwrap()) {
+    vistas.set(l, 1);
+}
+RJ
+
+caso "variavel de fora (via copia local)" erro <<'RJ'
+string ultima = "";
+for (string l in File.lines("in.txt").unwrap()) {
+    string t = l;
+    ultima = t;
+}
+print(ultima);
+RJ
+
+caso "campo de objeto" erro <<'RJ'
+class Reg {
+    prop string texto;
+    init(string t) { this.texto = ""; }
+}
+Reg r = new Reg("");
+for (string l in File.lines("in.txt").unwrap()) {
+    r.texto = l;
+}
+RJ
+
+caso "argumento de new" erro <<'RJ'
+class Reg {
+    prop string texto;
+    init(string t) { this.texto = t; }
+}
+for (string l in File.lines("in.txt").unwrap()) {
+    Reg r = new Reg(l);
+}
+RJ
+
+caso "return" erro <<'RJ'
+fn primeira(string p): Result<string,string> {
+    for (string l in File.lines(p)?) {
+        return Ok(l);
+    }
+    return Err("vazio");
+}
+print(primeira("in.txt").unwrap());
+RJ
+
+caso "gerador guardado numa variavel" erro <<'RJ'
+List<string> todas = new List<string>();
+Gen<string> g = File.lines("in.txt").unwrap();
+for (string l in g) {
+    todas.push(l);
+}
+RJ
+
+caso "retorno de funcao que devolve a linha" erro <<'RJ'
+fn ident(string s): string {
+    return s;
+}
+string ultimo = "";
+for (string l in File.lines("in.txt").unwrap()) {
+    ultimo = ident(l);
+}
+print(ultimo);
+RJ
+
+caso "metodo que guarda a linha no objeto" erro <<'RJ'
+class Reg {
+    prop string texto;
+    init(string t) { this.texto = ""; }
+    fn guardar(string t): void { this.texto = t; }
+}
+Reg r = new Reg("");
+for (string l in File.lines("in.txt").unwrap()) {
+    r.guardar(l);
+}
+print(r.texto);
+RJ
+
+caso "Result de File.lines guardado" erro <<'RJ'
+List<string> todas = new List<string>();
+Result<Gen<string>, string> arq = File.lines("in.txt");
+Gen<string> g = arq.unwrap();
+for (string l in g) {
+    todas.push(l);
+}
+RJ
+
+caso "gerador do programa numa variavel" "x y 2 " <<'RJ'
+fn letras(): Gen<string> {
+    yield "x";
+    yield "y";
+}
+List<string> todas = new List<string>();
+Gen<string> g = letras();
+for (string s in g) {
+    todas.push(s);
+    print(s);
+}
+print(todas.len());
+RJ
+
+caso "funcao que so le a linha" "a bb ccc 3 " <<'RJ'
+fn mostra(string s): int {
+    print(s);
+    return 1;
+}
+int total = 0;
+for (string l in File.lines("in.txt").unwrap()) {
+    total = total + mostra(l);
+}
+print(total);
+RJ
+
+caso "escrita no File.map" erro <<'RJ'
+byte[] d = File.map("in.txt").unwrap();
+d[0] = 65;
+RJ
+
+caso "funcao que escreve no File.map" erro <<'RJ'
+fn zera(byte[] b): void {
+    b[0] = 0;
+}
+Result<byte[], string> r = File.map("in.txt");
+byte[] d = r.unwrap();
+zera(d);
+RJ
+
+caso "funcao que so le o File.map" "9 " <<'RJ'
+fn conta(byte[] b): int {
+    int n = 0;
+    for (byte x in b) {
+        n = n + 1;
+    }
+    return n;
+}
+fn ler(string p): Result<int, string> {
+    byte[] d = File.map(p)?;
+    return Ok(conta(d));
+}
+print(ler("in.txt").unwrap());
+RJ
+
+[ $falhas -eq 0 ] || exit 1
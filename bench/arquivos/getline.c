@@ -0,0 +1,17 @@
+// Referência em C: getline() sobre stdio com o mesmo arquivo de linhas.rj
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+
+int main(void) {
+    FILE* f = fopen("/tmp/rujo_bench_log.txt", "r");
+    if (!f) return 1;
+    char* line = NULL;
+    size_t cap = 0;
+    long n = 0;
+    while (getline(&line, &cap, f) >= 0) n++;
+    printf("%ld\n", n);
+    free(line);
+    fclose(f);
+    return 0;
+}
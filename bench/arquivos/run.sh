@@ -0,0 +1,30 @@
+#!/bin/sh
+# Varredura de um log de ~650 MB (em cache): File.map, File.lines, getline() em C e wc -l.
+# escrever mede o FileWriter gerando o arquivo. Uso: bench/arquivos/run.sh (a partir da raiz, após make)
+set -e
+DIR=$(cd "$(dirname "$0")" && pwd)
+RUJO=${RUJO:-$DIR/../../rujo}
+LOG=/tmp/rujo_bench_log.txt
+TMP=$(mktemp -d)
+trap 'rm -rf "$TMP" "$LOG"' EXIT
+
+cd "$TMP"
+for name in escrever mapear linhas; do
+    "$RUJO" build "$DIR/$name.rj" > /dev/null
+    mv program.exe "$name"
+done
+gcc -O2 "$DIR/getline.c" -o getline
+
+medir() {
+    start=$(date +%s%N)
+    "$@" > /dev/null
+    end=$(date +%s%N)
+    ms=$(( (end - start) / 1000000 ))
+    mb=$(( $(wc -c < "$LOG") / 1000000 ))
+    echo "$1: $ms ms, $(( mb * 1000 / (ms + 1) )) MB/s"
+}
+
+medir ./escrever
+cat "$LOG" > /dev/null # deixa o arquivo no page cache
+for bin in ./mapear ./linhas ./getline; do medir $bin; done
+medir wc -l "$LOG"
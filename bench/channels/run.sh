@@ -0,0 +1,27 @@
+#!/bin/sh
+# Vazão e latência de Channel<T> / SpscChannel<T> nas topologias 1:1, N:1 e N:M.
+# Cada programa passa 10M inteiros (pingpong: 100k idas e voltas).
+# Uso: bench/channels/run.sh (a partir da raiz, após make). RUJO_THREADS=N fixa os workers.
+set -e
+DIR=$(cd "$(dirname "$0")" && pwd)
+RUJO=${RUJO:-$DIR/../../rujo}
+TMP=$(mktemp -d)
+trap 'rm -rf "$TMP"' EXIT
+
+cd "$TMP"
+for name in spsc mpmc lotes n_1 n_m pingpong; do
+    "$RUJO" build "$DIR/$name.rj" > /dev/null
+    mv program.exe "$name"
+done
+
+for name in spsc mpmc lotes n_1 n_m; do
+    start=$(date +%s%N)
+    ./$name > /dev/null
+    end=$(date +%s%N)
+    echo "$name: $(( (end - start) / 1000000 )) ms, $(( (end - start) / 10000000 )) ns/item"
+done
+
+start=$(date +%s%N)
+./pingpong > /dev/null
+end=$(date +%s%N)
+echo "pingpong: $(( (end - start) / 1000000 )) ms, $(( (end - start) / 100000 )) ns/ida e volta"
@@ -0,0 +1,51 @@
+#!/bin/sh
+# Entradas extremas com a pilha limitada (ulimit -s, padrão 1024 KB): o
+# compilador tem que terminar sem estourar a pilha em listas enormes e em
+# expressões profundas à esquerda, e recusar com erro o aninhamento acima do
+# limite do parser.
+#   N            statements da lista (padrão 10000000, ~1.7 GB de heap)
+#   PROFUNDIDADE termos da expressão encadeada (padrão 100000)
+#   PILHA_KB     limite de pilha (padrão 1024)
+# Uso: bench/compilador/estresse.sh (a partir da raiz, após make) ou make stress
+set -e
+DIR=$(cd "$(dirname "$0")" && pwd)
+RUJO=${RUJO:-$DIR/../../rujo}
+N=${N:-10000000}
+PROFUNDIDADE=${PROFUNDIDADE:-100000}
+PILHA_KB=${PILHA_KB:-1024}
+TMP=$(mktemp -d)
+trap 'rm -rf "$TMP"' EXIT
+cd "$TMP"
+
+falhas=0
+
+# caso esperado tipo n: esperado "ok" (C gerado) ou "erro" (erro de sintaxe, sem crash)
+caso() {
+    sh "$DIR/gerar.sh" "$3" "$4" > "$1.rj"
+    set +e
+    (ulimit -s "$PILHA_KB" && "$RUJO" emit "$1.rj" --time-report-json "$1.json") > "$1.log" 2>&1
+    status=$?
+    set -e
+    if [ "$2" = ok ] && [ $status -eq 0 ]; then
+        ms=$(sed -n 's/.*"wall_ms": \([0-9.]*\).*/\1/p' "$1.json" | awk '{ t += $1 } END { printf "%.0f", t }')
+        printf "%-11s ok    %9s %-10s %8s ms\n" "$1" "$4" "$3" "$ms"
+    elif [ "$2" = erro ] && [ $status -eq 1 ] && grep -q '^Erro' "$1.log"; then
+        printf "%-11s ok    %9s %-10s  %s\n" "$1" "$4" "$3" "$(grep -m1 '^Erro' "$1.log")"
+    else
+        printf "%-11s FALHA %9s %-10s  status %d\n" "$1" "$4" "$3" "$status"
+        tail -3 "$1.log"
+        falhas=$((falhas + 1))
+    fi
+}
+
+echo "pilha limitada a $PILHA_KB KB"
+caso lista ok chamadas "$N"
+caso statements ok statements 1000000
+caso cadeia ok cadeia "$PROFUNDIDADE"
+caso parenteses erro parenteses "$PROFUNDIDADE"
+caso aninhado ok parenteses 900
+
+if [ $falhas -gt 0 ]; then
+    echo "$falhas caso(s) falharam"
+    exit 1
+fi
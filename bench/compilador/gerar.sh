@@ -0,0 +1,120 @@
+#!/bin/sh
+# Gera programas Rujo grandes para medir o compilador.
+# Uso: bench/compilador/gerar.sh <tipo> <n> > arquivo.rj
+#   funcoes      n funções pequenas, todas chamadas no fim
+#   expressoes   n linhas, cada uma com uma expressão aninhada 40 níveis
+#   statements   n statements seguidos no nível superior
+#   classes      uma classe com n props e n métodos
+#   escopos      n funções com blocos aninhados 8 níveis, uma variável por bloco
+#   chamadas     n statements "flush();" (um nó cada: só o tamanho da lista pesa)
+#   cadeia       uma expressão com n termos somados (espinha esquerda de n nós)
+#   parenteses   uma expressão dentro de n pares de parênteses
+set -e
+tipo=$1
+n=$2
+if [ -z "$tipo" ] || [ -z "$n" ]; then
+    echo "uso: $0 <funcoes|expressoes|statements|classes|escopos|chamadas|cadeia|parenteses> <n>" >&2
+    exit 1
+fi
+
+case $tipo in
+funcoes)
+    awk -v n="$n" 'BEGIN {
+        for (i = 0; i < n; i++) {
+            printf "fn f%d(int a, int b): int {\n", i
+            printf "    int c = a * %d + b;\n", i % 97
+            printf "    if (c > %d) {\n        return c - a;\n    }\n", i
+            printf "    return c + 1;\n}\n\n"
+        }
+        print "int total = 0;"
+        for (i = 0; i < n; i++) printf "total = total + f%d(%d, total);\n", i, i % 13
+        print "print(total);"
+    }' ;;
+expressoes)
+    awk -v n="$n" 'BEGIN {
+        print "int x = 3;"
+        print "int y = 5;"
+        for (i = 0; i < n; i++) {
+            e = "x"
+            for (d = 0; d < 40; d++) {
+                op = (d % 3 == 0) ? "+" : (d % 3 == 1) ? "*" : "-"
+                e = "(" e " " op " " ((i + d) % 7 == 0 ? "y" : (d % 9 + 1)) ")"
+            }
+            printf "int e%d = %s;\n", i, e
+        }
+        printf "print(e%d);\n", n - 1
+    }' ;;
+statements)
+    awk -v n="$n" 'BEGIN {
+        print "int a = 1;"
+        print "int b = 2;"
+        for (i = 0; i < n; i++) {
+            k = i % 4
+            if (k == 0) printf "a = a + %d;\n", i % 10
+            else if (k == 1) printf "b = b * 3 - a;\n"
+            else if (k == 2) printf "if (a > b) {\n    a = a - b;\n}\n"
+            else printf "while (b > 1000) {\n    b = b - 1000;\n}\n"
+        }
+        print "print(a);"
+        print "print(b);"
+    }' ;;
+classes)
+    awk -v n="$n" 'BEGIN {
+        print "class Grande {"
+        for (i = 0; i < n; i++) printf "    prop int p%d;\n", i
+        for (i = 0; i < n; i++) {
+            printf "    fn m%d(int v): int {\n", i
+            printf "        this.p%d = this.p%d + v;\n", i, (i + 1) % n
+            printf "        return this.p%d;\n    }\n", i
+        }
+        print "}"
+        print "Grande g = new Grande();"
+        print "int s = 0;"
+        for (i = 0; i < n; i++) printf "s = s + g.m%d(%d);\n", i, i % 5
+        print "print(s);"
+    }' ;;
+escopos)
+    awk -v n="$n" 'BEGIN {
+        for (i = 0; i < n; i++) {
+            printf "fn g%d(int x): int {\n", i
+            printf "    int r = x;\n"
+            ind = "    "
+            for (d = 0; d < 8; d++) {
+                printf "%sif (r > %d) {\n", ind, d
+                ind = ind "    "
+                printf "%sint v%d = r - %d;\n", ind, d, d
+                printf "%sr = v%d + 1;\n", ind, d
+            }
+            for (d = 7; d >= 0; d--) {
+                ind = substr(ind, 5)
+                printf "%s}\n", ind
+            }
+            printf "    return r;\n}\n\n"
+        }
+        print "int t = 0;"
+        for (i = 0; i < n; i++) printf "t = t + g%d(%d);\n", i, i % 11
+        print "print(t);"
+    }' ;;
+chamadas)
+    awk -v n="$n" 'BEGIN { for (i = 0; i < n; i++) print "flush();" }' ;;
+cadeia)
+    awk -v n="$n" 'BEGIN {
+        print "int x = 1;"
+        printf "int y = x"
+        for (i = 1; i < n; i++) printf(i % 2 ? " + x" : " - 1")
+        print ";"
+        print "print(y);"
+    }' ;;
+parenteses)
+    awk -v n="$n" 'BEGIN {
+        printf "int y = "
+        for (i = 0; i < n; i++) printf "("
+        printf "1"
+        for (i = 0; i < n; i++) printf ")"
+        print ";"
+        print "print(y);"
+    }' ;;
+*)
+    echo "tipo desconhecido: $tipo" >&2
+    exit 1 ;;
+esac
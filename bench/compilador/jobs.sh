@@ -0,0 +1,73 @@
+#!/bin/sh
+# Escala do codegen com --jobs: tempo da fase codegen (melhor de R, padrão 3)
+# com 1, 2, 4, ... threads até o número de núcleos, e o ganho sobre 1 thread.
+# O out.c de cada N é comparado com o de 1 thread (tem que ser idêntico).
+#   JOBS="1 2 4"  escolhe os valores de N
+#   GCC=1         usa "rujo build" e mede a fase gcc (o C em N unidades)
+#   LTO=1         com GCC=1, passa --lto
+# Uso: bench/compilador/jobs.sh (a partir da raiz, após make) ou make bench-jobs
+set -e
+DIR=$(cd "$(dirname "$0")" && pwd)
+RUJO=${RUJO:-$DIR/../../rujo}
+R=${R:-3}
+TMP=$(mktemp -d)
+trap 'rm -rf "$TMP"' EXIT
+cd "$TMP"
+
+if [ -z "$JOBS" ]; then
+    nucleos=$(getconf _NPROCESSORS_ONLN 2>/dev/null || echo 1)
+    JOBS=1
+    j=2
+    while [ $j -lt "$nucleos" ]; do
+        JOBS="$JOBS $j"
+        j=$((j * 2))
+    done
+    [ "$nucleos" -gt 1 ] && JOBS="$JOBS $nucleos"
+fi
+
+# caso tipo n
+casos="funcoes funcoes 50000
+escopos escopos 20000
+classes classes 5000"
+
+cmd=emit
+fase=codegen
+extra=
+if [ -n "$GCC" ]; then
+    # O gcc é bem mais lento que o rujo: programas menores
+    casos="funcoes funcoes 2000
+escopos escopos 1000
+classes classes 500"
+    cmd=build
+    fase=gcc
+    [ -n "$LTO" ] && extra=--lto
+fi
+
+# wall_ms da fase medida num relatório JSON
+fase_ms() {
+    sed -n "s/.*\"name\": \"$fase\", \"wall_ms\": \([0-9.]*\).*/\1/p" "$1"
+}
+
+printf "%-9s %5s %12s %8s\n" caso jobs "$fase ms" ganho
+echo "$casos" | while read -r caso tipo n; do
+    sh "$DIR/gerar.sh" "$tipo" "$n" > "$caso.rj"
+    for j in $JOBS; do
+        melhor=
+        i=0
+        while [ $i -lt "$R" ]; do
+            "$RUJO" $cmd "$caso.rj" --jobs "$j" $extra --time-report-json "$caso.json" > /dev/null
+            ms=$(fase_ms "$caso.json")
+            if [ -z "$melhor" ] || awk "BEGIN { exit !($ms < $melhor) }"; then melhor=$ms; fi
+            i=$((i + 1))
+        done
+        marca=
+        if [ "$j" = 1 ]; then
+            serial=$melhor
+            [ -z "$GCC" ] && cp out.c serial.c
+        elif [ -z "$GCC" ]; then
+            cmp -s serial.c out.c || marca="  C DIFERENTE"
+        fi
+        ganho=$(echo "$serial $melhor" | awk '{ printf "%.2fx", $1 / $2 }')
+        printf "%-9s %5d %12s %8s%s\n" "$caso" "$j" "$melhor" "$ganho" "$marca"
+    done
+done
@@ -0,0 +1,114 @@
+#!/bin/sh
+# Vazão do compilador (linhas/s por fase) em programas gerados por gerar.sh,
+# comparada com baseline.txt. Cada caso roda R vezes (padrão 7) com
+# "rujo emit --time-report-json" e fica a mediana de cada fase. As fases
+# sozinhas oscilam demais entre execuções (lex e parse passam de 50%), então
+# só o total do caso (linhas / soma das fases) é marcado como REGRESSAO, quando
+# cai mais que a tolerância: TOL% (padrão 15) ou a dispersão medida do total
+# ((máx - mín) / mediana, na baseline ou agora), o que for maior.
+#   GCC=1        usa "rujo build" e mede também o gcc
+#   TOL=n        tolerância mínima em %
+#   ATUALIZAR=1  grava as medidas atuais como nova baseline (refaça a baseline
+#                no mesmo commit de qualquer mudança de vazão)
+# Uso: bench/compilador/run.sh (a partir da raiz, após make) ou make bench
+set -e
+DIR=$(cd "$(dirname "$0")" && pwd)
+RUJO=${RUJO:-$DIR/../../rujo}
+R=${R:-7}
+TOL=${TOL:-15}
+BASE=$DIR/baseline.txt
+TMP=$(mktemp -d)
+trap 'rm -rf "$TMP"' EXIT
+cd "$TMP"
+
+cmd=emit
+fases="lex parse semantico codegen"
+if [ -n "$GCC" ]; then
+    cmd=build
+    fases="$fases gcc"
+fi
+
+# caso tipo n
+casos="funcoes funcoes 20000
+expressoes expressoes 5000
+statements statements 200000
+classes classes 5000
+escopos escopos 8000"
+
+# "fase linhas_por_s" de um relatório JSON, mais "total linhas_por_s" com as
+# linhas do arquivo sobre a soma do tempo de parede das fases medidas
+fases_json() {
+    awk -v fases="$fases" '
+        BEGIN { split(fases, f, " "); for (i in f) quer[f[i]] = 1 }
+        /"lines":/ { gsub(/[^0-9]/, ""); linhas = $0 }
+        /"name":/ {
+            nome = $0; sub(/.*"name": "/, "", nome); sub(/".*/, "", nome)
+            if (!quer[nome]) next
+            ms = $0; sub(/.*"wall_ms": /, "", ms); sub(/,.*/, "", ms)
+            lps = $0; sub(/.*"lines_per_s": /, "", lps); sub(/}.*/, "", lps)
+            print nome, lps
+            soma += ms
+        }
+        END { if (soma > 0) printf "total %d\n", linhas * 1000 / soma }
+    ' "$1"
+}
+
+: > medidas.txt
+echo "$casos" | while read -r caso tipo n; do
+    sh "$DIR/gerar.sh" "$tipo" "$n" > "$caso.rj"
+    i=0
+    while [ $i -lt "$R" ]; do
+        "$RUJO" $cmd "$caso.rj" --time-report-json "$caso.json" > /dev/null
+        fases_json "$caso.json" | sed "s/^/$caso /" >> medidas.txt
+        i=$((i + 1))
+    done
+done
+
+# Mediana de R por caso/fase; o total leva também a dispersão em %
+sort -k1,1 -k2,2 -k3,3n medidas.txt | awk '
+    function fecha() {
+        if (k == "") return
+        med = c % 2 ? v[(c + 1) / 2] : (v[c / 2] + v[c / 2 + 1]) / 2
+        if (fase == "total") printf "%s %d %.1f\n", k, med, (v[c] - v[1]) * 100 / med
+        else printf "%s %d\n", k, med
+    }
+    $1 " " $2 != k { fecha(); k = $1 " " $2; fase = $2; c = 0 }
+    { v[++c] = $3 }
+    END { fecha() }
+' > ordenadas.txt
+# Volta à ordem dos casos e das fases
+awk 'FNR == NR { m[$1 " " $2] = $0; next } !($1 " " $2 in m) { next } { print m[$1 " " $2]; delete m[$1 " " $2] }' \
+    ordenadas.txt medidas.txt > atual.txt
+
+if [ -n "$ATUALIZAR" ]; then
+    {
+        echo "# caso fase linhas/s [dispersao%] (bench/compilador/run.sh, R=$R, ATUALIZAR=1)"
+        cat atual.txt
+    } > "$BASE"
+    echo "baseline atualizada: $BASE"
+fi
+
+touch "$BASE"
+awk -v tol="$TOL" '
+    FNR == NR { if ($1 !~ /^#/) { base[$1 " " $2] = $3; disp[$1 " " $2] = $4 }; next }
+    BEGIN { printf "%-11s %-10s %12s %12s %8s %7s\n", "caso", "fase", "linhas/s", "baseline", "delta", "limite" }
+    {
+        k = $1 " " $2
+        if (!(k in base) || base[k] <= 0) {
+            printf "%-11s %-10s %12d %12s %8s\n", $1, $2, $3, "-", "-"
+            next
+        }
+        d = ($3 - base[k]) * 100 / base[k]
+        if ($2 != "total") {
+            printf "%-11s %-10s %12d %12d %+7.1f%%\n", $1, $2, $3, base[k], d
+            next
+        }
+        lim = tol
+        if (disp[k] > lim) lim = disp[k]
+        if ($4 > lim) lim = $4
+        marca = d < -lim ? "  REGRESSAO" : ""
+        if (d < -lim) reg++
+        printf "%-11s %-10s %12d %12d %+7.1f%% %6.1f%%%s\n", $1, $2, $3, base[k], d, lim, marca
+    }
+    END { if (reg) printf "\n%d caso(s) com o total abaixo da baseline alem da tolerancia\n", reg }
+' "$BASE" atual.txt
@@ -0,0 +1,26 @@
+#!/bin/sh
+# Geradores: pipeline com frames inline vs. Gen<T> no heap vs. laço escrito à mão.
+# Cada programa processa 50M itens; RSS máximo mostra que a memória não cresce.
+# Uso: bench/geradores/run.sh (a partir da raiz, após make).
+set -e
+DIR=$(cd "$(dirname "$0")" && pwd)
+RUJO=${RUJO:-$DIR/../../rujo}
+TMP=$(mktemp -d)
+trap 'rm -rf "$TMP"' EXIT
+
+cd "$TMP"
+for name in pipeline heap laco; do
+    "$RUJO" build "$DIR/$name.rj" > /dev/null
+    mv program.exe "$name"
+done
+
+for name in pipeline heap laco; do
+    start=$(date +%s%N)
+    ./$name > /dev/null
+    end=$(date +%s%N)
+    rss=""
+    if [ -x /usr/bin/time ]; then
+        rss=", $(/usr/bin/time -f %M ./$name 2>&1 > /dev/null) KB"
+    fi
+    echo "$name: $(( (end - start) / 1000000 )) ms, $(( (end - start) / 50000000 )) ns/item$rss"
+done
@@ -0,0 +1,54 @@
+#!/bin/sh
+# Frames inline no --stream: um for-in sobre a chamada de um gerador guarda o
+# frame por valor também quando a função ou o statement que itera é gerado
+# antes do gerador (no --stream os geradores saem no fim). Confere que o C do
+# --stream chama tantos _frame_init quanto o modo normal e que a saída é a mesma.
+# Uso: bench/geradores/stream.sh (a partir da raiz, após make) ou make frames-stream
+set -e
+DIR=$(cd "$(dirname "$0")" && pwd)
+RUJO=${RUJO:-$DIR/../../rujo}
+TMP=$(mktemp -d)
+trap 'rm -rf "$TMP"' EXIT
+cd "$TMP"
+
+# Quem itera vem antes do gerador: no --stream ele é gerado primeiro
+cat > antes.rj <<'RJ'
+fn soma(int n): int {
+    int s = 0;
+    for (int x in contar(n)) {
+        s = s + x;
+    }
+    return s;
+}
+fn contar(int n): Gen<int> {
+    for (int i = 0; i < n; i = i + 1) {
+        yield i;
+    }
+}
+print(soma(10));
+int t = 0;
+for (int y in contar(5)) {
+    t = t + y;
+}
+print(t);
+RJ
+
+falhas=0
+for fonte in antes.rj "$DIR/../../snippets/teste_gerador.rj"; do
+    nome=$(basename "$fonte" .rj)
+    "$RUJO" emit "$fonte" > /dev/null
+    normal=$(grep -c '_frame_init(&' out.c || :)
+    "$RUJO" run "$fonte" | grep -v '^Sucesso' > normal.txt
+    "$RUJO" emit "$fonte" --stream > /dev/null
+    stream=$(grep -c '_frame_init(&' out.c || :)
+    "$RUJO" run "$fonte" --stream | grep -v '^Sucesso' > stream.txt
+    if [ "$normal" = "$stream" ] && cmp -s normal.txt stream.txt; then
+        printf "ok    %-16s frames inline: %s\n" "$nome" "$stream"
+    else
+        printf "FALHA %-16s frames inline: %s (normal: %s)%s\n" "$nome" "$stream" "$normal" \
+            "$(cmp -s normal.txt stream.txt || echo ', saidas diferentes')"
+        falhas=$((falhas + 1))
+    fi
+done
+
+[ $falhas -eq 0 ] || exit 1
@@ -0,0 +1,91 @@
+// Gerador de carga para echo.rj: N conexões, cada uma com uma mensagem em voo.
+// Mede requisições/s e a latência de ida e volta (p50/p99).
+// Uso: cliente <porta> <conexoes> <segundos>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#define MSG 64
+#define MAX_AMOSTRAS (1 << 22)
+
+static long agora_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000L + ts.tv_nsec;
+}
+
+static int compara(const void* a, const void* b) {
+    long x = *(const long*)a, y = *(const long*)b;
+    return (x > y) - (x < y);
+}
+
+int main(int argc, char** argv) {
+    int porta = argc > 1 ? atoi(argv[1]) : 9100;
+    int conns = argc > 2 ? atoi(argv[2]) : 64;
+    int segundos = argc > 3 ? atoi(argv[3]) : 3;
+
+    int ep = epoll_create1(0);
+    long* enviado = calloc(conns, sizeof(long));
+    int* recebido = calloc(conns, sizeof(int));
+    int* fds = calloc(conns, sizeof(int));
+    long* amostras = malloc(MAX_AMOSTRAS * sizeof(long));
+    long n_amostras = 0;
+    char msg[MSG], buf[MSG];
+    memset(msg, 'x', MSG);
+
+    struct sockaddr_in addr = { .sin_family = AF_INET, .sin_port = htons(porta) };
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    for (int i = 0; i < conns; i++) {
+        fds[i] = socket(AF_INET, SOCK_STREAM, 0);
+        if (connect(fds[i], (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+            perror("connect");
+            return 1;
+        }
+        int um = 1;
+        setsockopt(fds[i], IPPROTO_TCP, TCP_NODELAY, &um, sizeof(um));
+        struct epoll_event ev = { .events = EPOLLIN, .data.u32 = i };
+        epoll_ctl(ep, EPOLL_CTL_ADD, fds[i], &ev);
+        enviado[i] = agora_ns();
+        write(fds[i], msg, MSG);
+    }
+
+    long inicio = agora_ns();
+    long fim = inicio + segundos * 1000000000L;
+    long total = 0;
+    struct epoll_event evs[256];
+    while (agora_ns() < fim) {
+        int n = epoll_wait(ep, evs, 256, 100);
+        for (int e = 0; e < n; e++) {
+            int i = evs[e].data.u32;
+            int r = read(fds[i], buf, MSG - recebido[i]);
+            if (r <= 0) {
+                fprintf(stderr, "conexao %d fechada\n", i);
+                return 1;
+            }
+            recebido[i] += r;
+            if (recebido[i] < MSG) continue;
+            long t = agora_ns();
+            if (n_amostras < MAX_AMOSTRAS) amostras[n_amostras++] = t - enviado[i];
+            total++;
+            recebido[i] = 0;
+            enviado[i] = t;
+            write(fds[i], msg, MSG);
+        }
+    }
+    double dur = (agora_ns() - inicio) / 1e9;
+
+    qsort(amostras, n_amostras, sizeof(long), compara);
+    long p50 = n_amostras ? amostras[n_amostras / 2] : 0;
+    long p99 = n_amostras ? amostras[n_amostras * 99 / 100] : 0;
+    printf("%d conexoes: %.0f req/s, p50 %.1f us, p99 %.1f us\n",
+        conns, total / dur, p50 / 1000.0, p99 / 1000.0);
+    for (int i = 0; i < conns; i++) close(fds[i]);
+    return 0;
+}
@@ -0,0 +1,27 @@
+#!/bin/sh
+# Servidor echo em async fn (echo.rj) sob carga de cliente.c, com io_uring e com epoll.
+# Uso: bench/io/run.sh [conexoes] [segundos] (a partir da raiz, após make)
+set -e
+DIR=$(cd "$(dirname "$0")" && pwd)
+RUJO=${RUJO:-$DIR/../../rujo}
+CONNS=${1:-64}
+SEGS=${2:-3}
+TMP=$(mktemp -d)
+PID=""
+trap '[ -n "$PID" ] && kill $PID 2>/dev/null; rm -rf "$TMP"' EXIT
+
+cd "$TMP"
+"$RUJO" build "$DIR/echo.rj" > /dev/null
+mv program.exe echo_rujo
+gcc -O2 "$DIR/cliente.c" -o cliente
+
+for backend in uring epoll; do
+    RUJO_IO=$backend ./echo_rujo &
+    PID=$!
+    sleep 0.3
+    printf "%s: " "$backend"
+    ./cliente 9100 "$CONNS" "$SEGS"
+    kill $PID
+    wait $PID 2>/dev/null || true
+    PID=""
+done
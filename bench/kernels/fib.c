@@ -0,0 +1,11 @@
+#include <stdio.h>
+
+static int fib(int n) {
+    if (n < 2) return n;
+    return fib(n - 1) + fib(n - 2);
+}
+
+int main(void) {
+    printf("%d\n", fib(35));
+    return 0;
+}
@@ -0,0 +1,73 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+// Endereçamento aberto com sondagem linear, capacidade potência de 2, carga até 1/2
+typedef struct {
+    int* keys;
+    int* vals;
+    bool* used;
+    size_t cap, len;
+    int bits;    // cap == 1 << bits
+} Tabela;
+
+// Fibonacci hashing: os bits altos do produto espalham chaves sequenciais
+static inline size_t hash(int k, int bits) {
+    return (size_t)(((uint64_t)(uint32_t)k * 0x9E3779B97F4A7C15ULL) >> (64 - bits));
+}
+
+static void inserir(Tabela* t, int k, int v);
+
+static void crescer(Tabela* t) {
+    Tabela n = { 0 };
+    n.bits = t->cap ? t->bits + 1 : 4;
+    n.cap = (size_t)1 << n.bits;
+    n.keys = malloc(n.cap * sizeof(int));
+    n.vals = malloc(n.cap * sizeof(int));
+    n.used = calloc(n.cap, sizeof(bool));
+    for (size_t i = 0; i < t->cap; i++) {
+        if (t->used[i]) inserir(&n, t->keys[i], t->vals[i]);
+    }
+    free(t->keys);
+    free(t->vals);
+    free(t->used);
+    *t = n;
+}
+
+static void inserir(Tabela* t, int k, int v) {
+    if ((t->len + 1) * 2 > t->cap) crescer(t);
+    size_t i = hash(k, t->bits);
+    while (t->used[i] && t->keys[i] != k) i = (i + 1) & (t->cap - 1);
+    if (!t->used[i]) {
+        t->used[i] = true;
+        t->keys[i] = k;
+        t->len++;
+    }
+    t->vals[i] = v;
+}
+
+static inline int buscar(const Tabela* t, int k, int padrao) {
+    size_t i = hash(k, t->bits);
+    while (t->used[i]) {
+        if (t->keys[i] == k) return t->vals[i];
+        i = (i + 1) & (t->cap - 1);
+    }
+    return padrao;
+}
+
+int main(void) {
+    int n = 1000000;
+    Tabela m = { 0 };
+    for (int i = 0; i < n; i++) inserir(&m, i * 31 + 7, i);
+    int64_t soma = 0;
+    for (int r = 0; r < 4; r++) {
+        for (int i = 0; i < n; i++) soma += buscar(&m, i * 31 + 7, 0);
+        for (int i = 0; i < n; i++) soma += buscar(&m, i * 31 + 8, 1);
+    }
+    printf("%zu\n%lld\n", m.len, (long long)soma);
+    free(m.keys);
+    free(m.vals);
+    free(m.used);
+    return 0;
+}
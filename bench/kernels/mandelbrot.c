@@ -0,0 +1,23 @@
+#include <stdio.h>
+
+int main(void) {
+    int n = 1000;
+    int dentro = 0;
+    for (int y = 0; y < n; y++) {
+        float ci = 2.0f * y / n - 1.0f;
+        for (int x = 0; x < n; x++) {
+            float cr = 2.0f * x / n - 1.5f;
+            float zr = 0.0f, zi = 0.0f;
+            int k = 0;
+            for (; k < 50; k++) {
+                float zr2 = zr * zr, zi2 = zi * zi;
+                if (zr2 + zi2 > 4.0f) break;
+                zi = 2.0f * zr * zi + ci;
+                zr = zr2 - zi2 + cr;
+            }
+            if (k == 50) dentro++;
+        }
+    }
+    printf("%d\n", dentro);
+    return 0;
+}
@@ -0,0 +1,74 @@
+#include <stdio.h>
+#include <math.h>
+
+// Mesmo layout do nbody.rj: x, y, z, vx, vy, vz, massa por corpo
+static void avancar(float* b, int n, float dt) {
+    for (int i = 0; i < n; i++) {
+        float* p = b + i * 7;
+        for (int j = i + 1; j < n; j++) {
+            float* q = b + j * 7;
+            float dx = p[0] - q[0], dy = p[1] - q[1], dz = p[2] - q[2];
+            float d2 = dx * dx + dy * dy + dz * dz;
+            float mag = dt / (d2 * sqrtf(d2));
+            float mi = p[6] * mag, mj = q[6] * mag;
+            p[3] -= dx * mj;
+            p[4] -= dy * mj;
+            p[5] -= dz * mj;
+            q[3] += dx * mi;
+            q[4] += dy * mi;
+            q[5] += dz * mi;
+        }
+    }
+    for (int i = 0; i < n; i++) {
+        float* p = b + i * 7;
+        p[0] += dt * p[3];
+        p[1] += dt * p[4];
+        p[2] += dt * p[5];
+    }
+}
+
+static float energia(const float* b, int n) {
+    float e = 0.0f;
+    for (int i = 0; i < n; i++) {
+        const float* p = b + i * 7;
+        e += 0.5f * p[6] * (p[3] * p[3] + p[4] * p[4] + p[5] * p[5]);
+        for (int j = i + 1; j < n; j++) {
+            const float* q = b + j * 7;
+            float dx = p[0] - q[0], dy = p[1] - q[1], dz = p[2] - q[2];
+            e -= p[6] * q[6] / sqrtf(dx * dx + dy * dy + dz * dz);
+        }
+    }
+    return e;
+}
+
+int main(void) {
+    const float ano = 365.24f, massa_sol = 39.478418f;
+    float ini[5][7] = {
+        { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f },
+        { 4.841431f, -1.160320f, -0.103622f, 0.001660f, 0.007699f, -0.000069f, 0.000954f },
+        { 8.343367f, 4.124798f, -0.403523f, -0.002767f, 0.004998f, 0.000023f, 0.000286f },
+        { 12.894369f, -15.111151f, -0.223308f, 0.002964f, 0.002378f, -0.000030f, 0.000044f },
+        { 15.379697f, -25.919314f, 0.179259f, 0.002681f, 0.001628f, -0.000095f, 0.000052f },
+    };
+    int n = 5;
+    float b[5 * 7];
+    for (int i = 0; i < n; i++) {
+        for (int k = 0; k < 3; k++) {
+            b[i * 7 + k] = ini[i][k];
+            b[i * 7 + 3 + k] = ini[i][3 + k] * ano;
+        }
+        b[i * 7 + 6] = ini[i][6] * massa_sol;
+    }
+    float px = 0.0f, py = 0.0f, pz = 0.0f;
+    for (int i = 0; i < n; i++) {
+        px += b[i * 7 + 3] * b[i * 7 + 6];
+        py += b[i * 7 + 4] * b[i * 7 + 6];
+        pz += b[i * 7 + 5] * b[i * 7 + 6];
+    }
+    b[3] = -px / b[6];
+    b[4] = -py / b[6];
+    b[5] = -pz / b[6];
+    for (int s = 0; s < 5000000; s++) avancar(b, n, 0.01f);
+    printf("%d\n", (int)(energia(b, n) * 1000000.0f));
+    return 0;
+}
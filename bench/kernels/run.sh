@@ -0,0 +1,48 @@
+#!/bin/sh
+# Kernels em Rujo contra versões de referência em C escritas à mão. Os dois
+# lados passam pelo gcc com as mesmas opções que o "rujo build" usa; cada
+# executável roda R vezes (padrão 5) e fica a mediana do tempo de parede.
+# A razão rujo/C mostra onde o C gerado perde para o idiomático; saídas
+# diferentes são marcadas (ex: float promovido a double no lado Rujo).
+# Uso: bench/kernels/run.sh [kernel...] (a partir da raiz, após make)
+set -e
+DIR=$(cd "$(dirname "$0")" && pwd)
+RUJO=${RUJO:-$DIR/../../rujo}
+R=${R:-5}
+# Mesmas opções do gcc_cmd em src/main.c
+CFLAGS="-O2 -g"
+TMP=$(mktemp -d)
+trap 'rm -rf "$TMP"' EXIT
+cd "$TMP"
+
+kernels="$*"
+if [ -z "$kernels" ]; then
+    kernels="fib nbody spectral_norm mandelbrot strings hashing sorting"
+fi
+
+# Mediana de R execuções, em ms; a saída da última fica em $1.out
+medir() {
+    : > tempos.txt
+    i=0
+    while [ $i -lt "$R" ]; do
+        t0=$(date +%s%N)
+        "./$1" > "$1.out"
+        t1=$(date +%s%N)
+        echo $(((t1 - t0) / 1000)) >> tempos.txt
+        i=$((i + 1))
+    done
+    sort -n tempos.txt | awk '{ t[NR] = $1 } END { printf "%.1f\n", t[int((NR + 1) / 2)] / 1000 }'
+}
+
+printf "%-14s %10s %10s %7s\n" "kernel" "rujo ms" "C ms" "razao"
+for k in $kernels; do
+    "$RUJO" build "$DIR/$k.rj" > build.log || { cat build.log; exit 1; }
+    mv program.exe "$k.rujo"
+    gcc $CFLAGS "$DIR/$k.c" -o "$k.c.exe" -lm
+    a=$(medir "$k.rujo")
+    b=$(medir "$k.c.exe")
+    nota=""
+    cmp -s "$k.rujo.out" "$k.c.exe.out" || nota="  saida diferente: $(tr '\n' ' ' < "$k.rujo.out")/ $(tr '\n' ' ' < "$k.c.exe.out")"
+    awk -v k="$k" -v a="$a" -v b="$b" -v nota="$nota" \
+        'BEGIN { printf "%-14s %10.1f %10.1f %6.2fx%s\n", k, a, b, (b > 0 ? a / b : 0), nota }'
+done
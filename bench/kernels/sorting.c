@@ -0,0 +1,36 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+static void ordenar(int* a, int lo, int hi) {
+    if (lo >= hi) return;
+    int p = a[(lo + hi) / 2];
+    int i = lo, j = hi;
+    while (i <= j) {
+        while (a[i] < p) i++;
+        while (a[j] > p) j--;
+        if (i <= j) {
+            int t = a[i];
+            a[i++] = a[j];
+            a[j--] = t;
+        }
+    }
+    ordenar(a, lo, j);
+    ordenar(a, i, hi);
+}
+
+int main(void) {
+    int n = 2000000;
+    int* a = malloc(n * sizeof(int));
+    int64_t x = 42;
+    for (int i = 0; i < n; i++) {
+        x = x * 48271 % 2147483647;
+        a[i] = (int)(x / 2);
+    }
+    ordenar(a, 0, n - 1);
+    int fora = 0;
+    for (int i = 0; i + 1 < n; i++) fora += a[i] > a[i + 1];
+    printf("%d\n%d\n%d\n%d\n", fora, a[0], a[n / 2], a[n - 1]);
+    free(a);
+    return 0;
+}
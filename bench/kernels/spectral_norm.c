@@ -0,0 +1,51 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+static float a(int i, int j) {
+    int ij = i + j;
+    return 1.0f / (ij * (ij + 1) / 2 + i + 1);
+}
+
+static void mul_av(int n, const float* v, float* av) {
+    for (int i = 0; i < n; i++) {
+        float s = 0.0f;
+        for (int j = 0; j < n; j++) s += a(i, j) * v[j];
+        av[i] = s;
+    }
+}
+
+static void mul_atv(int n, const float* v, float* atv) {
+    for (int i = 0; i < n; i++) {
+        float s = 0.0f;
+        for (int j = 0; j < n; j++) s += a(j, i) * v[j];
+        atv[i] = s;
+    }
+}
+
+static void mul_atav(int n, const float* v, float* atav, float* tmp) {
+    mul_av(n, v, tmp);
+    mul_atv(n, tmp, atav);
+}
+
+int main(void) {
+    int n = 1000;
+    float* u = malloc(n * sizeof(float));
+    float* v = malloc(n * sizeof(float));
+    float* tmp = malloc(n * sizeof(float));
+    for (int i = 0; i < n; i++) u[i] = 1.0f;
+    for (int k = 0; k < 10; k++) {
+        mul_atav(n, u, v, tmp);
+        mul_atav(n, v, u, tmp);
+    }
+    float vbv = 0.0f, vv = 0.0f;
+    for (int i = 0; i < n; i++) {
+        vbv += u[i] * v[i];
+        vv += v[i] * v[i];
+    }
+    printf("%d\n", (int)(sqrtf(vbv / vv) * 1000000.0f));
+    free(u);
+    free(v);
+    free(tmp);
+    return 0;
+}
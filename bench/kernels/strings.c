@@ -0,0 +1,37 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+typedef struct {
+    char* data;
+    size_t len, cap;
+} Buf;
+
+static inline void push(Buf* b, char c) {
+    if (b->len == b->cap) {
+        b->cap = b->cap ? b->cap * 2 : 16;
+        b->data = realloc(b->data, b->cap);
+    }
+    b->data[b->len++] = c;
+}
+
+int main(void) {
+    int n = 5000000;
+    Buf buf = { 0 };
+    char dig[12];
+    for (int i = 0; i < n; i++) {
+        int v = i, k = 0;
+        if (v == 0) dig[k++] = '0';
+        while (v > 0) {
+            dig[k++] = (char)('0' + v % 10);
+            v /= 10;
+        }
+        while (k > 0) push(&buf, dig[--k]);
+        push(&buf, ',');
+    }
+    int64_t soma = 0;
+    for (size_t i = 0; i < buf.len; i++) soma += (unsigned char)buf.data[i];
+    printf("%zu\n%lld\n", buf.len, (long long)soma);
+    free(buf.data);
+    return 0;
+}
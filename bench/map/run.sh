@@ -0,0 +1,44 @@
+#!/bin/sh
+# Map<int, int> com capacidade 2^20 (reserve(917504)) em quatro cargas:
+# inserção, busca com acerto, busca com erro e remoção + reinserção, em ns por operação.
+# Rujo ainda não tem relógio: cada medida é um programa gerado (sed nos __X__)
+# e o tempo só da inserção é descontado. Uso: bench/map/run.sh (a partir da raiz, após make)
+set -e
+DIR=$(cd "$(dirname "$0")" && pwd)
+RUJO=${RUJO:-$DIR/../../rujo}
+R=${R:-10}
+TMP=$(mktemp -d)
+trap 'rm -rf "$TMP"' EXIT
+cd "$TMP"
+
+gerar() { # gerar <fonte> <saida> <n> <desvio>
+    sed -e "s/__N__/$3/g" -e "s/__R__/$R/g" -e "s/__DESVIO__/$4/g" "$DIR/$1.rj" > "$2.rj"
+    "$RUJO" build "$2.rj" > /dev/null
+    mv program.exe "$2"
+}
+
+medir() { # tempo em ns
+    start=$(date +%s%N)
+    "./$1" > /dev/null
+    end=$(date +%s%N)
+    echo $(( end - start ))
+}
+
+echo "carga    n        inserir  acerto   erro     remover  (ns/op)"
+for pct in 25 50 75 875; do
+    case $pct in
+        875) n=917504; carga=0.875 ;;
+        *) n=$(( 1048576 * pct / 100 )); carga=0.$pct ;;
+    esac
+    gerar inserir inserir $n 0
+    gerar buscar acerto $n 0
+    gerar buscar erro $n 1
+    gerar remover remover $n 0
+    base=$(medir inserir)
+    ops=$(( n * R ))
+    printf "%-8s %-8s %-8s %-8s %-8s %s\n" $carga $n \
+        $(( base / n )) \
+        $(( ($(medir acerto) - base) / ops )) \
+        $(( ($(medir erro) - base) / ops )) \
+        $(( ($(medir remover) - base) / (2 * ops) ))
+done
@@ -0,0 +1,109 @@
+#!/bin/sh
+# Cache dos .o dos módulos (.rujo/): cada mudança tem que recompilar só o
+# módulo alterado e, se a interface mudou, quem o importa. Um projeto com
+# geo/ponto.rj, util/mat.rj (não importa geo.ponto) e main.rj (importa os
+# dois) passa por edições e, depois de cada build, confere quais unidades
+# foram recompiladas (a .key da unidade muda) e a saída do programa. Cada
+# unidade só traz as classes e instâncias que usa: um campo novo em Ponto ou
+# uma List<int> nova no corpo de geo.ponto não recompilam util.mat.
+# Uso: bench/modulos/cache.sh (a partir da raiz, após make) ou make cache-modulos
+set -e
+DIR=$(cd "$(dirname "$0")" && pwd)
+RUJO=${RUJO:-$DIR/../../rujo}
+TMP=$(mktemp -d)
+trap 'rm -rf "$TMP"' EXIT
+cd "$TMP"
+
+mkdir geo util
+cat > geo/ponto.rj <<'RJ'
+module geo.ponto;
+
+fn quadrado(int v): int {
+    return v * v;
+}
+
+pub class Ponto {
+    prop int x;
+    prop int y;
+
+    init(int x, int y) {
+        this.x = x;
+        this.y = y;
+    }
+}
+
+pub fn distancia2(Ponto a, Ponto b): int {
+    return quadrado(a.x - b.x) + quadrado(a.y - b.y);
+}
+RJ
+cat > util/mat.rj <<'RJ'
+module util.mat;
+
+pub class Faixa {
+    prop int de;
+    prop int ate;
+
+    init(int de, int ate) {
+        this.de = de;
+        this.ate = ate;
+    }
+}
+
+pub fn soma(Faixa f): int {
+    int s = 0;
+    for (int i = f.de; i < f.ate; i = i + 1) { s = s + i; }
+    return s;
+}
+RJ
+cat > main.rj <<'RJ'
+import geo.ponto;
+import util.mat;
+
+Ponto a = new Ponto(0, 0);
+Ponto b = new Ponto(3, 4);
+print(distancia2(a, b));
+print(soma(new Faixa(0, 10)));
+RJ
+
+falhas=0
+unidades="m_geo.ponto m_util.mat m_main"
+
+# caso descricao saida recompiladas...: roda o build e confere o resultado
+caso() {
+    descricao=$1
+    saida=$2
+    shift 2
+    for u in $unidades; do cp ".rujo/$u.key" "$u.antes" 2>/dev/null || : > "$u.antes"; done
+    "$RUJO" run main.rj > run.log 2>&1 || { echo "FALHA $descricao: build"; cat run.log; falhas=$((falhas + 1)); return; }
+    mudaram=
+    for u in $unidades; do cmp -s ".rujo/$u.key" "$u.antes" || mudaram="$mudaram $u"; done
+    obtida=$(grep -v '^Sucesso' run.log | tr '\n' ' ')
+    if [ "$mudaram" = "$*" ] || [ "$mudaram" = " $*" ]; then
+        if [ "$obtida" = "$saida" ]; then
+            printf "ok    %-36s recompiladas:%s\n" "$descricao" "${mudaram:- nenhuma}"
+            return
+        fi
+    fi
+    printf "FALHA %-36s recompiladas:%s (esperado: %s), saida '%s' (esperado '%s')\n" \
+        "$descricao" "${mudaram:- nenhuma}" "${*:-nenhuma}" "$obtida" "$saida"
+    falhas=$((falhas + 1))
+}
+
+caso "primeiro build" "25 45 " m_geo.ponto m_util.mat m_main
+caso "sem mudancas" "25 45 "
+# Uma linha a mais numa fn privada: a classe Ponto, abaixo dela, desce uma linha
+sed 's/    return v \* v;/    int q = v * v;\n    return q;/' geo/ponto.rj > tmp.rj && mv tmp.rj geo/ponto.rj
+caso "corpo de fn privada" "25 45 " m_geo.ponto
+# Nova fn pub: quem importa geo.ponto vê o protótipo novo
+printf '\npub fn origem(): Ponto {\n    return new Ponto(0, 0);\n}\n' >> geo/ponto.rj
+caso "nova fn pub" "25 45 " m_geo.ponto m_main
+sed 's/s = s + i;/s = s + i * 2;/' util/mat.rj > tmp.rj && mv tmp.rj util/mat.rj
+caso "corpo de fn pub em util.mat" "25 90 " m_util.mat
+# Campo novo em Ponto: muda a struct de quem importa geo.ponto; util.mat não a vê
+sed 's/    prop int y;/    prop int y;\n    prop int z;/' geo/ponto.rj > tmp.rj && mv tmp.rj geo/ponto.rj
+caso "campo novo numa classe pub" "25 90 " m_geo.ponto m_main
+# List<int> num corpo privado: a instância nova só entra na unidade de geo.ponto
+sed 's/    int q = v \* v;/    List<int> l = new List<int>();\n    l.push(v * v);\n    int q = l.get(0);/' geo/ponto.rj > tmp.rj && mv tmp.rj geo/ponto.rj
+caso "List<int> num corpo privado" "25 90 " m_geo.ponto
+
+[ $falhas -eq 0 ] || exit 1
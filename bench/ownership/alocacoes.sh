@@ -0,0 +1,158 @@
+#!/bin/sh
+# Balanço do heap com RUJO_ALLOC_STATS=1: cada programa tem que terminar com
+# tantas liberações quanto alocações (nada vaza, nada é liberado duas vezes)
+# e imprimir a saída esperada. Cobre moves para Ok/Err, Result com heap nos
+# caminhos de Ok, de Err e do ?, e o número de alocações quando a cópia vira move.
+# Uso: bench/ownership/alocacoes.sh (a partir da raiz, após make) ou make alocacoes
+set -e
+DIR=$(cd "$(dirname "$0")" && pwd)
+RUJO=${RUJO:-$DIR/../../rujo}
+TMP=$(mktemp -d)
+trap 'rm -rf "$TMP"' EXIT
+cd "$TMP"
+
+falhas=0
+
+# caso descricao saida [alocacoes]: compila o programa da entrada padrão e
+# confere a saída, o balanço e (se dado) o total de alocações
+caso() {
+    descricao=$1
+    esperado=$2
+    total=$3
+    cat > caso.rj
+    if ! "$RUJO" build caso.rj > build.log 2>&1; then
+        printf "FALHA %s: build\n" "$descricao"
+        cat build.log
+        falhas=$((falhas + 1))
+        return
+    fi
+    RUJO_ALLOC_STATS=1 ./program.exe > run.log 2> stats.log || :
+    obtida=$(tr '\n' ' ' < run.log)
+    allocs=$(sed -n 's/.*alocacoes: \([0-9]*\), liberacoes: \([0-9]*\).*/\1/p' stats.log)
+    frees=$(sed -n 's/.*alocacoes: \([0-9]*\), liberacoes: \([0-9]*\).*/\2/p' stats.log)
+    if [ "$obtida" = "$esperado" ] && [ -n "$allocs" ] && [ "$allocs" = "$frees" ] &&
+       { [ -z "$total" ] || [ "$allocs" = "$total" ]; }; then
+        printf "ok    %-34s alocacoes: %s, liberacoes: %s\n" "$descricao" "$allocs" "$frees"
+    else
+        printf "FALHA %-34s alocacoes: %s, liberacoes: %s (esperado %s), saida '%s' (esperado '%s')\n" \
+            "$descricao" "$allocs" "$frees" "${total:-iguais}" "$obtida" "$esperado"
+        falhas=$((falhas + 1))
+    fi
+}
+
+# return Ok(v): o array passa para o Result sem cópia e sem ser liberado antes
+caso "Ok com heap" "7 " 1 <<'RJ'
+fn criar(int n): Result<int[], string> {
+    int[] v = new int[n];
+    v[0] = 7;
+    return Ok(v);
+}
+int[] x = criar(4).unwrap();
+print(x[0]);
+RJ
+
+caso "Err com heap" "true 9 " 1 <<'RJ'
+fn falhar(): Result<int, int[]> {
+    int[] e = new int[3];
+    e[0] = 9;
+    return Err(e);
+}
+Result<int, int[]> r = falhar();
+print(r.is_err());
+int[] e = r.error();
+print(e[0]);
+RJ
+
+caso "Result fora de escopo" "true true " 2 <<'RJ'
+fn criar(int n): Result<int[], string> {
+    int[] v = new int[n];
+    return Ok(v);
+}
+fn falhar(): Result<int, int[]> {
+    int[] e = new int[3];
+    return Err(e);
+}
+Result<int[], string> r = criar(5);
+print(r.is_ok());
+Result<int, int[]> f = falhar();
+print(f.is_err());
+RJ
+
+# O primeiro unwrap não é o último uso: copia; o segundo move
+caso "dois unwraps" "12 " 2 <<'RJ'
+fn criar(int n): Result<int[], string> {
+    int[] v = new int[n];
+    v[0] = n;
+    return Ok(v);
+}
+Result<int[], string> q = criar(6);
+int[] x = q.unwrap();
+int[] y = q.unwrap();
+print(x[0] + y[0]);
+RJ
+
+caso "unwrap_or nos dois caminhos" "5 1 " <<'RJ'
+fn criar(int n): Result<int[], string> {
+    int[] v = new int[n];
+    v[0] = n;
+    if (n > 100) {
+        return Err("grande");
+    }
+    return Ok(v);
+}
+int[] a = new int[1];
+int[] b = new int[1];
+b[0] = 1;
+int[] x = criar(5).unwrap_or(a);
+int[] y = criar(500).unwrap_or(b);
+print(x[0]);
+print(y[0]);
+RJ
+
+# O Err propagado por ? libera o que estava vivo na função
+caso "? nos caminhos de Ok e de Err" "9 true " <<'RJ'
+fn criar(int n): Result<int[], string> {
+    int[] v = new int[n];
+    v[0] = n;
+    if (n > 100) {
+        return Err("grande");
+    }
+    return Ok(v);
+}
+fn somar(int n): Result<int, string> {
+    List<int> viva = new List<int>();
+    viva.push(n);
+    int[] a = criar(n)?;
+    return Ok(a[0] + viva.len());
+}
+print(somar(8).unwrap());
+Result<int, string> r = somar(500);
+print(r.is_err());
+RJ
+
+caso "? dentro de laco" "true " <<'RJ'
+fn criar(int n): Result<int[], string> {
+    int[] v = new int[n];
+    if (n > 2) {
+        return Err("grande");
+    }
+    return Ok(v);
+}
+fn contar(): Result<int, string> {
+    int n = 0;
+    for (int i = 0; i < 10; i = i + 1) {
+        int[] guarda = new int[2];
+        int[] a = criar(i)?;
+        n = n + 1;
+    }
+    return Ok(n);
+}
+print(contar().is_err());
+RJ
+
+# Move elidindo cópias: o exemplo do README (criar + a cópia explícita de b)
+caso "snippet de ownership" "45 0 145 100 50 999 " <<RJ
+$(cat "$DIR/../../snippets/teste_ownership.rj")
+RJ
+
+[ $falhas -eq 0 ] || exit 1
@@ -0,0 +1,21 @@
+// Os helpers de print anteriores (printf por chamada) com os mesmos laços de ints.rj e floats.rj.
+// Uso: printf_ref ints | printf_ref floats
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+void print_int(int x) { printf("%d\n", x); }
+void print_float(float x) { printf("%f\n", x); }
+
+int main(int argc, char** argv) {
+    if (argc > 1 && strcmp(argv[1], "floats") == 0) {
+        float x = 0.37f;
+        for (int i = 0; i < 2000000; i = i + 1) {
+            print_float(x);
+            x = x + 1.13f;
+        }
+    } else {
+        for (int i = 0; i < 5000000; i = i + 1) print_int(i * 7 - 1000000);
+    }
+    return 0;
+}
@@ -0,0 +1,28 @@
+#!/bin/sh
+# Vazão de print(): runtime com buffer + write(2) vs. os helpers antigos com printf.
+# Saída para /dev/null e para um arquivo. Uso: bench/print/run.sh (a partir da raiz, após make)
+set -e
+DIR=$(cd "$(dirname "$0")" && pwd)
+RUJO=${RUJO:-$DIR/../../rujo}
+TMP=$(mktemp -d)
+trap 'rm -rf "$TMP"' EXIT
+
+cd "$TMP"
+for name in ints floats; do
+    "$RUJO" build "$DIR/$name.rj" > /dev/null
+    mv program.exe "$name"
+done
+gcc -O2 "$DIR/printf.c" -o printf_ref
+
+medir() {
+    start=$(date +%s%N)
+    "$@" > "$DEST"
+    end=$(date +%s%N)
+    echo $(( (end - start) / 1000000 ))
+}
+
+for DEST in /dev/null "$TMP/saida.txt"; do
+    echo "destino: $DEST"
+    echo "  ints   (5M): rujo $(medir ./ints) ms, printf $(medir ./printf_ref ints) ms"
+    echo "  floats (2M): rujo $(medir ./floats) ms, printf $(medir ./printf_ref floats) ms"
+done
@@ -0,0 +1,36 @@
+// Referência em C no estilo errno para o mesmo laço de result.rj
+#include <errno.h>
+#include <stdio.h>
+
+static int paridade(int i) {
+    if (i < 0) {
+        errno = EINVAL;
+        return 0;
+    }
+    return i - i / 2 * 2;
+}
+
+static int soma_paridades(int n, int* ok) {
+    int soma = 0;
+    for (int i = 0; i < n; i = i + 1) {
+        errno = 0;
+        int v = paridade(i);
+        if (errno != 0) {
+            *ok = 0;
+            return 0;
+        }
+        soma = soma + v;
+    }
+    *ok = 1;
+    return soma;
+}
+
+int main(void) {
+    for (int rep = 0; rep < 10; rep = rep + 1) {
+        int ok;
+        int r = soma_paridades(100000000, &ok);
+        if (!ok) return 1;
+        printf("%d\n", r);
+    }
+    return 0;
+}
@@ -0,0 +1,20 @@
+#!/bin/sh
+# Compara Result<T, E> + ? (gerado pelo rujo) com o estilo errno em C.
+# Os dois lados usam gcc -O2. Uso: bench/result/run.sh (a partir da raiz, após make)
+set -e
+DIR=$(cd "$(dirname "$0")" && pwd)
+RUJO=${RUJO:-$DIR/../../rujo}
+TMP=$(mktemp -d)
+trap 'rm -rf "$TMP"' EXIT
+
+cd "$TMP"
+"$RUJO" build "$DIR/result.rj" > /dev/null
+mv program.exe result_rujo
+gcc -O2 "$DIR/errno.c" -o result_errno
+
+for bin in result_rujo result_errno; do
+    start=$(date +%s%N)
+    ./$bin > /dev/null
+    end=$(date +%s%N)
+    echo "$bin: $(( (end - start) / 1000000 )) ms"
+done
@@ -2,14 +2,316 @@
 #include <stdlib.h>
 #include <stdint.h>
 #include <stdbool.h>
+#include <string.h>
+#include <limits.h>
 
-void print_int(int x) { printf("%d\n", x); }
-void print_float(float x) { printf("%f\n", x); }
-void print_string(const char* x) { printf("%s\n", x); }
-void print_bool(bool x) { printf("%s\n", x ? "true" : "false"); }
+#define RUJO_GLOBAL static
+#define RUJO_SHARED static
+
+#define RUJO_MIN(a, b) ({ __auto_type _a = (a); __auto_type _b = (b); _a < _b ? _a : _b; })
+#define RUJO_MAX(a, b) ({ __auto_type _a = (a); __auto_type _b = (b); _a > _b ? _a : _b; })
+
+RUJO_GLOBAL long rujo_allocs = 0, rujo_frees = 0;
+#define RUJO_COUNT(c) ((c)++)
+static void rujo_alloc_report(void) { fprintf(stderr, "[rujo] alocacoes: %ld, liberacoes: %ld\n", rujo_allocs, rujo_frees); }
+
+typedef struct RujoChunk { struct RujoChunk* next; size_t cap; size_t used; size_t _pad; } RujoChunk;
+typedef struct RujoArena { RujoChunk* head; RujoChunk* tail; struct RujoArena* prev; } RujoArena;
+RUJO_GLOBAL _Thread_local RujoArena* rujo_arena = NULL;
+RUJO_GLOBAL _Thread_local RujoChunk* rujo_chunk_cache = NULL;
+#define RUJO_CHUNK_MIN (64 * 1024)
+
+static void* rujo_arena_alloc(RujoArena* a, size_t n) {
+    size_t need = ((n + 15) & ~(size_t)15) + 16;
+    RujoChunk* c = a->head;
+    if (__builtin_expect(!c || c->used + need > c->cap, 0)) {
+        size_t cap = need > RUJO_CHUNK_MIN ? need : RUJO_CHUNK_MIN;
+        c = rujo_chunk_cache;
+        if (c && c->cap >= cap) {
+            rujo_chunk_cache = c->next;
+        } else {
+            c = malloc(sizeof(RujoChunk) + cap);
+            c->cap = cap;
+        }
+        c->used = 0;
+        c->next = a->head;
+        a->head = c;
+        if (!a->tail) a->tail = c;
+    }
+    char* p = (char*)(c + 1) + c->used;
+    c->used += need;
+    *(size_t*)p = n;
+    memset(p + 16, 0, n);
+    return p + 16;
+}
+
+static RujoArena* rujo_arena_of(const void* p) {
+    for (RujoArena* a = rujo_arena; a; a = a->prev) {
+        for (RujoChunk* c = a->head; c; c = c->next) {
+            const char* d = (const char*)(c + 1);
+            if ((const char*)p >= d && (const char*)p < d + c->cap) return a;
+        }
+    }
+    return NULL;
+}
+
+static inline void rujo_arena_begin(RujoArena* a) { a->head = a->tail = NULL; a->prev = rujo_arena; rujo_arena = a; }
+static inline void rujo_arena_end(RujoArena* a) {
+    if (a->tail) { a->tail->next = rujo_chunk_cache; rujo_chunk_cache = a->head; }
+    rujo_arena = a->prev;
+}
+
+static inline void* rujo_alloc(size_t n) {
+    if (rujo_arena) return rujo_arena_alloc(rujo_arena, n);
+    RUJO_COUNT(rujo_allocs);
+    return calloc(1, n ? n : 1);
+}
+static inline void* rujo_realloc(void* p, size_t n) {
+    RujoArena* a = p ? (rujo_arena ? rujo_arena_of(p) : NULL) : rujo_arena;
+    if (a) {
+        void* q = rujo_arena_alloc(a, n);
+        if (p) { size_t old = *(size_t*)((char*)p - 16); memcpy(q, p, old < n ? old : n); }
+        return q;
+    }
+    if (!p) RUJO_COUNT(rujo_allocs);
+    return realloc(p, n);
+}
+static inline void rujo_free(void* p) {
+    if (!p || (rujo_arena && rujo_arena_of(p))) return;
+    RUJO_COUNT(rujo_frees);
+    free(p);
+}
+
+typedef struct { int64_t len; int64_t map; } RujoArrayHeader;
+static inline void* rujo_array_new(int64_t n, size_t elem) {
+    RujoArrayHeader* h = rujo_alloc(sizeof(RujoArrayHeader) + (size_t)n * elem);
+    h->len = n;
+    h->map = 0;
+    return h + 1;
+}
+static inline int64_t rujo_array_len(const void* a) { return a ? ((const RujoArrayHeader*)a - 1)->len : 0; }
+static inline void rujo_array_free(void* a) { if (a) rujo_free((RujoArrayHeader*)a - 1); }
+static inline void* rujo_array_clone(const void* a, size_t elem) {
+    if (!a) return NULL;
+    void* c = rujo_array_new(rujo_array_len(a), elem);
+    memcpy(c, a, (size_t)rujo_array_len(a) * elem);
+    return c;
+}
+
+#include <unistd.h>
+#include <errno.h>
+
+// Saída de print(): buffer de 64 KB escrito com write(2) no fd 1 quando enche,
+// em flush() e na saída do programa. Num terminal cada print vai direto.
+#define RUJO_OUT_CAP (64 * 1024)
+RUJO_GLOBAL char rujo_out_buf[RUJO_OUT_CAP];
+RUJO_GLOBAL size_t rujo_out_len = 0;
+RUJO_GLOBAL bool rujo_out_tty = false;
+
+// Com tarefas, várias threads imprimem: um spinlock curto protege o buffer
+#ifdef RUJO_OUT_THREADS
+#include <sched.h>
+RUJO_GLOBAL char rujo_out_busy = 0;
+#define RUJO_OUT_LOCK() while (__atomic_test_and_set(&rujo_out_busy, __ATOMIC_ACQUIRE)) sched_yield()
+#define RUJO_OUT_UNLOCK() __atomic_clear(&rujo_out_busy, __ATOMIC_RELEASE)
+#else
+#define RUJO_OUT_LOCK() ((void)0)
+#define RUJO_OUT_UNLOCK() ((void)0)
+#endif
+
+static void rujo_out_write(const char* p, size_t n) {
+    while (n > 0) {
+        ssize_t w = write(1, p, n);
+        if (w < 0) {
+            if (errno == EINTR) continue;
+            return; // stdout fechado (EPIPE etc.): descarta como o stdio
+        }
+        p += w;
+        n -= (size_t)w;
+    }
+}
+
+static void rujo_out_drain(void) {
+    rujo_out_write(rujo_out_buf, rujo_out_len);
+    rujo_out_len = 0;
+}
+
+static void rujo_out_flush(void) {
+    RUJO_OUT_LOCK();
+    rujo_out_drain();
+    RUJO_OUT_UNLOCK();
+}
+
+static void rujo_out_init(void) {
+    rujo_out_tty = isatty(1);
+    atexit(rujo_out_flush);
+}
+
+// Acrescenta texto + '\n' ao buffer (texto maior que o buffer vai direto)
+static void rujo_out_line(const char* s, size_t n) {
+    RUJO_OUT_LOCK();
+    if (__builtin_expect(rujo_out_len + n + 1 > RUJO_OUT_CAP, 0)) {
+        rujo_out_drain();
+        if (n + 1 > RUJO_OUT_CAP) {
+            rujo_out_write(s, n);
+            rujo_out_write("\n", 1);
+            RUJO_OUT_UNLOCK();
+            return;
+        }
+    }
+    memcpy(rujo_out_buf + rujo_out_len, s, n);
+    rujo_out_buf[rujo_out_len + n] = '\n';
+    rujo_out_len += n + 1;
+    if (rujo_out_tty) rujo_out_drain();
+    RUJO_OUT_UNLOCK();
+}
+
+static const char rujo_digits2[201] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+    "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+// Escreve v em decimal terminando em end; devolve o início
+static char* rujo_fmt_u64(char* end, uint64_t v) {
+    while (v >= 100) {
+        end -= 2;
+        memcpy(end, rujo_digits2 + (v % 100) * 2, 2);
+        v /= 100;
+    }
+    if (v >= 10) {
+        end -= 2;
+        memcpy(end, rujo_digits2 + v * 2, 2);
+    } else {
+        *--end = (char)('0' + v);
+    }
+    return end;
+}
+
+static void print_long(int64_t x) {
+    char buf[24];
+    char* end = buf + sizeof(buf);
+    uint64_t u = x < 0 ? (uint64_t)0 - (uint64_t)x : (uint64_t)x;
+    char* p = rujo_fmt_u64(end, u);
+    if (x < 0) *--p = '-';
+    rujo_out_line(p, (size_t)(end - p));
+}
+
+static void print_int(int x) { print_long(x); }
+
+// v * 10^k em double; potências até 10^22 são exatas
+static double rujo_scale10(double v, int k) {
+    static const double p10[23] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+    if (k >= 0) {
+        while (k > 22) { v *= 1e22; k -= 22; }
+        return v * p10[k];
+    }
+    k = -k;
+    while (k > 22) { v /= 1e22; k -= 22; }
+    return v / p10[k];
+}
+
+// Menor sequência de dígitos que relida volta ao mesmo float. O float cabe
+// exato num double e o double tem folga de ~29 bits, então escalar por 10^k
+// e reconverter decide certo sem aritmética de precisão múltipla.
+static int rujo_float_digits(float x, char* digits, int* exp10) {
+    double v = x;
+    uint32_t bits;
+    memcpy(&bits, &x, sizeof(bits));
+    int e2 = (int)((bits >> 23) & 255) - 127;
+    int e10 = (e2 * 78913) >> 18; // floor(e2 * log10(2)), pode errar por 1
+    while (rujo_scale10(v, -e10) >= 10.0) e10++;
+    while (rujo_scale10(v, -e10) < 1.0) e10--;
+
+    uint64_t m = 0;
+    int p;
+    for (p = 1; p <= 9; p++) {
+        double s = rujo_scale10(v, p - 1 - e10);
+        m = (uint64_t)(s + 0.5);
+        int e = e10;
+        if (m >= (uint64_t)rujo_scale10(1.0, p)) { m /= 10; e++; }
+        if ((float)rujo_scale10((double)m, e - p + 1) == x) {
+            e10 = e;
+            break;
+        }
+    }
+    if (p > 9) p = 9;
+    while (p > 1 && m % 10 == 0) { m /= 10; p--; }
+    char buf[24];
+    char* end = buf + sizeof(buf);
+    char* s = rujo_fmt_u64(end, m);
+    memcpy(digits, s, (size_t)(end - s));
+    *exp10 = e10;
+    return (int)(end - s);
+}
+
+// Notação fixa entre 1e-5 e 1e16 (sempre com parte decimal), científica fora
+static void print_float(float x) {
+    char buf[48];
+    char* p = buf;
+    if (x != x) {
+        rujo_out_line("nan", 3);
+        return;
+    }
+    if (x < 0 || (x == 0 && 1.0f / x < 0)) {
+        *p++ = '-';
+        x = -x;
+    }
+    if (x == 0) {
+        memcpy(p, "0.0", 3);
+        rujo_out_line(buf, (size_t)(p - buf) + 3);
+        return;
+    }
+    if (__builtin_isinf(x)) {
+        memcpy(p, "inf", 3);
+        rujo_out_line(buf, (size_t)(p - buf) + 3);
+        return;
+    }
+    char d[12];
+    int e;
+    int n = rujo_float_digits(x, d, &e);
+    if (e >= 16 || e < -5) {
+        *p++ = d[0];
+        if (n > 1) {
+            *p++ = '.';
+            memcpy(p, d + 1, (size_t)n - 1);
+            p += n - 1;
+        }
+        *p++ = 'e';
+        *p++ = e < 0 ? '-' : '+';
+        if (e < 0) e = -e;
+        if (e < 10) *p++ = '0';
+        char* end = buf + sizeof(buf);
+        char* s = rujo_fmt_u64(end, (uint64_t)e);
+        memmove(p, s, (size_t)(end - s));
+        p += end - s;
+    } else if (e >= 0) {
+        for (int i = 0; i <= e; i++) *p++ = i < n ? d[i] : '0';
+        *p++ = '.';
+        if (n > e + 1) {
+            memcpy(p, d + e + 1, (size_t)(n - e - 1));
+            p += n - e - 1;
+        } else {
+            *p++ = '0';
+        }
+    } else {
+        *p++ = '0';
+        *p++ = '.';
+        for (int i = 0; i < -e - 1; i++) *p++ = '0';
+        memcpy(p, d, (size_t)n);
+        p += n;
+    }
+    rujo_out_line(buf, (size_t)(p - buf));
+}
+
+static void print_string(const char* x) { rujo_out_line(x, strlen(x)); }
+static void print_bool(bool x) { if (x) rujo_out_line("true", 4); else rujo_out_line("false", 5); }
 
 #define RUJO_PRINT(x) _Generic((x), \
     int: print_int, \
+    int64_t: print_long, \
     float: print_float, \
     double: print_float, \
     bool: print_bool, \
@@ -21,6 +323,7 @@ void print_bool(bool x) { printf("%s\n", x ? "true" : "false"); }
     _Bool: "bool", \
     uint8_t: "byte", \
     int: "int", \
+    int64_t: "long", \
     float: "float", \
     double: "float", \
     uint32_t: "char", \
@@ -29,30 +332,24 @@ void print_bool(bool x) { printf("%s\n", x ? "true" : "false"); }
     default: "unknown" \
 )
 
+
+
+
+#line 1 "/root/repo/snippets/teste_var.rj"
 int main() {
-RUJO_PRINT("--- Testando WHILE ---");
-int contador = 0;
-while ((contador < 3)) {
-RUJO_PRINT("Contagem While:");
-RUJO_PRINT(contador);
-contador = (contador + 1);
-}
-RUJO_PRINT("--- Testando FOR ---");
-for (int i = 0;
- (i < 5); i = (i + 1)) {
-RUJO_PRINT("Iteracao For:");
-RUJO_PRINT(i);
-}
-RUJO_PRINT("--- Teste de Logica Complexa ---");
-int soma = 0;
-for (int j = 0;
- (j < 5); j = (j + 1)) {
-soma = (soma + j);
-}
-RUJO_PRINT("A soma de 0 a 4 deve ser 10. Resultado:");
-RUJO_PRINT(soma);
-if ((soma == 10)) {
-RUJO_PRINT("Sucesso Total nos Loops!");
-}
+    if (getenv("RUJO_ALLOC_STATS")) atexit(rujo_alloc_report);
+    rujo_out_init();
+
+#line 1 "/root/repo/snippets/teste_var.rj"
+int idade = 25;
+
+#line 2 "/root/repo/snippets/teste_var.rj"
+const char* nome = "Gura";
+
+#line 3 "/root/repo/snippets/teste_var.rj"
+int nivel = 100;
+
+#line 4 "/root/repo/snippets/teste_var.rj"
+bool seraQueE = true;
     return 0;
 }
@@ -1,12 +1,35 @@
 #include "ast.h"
+#include "utils.h"
+#include "stats.h"
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
 
+static int pos_line = 0, pos_col = 0;
+
+void ast_set_pos(int line, int col) {
+    pos_line = line;
+    pos_col = col;
+}
+
+// Nós que começam por uma subexpressão (a.b, a[i], a + b, a = b) ficam na posição dela
+static void pos_from(ASTNode* node, ASTNode* first) {
+    if (!first) return;
+    node->line = first->line;
+    node->col = first->col;
+}
+
 ASTNode* create_node(ASTNodeType type) {
-    ASTNode* node = (ASTNode*)malloc(sizeof(ASTNode));
+    ASTNode* node = (ASTNode*)region_alloc(sizeof(ASTNode));
     node->type = type;
     node->next = NULL;
+    node->annotations = NULL;
+    node->eval_type = NULL;
+    node->ownership = OWN_NONE;
+    node->drops = NULL;
+    node->line = pos_line;
+    node->col = pos_col;
+    stat_add(STAT_NODES, 1);
     return node;
 }
 
@@ -18,9 +41,10 @@ ASTNode* ast_new_program(ASTNode* statements) {
 
 ASTNode* ast_new_var_decl(char* name, char* type, ASTNode* value) {
     ASTNode* node = create_node(AST_VAR_DECL);
-    node->data.var_decl.name = strdup(name);
-    node->data.var_decl.type_name = strdup(type);
+    node->data.var_decl.name = rujo_strdup(name);
+    node->data.var_decl.type_name = rujo_strdup(type);
     node->data.var_decl.value = value;
+    node->data.var_decl.borrowed = false;
     return node;
 }
 
@@ -41,7 +65,7 @@ ASTNode* ast_new_literal_float(double value) {
 ASTNode* ast_new_literal_string(char* value) {
     ASTNode* node = create_node(AST_LITERAL);
     node->data.literal.type = LIT_STRING;
-    node->data.literal.string_val = strdup(value);
+    node->data.literal.string_val = rujo_strdup(value);
     return node;
 }
 
@@ -61,25 +85,31 @@ ASTNode* ast_new_literal_char(uint32_t value) {
 
 ASTNode* ast_new_prop_decl(char* name, char* type) {
     ASTNode* node = create_node(AST_PROP_DECL);
-    node->data.var_decl.name = strdup(name);
-    node->data.var_decl.type_name = strdup(type);
+    node->data.var_decl.name = rujo_strdup(name);
+    node->data.var_decl.type_name = rujo_strdup(type);
     node->data.var_decl.value = NULL;
     return node;
 }
 
 ASTNode* ast_new_class_decl(char* name, ASTNode* members) {
     ASTNode* node = create_node(AST_CLASS_DECL);
-    node->data.class_decl.name = strdup(name);
+    node->data.class_decl.name = rujo_strdup(name);
     node->data.class_decl.members = members;
+    node->data.class_decl.type_params = NULL;
+    node->data.class_decl.module = 0;
+    node->data.class_decl.is_pub = false;
     return node;
 }
 
 ASTNode* ast_new_fn_decl(char* name, char* ret_type, ASTNode* params, ASTNode* body) {
     ASTNode* node = create_node(AST_FN_DECL);
-    node->data.fn_decl.name = strdup(name);
-    node->data.fn_decl.return_type = strdup(ret_type);
+    node->data.fn_decl.name = rujo_strdup(name);
+    node->data.fn_decl.return_type = rujo_strdup(ret_type);
     node->data.fn_decl.params = params;
     node->data.fn_decl.body = body;
+    node->data.fn_decl.type_params = NULL;
+    node->data.fn_decl.module = 0;
+    node->data.fn_decl.is_pub = false;
     return node;
 }
 
@@ -93,26 +123,29 @@ ASTNode* ast_new_assign(ASTNode* target, ASTNode* value) {
     ASTNode* node = create_node(AST_ASSIGN);
     node->data.assign.target = target;
     node->data.assign.value = value;
+    pos_from(node, target);
     return node;
 }
 
 ASTNode* ast_new_access(ASTNode* object, char* member_name) {
     ASTNode* node = create_node(AST_ACCESS);
     node->data.access.object = object;
-    node->data.access.member_name = strdup(member_name);
+    node->data.access.member_name = rujo_strdup(member_name);
+    pos_from(node, object);
     return node;
 }
 
 ASTNode* ast_new_ident(char* name) {
     ASTNode* node = create_node(AST_IDENTIFIER);
-    node->data.ident.name = strdup(name);
+    node->data.ident.name = rujo_strdup(name);
     return node;
 }
 
 ASTNode* ast_new_call(char* name, ASTNode* args) {
     ASTNode* node = create_node(AST_CALL);
-    node->data.call.name = strdup(name);
+    node->data.call.name = rujo_strdup(name);
     node->data.call.args = args;
+    node->data.call.type_args = NULL;
     return node;
 }
 
@@ -125,8 +158,9 @@ ASTNode* ast_new_typeof(ASTNode* expr) {
 ASTNode* ast_new_binary_op(ASTNode* left, char* op, ASTNode* right) {
     ASTNode* node = create_node(AST_BINARY_OP);
     node->data.binary_op.left = left;
-    node->data.binary_op.op = strdup(op);
+    node->data.binary_op.op = rujo_strdup(op);
     node->data.binary_op.right = right;
+    pos_from(node, left);
     return node;
 }
 
@@ -158,16 +192,429 @@ ASTNode* ast_new_for(ASTNode* init, ASTNode* condition, ASTNode* step, ASTNode*
     node->data.for_loop.condition = condition;
     node->data.for_loop.step = step;
     node->data.for_loop.body = body;
+    node->data.for_loop.captures = NULL;
+    node->data.for_loop.reductions = NULL;
+    node->data.for_loop.id = -1;
+    return node;
+}
+
+ASTNode* ast_new_annotation(char* name) {
+    ASTNode* node = create_node(AST_ANNOTATION);
+    node->data.annotation.name = rujo_strdup(name);
+    return node;
+}
+
+ASTNode* ast_new_index(ASTNode* array, ASTNode* index) {
+    ASTNode* node = create_node(AST_INDEX);
+    node->data.index.array = array;
+    node->data.index.index = index;
+    pos_from(node, array);
+    return node;
+}
+
+ASTNode* ast_new_new_array(char* elem_type, ASTNode* size) {
+    ASTNode* node = create_node(AST_NEW_ARRAY);
+    node->data.new_array.elem_type = rujo_strdup(elem_type);
+    node->data.new_array.size = size;
+    return node;
+}
+
+ASTNode* ast_new_new(char* type_name, ASTNode* args) {
+    ASTNode* node = create_node(AST_NEW);
+    node->data.new_obj.type_name = rujo_strdup(type_name);
+    node->data.new_obj.args = args;
+    return node;
+}
+
+ASTNode* ast_new_method_call(ASTNode* object, char* name, ASTNode* args) {
+    ASTNode* node = create_node(AST_METHOD_CALL);
+    node->data.method_call.object = object;
+    node->data.method_call.name = rujo_strdup(name);
+    node->data.method_call.args = args;
+    pos_from(node, object);
+    return node;
+}
+
+ASTNode* ast_new_try(ASTNode* expr) {
+    ASTNode* node = create_node(AST_TRY);
+    node->data.try_expr.expr = expr;
+    node->data.try_expr.fn_return_type = NULL;
+    return node;
+}
+
+ASTNode* ast_new_arena(ASTNode* body) {
+    ASTNode* node = create_node(AST_ARENA);
+    node->data.arena.body = body;
+    return node;
+}
+
+ASTNode* ast_new_bench(char* name, ASTNode* body) {
+    ASTNode* node = create_node(AST_BENCH);
+    node->data.bench.name = rujo_strdup(name);
+    node->data.bench.body = body;
+    node->data.bench.inputs = NULL;
+    return node;
+}
+
+ASTNode* ast_new_spawn(ASTNode* call) {
+    ASTNode* node = create_node(AST_SPAWN);
+    node->data.spawn.call = call;
+    node->data.spawn.id = -1;
+    node->data.spawn.blocking = false;
+    return node;
+}
+
+ASTNode* ast_new_yield(ASTNode* value) {
+    ASTNode* node = create_node(AST_YIELD);
+    node->data.yield.value = value;
+    node->data.yield.state = 0;
+    return node;
+}
+
+ASTNode* ast_new_for_in(char* var_type, char* var_name, ASTNode* source, ASTNode* body) {
+    ASTNode* node = create_node(AST_FOR_IN);
+    node->data.for_in.var_type = rujo_strdup(var_type);
+    node->data.for_in.var_name = rujo_strdup(var_name);
+    node->data.for_in.val_name = NULL;
+    node->data.for_in.val_type = NULL;
+    node->data.for_in.source = source;
+    node->data.for_in.body = body;
+    node->data.for_in.gen_fn = NULL;
+    node->data.for_in.id = -1;
     return node;
 }
 
+ASTNode* ast_new_await(ASTNode* expr, bool stmt) {
+    ASTNode* node = create_node(AST_AWAIT);
+    node->data.await.expr = expr;
+    node->data.await.stmt = stmt;
+    node->data.await.io = false;
+    node->data.await.async_fn = NULL;
+    node->data.await.state = 0;
+    node->data.await.id = -1;
+    return node;
+}
+
+ASTNode* ast_new_module(char* name) {
+    ASTNode* node = create_node(AST_MODULE);
+    node->data.module.name = rujo_strdup(name);
+    return node;
+}
+
+ASTNode* ast_new_import(char* name) {
+    ASTNode* node = create_node(AST_IMPORT);
+    node->data.module.name = rujo_strdup(name);
+    return node;
+}
+
+static char* clone_type(const char* type_name, ASTTypeMapper map_type, void* ctx) {
+    if (!type_name) return NULL;
+    return map_type ? map_type(type_name, ctx) : rujo_strdup(type_name);
+}
+
+static ASTNode* clone_one(ASTNode* node, ASTTypeMapper map_type, void* ctx) {
+    ASTNode* copy = create_node(node->type);
+    copy->data = node->data;
+    copy->line = node->line;
+    copy->col = node->col;
+    copy->annotations = ast_clone(node->annotations, NULL, NULL);
+
+    switch (node->type) {
+        case AST_PROGRAM:
+            copy->data.program.statements = ast_clone(node->data.program.statements, map_type, ctx);
+            break;
+        case AST_VAR_DECL:
+        case AST_PROP_DECL:
+            copy->data.var_decl.name = rujo_strdup(node->data.var_decl.name);
+            copy->data.var_decl.type_name = clone_type(node->data.var_decl.type_name, map_type, ctx);
+            copy->data.var_decl.value = ast_clone(node->data.var_decl.value, map_type, ctx);
+            break;
+        case AST_LITERAL:
+            if (node->data.literal.type == LIT_STRING) {
+                copy->data.literal.string_val = rujo_strdup(node->data.literal.string_val);
+            }
+            break;
+        case AST_CLASS_DECL:
+            copy->data.class_decl.name = rujo_strdup(node->data.class_decl.name);
+            copy->data.class_decl.members = ast_clone(node->data.class_decl.members, map_type, ctx);
+            copy->data.class_decl.type_params = ast_clone(node->data.class_decl.type_params, NULL, NULL);
+            break;
+        case AST_FN_DECL:
+            copy->data.fn_decl.name = rujo_strdup(node->data.fn_decl.name);
+            copy->data.fn_decl.return_type = clone_type(node->data.fn_decl.return_type, map_type, ctx);
+            copy->data.fn_decl.params = ast_clone(node->data.fn_decl.params, map_type, ctx);
+            copy->data.fn_decl.body = ast_clone(node->data.fn_decl.body, map_type, ctx);
+            copy->data.fn_decl.type_params = ast_clone(node->data.fn_decl.type_params, NULL, NULL);
+            break;
+        case AST_BLOCK:
+            copy->data.block.statements = ast_clone(node->data.block.statements, map_type, ctx);
+            break;
+        case AST_ASSIGN:
+            copy->data.assign.target = ast_clone(node->data.assign.target, map_type, ctx);
+            copy->data.assign.value = ast_clone(node->data.assign.value, map_type, ctx);
+            break;
+        case AST_ACCESS:
+            copy->data.access.object = ast_clone(node->data.access.object, map_type, ctx);
+            copy->data.access.member_name = rujo_strdup(node->data.access.member_name);
+            break;
+        case AST_IDENTIFIER:
+            copy->data.ident.name = rujo_strdup(node->data.ident.name);
+            break;
+        case AST_CALL: {
+            copy->data.call.name = rujo_strdup(node->data.call.name);
+            copy->data.call.args = ast_clone(node->data.call.args, map_type, ctx);
+            copy->data.call.type_args = ast_clone(node->data.call.type_args, NULL, NULL);
+            // Argumentos de tipo explícitos também são tipos
+            ASTNode* t = copy->data.call.type_args;
+            while (t && map_type) {
+                t->data.ident.name = map_type(t->data.ident.name, ctx);
+                t = t->next;
+            }
+            break;
+        }
+        case AST_TYPEOF:
+            copy->data.type_of.expr = ast_clone(node->data.type_of.expr, map_type, ctx);
+            break;
+        case AST_BINARY_OP: {
+            // A cópia desce a espinha esquerda em laço; só a folha e os
+            // operandos da direita passam por clone_one
+            ASTSpine spine;
+            ast_spine_init(&spine, node);
+            ASTNode* dst = copy;
+            for (int i = 0; i < spine.count; i++) {
+                ASTNode* src = spine.items[i];
+                if (i > 0) {
+                    ASTNode* inner = create_node(AST_BINARY_OP);
+                    inner->data = src->data;
+                    inner->line = src->line;
+                    inner->col = src->col;
+                    dst->data.binary_op.left = inner;
+                    dst = inner;
+                }
+                dst->data.binary_op.op = rujo_strdup(src->data.binary_op.op);
+                dst->data.binary_op.right = ast_clone(src->data.binary_op.right, map_type, ctx);
+            }
+            dst->data.binary_op.left = ast_clone(spine.items[spine.count - 1]->data.binary_op.left, map_type, ctx);
+            ast_spine_free(&spine);
+            break;
+        }
+        case AST_RETURN:
+            copy->data.ret.value = ast_clone(node->data.ret.value, map_type, ctx);
+            break;
+        case AST_IF:
+            copy->data.if_stmt.condition = ast_clone(node->data.if_stmt.condition, map_type, ctx);
+            copy->data.if_stmt.then_branch = ast_clone(node->data.if_stmt.then_branch, map_type, ctx);
+            copy->data.if_stmt.else_branch = ast_clone(node->data.if_stmt.else_branch, map_type, ctx);
+            break;
+        case AST_WHILE:
+            copy->data.while_loop.condition = ast_clone(node->data.while_loop.condition, map_type, ctx);
+            copy->data.while_loop.body = ast_clone(node->data.while_loop.body, map_type, ctx);
+            break;
+        case AST_FOR:
+            copy->data.for_loop.init = ast_clone(node->data.for_loop.init, map_type, ctx);
+            copy->data.for_loop.condition = ast_clone(node->data.for_loop.condition, map_type, ctx);
+            copy->data.for_loop.step = ast_clone(node->data.for_loop.step, map_type, ctx);
+            copy->data.for_loop.body = ast_clone(node->data.for_loop.body, map_type, ctx);
+            copy->data.for_loop.captures = NULL;
+            copy->data.for_loop.reductions = NULL;
+            copy->data.for_loop.id = -1;
+            break;
+        case AST_ANNOTATION:
+            copy->data.annotation.name = rujo_strdup(node->data.annotation.name);
+            break;
+        case AST_INDEX:
+            copy->data.index.array = ast_clone(node->data.index.array, map_type, ctx);
+            copy->data.index.index = ast_clone(node->data.index.index, map_type, ctx);
+            break;
+        case AST_NEW_ARRAY:
+            copy->data.new_array.elem_type = clone_type(node->data.new_array.elem_type, map_type, ctx);
+            copy->data.new_array.size = ast_clone(node->data.new_array.size, map_type, ctx);
+            break;
+        case AST_NEW:
+            copy->data.new_obj.type_name = clone_type(node->data.new_obj.type_name, map_type, ctx);
+            copy->data.new_obj.args = ast_clone(node->data.new_obj.args, map_type, ctx);
+            break;
+        case AST_METHOD_CALL:
+            copy->data.method_call.object = ast_clone(node->data.method_call.object, map_type, ctx);
+            copy->data.method_call.name = rujo_strdup(node->data.method_call.name);
+            copy->data.method_call.args = ast_clone(node->data.method_call.args, map_type, ctx);
+            break;
+        case AST_TRY:
+            copy->data.try_expr.expr = ast_clone(node->data.try_expr.expr, map_type, ctx);
+            copy->data.try_expr.fn_return_type = NULL;
+            break;
+        case AST_ARENA:
+            copy->data.arena.body = ast_clone(node->data.arena.body, map_type, ctx);
+            break;
+        case AST_BENCH:
+            copy->data.bench.name = rujo_strdup(node->data.bench.name);
+            copy->data.bench.body = ast_clone(node->data.bench.body, map_type, ctx);
+            copy->data.bench.inputs = NULL;
+            break;
+        case AST_SPAWN:
+            copy->data.spawn.call = ast_clone(node->data.spawn.call, map_type, ctx);
+            copy->data.spawn.id = -1;
+            copy->data.spawn.blocking = false;
+            break;
+        case AST_YIELD:
+            copy->data.yield.value = ast_clone(node->data.yield.value, map_type, ctx);
+            copy->data.yield.state = 0;
+            break;
+        case AST_FOR_IN:
+            copy->data.for_in.var_type = clone_type(node->data.for_in.var_type, map_type, ctx);
+            copy->data.for_in.var_name = rujo_strdup(node->data.for_in.var_name);
+            copy->data.for_in.val_type = clone_type(node->data.for_in.val_type, map_type, ctx);
+            copy->data.for_in.val_name = node->data.for_in.val_name ?
+                rujo_strdup(node->data.for_in.val_name) : NULL;
+            copy->data.for_in.source = ast_clone(node->data.for_in.source, map_type, ctx);
+            copy->data.for_in.body = ast_clone(node->data.for_in.body, map_type, ctx);
+            copy->data.for_in.gen_fn = NULL;
+            copy->data.for_in.id = -1;
+            break;
+        case AST_AWAIT:
+            copy->data.await.expr = ast_clone(node->data.await.expr, map_type, ctx);
+            copy->data.await.io = false;
+            copy->data.await.async_fn = NULL;
+            copy->data.await.state = 0;
+            copy->data.await.id = -1;
+            break;
+        case AST_MODULE:
+        case AST_IMPORT:
+            copy->data.module.name = rujo_strdup(node->data.module.name);
+            break;
+    }
+    return copy;
+}
+
+ASTNode* ast_clone(ASTNode* node, ASTTypeMapper map_type, void* ctx) {
+    ASTNode* head = NULL;
+    ASTNode* last = NULL;
+    while (node) {
+        ASTNode* copy = clone_one(node, map_type, ctx);
+        if (!head) head = copy;
+        else last->next = copy;
+        last = copy;
+        node = node->next;
+    }
+    return head;
+}
+
+bool ast_has_annotation(ASTNode* node, const char* name) {
+    if (!node) return false;
+    ASTNode* a = node->annotations;
+    while (a) {
+        if (strcmp(a->data.annotation.name, name) == 0) return true;
+        a = a->next;
+    }
+    return false;
+}
+
+void ast_spine_init(ASTSpine* s, ASTNode* node) {
+    s->items = s->small;
+    s->count = 0;
+    s->cap = 32;
+    for (; node && node->type == AST_BINARY_OP; node = node->data.binary_op.left) {
+        if (s->count == s->cap) {
+            s->cap *= 2;
+            if (s->items == s->small) {
+                s->items = malloc((size_t)s->cap * sizeof(ASTNode*));
+                memcpy(s->items, s->small, sizeof(s->small));
+            } else {
+                s->items = realloc(s->items, (size_t)s->cap * sizeof(ASTNode*));
+            }
+        }
+        s->items[s->count++] = node;
+    }
+}
+
+void ast_spine_free(ASTSpine* s) {
+    if (s->items != s->small) free(s->items);
+}
+
 void print_indent(int level) {
     for (int i = 0; i < level; i++) printf("  ");
 }
 
+void ast_visit(ASTNode* node, ASTVisitor fn, void* ctx) {
+    for (; node; node = node->next) {
+        fn(node, ctx);
+        switch (node->type) {
+            case AST_PROGRAM: ast_visit(node->data.program.statements, fn, ctx); break;
+            case AST_VAR_DECL:
+            case AST_PROP_DECL: ast_visit(node->data.var_decl.value, fn, ctx); break;
+            case AST_CLASS_DECL: ast_visit(node->data.class_decl.members, fn, ctx); break;
+            case AST_FN_DECL:
+                ast_visit(node->data.fn_decl.params, fn, ctx);
+                ast_visit(node->data.fn_decl.body, fn, ctx);
+                break;
+            case AST_BLOCK: ast_visit(node->data.block.statements, fn, ctx); break;
+            case AST_ASSIGN:
+                ast_visit(node->data.assign.target, fn, ctx);
+                ast_visit(node->data.assign.value, fn, ctx);
+                break;
+            case AST_ACCESS: ast_visit(node->data.access.object, fn, ctx); break;
+            case AST_CALL: ast_visit(node->data.call.args, fn, ctx); break;
+            case AST_TYPEOF: ast_visit(node->data.type_of.expr, fn, ctx); break;
+            case AST_BINARY_OP: {
+                // Pré-ordem sem recursão na espinha: os nós de fora para dentro,
+                // a folha, e os operandos da direita de dentro para fora
+                ASTSpine spine;
+                ast_spine_init(&spine, node);
+                for (int i = 1; i < spine.count; i++) fn(spine.items[i], ctx);
+                ast_visit(spine.items[spine.count - 1]->data.binary_op.left, fn, ctx);
+                for (int i = spine.count - 1; i >= 0; i--) ast_visit(spine.items[i]->data.binary_op.right, fn, ctx);
+                ast_spine_free(&spine);
+                break;
+            }
+            case AST_RETURN: ast_visit(node->data.ret.value, fn, ctx); break;
+            case AST_IF:
+                ast_visit(node->data.if_stmt.condition, fn, ctx);
+                ast_visit(node->data.if_stmt.then_branch, fn, ctx);
+                ast_visit(node->data.if_stmt.else_branch, fn, ctx);
+                break;
+            case AST_WHILE:
+                ast_visit(node->data.while_loop.condition, fn, ctx);
+                ast_visit(node->data.while_loop.body, fn, ctx);
+                break;
+            case AST_FOR:
+                ast_visit(node->data.for_loop.init, fn, ctx);
+                ast_visit(node->data.for_loop.condition, fn, ctx);
+                ast_visit(node->data.for_loop.step, fn, ctx);
+                ast_visit(node->data.for_loop.body, fn, ctx);
+                break;
+            case AST_INDEX:
+                ast_visit(node->data.index.array, fn, ctx);
+                ast_visit(node->data.index.index, fn, ctx);
+                break;
+            case AST_NEW_ARRAY: ast_visit(node->data.new_array.size, fn, ctx); break;
+            case AST_NEW: ast_visit(node->data.new_obj.args, fn, ctx); break;
+            case AST_METHOD_CALL:
+                ast_visit(node->data.method_call.object, fn, ctx);
+                ast_visit(node->data.method_call.args, fn, ctx);
+                break;
+            case AST_TRY: ast_visit(node->data.try_expr.expr, fn, ctx); break;
+            case AST_ARENA: ast_visit(node->data.arena.body, fn, ctx); break;
+            case AST_BENCH: ast_visit(node->data.bench.body, fn, ctx); break;
+            case AST_SPAWN: ast_visit(node->data.spawn.call, fn, ctx); break;
+            case AST_YIELD: ast_visit(node->data.yield.value, fn, ctx); break;
+            case AST_FOR_IN:
+                ast_visit(node->data.for_in.source, fn, ctx);
+                ast_visit(node->data.for_in.body, fn, ctx);
+                break;
+            case AST_AWAIT: ast_visit(node->data.await.expr, fn, ctx); break;
+            default: break;
+        }
+    }
+}
+
+static void print_node(ASTNode* node, int level);
+
+// A lista ->next é percorrida em laço: só a profundidade da árvore usa a pilha
 void ast_print(ASTNode* node, int level) {
-    if (!node) return;
+    for (; node; node = node->next) print_node(node, level);
+}
 
+static void print_node(ASTNode* node, int level) {
     print_indent(level);
 
     switch (node->type) {
@@ -176,7 +623,8 @@ void ast_print(ASTNode* node, int level) {
             ast_print(node->data.program.statements, level + 1);
             break;
         case AST_VAR_DECL:
-            printf("VarDecl (%s %s)\n", node->data.var_decl.type_name, node->data.var_decl.name);
+            printf("VarDecl (%s%s %s)\n", node->data.var_decl.borrowed ? "&" : "",
+                node->data.var_decl.type_name, node->data.var_decl.name);
             if (node->data.var_decl.value) ast_print(node->data.var_decl.value, level + 1);
             break;
         case AST_PROP_DECL:
@@ -191,8 +639,68 @@ void ast_print(ASTNode* node, int level) {
                 case LIT_CHAR:   printf("LiteralChar (%u)\n", node->data.literal.char_val); break;
             }
             break;      
+        case AST_NEW:
+            printf("New (%s)\n", node->data.new_obj.type_name);
+            ast_print(node->data.new_obj.args, level + 1);
+            break;
+
+        case AST_METHOD_CALL:
+            printf("MethodCall (%s)\n", node->data.method_call.name);
+            print_indent(level + 1); printf("Object:\n");
+            ast_print(node->data.method_call.object, level + 2);
+            print_indent(level + 1); printf("Args:\n");
+            ast_print(node->data.method_call.args, level + 2);
+            break;
+
+        case AST_TRY:
+            printf("Try (?)\n");
+            ast_print(node->data.try_expr.expr, level + 1);
+            break;
+
+        case AST_ARENA:
+            printf("Arena\n");
+            ast_print(node->data.arena.body, level + 1);
+            break;
+
+        case AST_BENCH:
+            printf("Bench (\"%s\")\n", node->data.bench.name);
+            ast_print(node->data.bench.body, level + 1);
+            break;
+
+        case AST_SPAWN:
+            printf("Spawn\n");
+            ast_print(node->data.spawn.call, level + 1);
+            break;
+
+        case AST_YIELD:
+            printf("Yield\n");
+            ast_print(node->data.yield.value, level + 1);
+            break;
+
+        case AST_FOR_IN:
+            printf("ForIn: %s %s", node->data.for_in.var_type, node->data.for_in.var_name);
+            if (node->data.for_in.val_name) printf(", %s %s", node->data.for_in.val_type, node->data.for_in.val_name);
+            printf("\n");
+            ast_print(node->data.for_in.source, level + 1);
+            ast_print(node->data.for_in.body, level + 1);
+            break;
+
+        case AST_AWAIT:
+            printf("Await\n");
+            ast_print(node->data.await.expr, level + 1);
+            break;
+
+        case AST_MODULE:
+            printf("Module (%s)\n", node->data.module.name);
+            break;
+
+        case AST_IMPORT:
+            printf("Import (%s)\n", node->data.module.name);
+            break;
+
         case AST_CLASS_DECL:
-            printf("Class (%s)\n", node->data.class_decl.name);
+            printf("Class (%s)%s\n", node->data.class_decl.name,
+                ast_has_annotation(node, "soa") ? " @soa" : "");
             ast_print(node->data.class_decl.members, level + 1);
             break;
         case AST_FN_DECL:
@@ -274,11 +782,24 @@ void ast_print(ASTNode* node, int level) {
             ast_print(node->data.for_loop.body, level + 2);
             break;
 
+        case AST_ANNOTATION:
+            printf("Annotation (@%s)\n", node->data.annotation.name);
+            break;
+
+        case AST_INDEX:
+            printf("Index\n");
+            print_indent(level + 1); printf("Array:\n");
+            ast_print(node->data.index.array, level + 2);
+            print_indent(level + 1); printf("Index:\n");
+            ast_print(node->data.index.index, level + 2);
+            break;
+
+        case AST_NEW_ARRAY:
+            printf("NewArray (%s)\n", node->data.new_array.elem_type);
+            ast_print(node->data.new_array.size, level + 1);
+            break;
+
         default:
             printf("Unknown Node\n");
     }
-
-    if (node->next) {
-        ast_print(node->next, level);
-    }
 }
\ No newline at end of file
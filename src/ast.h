@@ -30,18 +30,46 @@ typedef enum {
     AST_RETURN,
     AST_IF,
     AST_WHILE, // Novo
-    AST_FOR    // Novo
+    AST_FOR,   // Novo
+    AST_ANNOTATION, // @nome
+    AST_INDEX,      // arr[i]
+    AST_NEW_ARRAY,  // new T[n]
+    AST_NEW,        // new T(args)
+    AST_METHOD_CALL, // obj.metodo(args)
+    AST_TRY,         // expr? (propaga Err)
+    AST_ARENA,       // arena { ... } (região liberada de uma vez)
+    AST_SPAWN,       // spawn f(args) (tarefa no pool de threads)
+    AST_YIELD,       // yield expr; (dentro de uma função que devolve Gen<T>)
+    AST_FOR_IN,      // for (T x in fonte) (Gen<T>, List<T> ou T[])
+    AST_AWAIT,       // await expr (dentro de async fn: Async<T> ou operação de I/O)
+    AST_BENCH,       // bench "nome" { ... } (medido por rujo bench)
+    AST_MODULE,      // module a.b; (nome do arquivo, resolvido pelo carregador de módulos)
+    AST_IMPORT       // import a.b;
 } ASTNodeType;
 
+// Ownership: como um valor com heap é passado adiante (preenchido pelo semântico)
+typedef enum {
+    OWN_NONE,
+    OWN_COPY, // lugar que continua em uso: o valor é clonado
+    OWN_MOVE  // último uso: o valor é transferido sem cópia
+} OwnershipMode;
+
 typedef struct ASTNode ASTNode;
 
 struct ASTNode {
     ASTNodeType type;
     struct ASTNode* next;
+    struct ASTNode* annotations; // Lista de AST_ANNOTATION (@soa, ...)
+    char* eval_type;             // Tipo resolvido pelo semântico (NULL se desconhecido)
+    OwnershipMode ownership;     // Valores em posição de move (atribuição, argumento, return)
+    struct ASTNode* drops;       // Variáveis liberadas ao sair (blocos, returns, programa)
+    int line;                    // Posição no .rj (linha e coluna do primeiro token;
+    int col;                     // 0 em nós criados pelo compilador)
 
     union {
         struct { struct ASTNode* statements; } program;
-        struct { char* name; char* type_name; struct ASTNode* value; } var_decl;
+        // borrowed: parâmetro declarado com & (não é liberado pela função)
+        struct { char* name; char* type_name; struct ASTNode* value; bool borrowed; } var_decl;
         
         struct { 
             LiteralType type;
@@ -52,13 +80,23 @@ struct ASTNode {
             uint32_t char_val;
         } literal;
 
-        struct { char* name; struct ASTNode* members; } class_decl;
-        struct { char* name; char* return_type; struct ASTNode* params; struct ASTNode* body; } fn_decl;
+        // type_params: lista de AST_IDENTIFIER (NULL se não for genérico)
+        // module: índice do módulo (module.h; 0 sem import), is_pub: visível para quem importa
+        struct { char* name; struct ASTNode* members; struct ASTNode* type_params; int module; bool is_pub; } class_decl;
+        struct {
+            char* name;
+            char* return_type;
+            struct ASTNode* params;
+            struct ASTNode* body;
+            struct ASTNode* type_params;
+            int module;
+            bool is_pub;
+        } fn_decl;
         struct { struct ASTNode* statements; } block;
         struct { struct ASTNode* target; struct ASTNode* value; } assign;
         struct { struct ASTNode* object; char* member_name; } access;
         struct { char* name; } ident;
-        struct { char* name; struct ASTNode* args; } call;
+        struct { char* name; struct ASTNode* args; struct ASTNode* type_args; } call;
         struct { struct ASTNode* expr; } type_of;
         
         struct { struct ASTNode* left; char* op; struct ASTNode* right; } binary_op;
@@ -72,10 +110,63 @@ struct ASTNode {
             struct ASTNode* condition; 
             struct ASTNode* step; 
             struct ASTNode* body; 
+            // @parallel (preenchidos pelo semântico/codegen):
+            // captures: variáveis externas lidas (AST_IDENTIFIER tipados)
+            // reductions: acumuladores (AST_BINARY_OP: left = variável, op = + * min max)
+            struct ASTNode* captures;
+            struct ASTNode* reductions;
+            int id;
         } for_loop;
+
+        struct { char* name; } annotation;
+        struct { struct ASTNode* array; struct ASTNode* index; } index;
+        struct { char* elem_type; struct ASTNode* size; } new_array;
+        struct { char* type_name; struct ASTNode* args; } new_obj;
+        struct { struct ASTNode* object; char* name; struct ASTNode* args; } method_call;
+        // fn_return_type: Result da função onde o ? aparece (preenchido pelo semântico)
+        struct { struct ASTNode* expr; char* fn_return_type; } try_expr;
+        struct { struct ASTNode* body; } arena;
+        // inputs: variáveis de fora do bloco lidas nele (preenchido pelo semântico);
+        // o harness as relê a cada iteração para o C não tirar cálculos do laço
+        struct { char* name; struct ASTNode* body; struct ASTNode* inputs; } bench;
+        // id: índice da tarefa no programa (preenchido pelo codegen)
+        // blocking: recebe canais, pode bloquear (preenchido pelo semântico)
+        struct { struct ASTNode* call; int id; bool blocking; } spawn;
+        // state: ponto de retomada no gerador (preenchido pelo codegen)
+        struct { struct ASTNode* value; int state; } yield;
+        // gen_fn: gerador chamado direto na fonte (o frame fica na pilha de quem itera)
+        // (os drops do nó são as liberações do fim de cada iteração)
+        // val_name/val_type: segunda variável de "for (K k, V v in mapa)" (NULL se não houver)
+        struct {
+            char* var_name;
+            char* var_type;
+            char* val_name;
+            char* val_type;
+            struct ASTNode* source;
+            struct ASTNode* body;
+            char* gen_fn;
+            int id;
+        } for_in;
+        // stmt: await usado como statement (valor descartado)
+        // io: operação de I/O do runtime (accept, read, ...) (preenchido pelo semântico)
+        // async_fn: async fn chamada direto (o frame fica no de quem espera)
+        // state/id: ponto de retomada e slots no frame (preenchidos pelo codegen)
+        struct {
+            struct ASTNode* expr;
+            bool stmt;
+            bool io;
+            char* async_fn;
+            int state;
+            int id;
+        } await;
+        // module/import: nome com pontos (a.b é o arquivo a/b.rj)
+        struct { char* name; } module;
     } data;
 };
 
+// Posição dada aos próximos nós criados (o parser atualiza a cada token)
+void ast_set_pos(int line, int col);
+
 // Construtores
 ASTNode* ast_new_program(ASTNode* statements);
 ASTNode* ast_new_var_decl(char* name, char* type, ASTNode* value);
@@ -104,6 +195,44 @@ ASTNode* ast_new_if(ASTNode* condition, ASTNode* then_branch, ASTNode* else_bran
 ASTNode* ast_new_while(ASTNode* condition, ASTNode* body);
 ASTNode* ast_new_for(ASTNode* init, ASTNode* condition, ASTNode* step, ASTNode* body);
 
+ASTNode* ast_new_annotation(char* name);
+ASTNode* ast_new_index(ASTNode* array, ASTNode* index);
+ASTNode* ast_new_new_array(char* elem_type, ASTNode* size);
+ASTNode* ast_new_new(char* type_name, ASTNode* args);
+ASTNode* ast_new_method_call(ASTNode* object, char* name, ASTNode* args);
+ASTNode* ast_new_try(ASTNode* expr);
+ASTNode* ast_new_arena(ASTNode* body);
+ASTNode* ast_new_bench(char* name, ASTNode* body);
+ASTNode* ast_new_spawn(ASTNode* call);
+ASTNode* ast_new_yield(ASTNode* value);
+ASTNode* ast_new_for_in(char* var_type, char* var_name, ASTNode* source, ASTNode* body);
+ASTNode* ast_new_await(ASTNode* expr, bool stmt);
+ASTNode* ast_new_module(char* name);
+ASTNode* ast_new_import(char* name);
+bool ast_has_annotation(ASTNode* node, const char* name);
+
+// Cópia profunda (inclui a lista ->next). Se map_type != NULL, cada nome de
+// tipo copiado passa por ele (usado para instanciar genéricos).
+typedef char* (*ASTTypeMapper)(const char* type_name, void* ctx);
+ASTNode* ast_clone(ASTNode* node, ASTTypeMapper map_type, void* ctx);
+
+// Percorre a árvore em pré-ordem (filhos e lista ->next), chamando fn em cada nó
+typedef void (*ASTVisitor)(ASTNode* node, void* ctx);
+void ast_visit(ASTNode* node, ASTVisitor fn, void* ctx);
+
+// Espinha esquerda de operadores binários: a + b + c + ... vira uma árvore
+// profunda à esquerda, e 100k termos estouram a pilha de quem desce por
+// recursão. items[0] é o nó de fora, items[count - 1] o mais interno; a folha
+// é items[count - 1]->data.binary_op.left. Até 32 nós não usam o heap.
+typedef struct {
+    ASTNode** items;
+    int count, cap;
+    ASTNode* small[32];
+} ASTSpine;
+
+void ast_spine_init(ASTSpine* s, ASTNode* node);
+void ast_spine_free(ASTSpine* s);
+
 void ast_print(ASTNode* node, int level);
 
 #endif
\ No newline at end of file
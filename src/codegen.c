@@ -1,12 +1,141 @@
+#define _XOPEN_SOURCE 700 // open_memstream
 #include "codegen.h"
+#include "semantic.h"
+#include "types.h"
+#include "runtime.h"
+#include "utils.h"
+#include "module.h"
 #include <stdlib.h>
 #include <string.h>
 #include <stdint.h>
 #include <stdbool.h>
+#ifndef _WIN32
+#include <pthread.h>
+#include <stdatomic.h>
+#endif
+
+static ASTNode* program_stmts = NULL;
+
+// Tipos (e instâncias de funções genéricas) que a unidade do módulo em geração
+// usa: structs, helpers, construtores e protótipos só saem para eles. NULL
+// fora dos módulos (tudo sai)
+typedef struct {
+    const char** names;
+    int cap;
+    int count;
+} TypeSet;
+
+static TypeSet* unit_types = NULL;
+
+static int type_set_find(TypeSet* set, const char* name) {
+    int i = (int)(hash_bytes(HASH_SEED, name, strlen(name)) & (uint64_t)(set->cap - 1));
+    while (set->names[i] && strcmp(set->names[i], name) != 0) i = (i + 1) & (set->cap - 1);
+    return i;
+}
+
+// 1 se name entrou agora, 0 se já estava
+static int type_set_add(TypeSet* set, const char* name) {
+    if (set->count * 2 >= set->cap) {
+        TypeSet grown = { calloc((size_t)(set->cap ? set->cap * 2 : 64), sizeof(char*)), set->cap ? set->cap * 2 : 64, 0 };
+        for (int i = 0; i < set->cap; i++) {
+            if (set->names[i]) grown.names[type_set_find(&grown, set->names[i])] = set->names[i];
+        }
+        grown.count = set->count;
+        free(set->names);
+        *set = grown;
+    }
+    int i = type_set_find(set, name);
+    if (set->names[i]) return 0;
+    set->names[i] = name;
+    set->count++;
+    return 1;
+}
+
+static int unit_has(const char* name) {
+    return !unit_types || (unit_types->cap && unit_types->names[type_set_find(unit_types, name)]);
+}
+
+ASTNode* find_class(const char* name) {
+    ASTNode* lists[2] = { program_stmts, semantic_instances() };
+    for (int i = 0; i < 2; i++) {
+        ASTNode* node = lists[i];
+        while (node) {
+            if (node->type == AST_CLASS_DECL && strcmp(node->data.class_decl.name, name) == 0) {
+                return node;
+            }
+            node = node->next;
+        }
+    }
+    return NULL;
+}
+
+// Tipos da biblioteca padrão: implementação gerada pelo codegen, não pelo usuário
+int is_builtin_type(const char* type_name) {
+    return type_is_list(type_name) || type_is_map(type_name) || type_is_result(type_name) || type_is_task(type_name) ||
+           type_is_channel(type_name) || type_is_gen(type_name) || type_is_async(type_name) ||
+           type_is_file_writer(type_name);
+}
+
+// Contadores dos nomes gerados (_rj_tmpN, _rj_tryN, _rj_bN e for-in fora de
+// geradores): recomeçam em cada função, então o C de uma não depende das que
+// vieram antes e as funções podem ser geradas em qualquer ordem (--jobs)
+typedef struct {
+    int tmp;
+    int tries;
+    int benches;
+    int loops;
+} GenCounters;
+
+static _Thread_local GenCounters counters;
+
+// Classe anotada com @soa: arrays dela viram um array contíguo por prop
+int is_soa_class(const char* name) {
+    return ast_has_annotation(find_class(name), "soa");
+}
+
+// A expressão vira um lugar em C (pode receber &)? Chamadas, new e elementos
+// inteiros de arrays SoA (reconstruídos por _soa_get) são valores
+int is_c_lvalue(ASTNode* node) {
+    switch (node->type) {
+        case AST_IDENTIFIER:
+            return 1;
+        case AST_INDEX: {
+            char* elem = type_array_elem(node->data.index.array->eval_type);
+            return !elem || !is_soa_class(elem);
+        }
+        case AST_ACCESS: {
+            // p[i].x de um array SoA vira p.x[i]
+            ASTNode* obj = node->data.access.object;
+            if (obj->type == AST_INDEX) {
+                char* elem = type_array_elem(obj->data.index.array->eval_type);
+                if (elem && is_soa_class(elem)) return 1;
+            }
+            return is_c_lvalue(obj);
+        }
+        default:
+            return 0;
+    }
+}
 
 const char* map_type(const char* rujo_type) {
+    char* elem = type_array_elem(rujo_type);
+    if (elem) {
+        const char* inner = map_type(elem);
+        char* buf = (char*)malloc(strlen(inner) + 8);
+        if (is_soa_class(elem)) {
+            sprintf(buf, "%s_soa", inner);
+        } else {
+            sprintf(buf, "%s*", inner);
+        }
+        return buf;
+    }
+
+    // Instâncias de genéricos: nome mangled determinístico
+    if (strchr(rujo_type, '<')) return type_mangle(rujo_type);
+
     if (strcmp(rujo_type, "string") == 0) return "const char*";
     if (strcmp(rujo_type, "int")    == 0) return "int";
+    if (strcmp(rujo_type, "long")   == 0) return "int64_t";
     if (strcmp(rujo_type, "float")  == 0) return "float";
     if (strcmp(rujo_type, "bool")   == 0) return "bool";
     if (strcmp(rujo_type, "byte")   == 0) return "uint8_t";
@@ -17,41 +146,264 @@ const char* map_type(const char* rujo_type) {
 
 void gen_node(ASTNode* node, FILE* out);
 
+// Expressões usadas como statement precisam do ; emitido por quem as contém
+int is_expr_stmt(ASTNode* node) {
+    return node->type == AST_CALL || node->type == AST_ASSIGN || node->type == AST_METHOD_CALL;
+}
+
+// Dentro do corpo de um gerador (1) ou async fn (2) toda variável é um campo
+// do frame (_f->nome), para sobreviver entre um yield/await e a retomada
+static _Thread_local int gen_mode = 0;
+
+// rujo bench: os blocos bench viram o harness de medida (em build/run somem)
+static int bench_mode = 0;
+
+// Arquivo .rj de origem: caminho para os #line (perf/gdb apontam para o .rj)
+// e nome curto para os relatórios
+static const char* source_path = NULL;
+
+// Com módulos, o .rj do item em geração (NULL: o arquivo principal)
+static _Thread_local const char* line_path = NULL;
+
+void codegen_set_source(const char* path) {
+    source_path = path;
+}
+
+static const char* base_name(const char* path) {
+    const char* slash = strrchr(path, '/');
+    return slash ? slash + 1 : path;
+}
+
+static const char* item_path(ASTNode* item) {
+    int m = module_of(item);
+    return m ? module_path(m) : NULL;
+}
+
+// Literal C com aspas e barras escapadas
+static void gen_c_string(const char* s, FILE* out) {
+    fputc('"', out);
+    for (; *s; s++) {
+        if (*s == '"' || *s == '\\') fputc('\\', out);
+        fputc(*s, out);
+    }
+    fputc('"', out);
+}
+
+// O C que vem depois é atribuído à linha de node no .rj
+static void gen_line(ASTNode* node, FILE* out) {
+    if (!source_path || node->line <= 0) return;
+    fprintf(out, "\n#line %d ", node->line);
+    gen_c_string(line_path ? line_path : source_path, out);
+    fprintf(out, "\n");
+}
+
+// --instrument: sites (função ou laço) numerados na ordem em que são gerados;
+// a tabela com nome e linha de cada um vai para o C depois do main
+static int instrument_level = 0;
+static const char** prof_names = NULL;
+static const char** prof_files = NULL;
+static int* prof_lines = NULL;
+static int prof_count = 0;
+static _Thread_local const char* prof_fn = "main";   // função em geração (nome dos laços)
+
+void codegen_set_instrument(int level) {
+    instrument_level = level;
+}
+
+static int prof_site(const char* name, int line) {
+    prof_names = realloc(prof_names, (size_t)(prof_count + 1) * sizeof(char*));
+    prof_files = realloc(prof_files, (size_t)(prof_count + 1) * sizeof(char*));
+    prof_lines = realloc(prof_lines, (size_t)(prof_count + 1) * sizeof(int));
+    // A tabela sai depois do main: no --stream a função já foi liberada
+    Region* item_region = region_activate(NULL);
+    prof_names[prof_count] = rujo_strdup(name);
+    region_activate(item_region);
+    prof_files[prof_count] = base_name(line_path ? line_path : source_path ? source_path : "");
+    prof_lines[prof_count] = line;
+    return prof_count++;
+}
+
+void codegen_set_bench(int on) {
+    bench_mode = on;
+}
+
+static const char* local_prefix(void) {
+    return gen_mode ? "_f->" : "";
+}
+
+// Liberações decididas pelo ownership checker (lista de AST_IDENTIFIER tipados)
+void gen_drops(ASTNode* drops, FILE* out) {
+    for (ASTNode* d = drops; d; d = d->next) {
+        fprintf(out, "rujo_drop_%s(&%s%s);\n", type_mangle(d->eval_type), local_prefix(), d->data.ident.name);
+    }
+}
+
+// Arenas abertas no ponto atual: um return precisa fechá-las antes de sair
+static _Thread_local int open_arenas[64];
+static _Thread_local int open_arena_count = 0;
+
+void gen_arena_ends(FILE* out) {
+    for (int i = open_arena_count - 1; i >= 0; i--) {
+        fprintf(out, "rujo_arena_end(&_rj_arena%d);\n", open_arenas[i]);
+    }
+}
+
+// for-in abertos no ponto atual: um return libera o gerador/fonte de cada um
+static _Thread_local ASTNode* open_loops[64];
+static _Thread_local int open_loop_count = 0;
+
+void gen_node_inner(ASTNode* node, FILE* out);
+void gen_parallel_for(ASTNode* node, FILE* out);
+void gen_for_in(ASTNode* node, FILE* out);
+void gen_bench(ASTNode* node, FILE* out);
+void gen_for_in_cleanup(ASTNode* node, FILE* out);
+void gen_await(ASTNode* node, FILE* out);
+
+int is_await(ASTNode* node) {
+    return gen_mode == 2 && node && node->type == AST_AWAIT;
+}
+
+// Laço sondado: a sonda fecha depois do laço (break incluso); um return no
+// meio é fechado pela sonda da função
+void gen_loop_probe(ASTNode* node, FILE* out) {
+    const char* kind = node->type == AST_WHILE ? "while" : node->type == AST_FOR ? "for" : "for-in";
+    char* name = malloc(strlen(prof_fn) + strlen(kind) + 3);
+    sprintf(name, "%s: %s", prof_fn, kind);
+    int site = prof_site(name, node->line);
+    free(name);
+    fprintf(out, "{\nint _rj_pl%d = rujo_prof_enter(%d);\n", site, site);
+    gen_node_inner(node, out);
+    fprintf(out, "\nrujo_prof_exit(_rj_pl%d);\n}\n", site);
+}
+
 void gen_node(ASTNode* node, FILE* out) {
     if (!node) return;
+    if (instrument_level >= 2 && !gen_mode && node->line > 0 &&
+        (node->type == AST_WHILE || node->type == AST_FOR || node->type == AST_FOR_IN)) {
+        gen_loop_probe(node, out);
+        return;
+    }
+    // Move de um campo do frame: zera a origem para que o frame não o libere de novo
+    if (gen_mode && node->ownership == OWN_MOVE && node->type == AST_IDENTIFIER) {
+        const char* n = node->data.ident.name;
+        fprintf(out, "({ __auto_type _rj_mv = _f->%s; memset(&_f->%s, 0, sizeof(_f->%s)); _rj_mv; })", n, n, n);
+        return;
+    }
+    // Cópia de um valor com heap que continua vivo na origem
+    if (node->ownership == OWN_COPY) {
+        fprintf(out, "rujo_clone_%s(", type_mangle(node->eval_type));
+        gen_node_inner(node, out);
+        fprintf(out, ")");
+        return;
+    }
+    gen_node_inner(node, out);
+}
 
+void gen_node_inner(ASTNode* node, FILE* out) {
     switch (node->type) {
         case AST_BLOCK:
             fprintf(out, "{\n");
             ASTNode* stmt = node->data.block.statements;
             while (stmt) {
+                gen_line(stmt, out);
                 gen_node(stmt, out);
                 // CORREÇÃO: Adiciona ; se for Chamada OU Atribuição
-                if (stmt->type == AST_CALL || stmt->type == AST_ASSIGN) {
+                if (is_expr_stmt(stmt)) {
                     fprintf(out, ";\n");
                 }
                 stmt = stmt->next;
             }
+            gen_drops(node->drops, out);
             fprintf(out, "}\n");
             break;
 
         case AST_VAR_DECL:
+            if (gen_mode) {
+                const char* n = node->data.var_decl.name;
+                int awaits = is_await(node->data.var_decl.value);
+                if (awaits) {
+                    fprintf(out, "{\n");
+                    gen_await(node->data.var_decl.value, out);
+                }
+                if (node->data.var_decl.value) {
+                    fprintf(out, "_f->%s = ", n);
+                    gen_node(node->data.var_decl.value, out);
+                } else {
+                    fprintf(out, "memset(&_f->%s, 0, sizeof(_f->%s))", n, n);
+                }
+                fprintf(out, ";\n");
+                if (awaits) fprintf(out, "}\n");
+                break;
+            }
             fprintf(out, "%s %s", map_type(node->data.var_decl.type_name), node->data.var_decl.name);
             if (node->data.var_decl.value) {
                 fprintf(out, " = ");
                 gen_node(node->data.var_decl.value, out);
+            } else if (semantic_is_owned(node->data.var_decl.type_name)) {
+                fprintf(out, " = { 0 }");
             }
             fprintf(out, ";\n");
             break;
 
-        case AST_ASSIGN:
-            gen_node(node->data.assign.target, out);
-            fprintf(out, " = ");
-            gen_node(node->data.assign.value, out);
+        case AST_ASSIGN: {
+            // x = await op: a espera vem antes, num bloco (o ; do statement fica depois dele)
+            int awaits = is_await(node->data.assign.value);
+            if (awaits) {
+                fprintf(out, "{\n");
+                gen_await(node->data.assign.value, out);
+            }
+            ASTNode* target = node->data.assign.target;
+            char* soa = target->type == AST_INDEX ? type_array_elem(target->data.index.array->eval_type) : NULL;
+            if (soa && is_soa_class(soa)) {
+                // SoA: ps[i] não é um lugar em C; cada prop vai para o seu bloco
+                int id = counters.tmp++;
+                fprintf(out, "({ %s _rj_tmp%d = ", map_type(soa), id);
+                gen_node(node->data.assign.value, out);
+                fprintf(out, "; ");
+                if (semantic_is_owned(soa)) {
+                    fprintf(out, "%s _rj_old%d = ", map_type(soa), id);
+                    gen_node(target, out);
+                    fprintf(out, "; rujo_drop_%s(&_rj_old%d); ", type_mangle(soa), id);
+                }
+                fprintf(out, "%s_soa_set(", map_type(soa));
+                gen_node(target->data.index.array, out);
+                fprintf(out, ", ");
+                gen_node(target->data.index.index, out);
+                fprintf(out, ", _rj_tmp%d); })", id);
+            } else if (semantic_is_owned(node->data.assign.target->eval_type)) {
+                // Avalia o novo valor antes de liberar o antigo (x = f(x) continua válido)
+                const char* t = node->data.assign.target->eval_type;
+                int id = counters.tmp++;
+                fprintf(out, "({ %s _rj_tmp%d = ", map_type(t), id);
+                gen_node(node->data.assign.value, out);
+                fprintf(out, "; rujo_drop_%s(&(", type_mangle(t));
+                gen_node(node->data.assign.target, out);
+                fprintf(out, ")); ");
+                gen_node(node->data.assign.target, out);
+                fprintf(out, " = _rj_tmp%d; })", id);
+            } else {
+                gen_node(node->data.assign.target, out);
+                fprintf(out, " = ");
+                gen_node(node->data.assign.value, out);
+            }
+            if (awaits) fprintf(out, ";\n}\n");
             // AST_ASSIGN não gera ; aqui para permitir uso dentro de for(..;..; step)
             break;
+        }
 
         case AST_ACCESS:
+            // SoA: p[i].x -> p.x[i]
+            if (node->data.access.object->type == AST_INDEX) {
+                ASTNode* idx = node->data.access.object;
+                char* elem = type_array_elem(idx->data.index.array->eval_type);
+                if (elem && is_soa_class(elem)) {
+                    gen_node(idx->data.index.array, out);
+                    fprintf(out, ".%s[", node->data.access.member_name);
+                    gen_node(idx->data.index.index, out);
+                    fprintf(out, "]");
+                    break;
+                }
+            }
             gen_node(node->data.access.object, out);
             if (node->data.access.object->type == AST_IDENTIFIER && 
                 strcmp(node->data.access.object->data.ident.name, "this") == 0) {
@@ -62,7 +414,53 @@ void gen_node(ASTNode* node, FILE* out) {
             break;
 
         case AST_CALL:
-            if (strcmp(node->data.call.name, "print") == 0) {
+            if ((strcmp(node->data.call.name, "Ok") == 0 || strcmp(node->data.call.name, "Err") == 0) &&
+                type_is_result(node->eval_type)) {
+                fprintf(out, "%s_%s(", map_type(node->eval_type),
+                    strcmp(node->data.call.name, "Ok") == 0 ? "ok" : "err");
+                gen_node(node->data.call.args, out);
+                fprintf(out, ")");
+            } else if ((strcmp(node->data.call.name, "min") == 0 || strcmp(node->data.call.name, "max") == 0) &&
+                       node->data.call.args && node->data.call.args->next) {
+                fprintf(out, "RUJO_%s(", strcmp(node->data.call.name, "min") == 0 ? "MIN" : "MAX");
+                gen_node(node->data.call.args, out);
+                fprintf(out, ", ");
+                gen_node(node->data.call.args->next, out);
+                fprintf(out, ")");
+            } else if (strcmp(node->data.call.name, "io_run") == 0 && node->data.call.args &&
+                       type_is_async(node->data.call.args->eval_type)) {
+                // Laço de I/O até a tarefa raiz (e as disparadas) terminar; o resultado sai do frame
+                ASTNode* a = node->data.call.args;
+                int id = counters.tmp++;
+                int has_value = strcmp(node->eval_type, "void") != 0;
+                fprintf(out, "({ %s _rj_io%d = ", map_type(a->eval_type), id);
+                gen_node(a, out);
+                fprintf(out, "; rujo_io_run(_rj_io%d.f, _rj_io%d.poll); ", id, id);
+                if (has_value) fprintf(out, "%s _rj_r%d = *_rj_io%d.ret; ", map_type(node->eval_type), id, id);
+                fprintf(out, "rujo_drop_%s(&_rj_io%d); ", type_mangle(a->eval_type), id);
+                if (has_value) fprintf(out, "_rj_r%d; ", id);
+                fprintf(out, "})");
+            } else if (strcmp(node->data.call.name, "io_spawn") == 0 && node->data.call.args &&
+                       type_is_async(node->data.call.args->eval_type)) {
+                // O frame passa a ser da tarefa: o laço o libera quando ela termina
+                ASTNode* a = node->data.call.args;
+                int id = counters.tmp++;
+                fprintf(out, "({ %s _rj_io%d = ", map_type(a->eval_type), id);
+                gen_node(a, out);
+                fprintf(out, "; rujo_io_spawn(_rj_io%d.f, _rj_io%d.poll, _rj_io%d.drop); })", id, id, id);
+            } else if (strcmp(node->data.call.name, "flush") == 0) {
+                fprintf(out, "rujo_out_flush()");
+            } else if (strcmp(node->data.call.name, "now_ns") == 0 || strcmp(node->data.call.name, "cycles") == 0) {
+                fprintf(out, "rujo_%s()", node->data.call.name);
+            } else if (strcmp(node->data.call.name, "sqrt") == 0 && node->data.call.args) {
+                fprintf(out, "__builtin_sqrtf((float)(");
+                gen_node(node->data.call.args, out);
+                fprintf(out, "))");
+            } else if (strcmp(node->data.call.name, "keep") == 0 && node->data.call.args) {
+                fprintf(out, "RUJO_KEEP(");
+                gen_node(node->data.call.args, out);
+                fprintf(out, ")");
+            } else if (strcmp(node->data.call.name, "print") == 0) {
                 fprintf(out, "RUJO_PRINT("); 
                 if (node->data.call.args) {
                     gen_node(node->data.call.args, out);
@@ -71,7 +469,7 @@ void gen_node(ASTNode* node, FILE* out) {
                 }
                 fprintf(out, ")");
             } else {
-                fprintf(out, "%s(", node->data.call.name);
+                fprintf(out, "%s(", map_type(node->data.call.name));
                 ASTNode* arg = node->data.call.args;
                 while (arg) {
                     gen_node(arg, out);
@@ -101,6 +499,10 @@ void gen_node(ASTNode* node, FILE* out) {
             break;
 
         case AST_FOR:
+            if (node->data.for_loop.id >= 0) {
+                gen_parallel_for(node, out);
+                break;
+            }
             fprintf(out, "for (");
             if (node->data.for_loop.init) gen_node(node->data.for_loop.init, out);
             else fprintf(out, ";");
@@ -116,8 +518,27 @@ void gen_node(ASTNode* node, FILE* out) {
             break;
 
         case AST_IDENTIFIER:
-            fprintf(out, "%s", node->data.ident.name);
+            fprintf(out, "%s%s", local_prefix(), node->data.ident.name);
+            break;
+
+        case AST_FOR_IN:
+            gen_for_in(node, out);
+            break;
+
+        case AST_AWAIT:
+            // Como statement a espera é tudo; como valor, o resultado já está no frame
+            if (node->data.await.stmt) gen_await(node, out);
+            else fprintf(out, "_f->_rj_av%d", node->data.await.id);
+            break;
+
+        case AST_YIELD: {
+            // Suspende: entrega o item, grava o ponto de retomada e volta para quem iterava
+            int k = node->data.yield.state;
+            fprintf(out, "{\n*_out = ");
+            gen_node(node->data.yield.value, out);
+            fprintf(out, ";\n_f->_rj_state = %d;\nreturn true;\n_rj_y%d: ;\n}\n", k, k);
             break;
+        }
 
         case AST_LITERAL:
             switch(node->data.literal.type) {
@@ -135,15 +556,235 @@ void gen_node(ASTNode* node, FILE* out) {
             fprintf(out, ")");
             break;
 
-        case AST_BINARY_OP:
-            fprintf(out, "(");
-            gen_node(node->data.binary_op.left, out);
-            fprintf(out, " %s ", node->data.binary_op.op);
-            gen_node(node->data.binary_op.right, out);
+        case AST_BINARY_OP: {
+            // Mesmo C da descida recursiva, mas a espinha esquerda sai em laço
+            ASTSpine spine;
+            ast_spine_init(&spine, node);
+            for (int i = 0; i < spine.count; i++) fputc('(', out);
+            gen_node(spine.items[spine.count - 1]->data.binary_op.left, out);
+            for (int i = spine.count - 1; i >= 0; i--) {
+                fprintf(out, " %s ", spine.items[i]->data.binary_op.op);
+                gen_node(spine.items[i]->data.binary_op.right, out);
+                fputc(')', out);
+            }
+            ast_spine_free(&spine);
+            break;
+        }
+
+        case AST_INDEX: {
+            char* elem = type_array_elem(node->data.index.array->eval_type);
+            if (type_is_list(node->data.index.array->eval_type)) {
+                // Acesso direto ao buffer: sem chamada por elemento no laço
+                gen_node(node->data.index.array, out);
+                fprintf(out, ".data[");
+                gen_node(node->data.index.index, out);
+                fprintf(out, "]");
+            } else if (elem && is_soa_class(elem)) {
+                // Elemento inteiro de um array SoA: reconstrói a struct
+                fprintf(out, "%s_soa_get(", map_type(elem));
+                gen_node(node->data.index.array, out);
+                fprintf(out, ", ");
+                gen_node(node->data.index.index, out);
+                fprintf(out, ")");
+            } else {
+                gen_node(node->data.index.array, out);
+                fprintf(out, "[");
+                gen_node(node->data.index.index, out);
+                fprintf(out, "]");
+            }
+            break;
+        }
+
+        case AST_NEW: {
+            fprintf(out, "%s_new(", map_type(node->data.new_obj.type_name));
+            ASTNode* arg = node->data.new_obj.args;
+            while (arg) {
+                gen_node(arg, out);
+                if (arg->next) fprintf(out, ", ");
+                arg = arg->next;
+            }
+            fprintf(out, ")");
+            break;
+        }
+
+        case AST_METHOD_CALL: {
+            ASTNode* obj = node->data.method_call.object;
+            const char* obj_type = obj->eval_type ? obj->eval_type : "unknown";
+            int by_value = type_is_result(obj->eval_type) || type_is_channel(obj->eval_type);
+            int is_this = obj->type == AST_IDENTIFIER && strcmp(obj->data.ident.name, "this") == 0;
+            // Receptor num slot: elemento de array SoA (gravado de volta depois da
+            // chamada) ou temporário com heap (f().len(), liberado depois dela, a
+            // menos que o resultado possa apontar para ele)
+            int recv = -1;
+            int has_result = node->eval_type && strcmp(node->eval_type, "void") != 0;
+            int soa_recv = obj->type == AST_INDEX && !is_c_lvalue(obj);
+            // Result é recebido por valor: só is_ok/is_err deixam o valor dentro dele
+            int keeps = !by_value || (type_is_result(obj->eval_type) &&
+                        (strcmp(node->data.method_call.name, "is_ok") == 0 ||
+                         strcmp(node->data.method_call.name, "is_err") == 0));
+            int drop_recv = keeps && !is_this && !soa_recv && !is_c_lvalue(obj) &&
+                            semantic_is_owned(obj_type) && !(has_result && semantic_is_owned(node->eval_type));
+            if (soa_recv || drop_recv) {
+                recv = counters.tmp++;
+                fprintf(out, "({ %s _rj_recv%d = ", map_type(obj_type), recv);
+                gen_node(obj, out);
+                fprintf(out, "; ");
+                if (has_result) fprintf(out, "%s _rj_res%d = ", map_type(node->eval_type), recv);
+            }
+            fprintf(out, "%s_%s(", map_type(obj_type), node->data.method_call.name);
+            // Métodos recebem o objeto por ponteiro; this já é ponteiro
+            if (recv >= 0) {
+                fprintf(out, "%s_rj_recv%d", by_value ? "" : "&", recv);
+            } else if (by_value) {
+                gen_node(obj, out);
+            } else if (is_this) {
+                fprintf(out, "this");
+            } else if (is_c_lvalue(obj)) {
+                fprintf(out, "&(");
+                gen_node(obj, out);
+                fprintf(out, ")");
+            } else {
+                // Receptor temporário (f().m()): array literal de um item, que
+                // vive até o fim do bloco e decai para o ponteiro
+                fprintf(out, "(%s[]){ ", map_type(obj_type));
+                gen_node(obj, out);
+                fprintf(out, " }");
+            }
+            ASTNode* arg = node->data.method_call.args;
+            // send_batch / set_batch emprestam as listas (e as esvaziam)
+            int borrow = (type_is_channel(obj->eval_type) && strcmp(node->data.method_call.name, "send_batch") == 0) ||
+                         (type_is_map(obj->eval_type) && strcmp(node->data.method_call.name, "set_batch") == 0);
+            while (arg) {
+                fprintf(out, borrow ? ", &(" : ", ");
+                gen_node(arg, out);
+                if (borrow) fprintf(out, ")");
+                arg = arg->next;
+            }
             fprintf(out, ")");
+            if (soa_recv) {
+                fprintf(out, "; %s_soa_set(", map_type(obj_type));
+                gen_node(obj->data.index.array, out);
+                fprintf(out, ", ");
+                gen_node(obj->data.index.index, out);
+                fprintf(out, ", _rj_recv%d); ", recv);
+            } else if (drop_recv) {
+                fprintf(out, "; rujo_drop_%s(&_rj_recv%d); ", type_mangle(obj_type), recv);
+            }
+            if (recv >= 0) {
+                if (has_result) fprintf(out, "_rj_res%d; ", recv);
+                fprintf(out, "})");
+            }
+            break;
+        }
+
+        case AST_TRY: {
+            // expr? -> retorna o Err para quem chamou; o caminho feliz é só um teste de tag
+            int id = counters.tries++;
+            const char* res = map_type(node->data.try_expr.expr->eval_type);
+            const char* ret = map_type(node->data.try_expr.fn_return_type);
+            fprintf(out, "({ %s _rj_try%d = ", res, id);
+            gen_node(node->data.try_expr.expr, out);
+            if (node->drops || open_arena_count > 0 || open_loop_count > 0) {
+                // Como um return: o erro sai antes das liberações
+                fprintf(out, "; if (__builtin_expect(!_rj_try%d.is_ok, 0)) {\n", id);
+                fprintf(out, "%s _rj_err%d = %s_err(_rj_try%d.u.error);\n", ret, id, ret, id);
+                gen_drops(node->drops, out);
+                for (int i = open_loop_count - 1; i >= 0; i--) gen_for_in_cleanup(open_loops[i], out);
+                gen_arena_ends(out);
+                fprintf(out, "return _rj_err%d;\n} _rj_try%d.u.value; })", id, id);
+            } else {
+                fprintf(out, "; if (__builtin_expect(!_rj_try%d.is_ok, 0)) return %s_err(_rj_try%d.u.error); _rj_try%d.u.value; })",
+                    id, ret, id, id);
+            }
+            break;
+        }
+
+        case AST_NEW_ARRAY: {
+            const char* elem = node->data.new_array.elem_type;
+            if (is_soa_class(elem)) {
+                fprintf(out, "%s_soa_new(", map_type(elem));
+                gen_node(node->data.new_array.size, out);
+                fprintf(out, ")");
+            } else {
+                fprintf(out, "(%s*)rujo_array_new(", map_type(elem));
+                gen_node(node->data.new_array.size, out);
+                fprintf(out, ", sizeof(%s))", map_type(elem));
+            }
+            break;
+        }
+
+        case AST_ARENA: {
+            int id = counters.tmp++;
+            fprintf(out, "{\nRujoArena _rj_arena%d;\nrujo_arena_begin(&_rj_arena%d);\n", id, id);
+            int tracked = open_arena_count < 64;
+            if (tracked) open_arenas[open_arena_count++] = id;
+            gen_node(node->data.arena.body, out);
+            if (tracked) open_arena_count--;
+            fprintf(out, "rujo_arena_end(&_rj_arena%d);\n}\n", id);
+            break;
+        }
+
+        case AST_BENCH:
+            if (bench_mode) gen_bench(node, out);
+            break;
+
+        case AST_SPAWN: {
+            ASTNode* call = node->data.spawn.call;
+            int id = node->data.spawn.id;
+            int n = 0;
+            fprintf(out, "({ _rj_spawn%d_t* _s = malloc(sizeof(_rj_spawn%d_t)); ", id, id);
+            for (ASTNode* a = call->data.call.args; a; a = a->next) {
+                fprintf(out, "_s->a%d = ", n++);
+                gen_node(a, out);
+                fprintf(out, "; ");
+            }
+            fprintf(out, "%s(&_s->task, _rj_spawn%d_run); (%s){ &_s->task }; })",
+                node->data.spawn.blocking ? "rujo_spawn_blocking" : "rujo_spawn", id, map_type(node->eval_type));
             break;
+        }
 
         case AST_RETURN:
+            if (gen_mode == 2) {
+                // async fn: o resultado fica no frame, onde quem esperava o lê
+                fprintf(out, "{\n");
+                if (node->data.ret.value) {
+                    if (is_await(node->data.ret.value)) gen_await(node->data.ret.value, out);
+                    fprintf(out, "_f->_rj_ret = ");
+                    gen_node(node->data.ret.value, out);
+                    fprintf(out, ";\n");
+                }
+                gen_drops(node->drops, out);
+                for (int i = open_loop_count - 1; i >= 0; i--) gen_for_in_cleanup(open_loops[i], out);
+                gen_arena_ends(out);
+                fprintf(out, "_f->_rj_state = -1;\nreturn true;\n}\n");
+                break;
+            }
+            if (gen_mode) {
+                // Fim antecipado do gerador: o próximo resume devolve false
+                fprintf(out, "{\n");
+                gen_drops(node->drops, out);
+                for (int i = open_loop_count - 1; i >= 0; i--) gen_for_in_cleanup(open_loops[i], out);
+                gen_arena_ends(out);
+                fprintf(out, "_f->_rj_state = -1;\nreturn false;\n}\n");
+                break;
+            }
+            if (node->drops || open_arena_count > 0 || open_loop_count > 0) {
+                // O valor de retorno sai antes das liberações
+                int id = counters.tmp++;
+                fprintf(out, "{ ");
+                if (node->data.ret.value) {
+                    fprintf(out, "__auto_type _rj_ret%d = ", id);
+                    gen_node(node->data.ret.value, out);
+                    fprintf(out, ";");
+                }
+                fprintf(out, "\n");
+                gen_drops(node->drops, out);
+                for (int i = open_loop_count - 1; i >= 0; i--) gen_for_in_cleanup(open_loops[i], out);
+                gen_arena_ends(out);
+                if (node->data.ret.value) fprintf(out, "return _rj_ret%d; }\n", id);
+                else fprintf(out, "return; }\n");
+                break;
+            }
             fprintf(out, "return ");
             gen_node(node->data.ret.value, out);
             fprintf(out, ";\n");
@@ -154,123 +795,2286 @@ void gen_node(ASTNode* node, FILE* out) {
     }
 }
 
-void gen_structs(ASTNode* node, FILE* out) {
-    if (!node) return;
-    if (node->type == AST_CLASS_DECL) {
-        fprintf(out, "typedef struct {\n");
-        ASTNode* member = node->data.class_decl.members;
-        while (member) {
-            if (member->type == AST_PROP_DECL) {
-                fprintf(out, "    %s %s;\n", 
-                    map_type(member->data.var_decl.type_name), 
-                    member->data.var_decl.name);
-            }
-            member = member->next;
+// Layout struct-of-arrays: um ponteiro por prop, cada um com seu bloco contíguo
+void gen_soa_struct(ASTNode* node, FILE* out) {
+    const char* name = map_type(node->data.class_decl.name);
+    ASTNode* member;
+
+    fprintf(out, "typedef struct {\n");
+    for (member = node->data.class_decl.members; member; member = member->next) {
+        if (member->type == AST_PROP_DECL) {
+            fprintf(out, "    %s* restrict %s;\n",
+                map_type(member->data.var_decl.type_name), member->data.var_decl.name);
         }
-        fprintf(out, "} %s;\n\n", node->data.class_decl.name);
     }
-    gen_structs(node->next, out);
+    fprintf(out, "    int len;\n");
+    fprintf(out, "} %s_soa;\n\n", name);
+
+    fprintf(out, "static inline %s_soa %s_soa_new(int n) {\n", name, name);
+    fprintf(out, "    %s_soa s;\n", name);
+    fprintf(out, "    s.len = n;\n");
+    for (member = node->data.class_decl.members; member; member = member->next) {
+        if (member->type == AST_PROP_DECL) {
+            fprintf(out, "    s.%s = rujo_alloc((size_t)n * sizeof(%s));\n",
+                member->data.var_decl.name, map_type(member->data.var_decl.type_name));
+        }
+    }
+    fprintf(out, "    return s;\n");
+    fprintf(out, "}\n\n");
+
+    fprintf(out, "static inline %s %s_soa_get(%s_soa s, int i) {\n", name, name, name);
+    fprintf(out, "    %s e;\n", name);
+    for (member = node->data.class_decl.members; member; member = member->next) {
+        if (member->type == AST_PROP_DECL) {
+            fprintf(out, "    e.%s = s.%s[i];\n", member->data.var_decl.name, member->data.var_decl.name);
+        }
+    }
+    fprintf(out, "    return e;\n");
+    fprintf(out, "}\n\n");
+
+    fprintf(out, "static inline void %s_soa_set(%s_soa s, int i, %s e) {\n", name, name, name);
+    for (member = node->data.class_decl.members; member; member = member->next) {
+        if (member->type == AST_PROP_DECL) {
+            fprintf(out, "    s.%s[i] = e.%s;\n", member->data.var_decl.name, member->data.var_decl.name);
+        }
+    }
+    fprintf(out, "}\n\n");
 }
 
-void gen_methods(ASTNode* node, FILE* out) {
-    if (!node) return;
-    
-    if (node->type == AST_FN_DECL) {
-        if (strcmp(node->data.fn_decl.name, "main") != 0) {
-            fprintf(out, "%s %s(", map_type(node->data.fn_decl.return_type), node->data.fn_decl.name);
-            ASTNode* param = node->data.fn_decl.params;
-            int first = 1;
-            while (param) {
-                if (!first) fprintf(out, ", ");
-                fprintf(out, "%s %s", map_type(param->data.var_decl.type_name), param->data.var_decl.name);
-                first = 0;
-                param = param->next;
-            }
-            fprintf(out, ") ");
-            gen_node(node->data.fn_decl.body, out);
-            fprintf(out, "\n");
+// Structs já emitidas: membros por valor precisam vir antes de quem os usa
+static const char** emitted_structs = NULL;
+static int emitted_count = 0;
+
+int struct_emitted(const char* name) {
+    for (int i = 0; i < emitted_count; i++) {
+        if (strcmp(emitted_structs[i], name) == 0) return 1;
+    }
+    return 0;
+}
+
+void gen_struct_def(ASTNode* node, FILE* out) {
+    const char* name = node->data.class_decl.name;
+    if (struct_emitted(name)) return;
+    emitted_structs = realloc(emitted_structs, sizeof(char*) * (emitted_count + 1));
+    emitted_structs[emitted_count++] = name;
+
+    ASTNode* member = node->data.class_decl.members;
+    for (; member; member = member->next) {
+        if (member->type != AST_PROP_DECL) continue;
+        ASTNode* dep = find_class(member->data.var_decl.type_name);
+        if (dep) gen_struct_def(dep, out);
+    }
+
+    if (type_is_task(name)) {
+        // Handle por valor; o estado (tarefa + resultado) vive no heap até o join
+        const char* t = type_arg(name, 0);
+        fprintf(out, "struct %s { RujoTask* h; };\n", map_type(name));
+        fprintf(out, "typedef struct { RujoTask task; ");
+        if (strcmp(t, "void") != 0) fprintf(out, "%s result; ", map_type(t));
+        fprintf(out, "} %s_state;\n\n", map_type(name));
+        return;
+    }
+
+    if (type_is_channel(name)) {
+        // Handle por valor: cópias compartilham a mesma fila (contagem de referências)
+        fprintf(out, "struct %s { RujoChan* h; };\n\n", map_type(name));
+        return;
+    }
+
+    if (type_is_async(name)) {
+        // Handle por valor: frame da async fn no heap, poll e o resultado dentro do frame
+        const char* t = type_arg(name, 0);
+        fprintf(out, "struct %s { void* f; bool (*poll)(void*, RujoIoTask*); void (*drop)(void*);", map_type(name));
+        if (strcmp(t, "void") != 0) fprintf(out, " %s* ret;", map_type(t));
+        fprintf(out, " };\n\n");
+        return;
+    }
+
+    if (type_is_gen(name)) {
+        // Handle por valor: frame do gerador no heap + as funções da sua máquina de estados
+        fprintf(out, "struct %s { void* f; bool (*resume)(void*, %s*); void (*drop)(void*); };\n\n",
+            map_type(name), map_type(type_arg(name, 0)));
+        return;
+    }
+
+    if (type_is_result(name)) {
+        // Union + tag: Result<int, string> ocupa 16 bytes e volta em registradores
+        fprintf(out, "struct %s {\n", map_type(name));
+        fprintf(out, "    union { %s value; %s error; } u;\n",
+            map_type(type_arg(name, 0)), map_type(type_arg(name, 1)));
+        fprintf(out, "    bool is_ok;\n");
+        fprintf(out, "};\n\n");
+        return;
+    }
+
+    fprintf(out, "struct %s {\n", map_type(name));
+    member = node->data.class_decl.members;
+    while (member) {
+        if (member->type == AST_PROP_DECL) {
+            fprintf(out, "    %s %s;\n", 
+                map_type(member->data.var_decl.type_name), 
+                member->data.var_decl.name);
+        }
+        member = member->next;
+    }
+    fprintf(out, "};\n\n");
+
+    if (ast_has_annotation(node, "soa")) {
+        gen_soa_struct(node, out);
+    }
+}
+
+void gen_struct_forwards(ASTNode* node, FILE* out) {
+    for (; node; node = node->next) {
+        if (node->type == AST_CLASS_DECL && !node->data.class_decl.type_params &&
+            unit_has(node->data.class_decl.name)) {
+            const char* name = map_type(node->data.class_decl.name);
+            fprintf(out, "typedef struct %s %s;\n", name, name);
+        }
+    }
+}
+
+void gen_structs(ASTNode* node, FILE* out) {
+    for (; node; node = node->next) {
+        if (node->type == AST_CLASS_DECL && !node->data.class_decl.type_params &&
+            unit_has(node->data.class_decl.name)) {
+            gen_struct_def(node, out);
         }
     }
-    else if (node->type == AST_CLASS_DECL) {
-        char* class_name = node->data.class_decl.name;
+}
+
+// Assinatura C de uma função solta ou método (class_decl != NULL); suffix
+// vai no fim do nome (corpo de uma função sondada)
+void gen_fn_signature_as(ASTNode* fn, ASTNode* class_decl, const char* suffix, FILE* out) {
+    const char* ret = map_type(fn->data.fn_decl.return_type);
+    ASTNode* param = fn->data.fn_decl.params;
+    int first = 1;
+
+    if (class_decl) {
+        const char* class_name = map_type(class_decl->data.class_decl.name);
+        fprintf(out, "%s %s_%s%s(%s* this", ret, class_name, fn->data.fn_decl.name, suffix, class_name);
+        first = 0;
+    } else {
+        fprintf(out, "%s %s%s(", ret, map_type(fn->data.fn_decl.name), suffix);
+    }
+    while (param) {
+        if (!first) fprintf(out, ", ");
+        fprintf(out, "%s %s", map_type(param->data.var_decl.type_name), param->data.var_decl.name);
+        first = 0;
+        param = param->next;
+    }
+    if (first) fprintf(out, "void");
+    fprintf(out, ")");
+}
+
+void gen_fn_signature(ASTNode* fn, ASTNode* class_decl, FILE* out) {
+    gen_fn_signature_as(fn, class_decl, "", out);
+}
+
+ASTNode* find_init(ASTNode* class_decl) {
+    ASTNode* member = class_decl->data.class_decl.members;
+    for (; member; member = member->next) {
+        if (member->type == AST_FN_DECL && strcmp(member->data.fn_decl.name, "init") == 0) return member;
+    }
+    return NULL;
+}
+
+// Construtor por valor usado por "new Classe(args)"
+void gen_constructor_signature(ASTNode* class_decl, FILE* out) {
+    const char* name = map_type(class_decl->data.class_decl.name);
+    ASTNode* init = find_init(class_decl);
+    fprintf(out, "static inline %s %s_new(", name, name);
+    ASTNode* param = init ? init->data.fn_decl.params : NULL;
+    if (!param) fprintf(out, "void");
+    while (param) {
+        fprintf(out, "%s %s", map_type(param->data.var_decl.type_name), param->data.var_decl.name);
+        if (param->next) fprintf(out, ", ");
+        param = param->next;
+    }
+    fprintf(out, ")");
+}
+
+void gen_prototype(ASTNode* node, FILE* out) {
+    if (node->type == AST_FN_DECL && !node->data.fn_decl.type_params &&
+        strcmp(node->data.fn_decl.name, "main") != 0) {
+        gen_fn_signature(node, NULL, out);
+        fprintf(out, ";\n");
+    }
+    else if (node->type == AST_CLASS_DECL && !node->data.class_decl.type_params &&
+             !is_builtin_type(node->data.class_decl.name)) {
         ASTNode* member = node->data.class_decl.members;
         while (member) {
             if (member->type == AST_FN_DECL) {
-                char func_name[128];
-                if (strcmp(member->data.fn_decl.name, "init") == 0) {
-                    sprintf(func_name, "%s_init", class_name);
-                } else {
-                    sprintf(func_name, "%s_%s", class_name, member->data.fn_decl.name);
-                }
-                fprintf(out, "void %s(%s* this", func_name, class_name);
-                ASTNode* param = member->data.fn_decl.params;
-                while (param) {
-                    fprintf(out, ", %s %s", map_type(param->data.var_decl.type_name), param->data.var_decl.name);
-                    param = param->next;
-                }
-                fprintf(out, ") ");
-                gen_node(member->data.fn_decl.body, out);
-                fprintf(out, "\n");
+                gen_fn_signature(member, node, out);
+                fprintf(out, ";\n");
             }
             member = member->next;
         }
+        gen_constructor_signature(node, out);
+        fprintf(out, ";\n");
     }
+}
 
-    gen_methods(node->next, out);
+void gen_prototypes(ASTNode* node, FILE* out) {
+    for (; node; node = node->next) gen_prototype(node, out);
 }
 
-void gen_main(ASTNode* node, FILE* out) {
-    fprintf(out, "int main() {\n");
-    ASTNode* current = node;
-    while (current) {
-        if (current->type != AST_CLASS_DECL && current->type != AST_FN_DECL) {
-            gen_node(current, out);
-            // Também adiciona ; no main se for solto
-            if (current->type == AST_CALL || current->type == AST_ASSIGN) {
-                fprintf(out, ";\n");
-            }
-        }
-        current = current->next;
-    }
-    fprintf(out, "    return 0;\n");
+// List<T>: especializada por tipo de elemento, sem void* nem indireção extra
+void gen_list_impl(ASTNode* class_decl, FILE* out) {
+    const char* name = map_type(class_decl->data.class_decl.name);
+    const char* t = map_type(type_arg(class_decl->data.class_decl.name, 0));
+
+    fprintf(out, "static inline %s %s_new(void) { %s l = { 0 }; return l; }\n", name, name, name);
+    fprintf(out, "static inline void %s_reserve(%s* l, int n) {\n", name, name);
+    fprintf(out, "    if (n > l->cap) { l->data = rujo_realloc(l->data, (size_t)n * sizeof(%s)); l->cap = n; }\n", t);
     fprintf(out, "}\n");
+    fprintf(out, "static inline void %s_push(%s* l, %s v) {\n", name, name, t);
+    fprintf(out, "    if (__builtin_expect(l->len == l->cap, 0)) %s_reserve(l, l->cap ? l->cap * 2 : 8);\n", name);
+    fprintf(out, "    l->data[l->len++] = v;\n");
+    fprintf(out, "}\n");
+    fprintf(out, "static inline %s %s_pop(%s* l) { return l->data[--l->len]; }\n", t, name, name);
+    fprintf(out, "static inline %s %s_get(%s* l, int i) { return l->data[i]; }\n", t, name, name);
+    fprintf(out, "static inline void %s_set(%s* l, int i, %s v) { l->data[i] = v; }\n", name, name, t);
+    fprintf(out, "static inline int %s_len(%s* l) { return l->len; }\n", name, name);
+    fprintf(out, "static inline void %s_clear(%s* l) { l->len = 0; }\n\n", name, name);
 }
 
-void codegen_generate(ASTNode* root, FILE* out) {
-    fprintf(out, "#include <stdio.h>\n");
-    fprintf(out, "#include <stdlib.h>\n");
-    fprintf(out, "#include <stdint.h>\n");
-    fprintf(out, "#include <stdbool.h>\n\n");
+// Map<K, V>: Swiss table especializada por tipo. Controle, chaves e valores
+// num só bloco; h1 (bits altos do hash) escolhe o grupo, h2 (7 bits) vai no
+// byte de controle. Grupos são sondados em passos triangulares, que cobrem
+// todos quando o número de grupos é potência de 2.
+void gen_map_impl(ASTNode* class_decl, FILE* out) {
+    const char* type = class_decl->data.class_decl.name;
+    const char* name = map_type(type);
+    char* key = type_arg(type, 0);
+    char* val = type_arg(type, 1);
+    const char* k = map_type(key);
+    const char* v = map_type(val);
+    int owned = semantic_is_owned(val);
+    const char* vm = type_mangle(val);
 
-    fprintf(out, "void print_int(int x) { printf(\"%%d\\n\", x); }\n");
-    fprintf(out, "void print_float(float x) { printf(\"%%f\\n\", x); }\n"); 
-    fprintf(out, "void print_string(const char* x) { printf(\"%%s\\n\", x); }\n");
-    fprintf(out, "void print_bool(bool x) { printf(\"%%s\\n\", x ? \"true\" : \"false\"); }\n\n");
+    char* result_type = (char*)malloc(strlen(val) + 16);
+    sprintf(result_type, "Result<%s,string>", val);
+    const char* res = map_type(result_type);
+    char* klist_type = (char*)malloc(strlen(key) + 7);
+    sprintf(klist_type, "List<%s>", key);
+    char* vlist_type = (char*)malloc(strlen(val) + 7);
+    sprintf(vlist_type, "List<%s>", val);
 
-    fprintf(out, "#define RUJO_PRINT(x) _Generic((x), \\\n");
-    fprintf(out, "    int: print_int, \\\n");
-    fprintf(out, "    float: print_float, \\\n");
-    fprintf(out, "    double: print_float, \\\n");
-    fprintf(out, "    bool: print_bool, \\\n");
-    fprintf(out, "    char*: print_string, \\\n");
-    fprintf(out, "    const char*: print_string \\\n");
-    fprintf(out, ")(x)\n\n");
+    fprintf(out, "static inline %s %s_new(void) { %s m = { 0 }; return m; }\n", name, name, name);
+    if (strcmp(key, "string") == 0) {
+        fprintf(out, "static inline uint64_t %s_hash(%s k) { return rujo_hash_str(k); }\n", name, k);
+        fprintf(out, "static inline bool %s_eq(%s a, %s b) { return a == b || strcmp(a, b) == 0; }\n", name, k, k);
+    } else {
+        fprintf(out, "static inline uint64_t %s_hash(%s k) { return rujo_hash_u64((uint64_t)k); }\n", name, k);
+        fprintf(out, "static inline bool %s_eq(%s a, %s b) { return a == b; }\n", name, k, k);
+    }
 
-    fprintf(out, "#define RUJO_TYPEOF(x) _Generic((x), \\\n");
-    fprintf(out, "    _Bool: \"bool\", \\\n");
-    fprintf(out, "    uint8_t: \"byte\", \\\n");
-    fprintf(out, "    int: \"int\", \\\n");
-    fprintf(out, "    float: \"float\", \\\n");
-    fprintf(out, "    double: \"float\", \\\n");
-    fprintf(out, "    uint32_t: \"char\", \\\n");
-    fprintf(out, "    char*: \"string\", \\\n");
-    fprintf(out, "    const char*: \"string\", \\\n");
-    fprintf(out, "    default: \"unknown\" \\\n");
-    fprintf(out, ")\n\n");
+    // Slot com a chave ou -1; um grupo com slot vazio encerra a busca
+    fprintf(out, "static inline int64_t %s_find(%s* m, %s k, uint64_t h) {\n", name, name, k);
+    fprintf(out, "    if (__builtin_expect(m->cap == 0, 0)) return -1;\n");
+    fprintf(out, "    size_t mask = (size_t)m->cap / RUJO_MAP_GROUP - 1;\n");
+    fprintf(out, "    size_t g = (size_t)(h >> 7) & mask;\n");
+    fprintf(out, "    for (size_t step = 1;; step++) {\n");
+    fprintf(out, "        const uint8_t* c = m->ctrl + g * RUJO_MAP_GROUP;\n");
+    fprintf(out, "        for (uint32_t b = rujo_map_match(c, (uint8_t)(h & 0x7F)); b; b &= b - 1) {\n");
+    fprintf(out, "            size_t i = g * RUJO_MAP_GROUP + (size_t)__builtin_ctz(b);\n");
+    fprintf(out, "            if (__builtin_expect(%s_eq(m->keys[i], k), 1)) return (int64_t)i;\n", name);
+    fprintf(out, "        }\n");
+    fprintf(out, "        if (__builtin_expect(rujo_map_match_empty(c) != 0, 1)) return -1;\n");
+    fprintf(out, "        g = (g + step) & mask;\n");
+    fprintf(out, "    }\n}\n");
 
-    if (root->type == AST_PROGRAM) {
-        gen_structs(root->data.program.statements, out);
-        gen_methods(root->data.program.statements, out);
-        gen_main(root->data.program.statements, out);
+    // Primeiro slot vazio ou apagado na sequência de sondagem de h
+    fprintf(out, "static inline size_t %s_free_slot(%s* m, uint64_t h) {\n", name, name);
+    fprintf(out, "    size_t mask = (size_t)m->cap / RUJO_MAP_GROUP - 1;\n");
+    fprintf(out, "    size_t g = (size_t)(h >> 7) & mask;\n");
+    fprintf(out, "    for (size_t step = 1;; step++) {\n");
+    fprintf(out, "        uint32_t b = rujo_map_match_free(m->ctrl + g * RUJO_MAP_GROUP);\n");
+    fprintf(out, "        if (b) return g * RUJO_MAP_GROUP + (size_t)__builtin_ctz(b);\n");
+    fprintf(out, "        g = (g + step) & mask;\n");
+    fprintf(out, "    }\n}\n");
+
+    // Novo bloco com cap slots; reinsere os ocupados (apagados somem)
+    fprintf(out, "static void %s_resize(%s* m, int cap) {\n", name, name);
+    fprintf(out, "    uint8_t* old_ctrl = m->ctrl;\n");
+    fprintf(out, "    %s* old_keys = m->keys;\n", k);
+    fprintf(out, "    %s* old_vals = m->vals;\n", v);
+    fprintf(out, "    int old_cap = m->cap;\n");
+    fprintf(out, "    uint8_t* block = rujo_alloc((size_t)cap * (1 + sizeof(%s) + sizeof(%s)));\n", k, v);
+    fprintf(out, "    m->ctrl = block;\n");
+    fprintf(out, "    m->keys = (%s*)(block + cap);\n", k);
+    fprintf(out, "    m->vals = (%s*)(block + (size_t)cap * (1 + sizeof(%s)));\n", v, k);
+    fprintf(out, "    m->cap = cap;\n");
+    fprintf(out, "    memset(m->ctrl, RUJO_MAP_EMPTY, (size_t)cap);\n");
+    fprintf(out, "    for (int i = 0; i < old_cap; i++) {\n");
+    fprintf(out, "        if (old_ctrl[i] & 0x80) continue;\n");
+    fprintf(out, "        uint64_t h = %s_hash(old_keys[i]);\n", name);
+    fprintf(out, "        size_t j = %s_free_slot(m, h);\n", name);
+    fprintf(out, "        m->ctrl[j] = (uint8_t)(h & 0x7F);\n");
+    fprintf(out, "        m->keys[j] = old_keys[i];\n");
+    fprintf(out, "        m->vals[j] = old_vals[i];\n");
+    fprintf(out, "    }\n");
+    fprintf(out, "    m->left = cap - cap / 8 - m->len;\n");
+    fprintf(out, "    rujo_free(old_ctrl);\n}\n");
+
+    fprintf(out, "static inline void %s_reserve(%s* m, int n) {\n", name, name);
+    fprintf(out, "    int cap = rujo_map_capacity(n);\n");
+    fprintf(out, "    if (cap > m->cap) %s_resize(m, cap);\n}\n", name);
+
+    // Sem slot vazio sobrando: se metade do limite for de apagados basta
+    // reorganizar no mesmo tamanho, senão dobra
+    fprintf(out, "static void %s_grow(%s* m) {\n", name, name);
+    fprintf(out, "    if (m->cap == 0) %s_resize(m, RUJO_MAP_GROUP);\n", name);
+    fprintf(out, "    else if (m->len < (m->cap - m->cap / 8) / 2) %s_resize(m, m->cap);\n", name);
+    fprintf(out, "    else %s_resize(m, m->cap * 2);\n}\n", name);
+
+    fprintf(out, "static inline void %s_set(%s* m, %s k, %s v) {\n", name, name, k, v);
+    fprintf(out, "    uint64_t h = %s_hash(k);\n", name);
+    fprintf(out, "    int64_t i = %s_find(m, k, h);\n", name);
+    fprintf(out, "    if (i >= 0) {\n");
+    if (owned) fprintf(out, "        rujo_drop_%s(&m->vals[i]);\n", vm);
+    fprintf(out, "        m->vals[i] = v;\n        return;\n    }\n");
+    fprintf(out, "    if (__builtin_expect(m->left == 0, 0)) %s_grow(m);\n", name);
+    fprintf(out, "    size_t j = %s_free_slot(m, h);\n", name);
+    fprintf(out, "    if (m->ctrl[j] == RUJO_MAP_EMPTY) m->left--;\n");
+    fprintf(out, "    m->ctrl[j] = (uint8_t)(h & 0x7F);\n");
+    fprintf(out, "    m->keys[j] = k;\n");
+    fprintf(out, "    m->vals[j] = v;\n");
+    fprintf(out, "    m->len++;\n}\n");
+
+    fprintf(out, "static inline bool %s_has(%s* m, %s k) { return %s_find(m, k, %s_hash(k)) >= 0; }\n", name, name, k, name, name);
+    fprintf(out, "static inline %s %s_get(%s* m, %s k) {\n", res, name, name, k);
+    fprintf(out, "    int64_t i = %s_find(m, k, %s_hash(k));\n", name, name);
+    fprintf(out, "    if (__builtin_expect(i < 0, 0)) return %s_err(\"ausente\");\n", res);
+    if (owned) fprintf(out, "    return %s_ok(rujo_clone_%s(m->vals[i]));\n}\n", res, vm);
+    else fprintf(out, "    return %s_ok(m->vals[i]);\n}\n", res);
+    fprintf(out, "static inline %s %s_get_or(%s* m, %s k, %s d) {\n", v, name, name, k, v);
+    fprintf(out, "    int64_t i = %s_find(m, k, %s_hash(k));\n", name, name);
+    fprintf(out, "    if (i < 0) return d;\n");
+    if (owned) {
+        fprintf(out, "    rujo_drop_%s(&d);\n", vm);
+        fprintf(out, "    return rujo_clone_%s(m->vals[i]);\n}\n", vm);
+    } else {
+        fprintf(out, "    return m->vals[i];\n}\n");
+    }
+
+    // Grupo que ainda tem vazio nunca fez uma busca seguir adiante: o slot
+    // removido pode voltar a vazio em vez de virar apagado
+    fprintf(out, "static inline bool %s_remove(%s* m, %s k) {\n", name, name, k);
+    fprintf(out, "    int64_t i = %s_find(m, k, %s_hash(k));\n", name, name);
+    fprintf(out, "    if (i < 0) return false;\n");
+    if (owned) fprintf(out, "    rujo_drop_%s(&m->vals[i]);\n", vm);
+    fprintf(out, "    if (rujo_map_match_empty(m->ctrl + (i & ~(int64_t)(RUJO_MAP_GROUP - 1)))) {\n");
+    fprintf(out, "        m->ctrl[i] = RUJO_MAP_EMPTY;\n        m->left++;\n");
+    fprintf(out, "    } else {\n        m->ctrl[i] = RUJO_MAP_DELETED;\n    }\n");
+    fprintf(out, "    m->len--;\n    return true;\n}\n");
+
+    fprintf(out, "static inline int %s_len(%s* m) { return m->len; }\n", name, name);
+    fprintf(out, "static inline void %s_clear(%s* m) {\n", name, name);
+    if (owned) {
+        fprintf(out, "    for (int i = 0; i < m->cap; i++) if (!(m->ctrl[i] & 0x80)) rujo_drop_%s(&m->vals[i]);\n", vm);
+    }
+    fprintf(out, "    if (m->cap) memset(m->ctrl, RUJO_MAP_EMPTY, (size_t)m->cap);\n");
+    fprintf(out, "    m->len = 0;\n");
+    fprintf(out, "    m->left = m->cap - m->cap / 8;\n}\n");
+
+    // Inserção em lote: reserva uma vez e pede ao cache o grupo de uma chave
+    // alguns passos à frente, escondendo a latência das falhas de cache
+    fprintf(out, "static void %s_set_batch(%s* m, %s* ks, %s* vs) {\n", name, name, map_type(klist_type), map_type(vlist_type));
+    fprintf(out, "    int n = ks->len < vs->len ? ks->len : vs->len;\n");
+    fprintf(out, "    %s_reserve(m, m->len + n);\n", name);
+    fprintf(out, "    size_t mask = (size_t)m->cap / RUJO_MAP_GROUP - 1;\n");
+    fprintf(out, "    for (int i = 0; i < n; i++) {\n");
+    fprintf(out, "        if (i + 8 < n) __builtin_prefetch(m->ctrl + ((size_t)(%s_hash(ks->data[i + 8]) >> 7) & mask) * RUJO_MAP_GROUP);\n", name);
+    fprintf(out, "        %s_set(m, ks->data[i], vs->data[i]);\n", name);
+    fprintf(out, "    }\n");
+    if (owned) fprintf(out, "    for (int i = n; i < vs->len; i++) rujo_drop_%s(&vs->data[i]);\n", vm);
+    fprintf(out, "    ks->len = 0;\n    vs->len = 0;\n}\n\n");
+}
+
+// Result<T, E>: recebido por valor para que r.is_ok() funcione direto sobre chamadas;
+// o caminho de erro é marcado como improvável
+void gen_result_impl(ASTNode* class_decl, FILE* out) {
+    const char* name = map_type(class_decl->data.class_decl.name);
+    const char* t = map_type(type_arg(class_decl->data.class_decl.name, 0));
+    const char* e = map_type(type_arg(class_decl->data.class_decl.name, 1));
+
+    fprintf(out, "static inline %s %s_ok(%s v) { %s r; r.u.value = v; r.is_ok = true; return r; }\n", name, name, t, name);
+    fprintf(out, "static inline %s %s_err(%s e) { %s r; r.u.error = e; r.is_ok = false; return r; }\n", name, name, e, name);
+    fprintf(out, "static inline bool %s_is_ok(%s r) { return __builtin_expect(r.is_ok, 1); }\n", name, name);
+    fprintf(out, "static inline bool %s_is_err(%s r) { return __builtin_expect(!r.is_ok, 0); }\n", name, name);
+    if (!semantic_is_owned(class_decl->data.class_decl.name)) {
+        fprintf(out, "static inline %s %s_unwrap_or(%s r, %s d) { return __builtin_expect(r.is_ok, 1) ? r.u.value : d; }\n", t, name, name, t);
+        fprintf(out, "static inline %s %s_error(%s r) { return r.u.error; }\n", e, name, name);
+    } else {
+        // Com heap: unwrap_or libera o que não devolve; error() em Ok entregaria lixo
+        const char* ok_type = type_arg(class_decl->data.class_decl.name, 0);
+        const char* err_type = type_arg(class_decl->data.class_decl.name, 1);
+        fprintf(out, "static inline %s %s_unwrap_or(%s r, %s d) {\n", t, name, name, t);
+        fprintf(out, "    if (__builtin_expect(r.is_ok, 1)) {\n");
+        if (semantic_is_owned(ok_type)) fprintf(out, "        rujo_drop_%s(&d);\n", type_mangle(ok_type));
+        fprintf(out, "        return r.u.value;\n    }\n");
+        if (semantic_is_owned(err_type)) fprintf(out, "    rujo_drop_%s(&r.u.error);\n", type_mangle(err_type));
+        fprintf(out, "    return d;\n}\n");
+        fprintf(out, "static inline %s %s_error(%s r) {\n", e, name, name);
+        fprintf(out, "    if (__builtin_expect(r.is_ok, 0)) { fprintf(stderr, \"error() em Ok\\n\"); abort(); }\n");
+        fprintf(out, "    return r.u.error;\n");
+        fprintf(out, "}\n");
+    }
+    fprintf(out, "static inline %s %s_unwrap(%s r) {\n", t, name, name);
+    fprintf(out, "    if (__builtin_expect(!r.is_ok, 0)) { fprintf(stderr, \"unwrap() em Err\\n\"); abort(); }\n");
+    fprintf(out, "    return r.u.value;\n");
+    fprintf(out, "}\n\n");
+}
+
+// rujo_drop_* / rujo_clone_* para cada tipo com heap que o programa usa
+void gen_owned_decl(const char* type, FILE* out) {
+    const char* c = map_type(type);
+    const char* m = type_mangle(type);
+    fprintf(out, "static void rujo_drop_%s(%s* v);\n", m, c);
+    fprintf(out, "static %s rujo_clone_%s(%s v);\n", c, m, c);
+}
+
+void gen_owned_impl(const char* type, FILE* out) {
+    const char* c = map_type(type);
+    const char* m = type_mangle(type);
+    char* elem = type_array_elem(type);
+
+    if (type_is_task(type)) {
+        // Sair do escopo sem join espera a tarefa: nada roda solto depois do dono
+        char* t = type_arg(type, 0);
+        fprintf(out, "static void rujo_drop_%s(%s* v) {\n", m, c);
+        fprintf(out, "    if (!v->h) return;\n");
+        fprintf(out, "    rujo_task_join(v->h);\n");
+        if (semantic_is_owned(t)) {
+            fprintf(out, "    rujo_drop_%s(&((%s_state*)v->h)->result);\n", type_mangle(t), c);
+        }
+        fprintf(out, "    free(v->h);\n    v->h = NULL;\n}\n");
+        fprintf(out, "static %s rujo_clone_%s(%s v) { return v; } // nunca usado: Task só é movida\n\n", c, m, c);
+        return;
+    }
+
+    if (type_is_file_writer(type)) {
+        // Sair de escopo escreve o que restou no buffer e fecha o arquivo
+        fprintf(out, "static void rujo_drop_%s(%s* v) {\n", m, c);
+        fprintf(out, "    if (!v->h) return;\n");
+        fprintf(out, "    rujo_writer_close(v->h);\n    v->h = NULL;\n}\n");
+        fprintf(out, "static %s rujo_clone_%s(%s v) { return v; } // nunca usado: só é movido\n\n", c, m, c);
+        return;
+    }
+
+    if (type_is_channel(type)) {
+        // A última referência esvazia a fila liberando os itens que ninguém recebeu
+        char* t = type_arg(type, 0);
+        fprintf(out, "static void rujo_drop_%s(%s* v) {\n", m, c);
+        fprintf(out, "    if (!v->h) return;\n");
+        fprintf(out, "    if (rujo_chan_release(v->h)) {\n");
+        if (semantic_is_owned(t)) {
+            fprintf(out, "        %s x;\n", map_type(t));
+            fprintf(out, "        while (rujo_chan_pop(v->h, &x)) rujo_drop_%s(&x);\n", type_mangle(t));
+        }
+        fprintf(out, "        rujo_chan_free(v->h);\n    }\n    v->h = NULL;\n}\n");
+        fprintf(out, "static %s rujo_clone_%s(%s v) { if (v.h) rujo_chan_retain(v.h); return v; }\n\n", c, m, c);
+        return;
+    }
+
+    if (type_is_result(type)) {
+        // Só a variante ativa (pela tag) tem valor para liberar/copiar
+        char* t = type_arg(type, 0);
+        char* e = type_arg(type, 1);
+        fprintf(out, "static void rujo_drop_%s(%s* v) {\n", m, c);
+        if (semantic_is_owned(t)) fprintf(out, "    if (v->is_ok) rujo_drop_%s(&v->u.value);\n", type_mangle(t));
+        if (semantic_is_owned(e)) fprintf(out, "    if (!v->is_ok) rujo_drop_%s(&v->u.error);\n", type_mangle(e));
+        fprintf(out, "}\n");
+        fprintf(out, "static %s rujo_clone_%s(%s v) {\n", c, m, c);
+        fprintf(out, "    %s c = v;\n", c);
+        if (semantic_is_owned(t)) fprintf(out, "    if (v.is_ok) c.u.value = rujo_clone_%s(v.u.value);\n", type_mangle(t));
+        if (semantic_is_owned(e)) fprintf(out, "    if (!v.is_ok) c.u.error = rujo_clone_%s(v.u.error);\n", type_mangle(e));
+        fprintf(out, "    return c;\n}\n\n");
+        return;
+    }
+
+    if (type_is_gen(type) || type_is_async(type)) {
+        // Gerador/async fn abandonado antes do fim: o frame libera o que ainda segurava
+        fprintf(out, "static void rujo_drop_%s(%s* v) {\n", m, c);
+        fprintf(out, "    if (!v->f) return;\n");
+        fprintf(out, "    v->drop(v->f);\n    v->f = NULL;\n}\n");
+        fprintf(out, "static %s rujo_clone_%s(%s v) { return v; } // nunca usado: só é movido\n\n", c, m, c);
+        return;
+    }
+
+    if (elem && is_soa_class(elem)) {
+        ASTNode* cls = find_class(elem);
+        fprintf(out, "static void rujo_drop_%s(%s* v) {\n", m, c);
+        for (ASTNode* p = cls->data.class_decl.members; p; p = p->next) {
+            if (p->type == AST_PROP_DECL) fprintf(out, "    rujo_free(v->%s);\n", p->data.var_decl.name);
+        }
+        fprintf(out, "    memset(v, 0, sizeof(*v));\n}\n");
+        fprintf(out, "static %s rujo_clone_%s(%s v) {\n", c, m, c);
+        fprintf(out, "    %s c = %s_soa_new(v.len);\n", c, map_type(elem));
+        for (ASTNode* p = cls->data.class_decl.members; p; p = p->next) {
+            if (p->type != AST_PROP_DECL) continue;
+            fprintf(out, "    if (v.len) memcpy(c.%s, v.%s, (size_t)v.len * sizeof(%s));\n",
+                p->data.var_decl.name, p->data.var_decl.name, map_type(p->data.var_decl.type_name));
+        }
+        fprintf(out, "    return c;\n}\n\n");
+        return;
+    }
+
+    if (elem) {
+        int deep = semantic_is_owned(elem);
+        fprintf(out, "static void rujo_drop_%s(%s* v) {\n", m, c);
+        fprintf(out, "    if (!*v) return;\n");
+        if (deep) {
+            fprintf(out, "    for (int64_t i = 0; i < rujo_array_len(*v); i++) rujo_drop_%s(&(*v)[i]);\n", type_mangle(elem));
+        }
+        fprintf(out, "    rujo_array_free(*v);\n    *v = NULL;\n}\n");
+        fprintf(out, "static %s rujo_clone_%s(%s v) {\n", c, m, c);
+        fprintf(out, "    %s c = rujo_array_clone(v, sizeof(%s));\n", c, map_type(elem));
+        if (deep) {
+            fprintf(out, "    for (int64_t i = 0; i < rujo_array_len(v); i++) c[i] = rujo_clone_%s(v[i]);\n", type_mangle(elem));
+        }
+        fprintf(out, "    return c;\n}\n\n");
+        return;
+    }
+
+    if (type_is_map(type)) {
+        // Um bloco só (controle + chaves + valores); valores com heap percorrem os slots ocupados
+        char* k = type_arg(type, 0);
+        char* t = type_arg(type, 1);
+        int deep = semantic_is_owned(t);
+        fprintf(out, "static void rujo_drop_%s(%s* v) {\n", m, c);
+        if (deep) {
+            fprintf(out, "    for (int i = 0; i < v->cap; i++) if (!(v->ctrl[i] & 0x80)) rujo_drop_%s(&v->vals[i]);\n", type_mangle(t));
+        }
+        fprintf(out, "    rujo_free(v->ctrl);\n    memset(v, 0, sizeof(*v));\n}\n");
+        fprintf(out, "static %s rujo_clone_%s(%s v) {\n", c, m, c);
+        fprintf(out, "    %s c = v;\n", c);
+        fprintf(out, "    if (!v.cap) return c;\n");
+        fprintf(out, "    size_t bytes = (size_t)v.cap * (1 + sizeof(%s) + sizeof(%s));\n", map_type(k), map_type(t));
+        fprintf(out, "    c.ctrl = rujo_alloc(bytes);\n");
+        fprintf(out, "    memcpy(c.ctrl, v.ctrl, bytes);\n");
+        fprintf(out, "    c.keys = (%s*)(c.ctrl + v.cap);\n", map_type(k));
+        fprintf(out, "    c.vals = (%s*)(c.ctrl + (size_t)v.cap * (1 + sizeof(%s)));\n", map_type(t), map_type(k));
+        if (deep) {
+            fprintf(out, "    for (int i = 0; i < v.cap; i++) if (!(v.ctrl[i] & 0x80)) c.vals[i] = rujo_clone_%s(v.vals[i]);\n", type_mangle(t));
+        }
+        fprintf(out, "    return c;\n}\n\n");
+        return;
+    }
+
+    if (type_is_list(type)) {
+        char* t = type_arg(type, 0);
+        int deep = semantic_is_owned(t);
+        fprintf(out, "static void rujo_drop_%s(%s* v) {\n", m, c);
+        if (deep) {
+            fprintf(out, "    for (int i = 0; i < v->len; i++) rujo_drop_%s(&v->data[i]);\n", type_mangle(t));
+        }
+        fprintf(out, "    rujo_free(v->data);\n    memset(v, 0, sizeof(*v));\n}\n");
+        fprintf(out, "static %s rujo_clone_%s(%s v) {\n", c, m, c);
+        fprintf(out, "    %s c = v;\n", c);
+        fprintf(out, "    if (!v.cap) return c;\n");
+        fprintf(out, "    c.data = rujo_alloc((size_t)v.cap * sizeof(%s));\n", map_type(t));
+        if (deep) {
+            fprintf(out, "    for (int i = 0; i < v.len; i++) c.data[i] = rujo_clone_%s(v.data[i]);\n", type_mangle(t));
+        } else {
+            fprintf(out, "    memcpy(c.data, v.data, (size_t)v.len * sizeof(%s));\n", map_type(t));
+        }
+        fprintf(out, "    return c;\n}\n\n");
+        return;
+    }
+
+    // Classe: libera/copia só as props que têm heap
+    ASTNode* cls = find_class(type);
+    fprintf(out, "static void rujo_drop_%s(%s* v) {\n", m, c);
+    for (ASTNode* p = cls ? cls->data.class_decl.members : NULL; p; p = p->next) {
+        if (p->type == AST_PROP_DECL && semantic_is_owned(p->data.var_decl.type_name)) {
+            fprintf(out, "    rujo_drop_%s(&v->%s);\n", type_mangle(p->data.var_decl.type_name), p->data.var_decl.name);
+        }
+    }
+    fprintf(out, "}\n");
+    fprintf(out, "static %s rujo_clone_%s(%s v) {\n", c, m, c);
+    fprintf(out, "    %s c = v;\n", c);
+    for (ASTNode* p = cls ? cls->data.class_decl.members : NULL; p; p = p->next) {
+        if (p->type == AST_PROP_DECL && semantic_is_owned(p->data.var_decl.type_name)) {
+            fprintf(out, "    c.%s = rujo_clone_%s(v.%s);\n", p->data.var_decl.name,
+                type_mangle(p->data.var_decl.type_name), p->data.var_decl.name);
+        }
+    }
+    fprintf(out, "    return c;\n}\n\n");
+}
+
+void gen_owned_helpers(FILE* out) {
+    ASTNode* t;
+    for (t = semantic_owned_types(); t; t = t->next) {
+        if (unit_has(t->data.ident.name)) gen_owned_decl(t->data.ident.name, out);
+    }
+    fprintf(out, "\n");
+    for (t = semantic_owned_types(); t; t = t->next) {
+        if (unit_has(t->data.ident.name)) gen_owned_impl(t->data.ident.name, out);
+    }
+}
+
+// Task<T>: join espera (ajudando o pool), entrega o resultado e libera o estado
+void gen_task_impl(ASTNode* class_decl, FILE* out) {
+    const char* name = map_type(class_decl->data.class_decl.name);
+    const char* t = type_arg(class_decl->data.class_decl.name, 0);
+    int has_result = strcmp(t, "void") != 0;
+
+    fprintf(out, "static inline %s %s_join(%s* t) {\n", map_type(t), name, name);
+    fprintf(out, "    if (!t->h) { fprintf(stderr, \"join() em Task ja finalizada\\n\"); abort(); }\n");
+    fprintf(out, "    rujo_task_join(t->h);\n");
+    if (has_result) fprintf(out, "    %s r = ((%s_state*)t->h)->result;\n", map_type(t), name);
+    fprintf(out, "    free(t->h);\n");
+    fprintf(out, "    t->h = NULL;\n");
+    if (has_result) fprintf(out, "    return r;\n");
+    fprintf(out, "}\n");
+    fprintf(out, "static inline bool %s_done(%s* t) { return !t->h || rujo_task_done(t->h); }\n\n", name, name);
+}
+
+// Channel<T> / SpscChannel<T>: wrappers tipados sobre RujoChan; os itens são
+// copiados byte a byte para o slot, então um valor com heap muda de dono sem clone
+void gen_channel_impl(ASTNode* class_decl, FILE* out) {
+    const char* type = class_decl->data.class_decl.name;
+    const char* name = map_type(type);
+    char* elem = type_arg(type, 0);
+    const char* t = map_type(elem);
+    int spsc = strncmp(type, "SpscChannel<", 12) == 0;
+
+    char* list_type = (char*)malloc(strlen(elem) + 7);
+    sprintf(list_type, "List<%s>", elem);
+    char* result_type = (char*)malloc(strlen(elem) + 16);
+    sprintf(result_type, "Result<%s,string>", elem);
+    const char* list = map_type(list_type);
+    const char* res = map_type(result_type);
+
+    fprintf(out, "static inline %s %s_new(int cap) {\n", name, name);
+    fprintf(out, "    if (cap < 1) { fprintf(stderr, \"capacidade de canal invalida: %%d\\n\", cap); abort(); }\n");
+    fprintf(out, "    %s c = { rujo_chan_new(cap, sizeof(%s), %d) };\n    return c;\n}\n", name, t, spsc);
+    fprintf(out, "static inline void %s_send(%s c, %s v) {\n", name, name, t);
+    fprintf(out, "    if (__builtin_expect(!rujo_chan_send(c.h, &v), 0)) { fprintf(stderr, \"send() em canal fechado\\n\"); abort(); }\n}\n");
+    fprintf(out, "static inline bool %s_try_send(%s c, %s v) {\n", name, name, t);
+    fprintf(out, "    if (rujo_chan_try_send(c.h, &v)) return true;\n");
+    if (semantic_is_owned(elem)) fprintf(out, "    rujo_drop_%s(&v);\n", type_mangle(elem));
+    fprintf(out, "    return false;\n}\n");
+    fprintf(out, "static inline %s %s_recv(%s c) {\n", res, name, name);
+    fprintf(out, "    %s v;\n", t);
+    fprintf(out, "    if (__builtin_expect(rujo_chan_recv(c.h, &v), 1)) return %s_ok(v);\n", res);
+    fprintf(out, "    return %s_err(\"fechado\");\n}\n", res);
+    fprintf(out, "static inline %s %s_try_recv(%s c) {\n", res, name, name);
+    fprintf(out, "    %s v;\n", t);
+    fprintf(out, "    int r = rujo_chan_try_recv(c.h, &v);\n");
+    fprintf(out, "    if (r > 0) return %s_ok(v);\n", res);
+    fprintf(out, "    return %s_err(r < 0 ? \"fechado\" : \"vazio\");\n}\n", res);
+    fprintf(out, "static inline void %s_send_batch(%s c, %s* l) {\n", name, name, list);
+    fprintf(out, "    if (rujo_chan_send_n(c.h, l->data, l->len) < l->len) { fprintf(stderr, \"send_batch() em canal fechado\\n\"); abort(); }\n");
+    fprintf(out, "    l->len = 0;\n}\n");
+    fprintf(out, "static inline %s %s_recv_batch(%s c, int max) {\n", list, name, name);
+    fprintf(out, "    %s l = %s_new();\n", list, list);
+    fprintf(out, "    if (max > 0) { %s_reserve(&l, max); l.len = rujo_chan_recv_n(c.h, l.data, max); }\n", list);
+    fprintf(out, "    return l;\n}\n");
+    fprintf(out, "static inline void %s_close(%s c) { rujo_chan_close(c.h); }\n", name, name);
+    fprintf(out, "static inline int %s_len(%s c) { return rujo_chan_len(c.h); }\n\n", name, name);
+}
+
+// Um thunk por spawn: os argumentos são copiados para o estado da tarefa
+static ASTNode** spawn_sites = NULL;
+static int spawn_count = 0;
+
+void collect_spawn(ASTNode* node, void* ctx) {
+    (void)ctx;
+    if (node->type != AST_SPAWN || !node->eval_type) return;
+    spawn_sites = realloc(spawn_sites, sizeof(ASTNode*) * (spawn_count + 1));
+    node->data.spawn.id = spawn_count;
+    spawn_sites[spawn_count++] = node;
+}
+
+void gen_spawn_thunks(FILE* out) {
+    for (int i = 0; i < spawn_count; i++) {
+        ASTNode* call = spawn_sites[i]->data.spawn.call;
+        const char* ret = call->eval_type ? call->eval_type : "void";
+        int has_result = strcmp(ret, "void") != 0;
+        int n = 0;
+
+        fprintf(out, "typedef struct { RujoTask task; ");
+        if (has_result) fprintf(out, "%s result; ", map_type(ret));
+        for (ASTNode* a = call->data.call.args; a; a = a->next) {
+            fprintf(out, "%s a%d; ", map_type(a->eval_type), n++);
+        }
+        fprintf(out, "} _rj_spawn%d_t;\n", i);
+
+        fprintf(out, "static void _rj_spawn%d_run(void* _rj_ctx) {\n", i);
+        fprintf(out, "    _rj_spawn%d_t* _rj_s = _rj_ctx;\n    ", i);
+        if (has_result) fprintf(out, "_rj_s->result = ");
+        fprintf(out, "%s(", call->data.call.name);
+        for (int k = 0; k < n; k++) fprintf(out, "%s_rj_s->a%d", k ? ", " : "", k);
+        fprintf(out, ");\n}\n\n");
+    }
+}
+
+// @parallel: o corpo vira uma função chamada por fatia de iterações. As
+// variáveis externas entram por ponteiro num contexto; cada acumulador de
+// redução começa no elemento neutro e a fatia grava seu parcial, combinado
+// em ordem por quem chamou (resultado determinístico).
+static ASTNode** parallel_loops = NULL;
+static int parallel_count = 0;
+
+void collect_parallel(ASTNode* node, void* ctx) {
+    (void)ctx;
+    // Corpos de genéricos não verificados (só as instâncias) ficam de fora
+    if (node->type != AST_FOR || !ast_has_annotation(node, "parallel") ||
+        !node->data.for_loop.init || !node->data.for_loop.init->eval_type) return;
+    parallel_loops = realloc(parallel_loops, sizeof(ASTNode*) * (parallel_count + 1));
+    node->data.for_loop.id = parallel_count;
+    parallel_loops[parallel_count++] = node;
+}
+
+const char* capture_type(ASTNode* cap) {
+    // this já é ponteiro dentro dos métodos
+    if (strcmp(cap->data.ident.name, "this") == 0) {
+        const char* cls = map_type(cap->eval_type);
+        char* buf = (char*)malloc(strlen(cls) + 2);
+        sprintf(buf, "%s*", cls);
+        return buf;
+    }
+    return map_type(cap->eval_type);
+}
+
+const char* reduction_identity(ASTNode* r) {
+    const char* op = r->data.binary_op.op;
+    int is_float = strcmp(r->eval_type, "float") == 0;
+    if (strcmp(op, "+") == 0) return "0";
+    if (strcmp(op, "*") == 0) return "1";
+    if (strcmp(op, "min") == 0) return is_float ? "__builtin_inff()" : "INT_MAX";
+    return is_float ? "-__builtin_inff()" : "INT_MIN";
+}
+
+void gen_parallel_bodies(FILE* out) {
+    int i;
+    for (i = 0; i < parallel_count; i++) {
+        ASTNode* loop = parallel_loops[i];
+        ASTNode* n;
+        fprintf(out, "typedef struct {\n");
+        for (n = loop->data.for_loop.captures; n; n = n->next) {
+            fprintf(out, "    %s* %s;\n", capture_type(n), n->data.ident.name);
+        }
+        for (n = loop->data.for_loop.reductions; n; n = n->next) {
+            fprintf(out, "    %s* part_%s;\n", map_type(n->eval_type), n->data.binary_op.left->data.ident.name);
+        }
+        fprintf(out, "    int _unused;\n");
+        fprintf(out, "} _rj_par%d_ctx;\n", i);
+        fprintf(out, "static void _rj_par%d(void* _rj_ctx, int64_t _rj_lo, int64_t _rj_hi, int _rj_chunk);\n\n", i);
+    }
+
+    // Laços aninhados: todos os protótipos vêm antes das definições
+    for (i = 0; i < parallel_count; i++) {
+        ASTNode* loop = parallel_loops[i];
+        ASTNode* init = loop->data.for_loop.init;
+        ASTNode* n;
+        gen_line(loop, out);
+        fprintf(out, "static void _rj_par%d(void* _rj_ctx, int64_t _rj_lo, int64_t _rj_hi, int _rj_chunk) {\n", i);
+        fprintf(out, "    _rj_par%d_ctx* _rj_c = _rj_ctx;\n", i);
+        for (n = loop->data.for_loop.captures; n; n = n->next) {
+            fprintf(out, "    %s %s = *_rj_c->%s;\n", capture_type(n), n->data.ident.name, n->data.ident.name);
+        }
+        for (n = loop->data.for_loop.reductions; n; n = n->next) {
+            fprintf(out, "    %s %s = %s;\n", map_type(n->eval_type),
+                n->data.binary_op.left->data.ident.name, reduction_identity(n));
+        }
+        fprintf(out, "    for (int %s = (int)_rj_lo; %s < (int)_rj_hi; %s = %s + 1) ",
+            init->data.var_decl.name, init->data.var_decl.name, init->data.var_decl.name, init->data.var_decl.name);
+        gen_node(loop->data.for_loop.body, out);
+        for (n = loop->data.for_loop.reductions; n; n = n->next) {
+            const char* name = n->data.binary_op.left->data.ident.name;
+            fprintf(out, "    _rj_c->part_%s[_rj_chunk] = %s;\n", name, name);
+        }
+        fprintf(out, "    (void)_rj_c;\n}\n\n");
+    }
+}
+
+void gen_parallel_for(ASTNode* node, FILE* out) {
+    int id = node->data.for_loop.id;
+    ASTNode* cond = node->data.for_loop.condition;
+    ASTNode* n;
+
+    fprintf(out, "{\n");
+    fprintf(out, "int64_t _rj_lo%d = ", id);
+    gen_node(node->data.for_loop.init->data.var_decl.value, out);
+    fprintf(out, ";\nint64_t _rj_hi%d = (int64_t)(", id);
+    gen_node(cond->data.binary_op.right, out);
+    fprintf(out, ")%s;\n", strcmp(cond->data.binary_op.op, "<=") == 0 ? " + 1" : "");
+    fprintf(out, "int _rj_chunks%d = _rj_hi%d > _rj_lo%d ? rujo_parallel_chunks(_rj_hi%d - _rj_lo%d) : 0;\n",
+        id, id, id, id, id);
+    for (n = node->data.for_loop.reductions; n; n = n->next) {
+        fprintf(out, "%s _rj_part%d_%s[_rj_chunks%d + 1];\n", map_type(n->eval_type), id,
+            n->data.binary_op.left->data.ident.name, id);
+    }
+    fprintf(out, "_rj_par%d_ctx _rj_c%d = { ", id, id);
+    for (n = node->data.for_loop.captures; n; n = n->next) {
+        fprintf(out, ".%s = &%s, ", n->data.ident.name, n->data.ident.name);
+    }
+    for (n = node->data.for_loop.reductions; n; n = n->next) {
+        const char* name = n->data.binary_op.left->data.ident.name;
+        fprintf(out, ".part_%s = _rj_part%d_%s, ", name, id, name);
+    }
+    fprintf(out, "._unused = 0 };\n");
+    fprintf(out, "if (_rj_chunks%d) rujo_parallel_for(_rj_lo%d, _rj_hi%d, _rj_chunks%d, _rj_par%d, &_rj_c%d);\n",
+        id, id, id, id, id, id);
+    for (n = node->data.for_loop.reductions; n; n = n->next) {
+        const char* name = n->data.binary_op.left->data.ident.name;
+        const char* op = n->data.binary_op.op;
+        fprintf(out, "for (int _rj_k = 0; _rj_k < _rj_chunks%d; _rj_k++) ", id);
+        if (strcmp(op, "min") == 0 || strcmp(op, "max") == 0) {
+            fprintf(out, "%s = RUJO_%s(%s, _rj_part%d_%s[_rj_k]);\n", name,
+                strcmp(op, "min") == 0 ? "MIN" : "MAX", name, id, name);
+        } else {
+            fprintf(out, "%s = %s %s _rj_part%d_%s[_rj_k];\n", name, name, op, id, name);
+        }
+    }
+    fprintf(out, "}\n");
+}
+
+// Implementações da biblioteca padrão vêm antes de qualquer corpo que as use
+// Geradores: função com yield vira uma máquina de estados sem pilha própria.
+// Todas as variáveis vivem num frame de tamanho fixo (<fn>_frame); resume()
+// salta para o ponto salvo em _rj_state, roda até o próximo yield e retorna.
+// Um for-in sobre a chamada direta de um gerador guarda o frame dele por valor
+// (no frame/pilha de quem itera): pipelines inteiros não alocam nada por item
+// nem por gerador. Recursão entre geradores cai no Gen<T> com frame no heap.
+// async fn usa a mesma máquina: poll() roda até um await que não terminou na hora
+// e devolve false; o laço de I/O chama poll() de novo quando a operação conclui.
+typedef struct GenFrame {
+    ASTNode* fn;
+    int is_async;
+    ASTNode* slots;     // AST_IDENTIFIER tipados: parâmetros, locais e variáveis de laço
+    ASTNode* borrowed;  // variáveis de for-in sobre List/array: o frame não as libera
+    ASTNode* loops[256];
+    int loop_count;
+    ASTNode* awaits[256];
+    int await_count;
+    int yields;         // pontos de retomada (yield ou await)
+    int emitted;        // 0 = não, 1 = emitindo (ciclo), 2 = sim
+    int shared;         // de uma instância de genérico (com módulos, vai para todas as unidades)
+    struct GenFrame* next;
+} GenFrame;
+
+static GenFrame* gen_frames = NULL;
+static int for_in_counter = 0;
+static int await_counter = 0;
+
+GenFrame* find_gen_frame(const char* name) {
+    for (GenFrame* g = gen_frames; g; g = g->next) {
+        if (strcmp(g->fn->data.fn_decl.name, name) == 0) return g;
+    }
+    return NULL;
+}
+
+// --stream: os frames só são coletados no fim, com os geradores adiados, mas
+// saem no cabeçalho, antes de todos os corpos e do main. O gen_fn do semântico
+// é sempre a chamada de um gerador (função que devolve Gen<T>), que terá o seu
+// frame, então quem itera sobre ele o embute mesmo sendo gerado antes
+static int stream_mode = 0;
+
+static void add_slot(ASTNode** list, const char* name, const char* type) {
+    for (ASTNode* s = *list; s; s = s->next) {
+        if (strcmp(s->data.ident.name, name) == 0) return;
+    }
+    ASTNode* s = ast_new_ident((char*)name);
+    s->eval_type = (char*)type;
+    s->next = *list;
+    *list = s;
+}
+
+// Fonte de um for-in que precisa de slot próprio (valor temporário a liberar no fim)
+int for_in_temp(ASTNode* node) {
+    ASTNode* src = node->data.for_in.source;
+    return src->type != AST_IDENTIFIER && src->type != AST_ACCESS && src->type != AST_INDEX;
+}
+
+int has_value(const char* type_name) {
+    return type_name && strcmp(type_name, "void") != 0;
+}
+
+void collect_gen_slots(ASTNode* node, void* ctx) {
+    GenFrame* g = (GenFrame*)ctx;
+    if (node->type == AST_VAR_DECL) {
+        add_slot(&g->slots, node->data.var_decl.name, node->data.var_decl.type_name);
+    } else if (node->type == AST_YIELD) {
+        node->data.yield.state = ++g->yields;
+    } else if (node->type == AST_AWAIT) {
+        node->data.await.state = ++g->yields;
+        node->data.await.id = await_counter++;
+        if (g->await_count == 256) {
+            fprintf(stderr, "Erro: await demais na funcao %s\n", g->fn->data.fn_decl.name);
+            exit(1);
+        }
+        g->awaits[g->await_count++] = node;
+    } else if (node->type == AST_FOR_IN) {
+        node->data.for_in.id = for_in_counter++;
+        if (type_is_gen(node->data.for_in.source->eval_type)) {
+            add_slot(&g->slots, node->data.for_in.var_name, node->data.for_in.var_type);
+        } else {
+            add_slot(&g->borrowed, node->data.for_in.var_name, node->data.for_in.var_type);
+        }
+        if (node->data.for_in.val_name) {
+            add_slot(&g->borrowed, node->data.for_in.val_name, node->data.for_in.val_type);
+        }
+        if (g->loop_count == 256) {
+            fprintf(stderr, "Erro: for-in demais na funcao %s\n", g->fn->data.fn_decl.name);
+            exit(1);
+        }
+        g->loops[g->loop_count++] = node;
+    }
+}
+
+void collect_generators(ASTNode* node) {
+    for (; node; node = node->next) {
+        if (node->type != AST_FN_DECL || node->data.fn_decl.type_params) continue;
+        int is_async = type_is_async(node->data.fn_decl.return_type);
+        if (!is_async && !type_is_gen(node->data.fn_decl.return_type)) continue;
+        GenFrame* g = (GenFrame*)calloc(1, sizeof(GenFrame));
+        g->fn = node;
+        g->is_async = is_async;
+        ast_visit(node->data.fn_decl.params, collect_gen_slots, g);
+        ast_visit(node->data.fn_decl.body, collect_gen_slots, g);
+        g->next = gen_frames;
+        gen_frames = g;
+    }
+}
+
+// Slots de um for-in: frame inline do gerador, handle Gen<T>, fonte temporária, índice
+void gen_for_in_slots(ASTNode* node, const char* indent, FILE* out) {
+    int id = node->data.for_in.id;
+    const char* src = node->data.for_in.source->eval_type;
+    if (node->data.for_in.gen_fn) {
+        fprintf(out, "%s%s_frame _rj_in%d;\n", indent, map_type(node->data.for_in.gen_fn), id);
+    } else if (type_is_gen(src) || for_in_temp(node)) {
+        fprintf(out, "%s%s _rj_in%d;\n", indent, map_type(src), id);
+    }
+    if (!type_is_gen(src)) fprintf(out, "%sint _rj_i%d;\n", indent, id);
+}
+
+void gen_for_in_cleanup(ASTNode* node, FILE* out) {
+    int id = node->data.for_in.id;
+    const char* src = node->data.for_in.source->eval_type;
+    if (node->data.for_in.gen_fn) {
+        fprintf(out, "%s_frame_drop(&%s_rj_in%d);\n", map_type(node->data.for_in.gen_fn), local_prefix(), id);
+    } else if (type_is_gen(src) || for_in_temp(node)) {
+        fprintf(out, "rujo_drop_%s(&%s_rj_in%d);\n", type_mangle(src), local_prefix(), id);
+    }
+}
+
+// Frames em ordem de dependência: um frame inline precisa estar completo antes
+void gen_frame_struct(GenFrame* g, FILE* out) {
+    if (g->emitted) return;
+    g->emitted = 1;
+    for (int i = 0; i < g->loop_count; i++) {
+        ASTNode* loop = g->loops[i];
+        if (!loop->data.for_in.gen_fn) continue;
+        GenFrame* callee = find_gen_frame(loop->data.for_in.gen_fn);
+        if (callee) gen_frame_struct(callee, out);
+        if (!callee || callee->emitted != 2) loop->data.for_in.gen_fn = NULL;
+    }
+    for (int i = 0; i < g->await_count; i++) {
+        ASTNode* aw = g->awaits[i];
+        if (!aw->data.await.async_fn) continue;
+        GenFrame* callee = find_gen_frame(aw->data.await.async_fn);
+        if (callee) gen_frame_struct(callee, out);
+        if (!callee || callee->emitted != 2) aw->data.await.async_fn = NULL;
+    }
+
+    const char* name = map_type(g->fn->data.fn_decl.name);
+    const char* ret = type_arg(g->fn->data.fn_decl.return_type, 0);
+    fprintf(out, "typedef struct %s_frame {\n", name);
+    fprintf(out, "    int _rj_state;\n");
+    if (g->is_async && has_value(ret)) fprintf(out, "    %s _rj_ret;\n", map_type(ret));
+    for (ASTNode* s = g->slots; s; s = s->next) {
+        fprintf(out, "    %s %s;\n", map_type(s->eval_type), s->data.ident.name);
+    }
+    for (ASTNode* s = g->borrowed; s; s = s->next) {
+        fprintf(out, "    %s %s;\n", map_type(s->eval_type), s->data.ident.name);
+    }
+    for (int i = 0; i < g->loop_count; i++) gen_for_in_slots(g->loops[i], "    ", out);
+    for (int i = 0; i < g->await_count; i++) {
+        ASTNode* aw = g->awaits[i];
+        int id = aw->data.await.id;
+        if (aw->data.await.async_fn) {
+            fprintf(out, "    %s_frame _rj_aw%d;\n", map_type(aw->data.await.async_fn), id);
+        } else if (!aw->data.await.io) {
+            fprintf(out, "    %s _rj_aw%d;\n", map_type(aw->data.await.expr->eval_type), id);
+        }
+        if (has_value(aw->eval_type)) fprintf(out, "    %s _rj_av%d;\n", map_type(aw->eval_type), id);
+    }
+    fprintf(out, "} %s_frame;\n\n", name);
+    g->emitted = 2;
+}
+
+void gen_frame_prototypes(GenFrame* g, FILE* out) {
+    const char* name = map_type(g->fn->data.fn_decl.name);
+    fprintf(out, "RUJO_SHARED void %s_frame_init(%s_frame* _f", name, name);
+    for (ASTNode* p = g->fn->data.fn_decl.params; p; p = p->next) {
+        fprintf(out, ", %s %s", map_type(p->data.var_decl.type_name), p->data.var_decl.name);
+    }
+    fprintf(out, ");\n");
+    if (g->is_async) {
+        fprintf(out, "RUJO_SHARED bool %s_poll(void* _p, RujoIoTask* _t);\n", name);
+    } else {
+        fprintf(out, "RUJO_SHARED bool %s_resume(void* _p, %s* _out);\n", name,
+            map_type(type_arg(g->fn->data.fn_decl.return_type, 0)));
+    }
+    fprintf(out, "RUJO_SHARED void %s_frame_drop(void* _p);\n", name);
+    fprintf(out, "RUJO_SHARED void %s_gen_drop(void* _p);\n", name);
+}
+
+void gen_generator_frames(FILE* out) {
+    for (GenFrame* g = gen_frames; g; g = g->next) gen_frame_struct(g, out);
+    for (GenFrame* g = gen_frames; g; g = g->next) gen_frame_prototypes(g, out);
+    if (gen_frames) fprintf(out, "\n");
+}
+
+// Corpo de um gerador (resume) ou async fn (poll), mais init, drop e a função pública
+void gen_generator(ASTNode* fn, FILE* out) {
+    GenFrame* g = find_gen_frame(fn->data.fn_decl.name);
+    gen_line(fn, out);
+    const char* name = map_type(fn->data.fn_decl.name);
+    const char* handle = map_type(fn->data.fn_decl.return_type);
+    const char* elem = type_arg(fn->data.fn_decl.return_type, 0);
+
+    fprintf(out, "RUJO_SHARED void %s_frame_init(%s_frame* _f", name, name);
+    for (ASTNode* p = fn->data.fn_decl.params; p; p = p->next) {
+        fprintf(out, ", %s %s", map_type(p->data.var_decl.type_name), p->data.var_decl.name);
+    }
+    fprintf(out, ") {\n    memset(_f, 0, sizeof(*_f));\n");
+    for (ASTNode* p = fn->data.fn_decl.params; p; p = p->next) {
+        fprintf(out, "    _f->%s = %s;\n", p->data.var_decl.name, p->data.var_decl.name);
+    }
+    fprintf(out, "}\n\n");
+
+    // Gerador: true = entregou um item. async fn: true = terminou
+    const char* done = g->is_async ? "true" : "false";
+    if (g->is_async) {
+        fprintf(out, "RUJO_SHARED bool %s_poll(void* _p, RujoIoTask* _t) {\n", name);
+    } else {
+        fprintf(out, "RUJO_SHARED bool %s_resume(void* _p, %s* _out) {\n", name, map_type(elem));
+    }
+    fprintf(out, "    %s_frame* _f = _p;\n", name);
+    fprintf(out, "    switch (_f->_rj_state) {\n");
+    fprintf(out, "        case 0: break;\n");
+    for (int k = 1; k <= g->yields; k++) fprintf(out, "        case %d: goto _rj_y%d;\n", k, k);
+    fprintf(out, "        default: return %s;\n", done);
+    fprintf(out, "    }\n");
+    gen_mode = g->is_async ? 2 : 1;
+    gen_node(fn->data.fn_decl.body, out);
+    gen_mode = 0;
+    fprintf(out, "    _f->_rj_state = -1;\n    return %s;\n}\n\n", done);
+
+    // Suspenso no meio: tudo que está vivo tem valor; o resto foi zerado ao sair
+    fprintf(out, "RUJO_SHARED void %s_frame_drop(void* _p) {\n", name);
+    fprintf(out, "    %s_frame* _f = _p;\n", name);
+    fprintf(out, "    if (_f->_rj_state < 0) return;\n");
+    fprintf(out, "    _f->_rj_state = -1;\n");
+    gen_mode = g->is_async ? 2 : 1;
+    for (int i = g->await_count - 1; i >= 0; i--) {
+        ASTNode* aw = g->awaits[i];
+        if (aw->data.await.async_fn) {
+            fprintf(out, "    %s_frame_drop(&_f->_rj_aw%d);\n", map_type(aw->data.await.async_fn), aw->data.await.id);
+        } else if (!aw->data.await.io) {
+            fprintf(out, "    rujo_drop_%s(&_f->_rj_aw%d);\n", type_mangle(aw->data.await.expr->eval_type), aw->data.await.id);
+        }
+    }
+    for (int i = g->loop_count - 1; i >= 0; i--) gen_for_in_cleanup(g->loops[i], out);
+    for (ASTNode* s = g->slots; s; s = s->next) {
+        if (semantic_is_owned(s->eval_type)) {
+            fprintf(out, "    rujo_drop_%s(&_f->%s);\n", type_mangle(s->eval_type), s->data.ident.name);
+        }
+    }
+    gen_mode = 0;
+    fprintf(out, "}\n\n");
+
+    fprintf(out, "RUJO_SHARED void %s_gen_drop(void* _p) { %s_frame_drop(_p); rujo_free(_p); }\n\n", name, name);
+
+    gen_fn_signature(fn, NULL, out);
+    fprintf(out, " {\n");
+    fprintf(out, "    %s_frame* _f = rujo_alloc(sizeof(%s_frame));\n", name, name);
+    fprintf(out, "    %s_frame_init(_f", name);
+    for (ASTNode* p = fn->data.fn_decl.params; p; p = p->next) fprintf(out, ", %s", p->data.var_decl.name);
+    fprintf(out, ");\n");
+    if (!g->is_async) {
+        fprintf(out, "    return (%s){ _f, %s_resume, %s_gen_drop };\n}\n\n", handle, name, name);
+    } else if (has_value(elem)) {
+        fprintf(out, "    return (%s){ _f, %s_poll, %s_gen_drop, &_f->_rj_ret };\n}\n\n", handle, name, name);
+    } else {
+        fprintf(out, "    return (%s){ _f, %s_poll, %s_gen_drop };\n}\n\n", handle, name, name);
+    }
+}
+
+// await: suspende a tarefa até a operação de I/O (ou a async fn esperada) terminar.
+// O resultado vai para _rj_avN, lido pelo statement logo depois.
+void gen_await(ASTNode* node, FILE* out) {
+    ASTNode* expr = node->data.await.expr;
+    int id = node->data.await.id;
+    int k = node->data.await.state;
+    int value = has_value(node->eval_type);
+    fprintf(out, "{\n");
+    if (node->data.await.io) {
+        fprintf(out, "if (!%s(_t", expr->data.call.name);
+        for (ASTNode* a = expr->data.call.args; a; a = a->next) {
+            fprintf(out, ", ");
+            gen_node(a, out);
+        }
+        fprintf(out, ")) {\n_f->_rj_state = %d;\nreturn false;\n", k);
+        fprintf(out, "_rj_y%d: if (!rujo_io_again(_t)) return false;\n}\n", k);
+        if (value) fprintf(out, "_f->_rj_av%d = _t->res;\n", id);
+    } else if (node->data.await.async_fn) {
+        // Frame da async fn esperada embutido: poll direto, sem alocação
+        const char* callee = map_type(node->data.await.async_fn);
+        fprintf(out, "%s_frame_init(&_f->_rj_aw%d", callee, id);
+        for (ASTNode* a = expr->data.call.args; a; a = a->next) {
+            fprintf(out, ", ");
+            gen_node(a, out);
+        }
+        fprintf(out, ");\n");
+        fprintf(out, "_rj_y%d: if (!%s_poll(&_f->_rj_aw%d, _t)) { _f->_rj_state = %d; return false; }\n",
+            k, callee, id, k);
+        if (value) fprintf(out, "_f->_rj_av%d = _f->_rj_aw%d._rj_ret;\n", id, id);
+    } else {
+        fprintf(out, "_f->_rj_aw%d = ", id);
+        gen_node(expr, out);
+        fprintf(out, ";\n");
+        fprintf(out, "_rj_y%d: if (!_f->_rj_aw%d.poll(_f->_rj_aw%d.f, _t)) { _f->_rj_state = %d; return false; }\n",
+            k, id, id, k);
+        if (value) fprintf(out, "_f->_rj_av%d = *_f->_rj_aw%d.ret;\n", id, id);
+        fprintf(out, "rujo_drop_%s(&_f->_rj_aw%d);\n", type_mangle(expr->eval_type), id);
+    }
+    fprintf(out, "}\n");
+}
+
+// Fonte List/array: o slot temporário ou a própria expressão (lugar sem efeitos)
+void gen_for_in_source(ASTNode* node, FILE* out) {
+    if (for_in_temp(node)) fprintf(out, "%s_rj_in%d", local_prefix(), node->data.for_in.id);
+    else gen_node(node->data.for_in.source, out);
+}
+
+// for (T x in fonte) { ... }: gerador (inline ou Gen<T>), List<T> ou array
+void gen_for_in(ASTNode* node, FILE* out) {
+    ASTNode* source = node->data.for_in.source;
+    const char* src = source->eval_type;
+    const char* var = node->data.for_in.var_name;
+    const char* p = local_prefix();
+    if (node->data.for_in.id < 0) node->data.for_in.id = counters.loops++;
+    int id = node->data.for_in.id;
+    // Fora de geradores o gen_fn só vale se o frame do chamado existe
+    if (!gen_mode && !stream_mode && node->data.for_in.gen_fn && !find_gen_frame(node->data.for_in.gen_fn)) {
+        node->data.for_in.gen_fn = NULL;
+    }
+
+    fprintf(out, "{\n");
+    if (!gen_mode) {
+        fprintf(out, "%s %s;\n", map_type(node->data.for_in.var_type), var);
+        if (node->data.for_in.val_name) {
+            fprintf(out, "%s %s;\n", map_type(node->data.for_in.val_type), node->data.for_in.val_name);
+        }
+        gen_for_in_slots(node, "", out);
+    }
+
+    int tracked = open_loop_count < 64;
+    if (tracked) open_loops[open_loop_count++] = node;
+    if (node->data.for_in.gen_fn) {
+        // Frame do gerador embutido: init/resume diretos, que o compilador C pode inlinar
+        const char* callee = map_type(node->data.for_in.gen_fn);
+        fprintf(out, "%s_frame_init(&%s_rj_in%d", callee, p, id);
+        for (ASTNode* a = source->data.call.args; a; a = a->next) {
+            fprintf(out, ", ");
+            gen_node(a, out);
+        }
+        fprintf(out, ");\n");
+        fprintf(out, "while (%s_resume(&%s_rj_in%d, &%s%s)) {\n", callee, p, id, p, var);
+    } else if (type_is_gen(src)) {
+        fprintf(out, "%s_rj_in%d = ", p, id);
+        gen_node(source, out);
+        fprintf(out, ";\n");
+        fprintf(out, "while (%s_rj_in%d.f && %s_rj_in%d.resume(%s_rj_in%d.f, &%s%s)) {\n",
+            p, id, p, id, p, id, p, var);
+    } else if (type_is_map(src)) {
+        // Map: slots em ordem, pulando vazios e apagados (bit alto do controle)
+        if (for_in_temp(node)) {
+            fprintf(out, "%s_rj_in%d = ", p, id);
+            gen_node(source, out);
+            fprintf(out, ";\n");
+        }
+        fprintf(out, "for (%s_rj_i%d = 0; %s_rj_i%d < ", p, id, p, id);
+        gen_for_in_source(node, out);
+        fprintf(out, ".cap; %s_rj_i%d++) {\nif (", p, id);
+        gen_for_in_source(node, out);
+        fprintf(out, ".ctrl[%s_rj_i%d] & 0x80) continue;\n%s%s = ", p, id, p, var);
+        gen_for_in_source(node, out);
+        fprintf(out, ".keys[%s_rj_i%d];\n", p, id);
+        if (node->data.for_in.val_name) {
+            fprintf(out, "%s%s = ", p, node->data.for_in.val_name);
+            gen_for_in_source(node, out);
+            fprintf(out, ".vals[%s_rj_i%d];\n", p, id);
+        }
+    } else {
+        char* elem = type_array_elem(src);
+        if (for_in_temp(node)) {
+            fprintf(out, "%s_rj_in%d = ", p, id);
+            gen_node(source, out);
+            fprintf(out, ";\n");
+        }
+        // A fonte é relida a cada volta: o corpo pode crescer a lista
+        fprintf(out, "for (%s_rj_i%d = 0; %s_rj_i%d < ", p, id, p, id);
+        if (elem && !is_soa_class(elem)) {
+            fprintf(out, "rujo_array_len(");
+            gen_for_in_source(node, out);
+            fprintf(out, ")");
+        } else {
+            gen_for_in_source(node, out);
+            fprintf(out, ".len");
+        }
+        fprintf(out, "; %s_rj_i%d++) {\n%s%s = ", p, id, p, var);
+        if (!elem) {
+            gen_for_in_source(node, out);
+            fprintf(out, ".data[%s_rj_i%d]", p, id);
+        } else if (is_soa_class(elem)) {
+            fprintf(out, "%s_soa_get(", map_type(elem));
+            gen_for_in_source(node, out);
+            fprintf(out, ", %s_rj_i%d)", p, id);
+        } else {
+            gen_for_in_source(node, out);
+            fprintf(out, "[%s_rj_i%d]", p, id);
+        }
+        fprintf(out, ";\n");
+    }
+    gen_node(node->data.for_in.body, out);
+    // Item de gerador é da variável: liberado ao fim de cada volta
+    gen_drops(node->drops, out);
+    fprintf(out, "}\n");
+    if (tracked) open_loop_count--;
+    gen_for_in_cleanup(node, out);
+    fprintf(out, "}\n");
+}
+
+// bench "nome" { ... }: lotes do corpo entre duas leituras do relógio. As
+// variáveis de fora são relidas a cada volta e as declaradas no corpo são
+// usadas no fim dela, então o C não tira o trabalho do laço nem o descarta
+void gen_bench(ASTNode* node, FILE* out) {
+    int id = counters.benches++;
+    ASTNode* body = node->data.bench.body;
+    fprintf(out, "{\nRujoBench _rj_b%d;\n", id);
+    fprintf(out, "rujo_bench_begin(&_rj_b%d, \"%s\");\n", id, node->data.bench.name);
+    fprintf(out, "while (rujo_bench_next(&_rj_b%d)) {\n", id);
+    fprintf(out, "int64_t _rj_t%d = rujo_now_ns();\n", id);
+    fprintf(out, "for (int64_t _rj_k%d = _rj_b%d.batch; _rj_k%d > 0; _rj_k%d--) {\n", id, id, id, id);
+    for (ASTNode* in = node->data.bench.inputs; in; in = in->next) {
+        fprintf(out, "RUJO_LAUNDER(%s);\n", in->data.ident.name);
+    }
+    fprintf(out, "{\n");
+    for (ASTNode* stmt = body->data.block.statements; stmt; stmt = stmt->next) {
+        gen_line(stmt, out);
+        gen_node(stmt, out);
+        if (is_expr_stmt(stmt)) fprintf(out, ";\n");
+    }
+    for (ASTNode* stmt = body->data.block.statements; stmt; stmt = stmt->next) {
+        if (stmt->type == AST_VAR_DECL) fprintf(out, "RUJO_KEEP(%s);\n", stmt->data.var_decl.name);
+    }
+    gen_drops(body->drops, out);
+    fprintf(out, "}\n}\n");
+    fprintf(out, "rujo_bench_sample(&_rj_b%d, rujo_now_ns() - _rj_t%d);\n", id, id);
+    fprintf(out, "}\nrujo_bench_end(&_rj_b%d);\n}\n", id);
+}
+
+void gen_builtin_impl(ASTNode* node, FILE* out) {
+    if (node->type == AST_CLASS_DECL && type_is_list(node->data.class_decl.name)) {
+        gen_list_impl(node, out);
+    } else if (node->type == AST_CLASS_DECL && type_is_map(node->data.class_decl.name)) {
+        gen_map_impl(node, out);
+    } else if (node->type == AST_CLASS_DECL && type_is_result(node->data.class_decl.name)) {
+        gen_result_impl(node, out);
+    } else if (node->type == AST_CLASS_DECL && type_is_task(node->data.class_decl.name)) {
+        gen_task_impl(node, out);
+    } else if (node->type == AST_CLASS_DECL && type_is_channel(node->data.class_decl.name)) {
+        gen_channel_impl(node, out);
+    }
+}
+
+void gen_builtin_impls(ASTNode* node, FILE* out) {
+    for (; node; node = node->next) {
+        if (node->type != AST_CLASS_DECL || unit_has(node->data.class_decl.name)) gen_builtin_impl(node, out);
+    }
+}
+
+// Função sondada: o corpo vira name_rj_body e a função com o nome original
+// abre a sonda, chama o corpo e fecha a sonda, qualquer que seja o return
+void gen_fn_probed(ASTNode* fn, ASTNode* class_decl, FILE* out) {
+    const char* fn_name = fn->data.fn_decl.name;
+    const char* name = fn_name;
+    if (class_decl) {
+        const char* class_name = class_decl->data.class_decl.name;
+        char* full = malloc(strlen(class_name) + strlen(fn_name) + 2);
+        sprintf(full, "%s.%s", class_name, fn_name);
+        name = full;
+    }
+    int site = prof_site(name, fn->line);
+    prof_fn = name;
+    gen_line(fn, out);
+
+    fprintf(out, "static ");
+    gen_fn_signature_as(fn, class_decl, "_rj_body", out);
+    fprintf(out, " ");
+    gen_node(fn->data.fn_decl.body, out);
+    fprintf(out, "\n");
+
+    const char* ret = map_type(fn->data.fn_decl.return_type);
+    int has_ret = strcmp(ret, "void") != 0;
+    gen_fn_signature(fn, class_decl, out);
+    fprintf(out, " {\n    int _rj_pd = rujo_prof_enter(%d);\n    ", site);
+    if (has_ret) fprintf(out, "%s _rj_r = ", ret);
+    if (class_decl) fprintf(out, "%s_%s_rj_body(this", map_type(class_decl->data.class_decl.name), fn_name);
+    else fprintf(out, "%s_rj_body(", map_type(fn_name));
+    int first = class_decl == NULL;
+    for (ASTNode* p = fn->data.fn_decl.params; p; p = p->next) {
+        fprintf(out, "%s%s", first ? "" : ", ", p->data.var_decl.name);
+        first = 0;
+    }
+    fprintf(out, ");\n    rujo_prof_exit(_rj_pd);\n");
+    if (has_ret) fprintf(out, "    return _rj_r;\n");
+    fprintf(out, "}\n\n");
+    prof_fn = "main";
+}
+
+// Método de uma classe (class_decl) ou função solta (NULL). Os contadores
+// dos nomes gerados recomeçam aqui, então cada função pode sair de qualquer thread
+void gen_fn_body(ASTNode* fn, ASTNode* class_decl, FILE* out) {
+    GenCounters outer = counters;
+    memset(&counters, 0, sizeof(counters));
+    if (instrument_level) {
+        gen_fn_probed(fn, class_decl, out);
+    } else {
+        gen_line(fn, out);
+        gen_fn_signature(fn, class_decl, out);
+        fprintf(out, " ");
+        gen_node(fn->data.fn_decl.body, out);
+        fprintf(out, "\n");
+    }
+    counters = outer;
+}
+
+// Sem #line: nas partes comuns dos módulos o C não pode depender das linhas
+// do .rj da classe (mudaria a chave do cache de todas as unidades)
+static void gen_constructor_body(ASTNode* node, FILE* out) {
+    const char* name = map_type(node->data.class_decl.name);
+    ASTNode* init = find_init(node);
+    gen_constructor_signature(node, out);
+    fprintf(out, " {\n    %s self = { 0 };\n", name);
+    if (init) {
+        fprintf(out, "    %s_init(&self", name);
+        for (ASTNode* p = init->data.fn_decl.params; p; p = p->next) {
+            fprintf(out, ", %s", p->data.var_decl.name);
+        }
+        fprintf(out, ");\n");
+    }
+    fprintf(out, "    return self;\n}\n\n");
+}
+
+void gen_constructor(ASTNode* node, FILE* out) {
+    gen_line(node, out);
+    gen_constructor_body(node, out);
+}
+
+static int has_methods(ASTNode* node) {
+    return node->type == AST_CLASS_DECL && !node->data.class_decl.type_params &&
+           !is_builtin_type(node->data.class_decl.name);
+}
+
+// Corpo de uma função solta ou dos métodos e construtor de uma classe
+void gen_method(ASTNode* node, FILE* out) {
+    line_path = item_path(node);
+    if (node->type == AST_FN_DECL && !node->data.fn_decl.type_params &&
+        (type_is_gen(node->data.fn_decl.return_type) || type_is_async(node->data.fn_decl.return_type))) {
+        GenCounters outer = counters;
+        memset(&counters, 0, sizeof(counters));
+        gen_generator(node, out);
+        counters = outer;
+    }
+    else if (node->type == AST_FN_DECL && !node->data.fn_decl.type_params) {
+        if (strcmp(node->data.fn_decl.name, "main") != 0) gen_fn_body(node, NULL, out);
+    }
+    else if (has_methods(node)) {
+        for (ASTNode* member = node->data.class_decl.members; member; member = member->next) {
+            if (member->type == AST_FN_DECL) gen_fn_body(member, node, out);
+        }
+        gen_constructor(node, out);
+    }
+}
+
+// --jobs: threads que geram as funções e métodos
+static int codegen_jobs = 1;
+
+// C em várias unidades de tradução (codegen_generate_units)
+static int split_units = 0;
+
+void codegen_set_jobs(int jobs) {
+    codegen_jobs = jobs;
+}
+
+#ifndef _WIN32
+// Unidade de trabalho: função solta (owner NULL), método (owner é a classe)
+// ou construtor (node é a própria classe)
+typedef struct {
+    ASTNode* node;
+    ASTNode* owner;
+} MethodUnit;
+
+static void gen_unit(MethodUnit* u, FILE* out) {
+    line_path = item_path(u->owner ? u->owner : u->node);
+    if (u->node->type == AST_CLASS_DECL) gen_constructor(u->node, out);
+    else if (u->owner) gen_fn_body(u->node, u->owner, out);
+    else gen_method(u->node, out);
+}
+
+// Fatias de unidades seguidas, cada uma gerada num buffer próprio; as
+// threads pegam a próxima fatia livre. Várias fatias por thread equilibram
+// funções de tamanhos diferentes
+#define SLICES_PER_JOB 16
+
+typedef struct {
+    MethodUnit* units;
+    int count;
+    int slices;
+    char** texts;
+    size_t* lengths;
+    atomic_int next;
+} MethodBatch;
+
+static void* method_worker(void* arg) {
+    MethodBatch* batch = (MethodBatch*)arg;
+    int s;
+    while ((s = atomic_fetch_add(&batch->next, 1)) < batch->slices) {
+        int from = (int)((int64_t)batch->count * s / batch->slices);
+        int to = (int)((int64_t)batch->count * (s + 1) / batch->slices);
+        FILE* buf = open_memstream(&batch->texts[s], &batch->lengths[s]);
+        // O buffer é só desta thread: com o lock tomado uma vez, cada fprintf
+        // não precisa de uma operação atômica
+        flockfile(buf);
+        for (int i = from; i < to; i++) gen_unit(&batch->units[i], buf);
+        funlockfile(buf);
+        fclose(buf);
+    }
+    return NULL;
+}
+
+static void add_unit(MethodBatch* batch, int* cap, ASTNode* node, ASTNode* owner) {
+    if (batch->count == *cap) {
+        *cap = *cap ? *cap * 2 : 256;
+        batch->units = (MethodUnit*)realloc(batch->units, sizeof(MethodUnit) * (size_t)*cap);
+    }
+    batch->units[batch->count].node = node;
+    batch->units[batch->count].owner = owner;
+    batch->count++;
+}
+
+// Unidades da lista node, na ordem das declarações (sem os construtores
+// quando eles vão para o cabeçalho)
+static void collect_units(MethodBatch* batch, int* cap, ASTNode* node, int constructors) {
+    for (; node; node = node->next) {
+        if (node->type == AST_FN_DECL) {
+            add_unit(batch, cap, node, NULL);
+        } else if (has_methods(node)) {
+            for (ASTNode* member = node->data.class_decl.members; member; member = member->next) {
+                if (member->type == AST_FN_DECL) add_unit(batch, cap, member, node);
+            }
+            if (constructors) add_unit(batch, cap, node, node);
+        }
+    }
+}
+
+// Gera as fatias (pelo menos min_slices) em até codegen_jobs threads. As
+// sondas numeram os sites na ordem de geração: com --instrument uma thread
+// só, fatia após fatia
+static void render_units(MethodBatch* batch, int min_slices) {
+    int threads = instrument_level ? 1 : codegen_jobs;
+    if (threads > batch->count) threads = batch->count;
+    batch->slices = threads * SLICES_PER_JOB > min_slices ? threads * SLICES_PER_JOB : min_slices;
+    if (batch->slices > batch->count) batch->slices = batch->count;
+    batch->texts = (char**)calloc((size_t)batch->slices + 1, sizeof(char*));
+    batch->lengths = (size_t*)calloc((size_t)batch->slices + 1, sizeof(size_t));
+    atomic_init(&batch->next, 0);
+
+    pthread_t* workers = (pthread_t*)malloc(sizeof(pthread_t) * (size_t)(threads + 1));
+    int started = 0;
+    for (; started < threads - 1; started++) {
+        if (pthread_create(&workers[started], NULL, method_worker, batch) != 0) break;
+    }
+    method_worker(batch);
+    for (int i = 0; i < started; i++) pthread_join(workers[i], NULL);
+    free(workers);
+}
+
+static void free_batch(MethodBatch* batch) {
+    for (int s = 0; s < batch->slices; s++) free(batch->texts[s]);
+    free(batch->units);
+    free(batch->texts);
+    free(batch->lengths);
+}
+
+// Os buffers saem na ordem das declarações: o C é o mesmo da geração serial
+static void gen_methods_parallel(ASTNode* node, FILE* out) {
+    MethodBatch batch = { 0 };
+    int cap = 0;
+    collect_units(&batch, &cap, node, 1);
+    render_units(&batch, 0);
+    for (int s = 0; s < batch.slices; s++) fwrite(batch.texts[s], 1, batch.lengths[s], out);
+    free_batch(&batch);
+}
+#endif
+
+void gen_methods(ASTNode* node, FILE* out) {
+#ifndef _WIN32
+    if (codegen_jobs > 1 && !instrument_level) {
+        gen_methods_parallel(node, out);
+        return;
+    }
+#endif
+    for (; node; node = node->next) gen_method(node, out);
+}
+
+// File.map / File.lines / File.create / File.append: o runtime devolve ponteiros
+// crus e estas funções os embrulham nos Result instanciados pelo semântico
+void gen_file_builtins(FILE* out) {
+    const char* map = type_mangle("Result<byte[],string>");
+    const char* lines = type_mangle("Result<Gen<string>,string>");
+    const char* writer = type_mangle("Result<FileWriter,string>");
+    const char* gen = type_mangle("Gen<string>");
+
+    fprintf(out, "static %s rujo_file_map(const char* path) {\n", map);
+    fprintf(out, "    const char* err;\n");
+    fprintf(out, "    uint8_t* a = rujo_file_map_raw(path, &err);\n");
+    fprintf(out, "    return a ? %s_ok(a) : %s_err(err);\n}\n", map, map);
+
+    fprintf(out, "static %s rujo_file_lines(const char* path) {\n", lines);
+    fprintf(out, "    const char* err;\n");
+    fprintf(out, "    RujoLines* r = rujo_lines_open(path, &err);\n");
+    fprintf(out, "    if (!r) return %s_err(err);\n", lines);
+    fprintf(out, "    return %s_ok((%s){ r, rujo_lines_next, rujo_lines_drop });\n}\n", lines, gen);
+
+    const char* modes[2] = { "create", "append" };
+    for (int i = 0; i < 2; i++) {
+        fprintf(out, "static %s rujo_file_%s(const char* path) {\n", writer, modes[i]);
+        fprintf(out, "    const char* err;\n");
+        fprintf(out, "    RujoWriter* w = rujo_writer_open(path, %s, &err);\n", i ? "true" : "false");
+        fprintf(out, "    if (!w) return %s_err(err);\n", writer);
+        fprintf(out, "    return %s_ok((FileWriter){ w });\n}\n", writer);
+    }
+    fprintf(out, "\n");
+}
+
+// Tabela dos sites sondados (o main é o site 0) e o registro chamado no main
+void gen_prof_sites(FILE* out) {
+    fprintf(out, "\nstatic const RujoProfSite rujo_prof_sites[] = {\n");
+    for (int i = 0; i < prof_count; i++) {
+        fprintf(out, "    { \"%s\", ", prof_names[i]);
+        gen_c_string(prof_files[i], out);
+        fprintf(out, ", %d },\n", prof_lines[i]);
+    }
+    fprintf(out, "};\n");
+    fprintf(out, "static void rujo_prof_register(void) { rujo_prof_init(rujo_prof_sites, %d); }\n", prof_count);
+}
+
+void gen_main_open(FILE* out) {
+    line_path = NULL;
+    if (instrument_level) fprintf(out, "static void rujo_prof_register(void);\n\n");
+    // O preâmbulo do main fica na linha 1 do .rj
+    if (source_path) {
+        fprintf(out, "#line 1 ");
+        gen_c_string(source_path, out);
+        fprintf(out, "\n");
+    }
+    fprintf(out, "int main() {\n");
+    fprintf(out, "    if (getenv(\"RUJO_ALLOC_STATS\")) atexit(rujo_alloc_report);\n");
+    fprintf(out, "    rujo_out_init();\n");
+    if (instrument_level) {
+        fprintf(out, "    rujo_prof_register();\n");
+        fprintf(out, "    rujo_prof_enter(0);\n");
+    }
+}
+
+// Statement solto do programa (funções e classes ficam fora do main)
+void gen_main_stmt(ASTNode* current, FILE* out) {
+    if (current->type != AST_CLASS_DECL && current->type != AST_FN_DECL) {
+        gen_line(current, out);
+        gen_node(current, out);
+        // Também adiciona ; no main se for solto
+        if (is_expr_stmt(current)) {
+            fprintf(out, ";\n");
+        }
+    }
+}
+
+void gen_main_close(ASTNode* program_drops, FILE* out) {
+    gen_drops(program_drops, out);
+    fprintf(out, "    return 0;\n");
+    fprintf(out, "}\n");
+    if (instrument_level) gen_prof_sites(out);
+}
+
+void gen_main(ASTNode* node, ASTNode* program_drops, FILE* out) {
+    memset(&counters, 0, sizeof(counters));
+    gen_main_open(out);
+    for (ASTNode* current = node; current; current = current->next) gen_main_stmt(current, out);
+    gen_main_close(program_drops, out);
+}
+
+// Toda memória do programa passa por rujo_alloc. Dentro de um bloco arena as
+// alocações vêm de blocos contíguos (bump pointer) e a região inteira volta
+// para o cache da thread em O(1) na saída; rujo_free ignora memória de arena.
+// RUJO_ALLOC_STATS=1 mostra o balanço do heap na saída.
+void gen_alloc_runtime(FILE* out) {
+    fprintf(out, "RUJO_GLOBAL long rujo_allocs = 0, rujo_frees = 0;\n");
+    // Com tarefas, os contadores são atualizados por várias threads
+    if (semantic_uses_tasks()) {
+        fprintf(out, "#define RUJO_COUNT(c) __atomic_fetch_add(&(c), 1, __ATOMIC_RELAXED)\n");
+    } else {
+        fprintf(out, "#define RUJO_COUNT(c) ((c)++)\n");
+    }
+    fprintf(out, "static void rujo_alloc_report(void) { fprintf(stderr, \"[rujo] alocacoes: %%ld, liberacoes: %%ld\\n\", rujo_allocs, rujo_frees); }\n\n");
+
+    fprintf(out, "typedef struct RujoChunk { struct RujoChunk* next; size_t cap; size_t used; size_t _pad; } RujoChunk;\n");
+    fprintf(out, "typedef struct RujoArena { RujoChunk* head; RujoChunk* tail; struct RujoArena* prev; } RujoArena;\n");
+    fprintf(out, "RUJO_GLOBAL _Thread_local RujoArena* rujo_arena = NULL;\n");
+    fprintf(out, "RUJO_GLOBAL _Thread_local RujoChunk* rujo_chunk_cache = NULL;\n");
+    fprintf(out, "#define RUJO_CHUNK_MIN (64 * 1024)\n\n");
+
+    fprintf(out, "static void* rujo_arena_alloc(RujoArena* a, size_t n) {\n");
+    fprintf(out, "    size_t need = ((n + 15) & ~(size_t)15) + 16;\n");
+    fprintf(out, "    RujoChunk* c = a->head;\n");
+    fprintf(out, "    if (__builtin_expect(!c || c->used + need > c->cap, 0)) {\n");
+    fprintf(out, "        size_t cap = need > RUJO_CHUNK_MIN ? need : RUJO_CHUNK_MIN;\n");
+    fprintf(out, "        c = rujo_chunk_cache;\n");
+    fprintf(out, "        if (c && c->cap >= cap) {\n");
+    fprintf(out, "            rujo_chunk_cache = c->next;\n");
+    fprintf(out, "        } else {\n");
+    fprintf(out, "            c = malloc(sizeof(RujoChunk) + cap);\n");
+    fprintf(out, "            c->cap = cap;\n");
+    fprintf(out, "        }\n");
+    fprintf(out, "        c->used = 0;\n");
+    fprintf(out, "        c->next = a->head;\n");
+    fprintf(out, "        a->head = c;\n");
+    fprintf(out, "        if (!a->tail) a->tail = c;\n");
+    fprintf(out, "    }\n");
+    fprintf(out, "    char* p = (char*)(c + 1) + c->used;\n");
+    fprintf(out, "    c->used += need;\n");
+    fprintf(out, "    *(size_t*)p = n;\n");
+    fprintf(out, "    memset(p + 16, 0, n);\n");
+    fprintf(out, "    return p + 16;\n");
+    fprintf(out, "}\n\n");
+
+    fprintf(out, "static RujoArena* rujo_arena_of(const void* p) {\n");
+    fprintf(out, "    for (RujoArena* a = rujo_arena; a; a = a->prev) {\n");
+    fprintf(out, "        for (RujoChunk* c = a->head; c; c = c->next) {\n");
+    fprintf(out, "            const char* d = (const char*)(c + 1);\n");
+    fprintf(out, "            if ((const char*)p >= d && (const char*)p < d + c->cap) return a;\n");
+    fprintf(out, "        }\n");
+    fprintf(out, "    }\n");
+    fprintf(out, "    return NULL;\n");
+    fprintf(out, "}\n\n");
+
+    fprintf(out, "static inline void rujo_arena_begin(RujoArena* a) { a->head = a->tail = NULL; a->prev = rujo_arena; rujo_arena = a; }\n");
+    fprintf(out, "static inline void rujo_arena_end(RujoArena* a) {\n");
+    fprintf(out, "    if (a->tail) { a->tail->next = rujo_chunk_cache; rujo_chunk_cache = a->head; }\n");
+    fprintf(out, "    rujo_arena = a->prev;\n");
+    fprintf(out, "}\n\n");
+
+    fprintf(out, "static inline void* rujo_alloc(size_t n) {\n");
+    fprintf(out, "    if (rujo_arena) return rujo_arena_alloc(rujo_arena, n);\n");
+    fprintf(out, "    RUJO_COUNT(rujo_allocs);\n");
+    fprintf(out, "    return calloc(1, n ? n : 1);\n");
+    fprintf(out, "}\n");
+    fprintf(out, "static inline void* rujo_realloc(void* p, size_t n) {\n");
+    fprintf(out, "    RujoArena* a = p ? (rujo_arena ? rujo_arena_of(p) : NULL) : rujo_arena;\n");
+    fprintf(out, "    if (a) {\n");
+    fprintf(out, "        void* q = rujo_arena_alloc(a, n);\n");
+    fprintf(out, "        if (p) { size_t old = *(size_t*)((char*)p - 16); memcpy(q, p, old < n ? old : n); }\n");
+    fprintf(out, "        return q;\n");
+    fprintf(out, "    }\n");
+    fprintf(out, "    if (!p) RUJO_COUNT(rujo_allocs);\n");
+    fprintf(out, "    return realloc(p, n);\n");
+    fprintf(out, "}\n");
+    fprintf(out, "static inline void rujo_free(void* p) {\n");
+    fprintf(out, "    if (!p || (rujo_arena && rujo_arena_of(p))) return;\n");
+    fprintf(out, "    RUJO_COUNT(rujo_frees);\n");
+    fprintf(out, "    free(p);\n");
+    fprintf(out, "}\n\n");
+}
+
+// Includes, runtime e macros: depende do que o semântico viu o programa usar
+void gen_preamble(FILE* out) {
+    // accept4/SOCK_NONBLOCK do runtime de I/O
+    if (semantic_uses_io()) fprintf(out, "#define _GNU_SOURCE\n");
+    fprintf(out, "#include <stdio.h>\n");
+    fprintf(out, "#include <stdlib.h>\n");
+    fprintf(out, "#include <stdint.h>\n");
+    fprintf(out, "#include <stdbool.h>\n");
+    fprintf(out, "#include <string.h>\n");
+    fprintf(out, "#include <limits.h>\n\n");
+
+    // Estado do runtime e funções dos frames de geradores: com várias unidades
+    // de tradução (--jobs) o estado é um só (definição fraca em cada unidade)
+    // e os frames são chamados de outras unidades
+    if (split_units) {
+        fprintf(out, "#define RUJO_GLOBAL __attribute__((weak))\n");
+        fprintf(out, "#define RUJO_SHARED\n\n");
+    } else {
+        fprintf(out, "#define RUJO_GLOBAL static\n");
+        fprintf(out, "#define RUJO_SHARED static\n\n");
+    }
+
+    fprintf(out, "#define RUJO_MIN(a, b) ({ __auto_type _a = (a); __auto_type _b = (b); _a < _b ? _a : _b; })\n");
+    fprintf(out, "#define RUJO_MAX(a, b) ({ __auto_type _a = (a); __auto_type _b = (b); _a > _b ? _a : _b; })\n\n");
+
+    if (semantic_uses_tasks()) runtime_emit_tasks(out);
+    if (semantic_uses_channels()) runtime_emit_channels(out);
+    gen_alloc_runtime(out);
+
+    // Arrays guardam o tamanho num cabeçalho antes do primeiro elemento;
+    // map != 0 marca um array de File.map (tamanho do mapeamento a desfazer)
+    fprintf(out, "typedef struct { int64_t len; int64_t map; } RujoArrayHeader;\n");
+    fprintf(out, "static inline void* rujo_array_new(int64_t n, size_t elem) {\n");
+    fprintf(out, "    RujoArrayHeader* h = rujo_alloc(sizeof(RujoArrayHeader) + (size_t)n * elem);\n");
+    fprintf(out, "    h->len = n;\n");
+    fprintf(out, "    h->map = 0;\n");
+    fprintf(out, "    return h + 1;\n");
+    fprintf(out, "}\n");
+    fprintf(out, "static inline int64_t rujo_array_len(const void* a) { return a ? ((const RujoArrayHeader*)a - 1)->len : 0; }\n");
+    if (semantic_uses_files()) {
+        fprintf(out, "static void rujo_array_unmap(void* a);\n");
+        fprintf(out, "static inline void rujo_array_free(void* a) {\n");
+        fprintf(out, "    if (!a) return;\n");
+        fprintf(out, "    if (__builtin_expect(((RujoArrayHeader*)a - 1)->map != 0, 0)) rujo_array_unmap(a);\n");
+        fprintf(out, "    else rujo_free((RujoArrayHeader*)a - 1);\n");
+        fprintf(out, "}\n");
+    } else {
+        fprintf(out, "static inline void rujo_array_free(void* a) { if (a) rujo_free((RujoArrayHeader*)a - 1); }\n");
+    }
+    fprintf(out, "static inline void* rujo_array_clone(const void* a, size_t elem) {\n");
+    fprintf(out, "    if (!a) return NULL;\n");
+    fprintf(out, "    void* c = rujo_array_new(rujo_array_len(a), elem);\n");
+    fprintf(out, "    memcpy(c, a, (size_t)rujo_array_len(a) * elem);\n");
+    fprintf(out, "    return c;\n");
+    fprintf(out, "}\n\n");
+
+    if (semantic_uses_io()) runtime_emit_io(out);
+    if (semantic_uses_files()) runtime_emit_files(out);
+    if (semantic_uses_maps()) runtime_emit_map(out);
+
+    if (semantic_uses_tasks()) fprintf(out, "#define RUJO_OUT_THREADS\n");
+    runtime_emit_print(out);
+    if (semantic_uses_clock() || instrument_level) runtime_emit_bench(out);
+    if (instrument_level) runtime_emit_profile(out);
+
+    fprintf(out, "#define RUJO_PRINT(x) _Generic((x), \\\n");
+    fprintf(out, "    int: print_int, \\\n");
+    fprintf(out, "    int64_t: print_long, \\\n");
+    fprintf(out, "    float: print_float, \\\n");
+    fprintf(out, "    double: print_float, \\\n");
+    fprintf(out, "    bool: print_bool, \\\n");
+    fprintf(out, "    char*: print_string, \\\n");
+    fprintf(out, "    const char*: print_string \\\n");
+    fprintf(out, ")(x)\n\n");
+
+    fprintf(out, "#define RUJO_TYPEOF(x) _Generic((x), \\\n");
+    fprintf(out, "    _Bool: \"bool\", \\\n");
+    fprintf(out, "    uint8_t: \"byte\", \\\n");
+    fprintf(out, "    int: \"int\", \\\n");
+    fprintf(out, "    int64_t: \"long\", \\\n");
+    fprintf(out, "    float: \"float\", \\\n");
+    fprintf(out, "    double: \"float\", \\\n");
+    fprintf(out, "    uint32_t: \"char\", \\\n");
+    fprintf(out, "    char*: \"string\", \\\n");
+    fprintf(out, "    const char*: \"string\", \\\n");
+    fprintf(out, "    default: \"unknown\" \\\n");
+    fprintf(out, ")\n\n");
+
+}
+
+// Tudo o que vem antes dos corpos: structs das classes de decls e das
+// instâncias, frames dos geradores, protótipos, helpers de ownership, tipos da
+// biblioteca padrão, thunks de spawn e corpos @parallel (de bodies). Os
+// métodos das instâncias vêm logo depois
+void gen_header(ASTNode* decls, ASTNode* bodies, FILE* out) {
+    ASTNode* instances = semantic_instances();
+
+    gen_struct_forwards(instances, out);
+    gen_struct_forwards(decls, out);
+    fprintf(out, "\n");
+    gen_structs(instances, out);
+    gen_structs(decls, out);
+    collect_generators(instances);
+    collect_generators(bodies);
+    gen_generator_frames(out);
+
+    gen_prototypes(instances, out);
+    gen_prototypes(decls, out);
+    fprintf(out, "\n");
+
+    gen_owned_helpers(out);
+    gen_builtin_impls(instances, out);
+    if (semantic_uses_files()) gen_file_builtins(out);
+    ast_visit(instances, collect_spawn, NULL);
+    ast_visit(bodies, collect_spawn, NULL);
+    gen_spawn_thunks(out);
+    ast_visit(instances, collect_parallel, NULL);
+    ast_visit(bodies, collect_parallel, NULL);
+    gen_parallel_bodies(out);
+}
+
+void codegen_generate(ASTNode* root, FILE* out) {
+    // O main é o site 0
+    if (instrument_level) prof_site("main", 0);
+    gen_preamble(out);
+
+    if (root->type == AST_PROGRAM) {
+        program_stmts = root->data.program.statements;
+        gen_header(program_stmts, program_stmts, out);
+        gen_methods(semantic_instances(), out);
+        gen_methods(program_stmts, out);
+        gen_main(program_stmts, root->drops, out);
+    }
+}
+
+#ifndef _WIN32
+static FILE* open_unit(const char* path) {
+    FILE* f = fopen(path, "w");
+    if (!f) {
+        printf("Erro: Nao foi possivel criar o arquivo '%s'\n", path);
+        exit(1);
+    }
+    return f;
+}
+
+int codegen_generate_units(ASTNode* root, int units, long* bytes) {
+    split_units = 1;
+    program_stmts = root->data.program.statements;
+    if (instrument_level) prof_site("main", 0);
+
+    FILE* header = open_unit("out.h");
+    gen_preamble(header);
+    gen_header(program_stmts, program_stmts, header);
+    // Os construtores (static inline) vão para todas as unidades
+    ASTNode* lists[2] = { semantic_instances(), program_stmts };
+    for (int i = 0; i < 2; i++) {
+        for (ASTNode* node = lists[i]; node; node = node->next) {
+            if (has_methods(node)) gen_constructor(node, header);
+        }
+    }
+    *bytes = ftell(header);
+    fclose(header);
+
+    // Fatias consecutivas até cada arquivo ter ~1/units do C das funções
+    MethodBatch batch = { 0 };
+    int cap = 0;
+    collect_units(&batch, &cap, semantic_instances(), 0);
+    collect_units(&batch, &cap, program_stmts, 0);
+    render_units(&batch, units * SLICES_PER_JOB);
+    size_t total = 0;
+    for (int s = 0; s < batch.slices; s++) total += batch.lengths[s];
+
+    int files = 0;
+    size_t written = 0;
+    FILE* unit = NULL;
+    char path[32];
+    for (int s = 0; s < batch.slices; s++) {
+        if (!unit) {
+            sprintf(path, "out_%d.c", ++files);
+            unit = open_unit(path);
+            fprintf(unit, "#include \"out.h\"\n\n");
+        }
+        fwrite(batch.texts[s], 1, batch.lengths[s], unit);
+        written += batch.lengths[s];
+        if (files < units && written * (size_t)units >= total * (size_t)files) {
+            *bytes += ftell(unit);
+            fclose(unit);
+            unit = NULL;
+        }
+    }
+    if (unit) {
+        *bytes += ftell(unit);
+        fclose(unit);
+    }
+    free_batch(&batch);
+
+    // O main por último: a tabela das sondas só fica completa depois das funções
+    FILE* main_unit = open_unit("out_0.c");
+    fprintf(main_unit, "#include \"out.h\"\n\n");
+    gen_main(program_stmts, root->drops, main_unit);
+    *bytes += ftell(main_unit);
+    fclose(main_unit);
+    return files + 1;
+}
+
+// Os itens de um módulo são um trecho da lista do programa; enquanto a
+// unidade dele é gerada o trecho fica separado (a geração percorre a lista
+// até o fim)
+static ASTNode* module_items_cut(int m, ASTNode** rest) {
+    ASTNode* last = module_last(m);
+    if (!last) return NULL;
+    *rest = last->next;
+    last->next = NULL;
+    return module_first(m);
+}
+
+static void module_items_join(int m, ASTNode* rest) {
+    ASTNode* last = module_last(m);
+    if (last) last->next = rest;
+}
+
+// Frames que a unidade do módulo m vê: os dele, os dos módulos que ele
+// importa e os das instâncias (m = 0: todos). Os frames guardados inline
+// por eles vêm junto
+static void gen_module_frames(int m, FILE* out) {
+    for (GenFrame* g = gen_frames; g; g = g->next) g->emitted = 0;
+    for (GenFrame* g = gen_frames; g; g = g->next) {
+        if (!m || g->shared || module_imports(m, module_of(g->fn))) gen_frame_struct(g, out);
+    }
+    for (GenFrame* g = gen_frames; g; g = g->next) {
+        if (g->emitted == 2) gen_frame_prototypes(g, out);
+    }
+    if (gen_frames) fprintf(out, "\n");
+}
+
+// Tipos de que a unidade precisa: type e, por ele, os argumentos, o elemento
+// de um array e os campos e as assinaturas dos métodos de uma classe
+static void unit_use_signature(ASTNode* fn);
+
+static void unit_use(const char* type) {
+    if (!type || !type_set_add(unit_types, type)) return;
+    char* elem = type_array_elem(type);
+    if (elem) {
+        unit_use(elem);
+        return;
+    }
+    int count = type_arg_count(type);
+    for (int i = 0; i < count; i++) unit_use(type_arg(type, i));
+    // Os métodos de Channel<T> e Map<K, V> usam as instâncias que o semântico
+    // resolve junto com eles (recv, recv_batch, get, set_batch)
+    if (type_is_channel(type) || type_is_map(type)) {
+        const char* v = type_arg(type, count - 1);
+        char* result = (char*)malloc(strlen(v) + 16);
+        sprintf(result, "Result<%s,string>", v);
+        unit_use(result);
+        for (int i = 0; i < count; i++) {
+            const char* t = type_arg(type, i);
+            char* list = (char*)malloc(strlen(t) + 7);
+            sprintf(list, "List<%s>", t);
+            unit_use(list);
+        }
+    }
+    ASTNode* cls = find_class(type);
+    if (!cls || cls->data.class_decl.type_params) return;
+    for (ASTNode* member = cls->data.class_decl.members; member; member = member->next) {
+        if (member->type == AST_PROP_DECL) unit_use(member->data.var_decl.type_name);
+        else if (member->type == AST_FN_DECL) unit_use_signature(member);
+    }
+}
+
+static void unit_use_signature(ASTNode* fn) {
+    unit_use(fn->data.fn_decl.return_type);
+    for (ASTNode* p = fn->data.fn_decl.params; p; p = p->next) unit_use(p->data.var_decl.type_name);
+}
+
+// Tipos citados no código de um item; files vira 1 se ele chama File.*
+static void unit_use_node(ASTNode* node, void* files) {
+    unit_use(node->eval_type);
+    switch (node->type) {
+        case AST_VAR_DECL:
+        case AST_PROP_DECL: unit_use(node->data.var_decl.type_name); break;
+        case AST_FN_DECL: unit_use_signature(node); break;
+        case AST_CLASS_DECL:
+            if (!node->data.class_decl.type_params) unit_use(node->data.class_decl.name);
+            break;
+        case AST_NEW: unit_use(node->data.new_obj.type_name); break;
+        case AST_NEW_ARRAY: unit_use(node->data.new_array.elem_type); break;
+        case AST_FOR_IN:
+            unit_use(node->data.for_in.var_type);
+            unit_use(node->data.for_in.val_type);
+            break;
+        case AST_CALL:
+            // Instância de função genérica ("maior<int>"): o protótipo vem junto
+            if (strchr(node->data.call.name, '<')) {
+                for (ASTNode* inst = semantic_instances(); inst; inst = inst->next) {
+                    if (inst->type == AST_FN_DECL && strcmp(inst->data.fn_decl.name, node->data.call.name) == 0 &&
+                        type_set_add(unit_types, inst->data.fn_decl.name)) {
+                        unit_use_signature(inst);
+                    }
+                }
+            }
+            if (strncmp(node->data.call.name, "rujo_file_", 10) == 0) *(int*)files = 1;
+            break;
+        default: break;
+    }
+}
+
+static void unit_use_item(ASTNode* item, int* files) {
+    ASTNode* next = item->next;
+    item->next = NULL;
+    ast_visit(item, unit_use_node, files);
+    item->next = next;
+}
+
+// Função solta que a unidade do módulo m declara: as do módulo e as pub dos
+// que ele importa (m = 0: todas)
+static int unit_sees_fn(int m, ASTNode* fn) {
+    int owner = module_of(fn);
+    return !m || owner == m || (module_imports(m, owner) && fn->data.fn_decl.is_pub);
+}
+
+// Tipos da unidade do módulo m: os do código dele, os das declarações que ele
+// vê dos importados e os dos frames que ela emite
+static void unit_collect_types(int m, ASTNode* items, int* files) {
+    for (ASTNode* item = items; item; item = item->next) unit_use_item(item, files);
+    for (ASTNode* node = program_stmts; node; node = node->next) {
+        int owner = module_of(node);
+        if (owner == m || !module_imports(m, owner)) continue;
+        if (node->type == AST_FN_DECL && unit_sees_fn(m, node)) unit_use_signature(node);
+        if (node->type == AST_CLASS_DECL && node->data.class_decl.is_pub) unit_use(node->data.class_decl.name);
+    }
+    for (GenFrame* g = gen_frames; g; g = g->next) {
+        if (g->emitted == 2) unit_use_item(g->fn, files);
+    }
+    // gen_file_builtins embrulha o runtime nestes tipos
+    if (*files) {
+        static const char* file_types[] = { "Result<byte[],string>", "Result<Gen<string>,string>",
+                                            "Result<FileWriter,string>", "Gen<string>" };
+        for (size_t i = 0; i < sizeof(file_types) / sizeof(file_types[0]); i++) unit_use(file_types[i]);
+    }
+}
+
+// Interface de um módulo para quem o importa: campos e métodos das classes e
+// assinaturas das funções pub (sem corpos nem linhas)
+static uint64_t module_interface_hash(int m) {
+    char* text;
+    size_t len;
+    FILE* out = open_memstream(&text, &len);
+    for (ASTNode* node = module_first(m); node; node = node == module_last(m) ? NULL : node->next) {
+        if (node->type == AST_CLASS_DECL) {
+            for (ASTNode* p = node->data.class_decl.members; p; p = p->next) {
+                if (p->type == AST_PROP_DECL) fprintf(out, "%s %s;\n", p->data.var_decl.type_name, p->data.var_decl.name);
+            }
+            gen_prototype(node, out);
+        } else if (node->type == AST_FN_DECL && node->data.fn_decl.is_pub) {
+            gen_prototype(node, out);
+        }
+    }
+    fclose(out);
+    uint64_t h = hash_bytes(HASH_SEED, text, len);
+    free(text);
+    return h;
+}
+
+// Protótipos: instâncias e classes que a unidade usa; funções soltas do
+// módulo m e as pub dos que ele importa (m = 0: tudo)
+static void gen_module_prototypes(int m, FILE* out) {
+    for (ASTNode* node = semantic_instances(); node; node = node->next) {
+        if (unit_has(node->type == AST_FN_DECL ? node->data.fn_decl.name : node->data.class_decl.name)) {
+            gen_prototype(node, out);
+        }
+    }
+    for (ASTNode* node = program_stmts; node; node = node->next) {
+        if (node->type == AST_CLASS_DECL ? unit_has(node->data.class_decl.name)
+                                         : node->type == AST_FN_DECL && unit_sees_fn(m, node)) {
+            gen_prototype(node, out);
+        }
+    }
+    fprintf(out, "\n");
+}
+
+// Uma unidade: o preâmbulo comum e, do programa, só o que o módulo m usa
+// (itens items; 0 são as instâncias, que veem tudo). A primeira linha guarda
+// o hash do fonte do módulo e das interfaces dos importados: entra na chave
+// do cache junto com o C
+static void gen_module_unit(const char* path, int m, ASTNode* items, ASTNode* drops, const char* preamble,
+                            size_t preamble_len, long* bytes) {
+    ASTNode* instances = semantic_instances();
+    ASTNode* rest = NULL;
+    if (m) items = module_items_cut(m, &rest);
+
+    // Os frames não dependem dos tipos escolhidos, mas decidem alguns deles
+    char* frames;
+    size_t frames_len;
+    FILE* part = open_memstream(&frames, &frames_len);
+    gen_module_frames(m, part);
+    fclose(part);
+
+    TypeSet types = { 0 };
+    int files = semantic_uses_files();
+    if (m) {
+        unit_types = &types;
+        files = 0;
+        unit_collect_types(m, items, &files);
+    }
+
+    FILE* out = open_unit(path);
+    if (m) {
+        char* source = read_file(module_path(m));
+        uint64_t interfaces = HASH_SEED;
+        for (int j = 1; j <= module_count(); j++) {
+            if (j != m && module_imports(m, j)) {
+                uint64_t h = module_interface_hash(j);
+                interfaces = hash_bytes(interfaces, (const char*)&h, sizeof(h));
+            }
+        }
+        fprintf(out, "// rujo: fonte %016llx, interfaces %016llx\n",
+            (unsigned long long)hash_bytes(HASH_SEED, source ? source : "", source ? strlen(source) : 0),
+            (unsigned long long)interfaces);
+        free(source);
+    }
+    fwrite(preamble, 1, preamble_len, out);
+    emitted_count = 0;
+    gen_struct_forwards(instances, out);
+    gen_struct_forwards(program_stmts, out);
+    fprintf(out, "\n");
+    gen_structs(instances, out);
+    gen_structs(program_stmts, out);
+    fwrite(frames, 1, frames_len, out);
+    free(frames);
+    gen_module_prototypes(m, out);
+    gen_owned_helpers(out);
+    gen_builtin_impls(instances, out);
+    if (files) gen_file_builtins(out);
+    // Antes do primeiro #line: os construtores ficam com as linhas do próprio .c
+    ASTNode* lists[2] = { instances, program_stmts };
+    for (int i = 0; i < 2; i++) {
+        for (ASTNode* node = lists[i]; node; node = node->next) {
+            if (has_methods(node) && unit_has(node->data.class_decl.name)) gen_constructor_body(node, out);
+        }
+    }
+    unit_types = NULL;
+    free(types.names);
+
+    // Os thunks de spawn e os corpos @parallel são static: numerados por unidade
+    spawn_count = 0;
+    parallel_count = 0;
+    ast_visit(items, collect_spawn, NULL);
+    ast_visit(items, collect_parallel, NULL);
+    line_path = m ? module_path(m) : NULL;
+    gen_spawn_thunks(out);
+    gen_parallel_bodies(out);
+
+    // Os construtores já saíram acima
+    MethodBatch batch = { 0 };
+    int cap = 0;
+    collect_units(&batch, &cap, items, 0);
+    if (batch.count) render_units(&batch, 0);
+    for (int s = 0; s < batch.slices; s++) fwrite(batch.texts[s], 1, batch.lengths[s], out);
+    free_batch(&batch);
+    if (m == module_count()) gen_main(items, drops, out);
+    if (m) module_items_join(m, rest);
+    *bytes += ftell(out);
+    fclose(out);
+}
+
+int codegen_generate_modules(ASTNode* root, const char* dir, char*** names, long* bytes) {
+    split_units = 1;
+    program_stmts = root->data.program.statements;
+    ASTNode* instances = semantic_instances();
+    if (instrument_level) prof_site("main", 0);
+
+    // Comum a todas as unidades: o preâmbulo (runtime)
+    char* preamble;
+    size_t preamble_len;
+    FILE* part = open_memstream(&preamble, &preamble_len);
+    gen_preamble(part);
+    fclose(part);
+
+    // Os ids de for-in e await dos frames recomeçam em cada módulo: mudar um
+    // gerador não muda o C dos outros módulos
+    collect_generators(instances);
+    for (GenFrame* g = gen_frames; g; g = g->next) g->shared = 1;
+    int count = module_count();
+    for (int m = 1; m <= count; m++) {
+        ASTNode* rest = NULL;
+        ASTNode* items = module_items_cut(m, &rest);
+        for_in_counter = await_counter = 0;
+        collect_generators(items);
+        module_items_join(m, rest);
+    }
+    // Quais frames ficam inline (um ciclo de geradores cai no heap) é decidido
+    // uma vez, na ordem do programa, e vale para todas as unidades
+    char* discard;
+    size_t discard_len;
+    part = open_memstream(&discard, &discard_len);
+    gen_generator_frames(part);
+    fclose(part);
+    free(discard);
+
+    *names = (char**)malloc(sizeof(char*) * (size_t)(count + 1));
+    *bytes = 0;
+    int units = 0;
+    char path[1024];
+
+    // Métodos das instâncias de genéricos: uma unidade que vê todos os módulos
+    int instance_bodies = 0;
+    for (ASTNode* node = instances; node; node = node->next) {
+        if (node->type == AST_FN_DECL || has_methods(node)) instance_bodies = 1;
+    }
+    if (instance_bodies) {
+        snprintf(path, sizeof(path), "%s/instancias", dir);
+        (*names)[units++] = rujo_strdup(path);
+        strcat(path, ".c");
+        gen_module_unit(path, 0, instances, NULL, preamble, preamble_len, bytes);
     }
-}
\ No newline at end of file
+
+    // O principal por último: a tabela das sondas só fica completa no fim
+    for (int m = 1; m <= count; m++) {
+        snprintf(path, sizeof(path), "%s/m_%s", dir, module_name(m));
+        (*names)[units++] = rujo_strdup(path);
+        strcat(path, ".c");
+        gen_module_unit(path, m, NULL, root->drops, preamble, preamble_len, bytes);
+    }
+    free(preamble);
+    return units;
+}
+#endif
+
+void codegen_stream_begin(ASTNode* decls) {
+    program_stmts = decls;
+    stream_mode = 1;
+    if (instrument_level) prof_site("main", 0);
+}
+
+void codegen_stream_item(ASTNode* item, FILE* out) {
+    ast_visit(item, collect_spawn, NULL);
+    ast_visit(item, collect_parallel, NULL);
+    gen_method(item, out);
+}
+
+void codegen_stream_stmt(ASTNode* stmt, FILE* out) {
+    ast_visit(stmt, collect_spawn, NULL);
+    ast_visit(stmt, collect_parallel, NULL);
+    gen_main_stmt(stmt, out);
+}
+
+static void copy_file(FILE* from, FILE* out) {
+    char buf[1 << 16];
+    size_t n;
+    rewind(from);
+    while ((n = fread(buf, 1, sizeof(buf), from)) > 0) fwrite(buf, 1, n, out);
+}
+
+void codegen_stream_finish(ASTNode* deferred, ASTNode* stmts, ASTNode* drops, FILE* bodies, FILE* main_part, FILE* out) {
+    ast_visit(stmts, collect_spawn, NULL);
+    ast_visit(stmts, collect_parallel, NULL);
+    // O cabeçalho numera como no programa inteiro, onde sai antes do main
+    GenCounters main_counters = counters;
+    memset(&counters, 0, sizeof(counters));
+    gen_preamble(out);
+    gen_header(program_stmts, deferred, out);
+    gen_methods(semantic_instances(), out);
+    gen_methods(deferred, out);
+    counters = main_counters;
+    copy_file(bodies, out);
+    gen_main_open(out);
+    copy_file(main_part, out);
+    for (ASTNode* s = stmts; s; s = s->next) gen_main_stmt(s, out);
+    gen_main_close(drops, out);
+}
@@ -6,4 +6,51 @@
 
 void codegen_generate(ASTNode* root, FILE* out);
 
+// --stream (stream.c): o mesmo C gerado aos pedaços. decls tem as classes e
+// as assinaturas das funções; cada função ou classe vai para um arquivo de
+// corpos e cada statement solto para um do main assim que é verificado. O
+// cabeçalho (runtime, structs, protótipos) depende do programa todo e só sai
+// em codegen_stream_finish, que monta o out.c: cabeçalho (com os frames de
+// todos os geradores), funções adiadas (geradores e async), os corpos e o
+// main com os statements que ficaram pendentes no fim. Quem itera sobre um
+// gerador é gerado antes dele e já embute o frame, que sai no cabeçalho.
+void codegen_stream_begin(ASTNode* decls);
+void codegen_stream_item(ASTNode* item, FILE* out);
+void codegen_stream_stmt(ASTNode* stmt, FILE* out);
+void codegen_stream_finish(ASTNode* deferred, ASTNode* stmts, ASTNode* drops, FILE* bodies, FILE* main_part, FILE* out);
+
+// Liga o harness dos blocos bench (comando rujo bench)
+void codegen_set_bench(int on);
+
+// Arquivo .rj compilado: vai nos #line do C gerado e no relatório de --instrument
+void codegen_set_source(const char* path);
+
+// --instrument: 1 sonda funções e métodos, 2 também os laços
+void codegen_set_instrument(int level);
+
+// --jobs: funções e classes geradas em N threads, cada uma num buffer, e
+// concatenadas na ordem das declarações (o C não muda com N)
+void codegen_set_jobs(int jobs);
+
+// build com --jobs N: o C sai em várias unidades de tradução para o gcc
+// compilar em paralelo. out.h tem o runtime, as structs, os protótipos e os
+// construtores; out_0.c o main; out_1.c .. out_N.c as funções e métodos,
+// divididos pelo tamanho do C. Retorna quantos out_K.c foram escritos (com o
+// out_0.c) e soma os bytes gerados em bytes. Só em sistemas POSIX (no
+// Windows o build usa um out.c só).
+int codegen_generate_units(ASTNode* root, int units, long* bytes);
+
+// build de um programa com módulos (module.h): uma unidade por módulo em
+// dir/m_<nome>.c e uma para os métodos das instâncias de genéricos
+// (dir/instancias.c), cada uma com o próprio cabeçalho. Fora o runtime, cada
+// unidade traz só o que o módulo usa: frames de geradores e protótipos dele e
+// das funções pub dos que ele importa, e structs, helpers, construtores e
+// protótipos das classes e instâncias que aparecem no código e nessas
+// declarações; os thunks de spawn e corpos @parallel são só do módulo. A
+// primeira linha tem o hash do fonte do módulo e das interfaces dos
+// importados, então o C (e a chave do cache) só muda quando um deles muda.
+// names recebe o caminho de cada unidade sem o ".c" (o main fica na última);
+// retorna quantas são. Só em sistemas POSIX.
+int codegen_generate_modules(ASTNode* root, const char* dir, char*** names, long* bytes);
+
 #endif
\ No newline at end of file
@@ -4,8 +4,12 @@
 #include <stdio.h> 
 
 void lexer_init(Lexer* l, const char* input) {
+    lexer_init_len(l, input, strlen(input));
+}
+
+void lexer_init_len(Lexer* l, const char* input, size_t length) {
     l->input = input;
-    l->input_len = strlen(input);
+    l->input_len = length;
     l->position = 0;
     l->read_position = 0;
     l->line = 1;
@@ -52,6 +56,7 @@ TokenType lookup_ident(const char* ident, int length) {
         if (length == (int)strlen(str) && strncmp(ident, str, length) == 0) return type;
 
     CHECK_KEYWORD("int", TOK_TYPE_INT);
+    CHECK_KEYWORD("long", TOK_TYPE_LONG);
     CHECK_KEYWORD("float", TOK_TYPE_FLOAT);
     CHECK_KEYWORD("bool", TOK_TYPE_BOOL);
     CHECK_KEYWORD("byte", TOK_TYPE_BYTE);
@@ -69,6 +74,14 @@ TokenType lookup_ident(const char* ident, int length) {
     CHECK_KEYWORD("module", TOK_MODULE);
     CHECK_KEYWORD("required", TOK_REQUIRED);
     CHECK_KEYWORD("annotation", TOK_ANNOTATION);
+    CHECK_KEYWORD("new", TOK_NEW);
+    CHECK_KEYWORD("arena", TOK_ARENA);
+    CHECK_KEYWORD("spawn", TOK_SPAWN);
+    CHECK_KEYWORD("yield", TOK_YIELD);
+    CHECK_KEYWORD("in", TOK_IN);
+    CHECK_KEYWORD("async", TOK_ASYNC);
+    CHECK_KEYWORD("await", TOK_AWAIT);
+    CHECK_KEYWORD("bench", TOK_BENCH);
 
     CHECK_KEYWORD("if", TOK_IF);
     CHECK_KEYWORD("else", TOK_ELSE);
@@ -213,7 +226,21 @@ const char* token_type_to_str(TokenType type) {
         case TOK_PROP: return "PROP";
         case TOK_INIT: return "INIT";
         case TOK_RETURN: return "RETURN";
+        case TOK_ANNOTATION: return "ANNOTATION";
+        case TOK_NEW: return "NEW";
+        case TOK_ARENA: return "ARENA";
+        case TOK_SPAWN: return "SPAWN";
+        case TOK_YIELD: return "YIELD";
+        case TOK_IN: return "IN";
+        case TOK_ASYNC: return "ASYNC";
+        case TOK_AWAIT: return "AWAIT";
+        case TOK_BENCH: return "BENCH";
+        case TOK_AT: return "AT (@)";
+        case TOK_QUESTION: return "QUESTION (?)";
+        case TOK_AMPERSAND: return "AMPERSAND (&)";
+        case TOK_TYPE_BOOL: return "TYPE_BOOL";
         case TOK_TYPE_INT: return "TYPE_INT";
+        case TOK_TYPE_LONG: return "TYPE_LONG";
         case TOK_TYPE_FLOAT: return "TYPE_FLOAT";
         case TOK_TYPE_STRING: return "TYPE_STRING";
         case TOK_TYPE_VOID: return "TYPE_VOID";
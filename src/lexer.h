@@ -25,6 +25,14 @@ typedef enum {
     TOK_RETURN,
     TOK_REQUIRED,
     TOK_ANNOTATION,
+    TOK_NEW,
+    TOK_ARENA,
+    TOK_SPAWN,
+    TOK_YIELD,
+    TOK_IN,
+    TOK_ASYNC,
+    TOK_AWAIT,
+    TOK_BENCH,
 
     TOK_TYPEOF,
 
@@ -35,6 +43,7 @@ typedef enum {
     TOK_FOR,   // Novo
 
     TOK_TYPE_INT,
+    TOK_TYPE_LONG,
     TOK_TYPE_FLOAT,
     TOK_TYPE_BOOL,
     TOK_TYPE_BYTE,
@@ -92,6 +101,8 @@ typedef struct {
 } Lexer;
 
 void lexer_init(Lexer* l, const char* input);
+// Fonte sem '\0' no fim (arquivo mapeado): só os length bytes são lidos
+void lexer_init_len(Lexer* l, const char* input, size_t length);
 Token lexer_next_token(Lexer* l);
 const char* token_type_to_str(TokenType type);
 
@@ -1,62 +1,391 @@
+#define _XOPEN_SOURCE 700 // setenv, realpath
+#include <errno.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
 #include "lexer.h"
 #include "parser.h"
+#include "semantic.h"
 #include "codegen.h"
 #include "utils.h" 
+#include "stats.h"
+#include "stream.h"
+#include "module.h"
+#include "watch.h"
+#ifndef _WIN32
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+// --time-report / --time-report-json (0 se o JSON não pôde ser gravado)
+static int time_report(int report, const char* json, const char* filename) {
+    phase_end();
+    if (report) stats_report(stderr);
+    if (json && !stats_write_json(json, filename)) {
+        printf("Erro: Nao foi possivel escrever '%s'\n", json);
+        return 0;
+    }
+    return 1;
+}
+
+#ifndef _WIN32
+// Roda os comandos com até jobs ao mesmo tempo; 0 se algum falhou
+static int run_parallel(char** cmds, int count, int jobs) {
+    int running = 0, next = 0, ok = 1;
+    while (next < count || running > 0) {
+        if (next < count && running < jobs) {
+            pid_t pid = fork();
+            if (pid == 0) {
+                // Sem o inline das funções de outras unidades, um main com
+                // milhares de chamadas estoura a pilha padrão do cc1
+                struct rlimit stack;
+                if (getrlimit(RLIMIT_STACK, &stack) == 0) {
+                    stack.rlim_cur = stack.rlim_max;
+                    setrlimit(RLIMIT_STACK, &stack);
+                }
+                execl("/bin/sh", "sh", "-c", cmds[next], (char*)NULL);
+                _exit(127);
+            }
+            if (pid < 0) return 0;
+            next++;
+            running++;
+            continue;
+        }
+        int status;
+        if (wait(&status) < 0) return 0;
+        running--;
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) ok = 0;
+    }
+    return ok;
+}
+
+// --jobs no build: cada out_K.c vira um .o em paralelo e o link junta todos
+static int compile_units(int units, int jobs, int lto, const char* libs, const char* exe_name) {
+    char** cmds = (char**)malloc(sizeof(char*) * (size_t)units);
+    char* link = (char*)malloc((size_t)units * 16 + 256);
+    int n = sprintf(link, "gcc -O2 -g%s", lto ? " -flto=auto" : "");
+    for (int i = 0; i < units; i++) {
+        cmds[i] = (char*)malloc(128);
+        sprintf(cmds[i], "gcc -O2 -g%s -c out_%d.c -o out_%d.o%s", lto ? " -flto" : "", i, i, libs);
+        n += sprintf(link + n, " out_%d.o", i);
+    }
+    sprintf(link + n, " -o %s -lm%s", exe_name, libs);
+    int ok = run_parallel(cmds, units, jobs) && system(link) == 0;
+    for (int i = 0; i < units; i++) free(cmds[i]);
+    free(cmds);
+    free(link);
+    return ok;
+}
+
+// Diretório dos .o dos módulos, guardados entre builds
+#define MODULE_CACHE ".rujo"
+
+// Módulos: cada unidade <nome>.c vira <nome>.o, que fica para o próximo
+// build. A chave (hash do C e do comando do gcc) vai em <nome>.key; só as
+// unidades com a chave mudada (ou sem .o) são recompiladas, em paralelo, e o
+// link junta todas. rebuilt recebe quantas foram recompiladas
+static int compile_modules(char** names, int count, int jobs, int lto, const char* libs, const char* exe_name,
+                           int* rebuilt) {
+    char** cmds = (char**)malloc(sizeof(char*) * (size_t)count);
+    char** todo = (char**)malloc(sizeof(char*) * (size_t)count);
+    uint64_t* keys = (uint64_t*)malloc(sizeof(uint64_t) * (size_t)count);
+    int* stale = (int*)malloc(sizeof(int) * (size_t)count);
+    size_t link_len = 256 + strlen(exe_name) + strlen(libs);
+    for (int i = 0; i < count; i++) link_len += strlen(names[i]) + 4;
+    char* link = (char*)malloc(link_len);
+    char* path = (char*)malloc(link_len);
+    int n = sprintf(link, "gcc -O2 -g%s", lto ? " -flto=auto" : "");
+    int ok = 1;
+    *rebuilt = 0;
+
+    for (int i = 0; i < count; i++) {
+        cmds[i] = (char*)malloc(strlen(names[i]) * 2 + strlen(libs) + 64);
+        sprintf(cmds[i], "gcc -O2 -g%s -c %s.c -o %s.o%s", lto ? " -flto" : "", names[i], names[i], libs);
+        n += sprintf(link + n, " %s.o", names[i]);
+
+        sprintf(path, "%s.c", names[i]);
+        char* text = read_file(path);
+        if (!text) {
+            ok = 0;
+            continue;
+        }
+        keys[i] = hash_bytes(hash_bytes(HASH_SEED, text, strlen(text)), cmds[i], strlen(cmds[i]));
+        free(text);
+
+        unsigned long long old = 0;
+        sprintf(path, "%s.key", names[i]);
+        FILE* key = fopen(path, "r");
+        int cached = key && fscanf(key, "%llx", &old) == 1 && old == (unsigned long long)keys[i];
+        if (key) fclose(key);
+        sprintf(path, "%s.o", names[i]);
+        if (cached && access(path, F_OK) == 0) continue;
+        // Sem a chave até o .o novo ficar pronto: um build interrompido não deixa um .o velho valendo
+        sprintf(path, "%s.key", names[i]);
+        remove(path);
+        stale[*rebuilt] = i;
+        todo[(*rebuilt)++] = cmds[i];
+    }
+    sprintf(link + n, " -o %s -lm%s", exe_name, libs);
+
+    ok = ok && run_parallel(todo, *rebuilt, jobs);
+    for (int k = 0; ok && k < *rebuilt; k++) {
+        sprintf(path, "%s.key", names[stale[k]]);
+        FILE* key = fopen(path, "w");
+        if (key) {
+            fprintf(key, "%llx\n", (unsigned long long)keys[stale[k]]);
+            fclose(key);
+        }
+    }
+    ok = ok && system(link) == 0;
+    for (int i = 0; i < count; i++) free(cmds[i]);
+    free(cmds);
+    free(todo);
+    free(keys);
+    free(stale);
+    free(link);
+    free(path);
+    return ok;
+}
+#endif
+
+static FILE* open_output(void) {
+    FILE* out_file = fopen("out.c", "w");
+    if (!out_file) printf("Erro: Nao foi possivel criar o arquivo 'out.c'\n");
+    return out_file;
+}
 
 int main(int argc, char* argv[]) {
     if (argc < 3) {
-        printf("Uso: rujo <comando> <arquivo.rj>\n");
+        printf("Uso: rujo <comando> <arquivo.rj> [opcoes]\n");
         printf("Comandos:\n");
         printf("  build   Compila para executavel nativo\n");
+        printf("  emit    Gera so o C (out.c), sem chamar o gcc\n");
         printf("  run     Compila e executa imediatamente\n");
+        printf("  bench   Compila e roda os blocos bench (--json arquivo grava os resultados)\n");
+        printf("  profile Compila com sondas, executa e mostra o perfil (como run --instrument)\n");
+        printf("  watch   Refaz o build a cada mudanca nos .rj (arquivo ou diretorio com main.rj;\n");
+        printf("          --run executa o programa depois de cada build)\n");
+        printf("Opcoes de build/run/profile:\n");
+        printf("  --instrument        Sonda a entrada e a saida de cada funcao\n");
+        printf("  --instrument-loops  Sonda tambem cada laco\n");
+        printf("Opcoes gerais:\n");
+        printf("  --stream            Compila um item por vez, com memoria limitada (fontes enormes)\n");
+        printf("  --jobs N            Gera o C das funcoes em N threads (o C gerado nao muda); no\n");
+        printf("                      build divide o C em N unidades compiladas em paralelo (com\n");
+        printf("                      import: N modulos compilados ao mesmo tempo, padrao os nucleos)\n");
+        printf("  --lto               Com --jobs, otimiza de novo no link (inline entre unidades)\n");
+        printf("  --time-report       Tempo, CPU, alocacoes e pico de memoria de cada fase\n");
+        printf("  --time-report-json arquivo  O mesmo relatorio em JSON\n");
         return 1;
     }
 
     const char* command = argv[1];
     const char* filename = argv[2];
+    const char* json_path = NULL;
+    const char* report_json = NULL;
+    int report = 0;
+    int stream = 0;
+    int jobs = 1;
+    int jobs_given = 0;
+    int lto = 0;
+    int bench = strcmp(command, "bench") == 0;
+    int emit = strcmp(command, "emit") == 0;
+    int profile = strcmp(command, "profile") == 0;
+    int watching = strcmp(command, "watch") == 0;
+    int rerun = 0;
+    int instrument = profile ? 1 : 0;
+
+    if (strcmp(command, "build") != 0 && strcmp(command, "run") != 0 && !bench && !profile && !emit && !watching) {
+        printf("Comando desconhecido: %s\n", command);
+        return 1;
+    }
+    for (int i = 3; i < argc; i++) {
+        if (bench && strcmp(argv[i], "--json") == 0 && i + 1 < argc) {
+            json_path = argv[++i];
+        } else if (watching && strcmp(argv[i], "--run") == 0) {
+            rerun = 1;
+        } else if (!bench && strcmp(argv[i], "--instrument") == 0) {
+            if (instrument < 1) instrument = 1;
+        } else if (!bench && strcmp(argv[i], "--instrument-loops") == 0) {
+            instrument = 2;
+        } else if (strcmp(argv[i], "--stream") == 0) {
+            stream = 1;
+        } else if (strcmp(argv[i], "--jobs") == 0 && i + 1 < argc) {
+            jobs = atoi(argv[++i]);
+            jobs_given = 1;
+            if (jobs < 1) {
+                printf("Erro: --jobs espera um numero de threads maior que zero\n");
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--lto") == 0) {
+            lto = 1;
+        } else if (strcmp(argv[i], "--time-report") == 0) {
+            report = 1;
+        } else if (strcmp(argv[i], "--time-report-json") == 0 && i + 1 < argc) {
+            report_json = argv[++i];
+        } else {
+            printf("Opcao desconhecida: %s\n", argv[i]);
+            return 1;
+        }
+    }
 
-    char* source = read_file(filename);
-    if (!source) return 1;
+    if (watching) {
+        if (stream) {
+            printf("Erro: rujo watch nao suporta --stream\n");
+            return 1;
+        }
+        // Daqui em diante só no processo de cada build, como um build/run comum
+        filename = watch_main_file(filename);
+        watch_loop(filename);
+        command = rerun ? "run" : "build";
+    }
 
-    Lexer l;
-    lexer_init(&l, source);
+    if (report || report_json) stats_enable();
 
-    parser_init(&l);
-    ASTNode* root = parser_parse_program(&l);
+    // O C gerado fica ao lado do executável; os #line apontam para o .rj pelo
+    // caminho absoluto, então perf/gdb acham o fonte de qualquer diretório
+#ifdef _WIN32
+    char* source_path = _fullpath(NULL, filename, 0);
+#else
+    char* source_path = realpath(filename, NULL);
+#endif
+    codegen_set_source(source_path ? source_path : filename);
+    codegen_set_bench(bench);
+    codegen_set_instrument(instrument);
+    codegen_set_jobs(jobs);
 
-    FILE* out_file = fopen("out.c", "w");
-    if (!out_file) {
-        printf("Erro: Nao foi possivel criar o arquivo temporario 'out.c'\n");
-        return 1;
+    FILE* out_file = NULL;
+    int units = 0;          // out_K.c escritos (0: um out.c só)
+    char** unit_names = NULL; // Com módulos: as unidades em MODULE_CACHE
+    long c_bytes = 0;
+    if (stream) {
+        out_file = open_output();
+        if (!out_file) return 1;
+        if (!stream_compile(filename, out_file)) {
+            printf("Compilacao abortada: erros semanticos.\n");
+            return 1;
+        }
+    } else {
+        ASTNode* root;
+        if (watching) {
+            // Os arquivos que não mudaram desde o último build vêm prontos do watch
+            phase_begin("parse");
+            root = watch_parse(source_path ? source_path : filename);
+        } else {
+            phase_begin("leitura");
+            char* source = read_file(filename);
+            if (!source) return 1;
+            int64_t lines = *source ? 1 : 0;
+            for (const char* c = source; *c; c++) lines += *c == '\n' && c[1];
+            stat_add(STAT_LINES, lines);
+
+            Lexer l;
+            // O parser puxa os tokens sob demanda; no relatório o lexer tem uma
+            // passada só dele para o seu tempo aparecer separado
+            if (report || report_json) {
+                phase_begin("lex");
+                lexer_init(&l, source);
+                while (lexer_next_token(&l).type != TOK_EOF) {}
+            }
+            lexer_init(&l, source);
+
+            phase_begin("parse");
+            parser_init(&l);
+            root = parser_parse_program(&l);
+        }
+        root = module_load(root, filename);
+
+        // O codegen depende dos tipos resolvidos pelo semântico (ex: arrays @soa)
+        phase_begin("semantico");
+        if (!semantic_analysis(root)) {
+            printf("Compilacao abortada: erros semanticos.\n");
+            return 1;
+        }
+
+#ifndef _WIN32
+        // Várias unidades só quando o gcc vai rodar; o emit continua com um out.c
+        if (module_count() > 0 && !emit) {
+            if (mkdir(MODULE_CACHE, 0755) != 0 && errno != EEXIST) {
+                printf("Erro: Nao foi possivel criar o diretorio '%s'\n", MODULE_CACHE);
+                return 1;
+            }
+            phase_begin("codegen");
+            units = codegen_generate_modules(root, MODULE_CACHE, &unit_names, &c_bytes);
+        } else if (jobs > 1 && !emit) {
+            phase_begin("codegen");
+            units = codegen_generate_units(root, jobs, &c_bytes);
+        }
+#endif
+        if (!units) {
+            out_file = open_output();
+            if (!out_file) return 1;
+            phase_begin("codegen");
+            codegen_generate(root, out_file);
+        }
+    }
+    if (out_file) {
+        c_bytes = ftell(out_file);
+        fclose(out_file);
+    }
+    stat_add(STAT_C_BYTES, c_bytes);
+
+    if (emit) {
+        if (!time_report(report, report_json, filename)) return 1;
+        printf("Sucesso! C gerado em 'out.c'.\n");
+        return 0;
     }
-    
-    codegen_generate(root, out_file);
-    fclose(out_file);
 
     char gcc_cmd[512];
     const char* exe_name = "program.exe";
-    sprintf(gcc_cmd, "gcc out.c -o %s", exe_name);
-    
-    int compile_status = system(gcc_cmd);
+    // O runtime de tarefas usa pthreads; -g leva as linhas do .rj para o binário;
+    // -lm para o sqrt (o gcc só chama a libm quando o argumento é negativo)
+    const char* libs = semantic_uses_tasks() ? " -pthread" : "";
+    sprintf(gcc_cmd, "gcc -O2 -g out.c -o %s -lm%s", exe_name, libs);
+
+    phase_begin_child("gcc");
+    int compile_status;
+    int rebuilt = 0;
+#ifndef _WIN32
+    if (unit_names) {
+        // Sem --jobs, um gcc por núcleo
+        long cores = sysconf(_SC_NPROCESSORS_ONLN);
+        int gcc_jobs = jobs_given ? jobs : (cores > 0 ? (int)cores : 1);
+        compile_status = compile_modules(unit_names, units, gcc_jobs, lto, libs, exe_name, &rebuilt) ? 0 : 1;
+    }
+    else if (units) compile_status = compile_units(units, jobs, lto, libs, exe_name) ? 0 : 1;
+    else
+#endif
+    compile_status = system(gcc_cmd);
+    phase_end();
     if (compile_status != 0) {
         printf("Erro de Compilacao (GCC falhou).\n");
         return 1;
     }
+    if (!time_report(report, report_json, filename)) return 1;
 
-    if (strcmp(command, "run") == 0) {
-        char run_cmd[512];
-        sprintf(run_cmd, ".\\%s", exe_name); 
-        system(run_cmd);
-    } else if (strcmp(command, "build") == 0) {
-        printf("Sucesso! Compilado para '%s'.\n", exe_name);
-    } else {
-        printf("Comando desconhecido: %s\n", command);
-        return 1;
+    if (strcmp(command, "build") == 0) {
+        if (unit_names) {
+            printf("Sucesso! Compilado para '%s' (%d de %d unidades recompiladas).\n", exe_name, rebuilt, units);
+        } else {
+            printf("Sucesso! Compilado para '%s'.\n", exe_name);
+        }
+        return 0;
     }
 
+    // O harness de bench lê o destino do JSON do ambiente
+    char run_cmd[512];
+#ifdef _WIN32
+    if (json_path) _putenv_s("RUJO_BENCH_JSON", json_path);
+    sprintf(run_cmd, ".\\%s", exe_name);
+#else
+    if (json_path) setenv("RUJO_BENCH_JSON", json_path, 1);
+    sprintf(run_cmd, "./%s", exe_name);
+#endif
+    int status = system(run_cmd);
+    if (bench && status != 0) return 1;
+
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,219 @@
+#define _XOPEN_SOURCE 700 // realpath
+#include "module.h"
+#include "lexer.h"
+#include "parser.h"
+#include "utils.h"
+#include "stats.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+    char* name;
+    char* path;
+    ASTNode* first;
+    ASTNode* last;
+    int* imports;      // Índices dos módulos importados
+    int import_count;
+    int index;         // 0 enquanto carrega: um import dele de novo é um ciclo
+} Module;
+
+static Module** loaded = NULL;   // Na ordem em que começaram a ser carregados
+static int loaded_count = 0;
+static Module** modules = NULL;  // Por índice - 1 (dependências antes)
+static int count = 0;
+static char* base_dir = NULL;
+static ASTNode* program_head = NULL;
+static ASTNode* program_tail = NULL;
+static ASTNode* (*reader)(const char* path) = NULL;
+
+static char* absolute_path(const char* path) {
+#ifdef _WIN32
+    char* full = _fullpath(NULL, path, 0);
+#else
+    char* full = realpath(path, NULL);
+#endif
+    if (full) return full;
+    char* copy = (char*)malloc(strlen(path) + 1);
+    strcpy(copy, path);
+    return copy;
+}
+
+// a.b -> <diretório do principal>/a/b.rj
+static char* module_file(const char* name) {
+    char* path = (char*)malloc(strlen(base_dir) + strlen(name) + 5);
+    char* p = path + sprintf(path, "%s/", base_dir);
+    for (const char* c = name; *c; c++) *p++ = *c == '.' ? '/' : *c;
+    strcpy(p, ".rj");
+    return path;
+}
+
+static ASTNode* parse_file(const char* path) {
+    if (reader) return reader(path)->data.program.statements;
+    char* source = read_file(path);
+    if (!source) exit(1);
+    int64_t lines = *source ? 1 : 0;
+    for (const char* c = source; *c; c++) lines += *c == '\n' && c[1];
+    stat_add(STAT_LINES, lines);
+
+    Lexer l;
+    lexer_init(&l, source);
+    parser_init(&l);
+    return parser_parse_program(&l)->data.program.statements;
+}
+
+static Module* find_loaded(const char* name) {
+    for (int i = 0; i < loaded_count; i++) {
+        if (strcmp(loaded[i]->name, name) == 0) return loaded[i];
+    }
+    return NULL;
+}
+
+static void set_module(ASTNode* decl, int index) {
+    if (decl->type == AST_FN_DECL) decl->data.fn_decl.module = index;
+    else if (decl->type == AST_CLASS_DECL) decl->data.class_decl.module = index;
+}
+
+// Carrega os imports de stmts (recursivamente) e registra o módulo depois deles
+static Module* load(char* name, char* path, ASTNode* stmts, int main_file) {
+    Module* m = (Module*)calloc(1, sizeof(Module));
+    m->name = name;
+    m->path = path;
+    loaded = (Module**)realloc(loaded, sizeof(Module*) * (size_t)(loaded_count + 1));
+    loaded[loaded_count++] = m;
+
+    int first = 1;
+    ASTNode* stmt = stmts;
+    while (stmt) {
+        ASTNode* next = stmt->next;
+        stmt->next = NULL;
+        if (stmt->type == AST_MODULE) {
+            if (!first) {
+                printf("Erro: 'module' deve ser a primeira declaracao de '%s' (linha %d)\n", path, stmt->line);
+                exit(1);
+            }
+            if (main_file) {
+                m->name = stmt->data.module.name;
+            } else if (strcmp(stmt->data.module.name, name) != 0) {
+                printf("Erro: '%s' declara 'module %s', mas foi importado como '%s'\n",
+                    path, stmt->data.module.name, name);
+                exit(1);
+            }
+        } else if (stmt->type == AST_IMPORT) {
+            char* dep_name = stmt->data.module.name;
+            Module* dep = find_loaded(dep_name);
+            if (dep && !dep->index) {
+                printf("Erro: Import circular: '%s' importa '%s' (linha %d de '%s')\n",
+                    m->name, dep_name, stmt->line, path);
+                exit(1);
+            }
+            if (!dep) {
+                char* dep_file = module_file(dep_name);
+                FILE* f = fopen(dep_file, "rb");
+                if (!f) {
+                    printf("Erro: Modulo '%s' nao encontrado ('%s', importado na linha %d de '%s')\n",
+                        dep_name, dep_file, stmt->line, path);
+                    exit(1);
+                }
+                fclose(f);
+                char* dep_path = absolute_path(dep_file);
+                free(dep_file);
+                dep = load(dep_name, dep_path, parse_file(dep_path), 0);
+            }
+            m->imports = (int*)realloc(m->imports, sizeof(int) * (size_t)(m->import_count + 1));
+            m->imports[m->import_count++] = dep->index;
+        } else {
+            if (!main_file && stmt->type != AST_FN_DECL && stmt->type != AST_CLASS_DECL) {
+                printf("Erro: Modulo '%s' so pode declarar fn e class (linha %d de '%s')\n",
+                    name, stmt->line, path);
+                exit(1);
+            }
+            if (!m->first) m->first = stmt;
+            else m->last->next = stmt;
+            m->last = stmt;
+        }
+        first = 0;
+        stmt = next;
+    }
+
+    m->index = ++count;
+    modules = (Module**)realloc(modules, sizeof(Module*) * (size_t)count);
+    modules[count - 1] = m;
+    for (ASTNode* item = m->first; item; item = item->next) set_module(item, m->index);
+    if (m->first) {
+        if (!program_head) program_head = m->first;
+        else program_tail->next = m->first;
+        program_tail = m->last;
+    }
+    return m;
+}
+
+void module_set_reader(ASTNode* (*parse)(const char* path)) {
+    reader = parse;
+}
+
+ASTNode* module_load(ASTNode* root, const char* path) {
+    int uses_modules = 0;
+    for (ASTNode* stmt = root->data.program.statements; stmt; stmt = stmt->next) {
+        if (stmt->type == AST_MODULE || stmt->type == AST_IMPORT) uses_modules = 1;
+    }
+    if (!uses_modules) return root;
+
+    char* root_path = absolute_path(path);
+    base_dir = (char*)malloc(strlen(root_path) + 2);
+    strcpy(base_dir, root_path);
+    char* slash = strrchr(base_dir, '/');
+#ifdef _WIN32
+    char* backslash = strrchr(base_dir, '\\');
+    if (backslash > slash) slash = backslash;
+#endif
+    if (slash) *slash = '\0';
+    else strcpy(base_dir, ".");
+
+    // Sem "module" o principal se chama como o arquivo (sem o .rj)
+    const char* file = slash ? root_path + (slash - base_dir) + 1 : root_path;
+    char* name = (char*)malloc(strlen(file) + 1);
+    strcpy(name, file);
+    char* dot = strrchr(name, '.');
+    if (dot && strcmp(dot, ".rj") == 0) *dot = '\0';
+
+    load(name, root_path, root->data.program.statements, 1);
+    root->data.program.statements = program_head;
+    return root;
+}
+
+int module_count(void) {
+    return count;
+}
+
+const char* module_name(int index) {
+    return modules[index - 1]->name;
+}
+
+const char* module_path(int index) {
+    return modules[index - 1]->path;
+}
+
+ASTNode* module_first(int index) {
+    return modules[index - 1]->first;
+}
+
+ASTNode* module_last(int index) {
+    return modules[index - 1]->last;
+}
+
+bool module_imports(int from, int to) {
+    if (from == to) return true;
+    if (from < 1 || from > count) return false;
+    Module* m = modules[from - 1];
+    for (int i = 0; i < m->import_count; i++) {
+        if (m->imports[i] == to) return true;
+    }
+    return false;
+}
+
+int module_of(ASTNode* decl) {
+    if (decl->type == AST_FN_DECL) return decl->data.fn_decl.module;
+    if (decl->type == AST_CLASS_DECL) return decl->data.class_decl.module;
+    return 0;
+}
@@ -0,0 +1,38 @@
+#ifndef RUJO_MODULE_H
+#define RUJO_MODULE_H
+
+#include "ast.h"
+#include <stdbool.h>
+
+// Módulos: "import a.b;" carrega a/b.rj, a partir do diretório do arquivo
+// principal; "module a.b;" na primeira linha de um arquivo confirma o nome.
+// Quem importa só vê as fn e class marcadas com pub. Um módulo importado tem
+// só declarações: os statements soltos (o main) ficam no arquivo principal.
+
+// Junta ao programa principal (root, já lido pelo parser, de path) os módulos
+// que ele importa, direta ou indiretamente. Cada módulo vem antes de quem o
+// importa e o principal fica por último; os import/module saem da lista.
+// As declarações de nível superior recebem o índice do módulo (1 a
+// module_count(), o principal é o último). Sem import nem module, root volta
+// como está e module_count() é 0.
+ASTNode* module_load(ASTNode* root, const char* path);
+
+// Troca a leitura dos arquivos importados: parse devolve o AST_PROGRAM de
+// path (o rujo watch reaproveita as árvores dos arquivos que não mudaram)
+void module_set_reader(ASTNode* (*parse)(const char* path));
+
+int module_count(void);
+const char* module_name(int index);
+const char* module_path(int index); // Caminho absoluto do .rj
+
+// Primeiro e último item do módulo na lista do programa (NULL se vazio)
+ASTNode* module_first(int index);
+ASTNode* module_last(int index);
+
+// from importa to diretamente (ou é o próprio módulo)
+bool module_imports(int from, int to);
+
+// Módulo de uma fn ou class (0: do compilador ou de um programa sem módulos)
+int module_of(ASTNode* decl);
+
+#endif
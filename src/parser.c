@@ -2,6 +2,7 @@
 #include "lexer.h"
 #include "ast.h"
 #include "utils.h"
+#include "stats.h"
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
@@ -16,16 +17,77 @@ ASTNode* parse_equality(Lexer* l);
 ASTNode* parse_comparison(Lexer* l);
 ASTNode* parse_term(Lexer* l);
 ASTNode* parse_factor(Lexer* l);
+ASTNode* parse_postfix(Lexer* l);
 ASTNode* parse_primary(Lexer* l);
+ASTNode* parse_type_args(Lexer* l);
 
 Token curr_tok;
 
-void parser_init(Lexer* l) {
-    (void)l;
+// Aninhamento (parênteses, argumentos, índices, acessos encadeados, blocos).
+// Listas e a espinha esquerda de operadores binários são percorridas em laço
+// depois do parse; o resto desce por recursão, então o limite fica aqui
+#define MAX_NESTING 1000
+static int nesting = 0;
+
+static void nesting_enter(void) {
+    if (++nesting > MAX_NESTING) {
+        printf("Erro: Aninhamento maior que %d niveis na linha %d\n", MAX_NESTING, curr_tok.line);
+        exit(1);
+    }
 }
 
+// Nós criados a partir daqui ficam na posição do token atual (create_node);
+// statements e primários são depois marcados com o primeiro token deles
 void next_token(Lexer* l) {
     curr_tok = lexer_next_token(l);
+    ast_set_pos(curr_tok.line, curr_tok.column);
+    stat_add(STAT_TOKENS, 1);
+}
+
+// Lê o primeiro token; daí em diante o parser está sempre um token à frente
+void parser_init(Lexer* l) {
+    nesting = 0;
+    next_token(l);
+}
+
+// Lookahead sem consumir: o Lexer é uma struct de valor, basta copiá-lo
+Token peek_token(Lexer* l, int n) {
+    Lexer copy = *l;
+    Token t = curr_tok;
+    for (int i = 0; i < n; i++) {
+        t = lexer_next_token(&copy);
+    }
+    return t;
+}
+
+int is_type_token(TokenType type) {
+    return type == TOK_TYPE_INT || type == TOK_TYPE_LONG || type == TOK_TYPE_FLOAT || type == TOK_TYPE_BOOL ||
+           type == TOK_TYPE_BYTE || type == TOK_TYPE_CHAR || type == TOK_TYPE_STRING ||
+           type == TOK_TYPE_VOID || type == TOK_IDENT;
+}
+
+// A partir do token n (que deve ser '<'), verifica se há uma lista de argumentos
+// de tipo balanceada. Retorna o índice do token após o '>' ou -1.
+int scan_type_args(Lexer* l, int n) {
+    Lexer copy = *l;
+    Token t = curr_tok;
+    for (int i = 0; i < n; i++) t = lexer_next_token(&copy);
+    if (t.type != TOK_LT) return -1;
+
+    int depth = 0;
+    while (1) {
+        if (t.type == TOK_LT) {
+            depth++;
+        } else if (t.type == TOK_GT) {
+            depth--;
+            if (depth == 0) return n + 1;
+        } else if (!is_type_token(t.type) && t.type != TOK_COMMA &&
+                   t.type != TOK_LBRACKET && t.type != TOK_RBRACKET) {
+            return -1;
+        }
+        t = lexer_next_token(&copy);
+        n++;
+    }
 }
 
 void expect(Lexer* l, TokenType type) {
@@ -42,6 +104,7 @@ char* parse_type_name(Lexer* l) {
     char* type_name = NULL;
     switch (curr_tok.type) {
         case TOK_TYPE_INT:    type_name = "int"; break;
+        case TOK_TYPE_LONG:   type_name = "long"; break;
         case TOK_TYPE_FLOAT:  type_name = "float"; break;
         case TOK_TYPE_BOOL:   type_name = "bool"; break;
         case TOK_TYPE_BYTE:   type_name = "byte"; break;
@@ -56,12 +119,113 @@ char* parse_type_name(Lexer* l) {
             exit(1);
     }
     next_token(l);
+
+    // Genéricos: List<int>, Pair<int,float> (forma canônica, sem espaços)
+    if (curr_tok.type == TOK_LT) {
+        ASTNode* args = parse_type_args(l);
+        size_t len = strlen(type_name) + 3;
+        for (ASTNode* a = args; a; a = a->next) len += strlen(a->data.ident.name) + 1;
+        char* full = (char*)region_alloc(len);
+        strcpy(full, type_name);
+        strcat(full, "<");
+        for (ASTNode* a = args; a; a = a->next) {
+            strcat(full, a->data.ident.name);
+            if (a->next) strcat(full, ",");
+        }
+        strcat(full, ">");
+        type_name = full;
+    }
+
+    // Arrays: T[]
+    if (curr_tok.type == TOK_LBRACKET && peek_token(l, 1).type == TOK_RBRACKET) {
+        next_token(l);
+        next_token(l);
+        char* arr_type = (char*)region_alloc(strlen(type_name) + 3);
+        sprintf(arr_type, "%s[]", type_name);
+        type_name = arr_type;
+    }
     return type_name;
 }
 
+// <int, List<float>>: cada tipo vira um AST_IDENTIFIER com o nome canônico
+ASTNode* parse_type_args(Lexer* l) {
+    expect(l, TOK_LT);
+    ASTNode* head = NULL;
+    ASTNode* last = NULL;
+    while (1) {
+        ASTNode* t = ast_new_ident(parse_type_name(l));
+        if (!head) head = t;
+        else last->next = t;
+        last = t;
+        if (curr_tok.type == TOK_COMMA) {
+            next_token(l);
+        } else {
+            break;
+        }
+    }
+    expect(l, TOK_GT);
+    return head;
+}
+
+// <T, U> na declaração de funções e classes genéricas
+ASTNode* parse_type_params(Lexer* l) {
+    if (curr_tok.type != TOK_LT) return NULL;
+    next_token(l);
+    ASTNode* head = NULL;
+    ASTNode* last = NULL;
+    while (1) {
+        char* name = rujo_strndup(curr_tok.literal, curr_tok.length);
+        expect(l, TOK_IDENT);
+        ASTNode* t = ast_new_ident(name);
+        if (!head) head = t;
+        else last->next = t;
+        last = t;
+        if (curr_tok.type == TOK_COMMA) {
+            next_token(l);
+        } else {
+            break;
+        }
+    }
+    expect(l, TOK_GT);
+    return head;
+}
+
+ASTNode* parse_args(Lexer* l) {
+    expect(l, TOK_LPAREN);
+    ASTNode* args = NULL;
+    ASTNode* last_arg = NULL;
+
+    if (curr_tok.type != TOK_RPAREN) {
+        while (1) {
+            ASTNode* arg = parse_expression(l);
+            if (!args) args = arg;
+            else last_arg->next = arg;
+            last_arg = arg;
+
+            if (curr_tok.type == TOK_COMMA) {
+                next_token(l);
+            } else {
+                break;
+            }
+        }
+    }
+    expect(l, TOK_RPAREN);
+    return args;
+}
+
 // --- EXPRESSÕES (Precedência) ---
 
+ASTNode* parse_primary_at(Lexer* l);
+
 ASTNode* parse_primary(Lexer* l) {
+    int line = curr_tok.line, col = curr_tok.column;
+    ASTNode* node = parse_primary_at(l);
+    node->line = line;
+    node->col = col;
+    return node;
+}
+
+ASTNode* parse_primary_at(Lexer* l) {
     ASTNode* node = NULL;
 
     switch (curr_tok.type) {
@@ -107,30 +271,27 @@ ASTNode* parse_primary(Lexer* l) {
 
         case TOK_IDENT:
             {
+                // Chamada genérica explícita: maior<int>(a, b)
+                int generic_end = -1;
+                if (peek_token(l, 1).type == TOK_LT) {
+                    generic_end = scan_type_args(l, 1);
+                    if (generic_end > 0 && peek_token(l, generic_end).type != TOK_LPAREN) {
+                        generic_end = -1;
+                    }
+                }
+
                 char* name = rujo_strndup(curr_tok.literal, curr_tok.length);
                 next_token(l);
+
+                ASTNode* type_args = NULL;
+                if (generic_end > 0) {
+                    type_args = parse_type_args(l);
+                }
                 
                 if (curr_tok.type == TOK_LPAREN) {
-                    next_token(l); // consome '('
-                    ASTNode* args = NULL;
-                    ASTNode* last_arg = NULL;
-                    
-                    if (curr_tok.type != TOK_RPAREN) {
-                        while (1) {
-                            ASTNode* arg = parse_expression(l);
-                            if (!args) args = arg;
-                            else last_arg->next = arg;
-                            last_arg = arg;
-
-                            if (curr_tok.type == TOK_COMMA) {
-                                next_token(l);
-                            } else {
-                                break;
-                            }
-                        }
-                    }
-                    expect(l, TOK_RPAREN);
+                    ASTNode* args = parse_args(l);
                     node = ast_new_call(name, args);
+                    node->data.call.type_args = type_args;
                 } else {
                     node = ast_new_ident(name);
                 }
@@ -155,6 +316,40 @@ ASTNode* parse_primary(Lexer* l) {
             }
             break;
 
+        case TOK_NEW:
+            {
+                next_token(l); // consome new
+                char* type_name = parse_type_name(l);
+                if (curr_tok.type == TOK_LPAREN) {
+                    // Instância: new Heroi("x"), new List<int>()
+                    node = ast_new_new(type_name, parse_args(l));
+                    break;
+                }
+                expect(l, TOK_LBRACKET);
+                ASTNode* size = parse_expression(l);
+                expect(l, TOK_RBRACKET);
+                node = ast_new_new_array(type_name, size);
+            }
+            break;
+
+        case TOK_SPAWN:
+            {
+                int line = curr_tok.line;
+                next_token(l); // consome spawn
+                ASTNode* call = parse_primary(l);
+                if (call->type != AST_CALL) {
+                    printf("Erro: 'spawn' espera uma chamada de funcao na linha %d\n", line);
+                    exit(1);
+                }
+                node = ast_new_spawn(call);
+            }
+            break;
+
+        case TOK_AWAIT:
+            next_token(l); // consome await
+            node = ast_new_await(parse_postfix(l), false);
+            break;
+
         default:
             printf("Erro: Token inesperado em expressão na linha %d: %s\n", curr_tok.line, token_type_to_str(curr_tok.type));
             exit(1);
@@ -162,13 +357,43 @@ ASTNode* parse_primary(Lexer* l) {
     return node;
 }
 
+// Acesso a membro (obj.campo), indexação (arr[i]) e propagação de erro (expr?)
+ASTNode* parse_postfix(Lexer* l) {
+    ASTNode* node = parse_primary(l);
+    int saved = nesting;
+
+    while (curr_tok.type == TOK_DOT || curr_tok.type == TOK_LBRACKET || curr_tok.type == TOK_QUESTION) {
+        nesting_enter();
+        if (curr_tok.type == TOK_QUESTION) {
+            next_token(l);
+            node = ast_new_try(node);
+        } else if (curr_tok.type == TOK_DOT) {
+            next_token(l);
+            char* member = rujo_strndup(curr_tok.literal, curr_tok.length);
+            expect(l, TOK_IDENT);
+            if (curr_tok.type == TOK_LPAREN) {
+                node = ast_new_method_call(node, member, parse_args(l));
+            } else {
+                node = ast_new_access(node, member);
+            }
+        } else {
+            next_token(l);
+            ASTNode* index = parse_expression(l);
+            expect(l, TOK_RBRACKET);
+            node = ast_new_index(node, index);
+        }
+    }
+    nesting = saved;
+    return node;
+}
+
 ASTNode* parse_factor(Lexer* l) {
-    ASTNode* left = parse_primary(l);
+    ASTNode* left = parse_postfix(l);
 
     while (curr_tok.type == TOK_STAR || curr_tok.type == TOK_SLASH) {
         char* op = (curr_tok.type == TOK_STAR) ? "*" : "/";
         next_token(l);
-        ASTNode* right = parse_primary(l);
+        ASTNode* right = parse_postfix(l);
         left = ast_new_binary_op(left, op, right);
     }
     return left;
@@ -218,11 +443,178 @@ ASTNode* parse_equality(Lexer* l) {
 }
 
 ASTNode* parse_expression(Lexer* l) {
-    return parse_equality(l);
+    nesting_enter();
+    ASTNode* node = parse_equality(l);
+    nesting--;
+    return node;
 }
 
 // --- STATEMENTS (Declarações) ---
 
+int is_assign_target(ASTNode* expr) {
+    return expr->type == AST_IDENTIFIER || expr->type == AST_ACCESS || expr->type == AST_INDEX;
+}
+
+// Declaração com tipo definido pelo usuário: "Heroi h;" ou "Heroi[] hs = ...;"
+int is_custom_type_decl(Lexer* l) {
+    if (curr_tok.type != TOK_IDENT) return 0;
+    int n = 1;
+    if (peek_token(l, 1).type == TOK_LT) {
+        // List<int> xs;
+        n = scan_type_args(l, 1);
+        if (n < 0) return 0;
+    }
+    Token t1 = peek_token(l, n);
+    if (t1.type == TOK_IDENT) return 1;
+    if (t1.type == TOK_LBRACKET && peek_token(l, n + 1).type == TOK_RBRACKET) return 1;
+    return 0;
+}
+
+ASTNode* parse_params(Lexer* l) {
+    expect(l, TOK_LPAREN);
+
+    ASTNode* params = NULL;
+    ASTNode* last_param = NULL;
+
+    if (curr_tok.type != TOK_RPAREN) {
+        while (1) {
+            // &T: empréstimo, a função não assume a posse do valor
+            bool borrowed = false;
+            if (curr_tok.type == TOK_AMPERSAND) {
+                next_token(l);
+                borrowed = true;
+            }
+            char* p_type = parse_type_name(l);
+            char* p_name = rujo_strndup(curr_tok.literal, curr_tok.length);
+            expect(l, TOK_IDENT);
+
+            ASTNode* p_node = ast_new_var_decl(p_name, p_type, NULL);
+            p_node->data.var_decl.borrowed = borrowed;
+            if (!params) params = p_node;
+            else last_param->next = p_node;
+            last_param = p_node;
+
+            if (curr_tok.type == TOK_COMMA) {
+                next_token(l);
+            } else {
+                break;
+            }
+        }
+    }
+
+    expect(l, TOK_RPAREN);
+    return params;
+}
+
+// @nome antes de uma declaração
+ASTNode* parse_annotations(Lexer* l) {
+    ASTNode* head = NULL;
+    ASTNode* last = NULL;
+    while (curr_tok.type == TOK_AT) {
+        next_token(l);
+        char* name = rujo_strndup(curr_tok.literal, curr_tok.length);
+        expect(l, TOK_IDENT);
+        ASTNode* a = ast_new_annotation(name);
+        if (!head) head = a;
+        else last->next = a;
+        last = a;
+    }
+    return head;
+}
+
+ASTNode* parse_class_decl(Lexer* l) {
+    next_token(l); // consome class
+    char* name = rujo_strndup(curr_tok.literal, curr_tok.length);
+    expect(l, TOK_IDENT);
+    ASTNode* type_params = parse_type_params(l);
+    expect(l, TOK_LBRACE);
+
+    ASTNode* members = NULL;
+    ASTNode* last = NULL;
+
+    while (curr_tok.type != TOK_RBRACE && curr_tok.type != TOK_EOF) {
+        ASTNode* member = NULL;
+
+        if (curr_tok.type == TOK_PROP) {
+            next_token(l);
+            char* p_type = parse_type_name(l);
+            char* p_name = rujo_strndup(curr_tok.literal, curr_tok.length);
+            expect(l, TOK_IDENT);
+            expect(l, TOK_SEMICOLON);
+            member = ast_new_prop_decl(p_name, p_type);
+        } else if (curr_tok.type == TOK_INIT) {
+            int line = curr_tok.line, col = curr_tok.column;
+            next_token(l);
+            ASTNode* params = parse_params(l);
+            ASTNode* body = parse_statement(l);
+            member = ast_new_fn_decl("init", "void", params, body);
+            member->line = line;
+            member->col = col;
+        } else if (curr_tok.type == TOK_FN) {
+            member = parse_statement(l);
+        } else {
+            printf("Erro: Membro de classe invalido na linha %d ('%s')\n", curr_tok.line, token_type_to_str(curr_tok.type));
+            exit(1);
+        }
+
+        if (!members) members = member;
+        else last->next = member;
+        last = member;
+    }
+    expect(l, TOK_RBRACE);
+    ASTNode* cls = ast_new_class_decl(name, members);
+    cls->data.class_decl.type_params = type_params;
+    return cls;
+}
+
+// Pula um tipo começando no token n (T, T<...>, T[]): índice do token seguinte ou -1
+int scan_type(Lexer* l, int n) {
+    if (!is_type_token(peek_token(l, n).type)) return -1;
+    n++;
+    if (peek_token(l, n).type == TOK_LT) {
+        n = scan_type_args(l, n);
+        if (n < 0) return -1;
+    }
+    if (peek_token(l, n).type == TOK_LBRACKET && peek_token(l, n + 1).type == TOK_RBRACKET) n += 2;
+    return n;
+}
+
+// Depois de "for (": T x in ... ou K k, V v in ... (tipos podem ser genéricos ou arrays)
+int is_for_in(Lexer* l) {
+    int n = scan_type(l, 0);
+    if (n < 0 || peek_token(l, n).type != TOK_IDENT) return 0;
+    n++;
+    if (peek_token(l, n).type == TOK_COMMA) {
+        n = scan_type(l, n + 1);
+        if (n < 0 || peek_token(l, n).type != TOK_IDENT) return 0;
+        n++;
+    }
+    return peek_token(l, n).type == TOK_IN;
+}
+
+// Nome de módulo: a ou a.b.c
+char* parse_module_name(Lexer* l) {
+    if (curr_tok.type != TOK_IDENT) {
+        printf("Erro: Esperado nome do modulo na linha %d\n", curr_tok.line);
+        exit(1);
+    }
+    size_t len = 0;
+    char buf[256];
+    while (1) {
+        if (len + curr_tok.length + 2 > sizeof(buf)) {
+            printf("Erro: Nome de modulo longo demais na linha %d\n", curr_tok.line);
+            exit(1);
+        }
+        memcpy(buf + len, curr_tok.literal, curr_tok.length);
+        len += curr_tok.length;
+        expect(l, TOK_IDENT);
+        if (curr_tok.type != TOK_DOT) break;
+        buf[len++] = '.';
+        next_token(l);
+    }
+    return rujo_strndup(buf, len);
+}
+
 ASTNode* parse_var_decl(Lexer* l) {
     char* type = parse_type_name(l); 
     
@@ -243,9 +635,22 @@ ASTNode* parse_var_decl(Lexer* l) {
     return ast_new_var_decl(name, type, value);
 }
 
+ASTNode* parse_statement_at(Lexer* l);
+
 ASTNode* parse_statement(Lexer* l) {
+    int line = curr_tok.line, col = curr_tok.column;
+    nesting_enter();
+    ASTNode* stmt = parse_statement_at(l);
+    nesting--;
+    stmt->line = line;
+    stmt->col = col;
+    return stmt;
+}
+
+ASTNode* parse_statement_at(Lexer* l) {
     // Declaração de Variáveis
     if (curr_tok.type == TOK_TYPE_INT || 
+        curr_tok.type == TOK_TYPE_LONG ||
         curr_tok.type == TOK_TYPE_FLOAT ||
         curr_tok.type == TOK_TYPE_BOOL || 
         curr_tok.type == TOK_TYPE_BYTE ||
@@ -254,11 +659,54 @@ ASTNode* parse_statement(Lexer* l) {
         return parse_var_decl(l);
     }
 
+    // Anotações: @soa class ...
+    if (curr_tok.type == TOK_AT) {
+        ASTNode* annotations = parse_annotations(l);
+        ASTNode* stmt = parse_statement(l);
+        stmt->annotations = annotations;
+        return stmt;
+    }
+
+    // Classes
+    if (curr_tok.type == TOK_CLASS) {
+        return parse_class_decl(l);
+    }
+
+    // pub fn / pub class: visível para os módulos que importam este
+    if (curr_tok.type == TOK_PUB) {
+        int line = curr_tok.line;
+        next_token(l);
+        ASTNode* item = parse_statement(l);
+        if (item->type == AST_FN_DECL) {
+            item->data.fn_decl.is_pub = true;
+        } else if (item->type == AST_CLASS_DECL) {
+            item->data.class_decl.is_pub = true;
+        } else {
+            printf("Erro: 'pub' so vale para fn e class na linha %d\n", line);
+            exit(1);
+        }
+        return item;
+    }
+
+    // module a.b; / import a.b; (resolvidos pelo carregador de módulos)
+    if (curr_tok.type == TOK_MODULE || curr_tok.type == TOK_IMPORT) {
+        int is_import = curr_tok.type == TOK_IMPORT;
+        next_token(l);
+        char* name = parse_module_name(l);
+        expect(l, TOK_SEMICOLON);
+        return is_import ? ast_new_import(name) : ast_new_module(name);
+    }
+
+    // Variáveis de tipos de usuário (Heroi h; Heroi[] hs;)
+    if (is_custom_type_decl(l)) {
+        return parse_var_decl(l);
+    }
+
     // Identificadores (Chamadas ou Atribuições)
     if (curr_tok.type == TOK_IDENT) {
         ASTNode* expr = parse_expression(l);
         
-        if (curr_tok.type == TOK_ASSIGN && expr->type == AST_IDENTIFIER) {
+        if (curr_tok.type == TOK_ASSIGN && is_assign_target(expr)) {
             next_token(l); // consome =
             ASTNode* value = parse_expression(l);
             expect(l, TOK_SEMICOLON);
@@ -303,6 +751,32 @@ ASTNode* parse_statement(Lexer* l) {
     }
 
     // WHILE
+    // arena { ... }: tudo alocado dentro do bloco é liberado junto na saída
+    if (curr_tok.type == TOK_ARENA) {
+        next_token(l);
+        if (curr_tok.type != TOK_LBRACE) {
+            printf("Erro: Esperado '{' depois de 'arena' na linha %d\n", curr_tok.line);
+            exit(1);
+        }
+        return ast_new_arena(parse_statement(l));
+    }
+
+    // bench "nome" { ... }: medido pelo harness de rujo bench (ignorado em build/run)
+    if (curr_tok.type == TOK_BENCH) {
+        next_token(l);
+        if (curr_tok.type != TOK_LIT_STRING) {
+            printf("Erro: Esperado o nome do bench (string) na linha %d\n", curr_tok.line);
+            exit(1);
+        }
+        char* name = rujo_strndup(curr_tok.literal + 1, curr_tok.length - 2);
+        next_token(l);
+        if (curr_tok.type != TOK_LBRACE) {
+            printf("Erro: Esperado '{' depois do nome do bench na linha %d\n", curr_tok.line);
+            exit(1);
+        }
+        return ast_new_bench(name, parse_statement(l));
+    }
+
     if (curr_tok.type == TOK_WHILE) {
         next_token(l); // consome while
         expect(l, TOK_LPAREN);
@@ -316,6 +790,30 @@ ASTNode* parse_statement(Lexer* l) {
     if (curr_tok.type == TOK_FOR) {
         next_token(l);
         expect(l, TOK_LPAREN);
+
+        // for (T x in fonte)
+        if (is_for_in(l)) {
+            char* type = parse_type_name(l);
+            char* name = rujo_strndup(curr_tok.literal, curr_tok.length);
+            next_token(l);
+            // for (K k, V v in mapa): chave e valor
+            char* val_type = NULL;
+            char* val_name = NULL;
+            if (curr_tok.type == TOK_COMMA) {
+                next_token(l);
+                val_type = parse_type_name(l);
+                val_name = rujo_strndup(curr_tok.literal, curr_tok.length);
+                next_token(l);
+            }
+            expect(l, TOK_IN);
+            ASTNode* source = parse_expression(l);
+            expect(l, TOK_RPAREN);
+            ASTNode* body = parse_statement(l);
+            ASTNode* loop = ast_new_for_in(type, name, source, body);
+            loop->data.for_in.val_type = val_type;
+            loop->data.for_in.val_name = val_name;
+            return loop;
+        }
         
         ASTNode* init = NULL;
         if (curr_tok.type == TOK_TYPE_INT) { 
@@ -336,7 +834,7 @@ ASTNode* parse_statement(Lexer* l) {
         ASTNode* step = NULL;
         if (curr_tok.type != TOK_RPAREN) {
             ASTNode* expr = parse_expression(l);
-            if (curr_tok.type == TOK_ASSIGN && expr->type == AST_IDENTIFIER) {
+            if (curr_tok.type == TOK_ASSIGN && is_assign_target(expr)) {
                 next_token(l);
                 ASTNode* val = parse_expression(l);
                 step = ast_new_assign(expr, val);
@@ -350,69 +848,89 @@ ASTNode* parse_statement(Lexer* l) {
         return ast_new_for(init, cond, step, body);
     }
 
-    // Funções
+    // Funções (async fn f(): T devolve Async<T>)
+    bool is_async = false;
+    if (curr_tok.type == TOK_ASYNC) {
+        is_async = true;
+        next_token(l);
+        if (curr_tok.type != TOK_FN) {
+            printf("Erro: Esperado 'fn' depois de 'async' na linha %d\n", curr_tok.line);
+            exit(1);
+        }
+    }
     if (curr_tok.type == TOK_FN) {
         next_token(l);
         char* name = rujo_strndup(curr_tok.literal, curr_tok.length);
         next_token(l);
+        ASTNode* type_params = parse_type_params(l);
         
-        expect(l, TOK_LPAREN);
-        
-        ASTNode* params = NULL;
-        ASTNode* last_param = NULL;
-
-        if (curr_tok.type != TOK_RPAREN) {
-            while (1) {
-                char* p_type = parse_type_name(l);
-                char* p_name = rujo_strndup(curr_tok.literal, curr_tok.length);
-                expect(l, TOK_IDENT);
-
-                ASTNode* p_node = ast_new_var_decl(p_name, p_type, NULL);
-                if (!params) params = p_node;
-                else last_param->next = p_node;
-                last_param = p_node;
-
-                if (curr_tok.type == TOK_COMMA) {
-                    next_token(l);
-                } else {
-                    break;
-                }
-            }
-        }
-
-        expect(l, TOK_RPAREN);
+        ASTNode* params = parse_params(l);
         expect(l, TOK_COLON);
         char* ret_type = parse_type_name(l);
+        if (is_async) {
+            char* wrapped = (char*)region_alloc(strlen(ret_type) + 8);
+            sprintf(wrapped, "Async<%s>", ret_type);
+            ret_type = wrapped;
+        }
         
         ASTNode* body = parse_statement(l);
-        return ast_new_fn_decl(name, ret_type, params, body);
+        ASTNode* fn = ast_new_fn_decl(name, ret_type, params, body);
+        fn->data.fn_decl.type_params = type_params;
+        return fn;
     }
 
-    // Return
+    // Return (sem valor só em geradores)
     if (curr_tok.type == TOK_RETURN) {
         next_token(l);
-        ASTNode* val = parse_expression(l);
+        ASTNode* val = NULL;
+        if (curr_tok.type != TOK_SEMICOLON) val = parse_expression(l);
         expect(l, TOK_SEMICOLON);
         return ast_new_return(val);
     }
 
+    // await expr; (resultado descartado)
+    if (curr_tok.type == TOK_AWAIT) {
+        next_token(l);
+        ASTNode* expr = parse_postfix(l);
+        expect(l, TOK_SEMICOLON);
+        return ast_new_await(expr, true);
+    }
+
+    // yield expr;
+    if (curr_tok.type == TOK_YIELD) {
+        next_token(l);
+        ASTNode* val = parse_expression(l);
+        expect(l, TOK_SEMICOLON);
+        return ast_new_yield(val);
+    }
+
     printf("Erro: Statement desconhecido na linha %d ('%s')\n", curr_tok.line, token_type_to_str(curr_tok.type));
     exit(1);
     return NULL;
 }
 
+ASTNode* parser_next_decl(Lexer* l) {
+    while (curr_tok.type != TOK_EOF) {
+        ASTNode* stmt = parse_statement(l);
+        if (stmt) return stmt;
+    }
+    return NULL;
+}
+
+size_t parser_offset(Lexer* l) {
+    if (curr_tok.type == TOK_EOF) return l->input_len;
+    return (size_t)(curr_tok.literal - l->input);
+}
+
 ASTNode* parser_parse_program(Lexer* l) {
-    next_token(l); 
     ASTNode* head = NULL;
     ASTNode* current = NULL;
 
-    while (curr_tok.type != TOK_EOF) {
-        ASTNode* stmt = parse_statement(l);
-        if (stmt) {
-            if (!head) head = stmt;
-            else current->next = stmt;
-            current = stmt;
-        }
+    ASTNode* stmt;
+    while ((stmt = parser_next_decl(l))) {
+        if (!head) head = stmt;
+        else current->next = stmt;
+        current = stmt;
     }
     return ast_new_program(head);
 }
\ No newline at end of file
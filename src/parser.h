@@ -7,4 +7,10 @@
 void parser_init(Lexer* l);
 ASTNode* parser_parse_program(Lexer* l);
 
+// Próximo item de nível superior (statement, função ou classe); NULL no fim
+ASTNode* parser_next_decl(Lexer* l);
+
+// Posição no fonte do token atual: o que vem antes já foi consumido
+size_t parser_offset(Lexer* l);
+
 #endif
\ No newline at end of file
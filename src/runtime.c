@@ -0,0 +1,1947 @@
+#include "runtime.h"
+
+// Código C do runtime, copiado para o out.c só quando o programa usa o recurso.
+
+// Pool de threads com work stealing: uma deque de Chase-Lev por worker,
+// join que ajuda a executar outras tarefas e dorme em futex quando não há nada.
+static const char* RUNTIME_TASKS =
+    "#include <pthread.h>\n"
+    "#include <stdatomic.h>\n"
+    "#include <sched.h>\n"
+    "#include <unistd.h>\n"
+    "#ifdef __linux__\n"
+    "#include <linux/futex.h>\n"
+    "#include <sys/syscall.h>\n"
+    "#endif\n"
+    "\n"
+    "// Tarefas: done = 0 rodando, 1 pronta, 2 alguém dormindo no join\n"
+    "typedef struct RujoTask {\n"
+    "    void (*run)(void*);\n"
+    "    atomic_int done;\n"
+    "    struct RujoTask* next; // fila de tarefas bloqueantes\n"
+    "} RujoTask;\n"
+    "\n"
+    "// Deque de Chase-Lev: o dono empilha e desempilha no fundo, ladrões roubam do topo\n"
+    "#define RUJO_DEQUE_CAP 4096\n"
+    "typedef struct {\n"
+    "    _Alignas(64) atomic_long top;\n"
+    "    _Alignas(64) atomic_long bottom;\n"
+    "    _Alignas(64) RujoTask* _Atomic slots[RUJO_DEQUE_CAP];\n"
+    "} RujoDeque;\n"
+    "\n"
+    "typedef struct {\n"
+    "    RujoDeque* deques;\n"
+    "    int workers;\n"
+    "    atomic_int pending;\n"
+    "    atomic_int sleeping;\n"
+    "    atomic_int spares;\n"
+    "    pthread_mutex_t lock;\n"
+    "    pthread_cond_t wake;\n"
+    "    // Tarefas que podem bloquear em canais: ficam fora das deques para que um\n"
+    "    // join nunca as execute no meio da própria pilha\n"
+    "    RujoTask* blocking_head;\n"
+    "    RujoTask* blocking_tail;\n"
+    "    atomic_int blocking_count;\n"
+    "} RujoPool;\n"
+    "\n"
+    "RUJO_GLOBAL RujoPool rujo_pool;\n"
+    "RUJO_GLOBAL pthread_once_t rujo_pool_once = PTHREAD_ONCE_INIT;\n"
+    "RUJO_GLOBAL _Thread_local int rujo_worker_id = -1;\n"
+    "\n"
+    "static void rujo_futex_wait(atomic_int* addr, int val) {\n"
+    "#ifdef __linux__\n"
+    "    syscall(SYS_futex, addr, FUTEX_WAIT_PRIVATE, val, NULL, NULL, 0);\n"
+    "#else\n"
+    "    (void)addr; (void)val;\n"
+    "    sched_yield();\n"
+    "#endif\n"
+    "}\n"
+    "\n"
+    "static void rujo_futex_wake(atomic_int* addr) {\n"
+    "#ifdef __linux__\n"
+    "    syscall(SYS_futex, addr, FUTEX_WAKE_PRIVATE, 1 << 30, NULL, NULL, 0);\n"
+    "#else\n"
+    "    (void)addr;\n"
+    "#endif\n"
+    "}\n"
+    "\n"
+    "static int rujo_deque_push(RujoDeque* d, RujoTask* t) {\n"
+    "    long b = atomic_load_explicit(&d->bottom, memory_order_relaxed);\n"
+    "    long top = atomic_load_explicit(&d->top, memory_order_acquire);\n"
+    "    if (b - top >= RUJO_DEQUE_CAP) return 0;\n"
+    "    atomic_store_explicit(&d->slots[b & (RUJO_DEQUE_CAP - 1)], t, memory_order_relaxed);\n"
+    "    atomic_store_explicit(&d->bottom, b + 1, memory_order_release);\n"
+    "    return 1;\n"
+    "}\n"
+    "\n"
+    "static RujoTask* rujo_deque_pop(RujoDeque* d) {\n"
+    "    long b = atomic_load_explicit(&d->bottom, memory_order_relaxed) - 1;\n"
+    "    atomic_store_explicit(&d->bottom, b, memory_order_relaxed);\n"
+    "    atomic_thread_fence(memory_order_seq_cst);\n"
+    "    long t = atomic_load_explicit(&d->top, memory_order_relaxed);\n"
+    "    if (t > b) {\n"
+    "        atomic_store_explicit(&d->bottom, b + 1, memory_order_relaxed);\n"
+    "        return NULL;\n"
+    "    }\n"
+    "    RujoTask* task = atomic_load_explicit(&d->slots[b & (RUJO_DEQUE_CAP - 1)], memory_order_relaxed);\n"
+    "    if (t == b) {\n"
+    "        // Último elemento: disputa com os ladrões\n"
+    "        if (!atomic_compare_exchange_strong_explicit(&d->top, &t, t + 1, memory_order_seq_cst, memory_order_relaxed)) {\n"
+    "            task = NULL;\n"
+    "        }\n"
+    "        atomic_store_explicit(&d->bottom, b + 1, memory_order_relaxed);\n"
+    "    }\n"
+    "    return task;\n"
+    "}\n"
+    "\n"
+    "static RujoTask* rujo_deque_steal(RujoDeque* d) {\n"
+    "    long t = atomic_load_explicit(&d->top, memory_order_acquire);\n"
+    "    atomic_thread_fence(memory_order_seq_cst);\n"
+    "    long b = atomic_load_explicit(&d->bottom, memory_order_acquire);\n"
+    "    if (t >= b) return NULL;\n"
+    "    RujoTask* task = atomic_load_explicit(&d->slots[t & (RUJO_DEQUE_CAP - 1)], memory_order_relaxed);\n"
+    "    if (!atomic_compare_exchange_strong_explicit(&d->top, &t, t + 1, memory_order_seq_cst, memory_order_relaxed)) {\n"
+    "        return NULL;\n"
+    "    }\n"
+    "    return task;\n"
+    "}\n"
+    "\n"
+    "#define RUJO_MAX_SPARES 1024\n"
+    "\n"
+    "static RujoTask* rujo_take_blocking(void) {\n"
+    "    RujoTask* t = NULL;\n"
+    "    pthread_mutex_lock(&rujo_pool.lock);\n"
+    "    if (rujo_pool.blocking_head) {\n"
+    "        t = rujo_pool.blocking_head;\n"
+    "        rujo_pool.blocking_head = t->next;\n"
+    "        if (!rujo_pool.blocking_head) rujo_pool.blocking_tail = NULL;\n"
+    "        atomic_fetch_sub(&rujo_pool.blocking_count, 1);\n"
+    "    }\n"
+    "    pthread_mutex_unlock(&rujo_pool.lock);\n"
+    "    if (t) atomic_fetch_sub(&rujo_pool.pending, 1);\n"
+    "    return t;\n"
+    "}\n"
+    "\n"
+    "static RujoTask* rujo_find_task(void) {\n"
+    "    int self = rujo_worker_id;\n"
+    "    RujoTask* t = rujo_deque_pop(&rujo_pool.deques[self]);\n"
+    "    if (!t) {\n"
+    "        int n = rujo_pool.workers;\n"
+    "        for (int i = 1; i < n && !t; i++) {\n"
+    "            t = rujo_deque_steal(&rujo_pool.deques[(self + i) % n]);\n"
+    "        }\n"
+    "    }\n"
+    "    if (t) atomic_fetch_sub(&rujo_pool.pending, 1);\n"
+    "    return t;\n"
+    "}\n"
+    "\n"
+    "static void rujo_run_task(RujoTask* t) {\n"
+    "    t->run(t);\n"
+    "    if (atomic_exchange_explicit(&t->done, 1, memory_order_release) == 2) {\n"
+    "        rujo_futex_wake(&t->done);\n"
+    "    }\n"
+    "}\n"
+    "\n"
+    "static void* rujo_worker_main(void* arg) {\n"
+    "    rujo_worker_id = (int)(intptr_t)arg;\n"
+    "    for (;;) {\n"
+    "        RujoTask* t = NULL;\n"
+    "        for (int spin = 0; spin < 64 && !t; spin++) {\n"
+    "            t = rujo_find_task();\n"
+    "            if (!t && atomic_load_explicit(&rujo_pool.blocking_count, memory_order_relaxed) > 0) {\n"
+    "                t = rujo_take_blocking();\n"
+    "            }\n"
+    "            if (!t) sched_yield();\n"
+    "        }\n"
+    "        if (t) {\n"
+    "            rujo_run_task(t);\n"
+    "            continue;\n"
+    "        }\n"
+    "        // Sem trabalho: dorme até alguém enfileirar\n"
+    "        pthread_mutex_lock(&rujo_pool.lock);\n"
+    "        atomic_fetch_add(&rujo_pool.sleeping, 1);\n"
+    "        while (atomic_load(&rujo_pool.pending) == 0) {\n"
+    "            pthread_cond_wait(&rujo_pool.wake, &rujo_pool.lock);\n"
+    "        }\n"
+    "        atomic_fetch_sub(&rujo_pool.sleeping, 1);\n"
+    "        pthread_mutex_unlock(&rujo_pool.lock);\n"
+    "    }\n"
+    "    return NULL;\n"
+    "}\n"
+    "\n"
+    "// Thread extra enquanto outras estão bloqueadas: só rouba e sai quando falta trabalho\n"
+    "static void* rujo_spare_main(void* arg) {\n"
+    "    (void)arg;\n"
+    "    for (int idle = 0; idle < 64; idle++) {\n"
+    "        RujoTask* t = atomic_load(&rujo_pool.blocking_count) > 0 ? rujo_take_blocking() : NULL;\n"
+    "        for (int i = 0; i < rujo_pool.workers && !t; i++) {\n"
+    "            t = rujo_deque_steal(&rujo_pool.deques[i]);\n"
+    "            if (t) atomic_fetch_sub(&rujo_pool.pending, 1);\n"
+    "        }\n"
+    "        if (t) {\n"
+    "            rujo_run_task(t);\n"
+    "            idle = 0;\n"
+    "        } else {\n"
+    "            sched_yield();\n"
+    "        }\n"
+    "    }\n"
+    "    atomic_fetch_sub(&rujo_pool.spares, 1);\n"
+    "    return NULL;\n"
+    "}\n"
+    "\n"
+    "// Antes de dormir em canal ou join: se há trabalho esperando e nenhum worker livre,\n"
+    "// outra thread assume, senão tarefas bloqueadas poderiam esperar por tarefas que\n"
+    "// nunca rodam. O join já esvaziou o que podia das deques: só conta a fila bloqueante.\n"
+    "static void rujo_pool_compensate(int any_work) {\n"
+    "    int waiting = any_work ? atomic_load(&rujo_pool.pending) : atomic_load(&rujo_pool.blocking_count);\n"
+    "    if (!rujo_pool.deques || waiting == 0 || atomic_load(&rujo_pool.sleeping) > 0) return;\n"
+    "    if (atomic_fetch_add(&rujo_pool.spares, 1) >= RUJO_MAX_SPARES) {\n"
+    "        atomic_fetch_sub(&rujo_pool.spares, 1);\n"
+    "        return;\n"
+    "    }\n"
+    "    pthread_t th;\n"
+    "    pthread_create(&th, NULL, rujo_spare_main, NULL);\n"
+    "    pthread_detach(th);\n"
+    "}\n"
+    "\n"
+    "// Uma deque por núcleo; a thread que chama o primeiro spawn é o worker 0\n"
+    "static void rujo_pool_init(void) {\n"
+    "    const char* env = getenv(\"RUJO_THREADS\");\n"
+    "    int n = env ? atoi(env) : (int)sysconf(_SC_NPROCESSORS_ONLN);\n"
+    "    if (n < 2) n = 2;\n"
+    "    rujo_pool.workers = n;\n"
+    "    rujo_pool.deques = aligned_alloc(64, sizeof(RujoDeque) * n);\n"
+    "    memset(rujo_pool.deques, 0, sizeof(RujoDeque) * n);\n"
+    "    pthread_mutex_init(&rujo_pool.lock, NULL);\n"
+    "    pthread_cond_init(&rujo_pool.wake, NULL);\n"
+    "    rujo_worker_id = 0;\n"
+    "    for (int i = 1; i < n; i++) {\n"
+    "        pthread_t th;\n"
+    "        pthread_create(&th, NULL, rujo_worker_main, (void*)(intptr_t)i);\n"
+    "        pthread_detach(th);\n"
+    "    }\n"
+    "}\n"
+    "\n"
+    "static void rujo_spawn(RujoTask* t, void (*run)(void*)) {\n"
+    "    pthread_once(&rujo_pool_once, rujo_pool_init);\n"
+    "    t->run = run;\n"
+    "    atomic_store_explicit(&t->done, 0, memory_order_relaxed);\n"
+    "    // Fora do pool ou deque cheia: executa na hora\n"
+    "    if (rujo_worker_id < 0 || !rujo_deque_push(&rujo_pool.deques[rujo_worker_id], t)) {\n"
+    "        rujo_run_task(t);\n"
+    "        return;\n"
+    "    }\n"
+    "    atomic_fetch_add(&rujo_pool.pending, 1);\n"
+    "    if (atomic_load(&rujo_pool.sleeping) > 0) {\n"
+    "        pthread_mutex_lock(&rujo_pool.lock);\n"
+    "        pthread_cond_signal(&rujo_pool.wake);\n"
+    "        pthread_mutex_unlock(&rujo_pool.lock);\n"
+    "    }\n"
+    "}\n"
+    "\n"
+    "// Tarefa que recebe canais: vai para a fila compartilhada\n"
+    "static void rujo_spawn_blocking(RujoTask* t, void (*run)(void*)) {\n"
+    "    pthread_once(&rujo_pool_once, rujo_pool_init);\n"
+    "    t->run = run;\n"
+    "    t->next = NULL;\n"
+    "    atomic_store_explicit(&t->done, 0, memory_order_relaxed);\n"
+    "    pthread_mutex_lock(&rujo_pool.lock);\n"
+    "    if (rujo_pool.blocking_tail) rujo_pool.blocking_tail->next = t;\n"
+    "    else rujo_pool.blocking_head = t;\n"
+    "    rujo_pool.blocking_tail = t;\n"
+    "    atomic_fetch_add(&rujo_pool.blocking_count, 1);\n"
+    "    atomic_fetch_add(&rujo_pool.pending, 1);\n"
+    "    pthread_cond_signal(&rujo_pool.wake);\n"
+    "    pthread_mutex_unlock(&rujo_pool.lock);\n"
+    "}\n"
+    "\n"
+    "static inline bool rujo_task_done(RujoTask* t) {\n"
+    "    return atomic_load_explicit(&t->done, memory_order_acquire) == 1;\n"
+    "}\n"
+    "\n"
+    "// Quem espera ajuda: executa outras tarefas antes de dormir no futex\n"
+    "static void rujo_task_join(RujoTask* t) {\n"
+    "    while (!rujo_task_done(t)) {\n"
+    "        RujoTask* other = rujo_worker_id >= 0 ? rujo_find_task() : NULL;\n"
+    "        if (other) {\n"
+    "            rujo_run_task(other);\n"
+    "            continue;\n"
+    "        }\n"
+    "        rujo_pool_compensate(0);\n"
+    "        int expected = 0;\n"
+    "        if (atomic_compare_exchange_strong(&t->done, &expected, 2) || expected == 2) {\n"
+    "            rujo_futex_wait(&t->done, 2);\n"
+    "        }\n"
+    "    }\n"
+    "}\n"
+    "\n"
+    "// @parallel: divide [lo, hi) em fatias; quem chama executa a primeira\n"
+    "typedef void (*RujoRangeFn)(void* ctx, int64_t lo, int64_t hi, int chunk);\n"
+    "typedef struct {\n"
+    "    RujoTask task;\n"
+    "    RujoRangeFn fn;\n"
+    "    void* ctx;\n"
+    "    int64_t lo, hi;\n"
+    "    int chunk;\n"
+    "} RujoRangeTask;\n"
+    "\n"
+    "static void rujo_range_run(void* p) {\n"
+    "    RujoRangeTask* r = p;\n"
+    "    r->fn(r->ctx, r->lo, r->hi, r->chunk);\n"
+    "}\n"
+    "\n"
+    "// Algumas fatias por worker equilibram iterações de custo desigual\n"
+    "static int rujo_parallel_chunks(int64_t n) {\n"
+    "    pthread_once(&rujo_pool_once, rujo_pool_init);\n"
+    "    int64_t c = (int64_t)rujo_pool.workers * 4;\n"
+    "    return (int)(c < n ? c : n);\n"
+    "}\n"
+    "\n"
+    "static void rujo_parallel_for(int64_t lo, int64_t hi, int chunks, RujoRangeFn fn, void* ctx) {\n"
+    "    RujoRangeTask* ts = malloc(sizeof(RujoRangeTask) * chunks);\n"
+    "    int64_t n = hi - lo;\n"
+    "    for (int c = 0; c < chunks; c++) {\n"
+    "        ts[c].fn = fn;\n"
+    "        ts[c].ctx = ctx;\n"
+    "        ts[c].chunk = c;\n"
+    "        ts[c].lo = lo + n * c / chunks;\n"
+    "        ts[c].hi = lo + n * (c + 1) / chunks;\n"
+    "    }\n"
+    "    for (int c = 1; c < chunks; c++) rujo_spawn(&ts[c].task, rujo_range_run);\n"
+    "    fn(ctx, ts[0].lo, ts[0].hi, 0);\n"
+    "    for (int c = 1; c < chunks; c++) rujo_task_join(&ts[c].task);\n"
+    "    free(ts);\n"
+    "}\n";
+
+// Canais com buffer circular limitado, sem locks.
+// MPMC: fila de Vyukov (número de sequência por slot, CAS nos índices).
+// SPSC: só o produtor move head e só o consumidor move tail; cada lado guarda
+// uma cópia do índice do outro para não disputar a linha de cache a cada item.
+// Quem espera dorme em futex (recv_seq / send_seq) depois de uma curta espera ativa.
+static const char* RUNTIME_CHANNELS =
+    "#define RUJO_SLOT_HDR 16\n"
+    "#if defined(__x86_64__) || defined(__i386__)\n"
+    "#define RUJO_CPU_RELAX() __builtin_ia32_pause()\n"
+    "#else\n"
+    "#define RUJO_CPU_RELAX() ((void)0)\n"
+    "#endif\n"
+    "\n"
+    "typedef struct RujoChan {\n"
+    "    size_t cap, mask, elem, stride;\n"
+    "    int spsc;\n"
+    "    char* slots;\n"
+    "    atomic_int refs;\n"
+    "    atomic_int closed;\n"
+    "    _Alignas(64) atomic_size_t head;\n"
+    "    size_t cached_tail;\n"
+    "    _Alignas(64) atomic_size_t tail;\n"
+    "    size_t cached_head;\n"
+    "    _Alignas(64) atomic_int recv_seq;\n"
+    "    atomic_int recv_waiters;\n"
+    "    _Alignas(64) atomic_int send_seq;\n"
+    "    atomic_int send_waiters;\n"
+    "} RujoChan;\n"
+    "\n"
+    "static void rujo_futex_wake_n(atomic_int* addr, int n) {\n"
+    "#ifdef __linux__\n"
+    "    syscall(SYS_futex, addr, FUTEX_WAKE_PRIVATE, n, NULL, NULL, 0);\n"
+    "#else\n"
+    "    (void)addr; (void)n;\n"
+    "#endif\n"
+    "}\n"
+    "\n"
+    "static RujoChan* rujo_chan_new(int cap, size_t elem, int spsc) {\n"
+    "    size_t n = 2;\n"
+    "    while (n < (size_t)cap) n <<= 1;\n"
+    "    RujoChan* c = aligned_alloc(64, (sizeof(RujoChan) + 63) & ~(size_t)63);\n"
+    "    memset(c, 0, sizeof(RujoChan));\n"
+    "    c->cap = n;\n"
+    "    c->mask = n - 1;\n"
+    "    c->elem = elem;\n"
+    "    c->stride = (RUJO_SLOT_HDR + elem + 15) & ~(size_t)15;\n"
+    "    c->spsc = spsc;\n"
+    "    c->slots = malloc(c->stride * n);\n"
+    "    for (size_t i = 0; i < n; i++) {\n"
+    "        atomic_store_explicit((atomic_size_t*)(c->slots + i * c->stride), i, memory_order_relaxed);\n"
+    "    }\n"
+    "    atomic_store(&c->refs, 1);\n"
+    "    return c;\n"
+    "}\n"
+    "\n"
+    "static inline void rujo_chan_retain(RujoChan* c) {\n"
+    "    atomic_fetch_add_explicit(&c->refs, 1, memory_order_relaxed);\n"
+    "}\n"
+    "\n"
+    "// 1 se era a última referência (quem chamou libera com rujo_chan_free)\n"
+    "static inline int rujo_chan_release(RujoChan* c) {\n"
+    "    return atomic_fetch_sub_explicit(&c->refs, 1, memory_order_acq_rel) == 1;\n"
+    "}\n"
+    "\n"
+    "static void rujo_chan_free(RujoChan* c) {\n"
+    "    free(c->slots);\n"
+    "    free(c);\n"
+    "}\n"
+    "\n"
+    "static inline int rujo_chan_push(RujoChan* c, const void* v) {\n"
+    "    if (c->spsc) {\n"
+    "        size_t h = atomic_load_explicit(&c->head, memory_order_relaxed);\n"
+    "        if (h - c->cached_tail >= c->cap) {\n"
+    "            c->cached_tail = atomic_load_explicit(&c->tail, memory_order_acquire);\n"
+    "            if (h - c->cached_tail >= c->cap) return 0;\n"
+    "        }\n"
+    "        memcpy(c->slots + (h & c->mask) * c->stride + RUJO_SLOT_HDR, v, c->elem);\n"
+    "        atomic_store_explicit(&c->head, h + 1, memory_order_release);\n"
+    "        return 1;\n"
+    "    }\n"
+    "    size_t pos = atomic_load_explicit(&c->head, memory_order_relaxed);\n"
+    "    for (;;) {\n"
+    "        char* slot = c->slots + (pos & c->mask) * c->stride;\n"
+    "        size_t seq = atomic_load_explicit((atomic_size_t*)slot, memory_order_acquire);\n"
+    "        intptr_t dif = (intptr_t)seq - (intptr_t)pos;\n"
+    "        if (dif == 0) {\n"
+    "            if (atomic_compare_exchange_weak_explicit(&c->head, &pos, pos + 1,\n"
+    "                    memory_order_relaxed, memory_order_relaxed)) {\n"
+    "                memcpy(slot + RUJO_SLOT_HDR, v, c->elem);\n"
+    "                atomic_store_explicit((atomic_size_t*)slot, pos + 1, memory_order_release);\n"
+    "                return 1;\n"
+    "            }\n"
+    "        } else if (dif < 0) {\n"
+    "            return 0;\n"
+    "        } else {\n"
+    "            pos = atomic_load_explicit(&c->head, memory_order_relaxed);\n"
+    "        }\n"
+    "    }\n"
+    "}\n"
+    "\n"
+    "static inline int rujo_chan_pop(RujoChan* c, void* v) {\n"
+    "    if (c->spsc) {\n"
+    "        size_t t = atomic_load_explicit(&c->tail, memory_order_relaxed);\n"
+    "        if (t == c->cached_head) {\n"
+    "            c->cached_head = atomic_load_explicit(&c->head, memory_order_acquire);\n"
+    "            if (t == c->cached_head) return 0;\n"
+    "        }\n"
+    "        memcpy(v, c->slots + (t & c->mask) * c->stride + RUJO_SLOT_HDR, c->elem);\n"
+    "        atomic_store_explicit(&c->tail, t + 1, memory_order_release);\n"
+    "        return 1;\n"
+    "    }\n"
+    "    size_t pos = atomic_load_explicit(&c->tail, memory_order_relaxed);\n"
+    "    for (;;) {\n"
+    "        char* slot = c->slots + (pos & c->mask) * c->stride;\n"
+    "        size_t seq = atomic_load_explicit((atomic_size_t*)slot, memory_order_acquire);\n"
+    "        intptr_t dif = (intptr_t)seq - (intptr_t)(pos + 1);\n"
+    "        if (dif == 0) {\n"
+    "            if (atomic_compare_exchange_weak_explicit(&c->tail, &pos, pos + 1,\n"
+    "                    memory_order_relaxed, memory_order_relaxed)) {\n"
+    "                memcpy(v, slot + RUJO_SLOT_HDR, c->elem);\n"
+    "                atomic_store_explicit((atomic_size_t*)slot, pos + c->mask + 1, memory_order_release);\n"
+    "                return 1;\n"
+    "            }\n"
+    "        } else if (dif < 0) {\n"
+    "            return 0;\n"
+    "        } else {\n"
+    "            pos = atomic_load_explicit(&c->tail, memory_order_relaxed);\n"
+    "        }\n"
+    "    }\n"
+    "}\n"
+    "\n"
+    "// Cada aviso consome um waiter anunciado: com o consumidor dormindo, só o\n"
+    "// primeiro send depois dele paga a syscall\n"
+    "static inline void rujo_chan_notify(atomic_int* seq, atomic_int* waiters, int n) {\n"
+    "    atomic_thread_fence(memory_order_seq_cst);\n"
+    "    int w = atomic_load_explicit(waiters, memory_order_relaxed);\n"
+    "    int k = 0;\n"
+    "    while (w > 0 && k < n) {\n"
+    "        if (atomic_compare_exchange_weak(waiters, &w, w - 1)) {\n"
+    "            k++;\n"
+    "            w--;\n"
+    "        }\n"
+    "    }\n"
+    "    if (k > 0) {\n"
+    "        atomic_fetch_add(seq, 1);\n"
+    "        rujo_futex_wake_n(seq, k);\n"
+    "    }\n"
+    "}\n"
+    "\n"
+    "// Espera ativa curta e depois dorme até o outro lado avisar\n"
+    "static void rujo_chan_park(RujoChan* c, atomic_int* seq, atomic_int* waiters, int (*ready)(RujoChan*)) {\n"
+    "    for (int spin = 0; spin < 128; spin++) {\n"
+    "        if (ready(c)) return;\n"
+    "        RUJO_CPU_RELAX();\n"
+    "    }\n"
+    "    int s = atomic_load(seq);\n"
+    "    atomic_fetch_add(waiters, 1);\n"
+    "    atomic_thread_fence(memory_order_seq_cst);\n"
+    "    if (ready(c)) {\n"
+    "        // Desiste da espera, a menos que um aviso já tenha contado com ela\n"
+    "        int w = atomic_load(waiters);\n"
+    "        while (w > 0 && !atomic_compare_exchange_weak(waiters, &w, w - 1)) {}\n"
+    "        return;\n"
+    "    }\n"
+    "    rujo_pool_compensate(1);\n"
+    "    rujo_futex_wait(seq, s);\n"
+    "}\n"
+    "\n"
+    "static int rujo_chan_can_recv(RujoChan* c) {\n"
+    "    return atomic_load(&c->head) != atomic_load(&c->tail) || atomic_load(&c->closed);\n"
+    "}\n"
+    "\n"
+    "static int rujo_chan_can_send(RujoChan* c) {\n"
+    "    return atomic_load(&c->head) - atomic_load(&c->tail) < c->cap || atomic_load(&c->closed);\n"
+    "}\n"
+    "\n"
+    "static int rujo_chan_try_send(RujoChan* c, const void* v) {\n"
+    "    if (atomic_load_explicit(&c->closed, memory_order_relaxed) || !rujo_chan_push(c, v)) return 0;\n"
+    "    rujo_chan_notify(&c->recv_seq, &c->recv_waiters, 1);\n"
+    "    return 1;\n"
+    "}\n"
+    "\n"
+    "// 0 se o canal foi fechado\n"
+    "static int rujo_chan_send(RujoChan* c, const void* v) {\n"
+    "    for (;;) {\n"
+    "        if (atomic_load_explicit(&c->closed, memory_order_relaxed)) return 0;\n"
+    "        if (rujo_chan_push(c, v)) {\n"
+    "            rujo_chan_notify(&c->recv_seq, &c->recv_waiters, 1);\n"
+    "            return 1;\n"
+    "        }\n"
+    "        rujo_chan_park(c, &c->send_seq, &c->send_waiters, rujo_chan_can_send);\n"
+    "    }\n"
+    "}\n"
+    "\n"
+    "// 1 recebeu, 0 vazio, -1 fechado e vazio\n"
+    "static int rujo_chan_try_recv(RujoChan* c, void* v) {\n"
+    "    if (rujo_chan_pop(c, v)) {\n"
+    "        rujo_chan_notify(&c->send_seq, &c->send_waiters, 1);\n"
+    "        return 1;\n"
+    "    }\n"
+    "    if (atomic_load(&c->closed)) return rujo_chan_pop(c, v) ? 1 : -1;\n"
+    "    return 0;\n"
+    "}\n"
+    "\n"
+    "static int rujo_chan_recv(RujoChan* c, void* v) {\n"
+    "    for (;;) {\n"
+    "        int r = rujo_chan_try_recv(c, v);\n"
+    "        if (r != 0) return r > 0;\n"
+    "        rujo_chan_park(c, &c->recv_seq, &c->recv_waiters, rujo_chan_can_recv);\n"
+    "    }\n"
+    "}\n"
+    "\n"
+    "// Lotes: um aviso por lote em vez de um por item\n"
+    "static int rujo_chan_send_n(RujoChan* c, const void* src, int n) {\n"
+    "    const char* p = src;\n"
+    "    int sent = 0;\n"
+    "    while (sent < n) {\n"
+    "        if (atomic_load_explicit(&c->closed, memory_order_relaxed)) break;\n"
+    "        int before = sent;\n"
+    "        while (sent < n && rujo_chan_push(c, p + (size_t)sent * c->elem)) sent++;\n"
+    "        if (sent > before) rujo_chan_notify(&c->recv_seq, &c->recv_waiters, sent - before);\n"
+    "        if (sent < n) rujo_chan_park(c, &c->send_seq, &c->send_waiters, rujo_chan_can_send);\n"
+    "    }\n"
+    "    return sent;\n"
+    "}\n"
+    "\n"
+    "// Bloqueia até ter ao menos um item (ou o canal fechar) e pega até max\n"
+    "static int rujo_chan_recv_n(RujoChan* c, void* dst, int max) {\n"
+    "    char* p = dst;\n"
+    "    int got = 0;\n"
+    "    if (max <= 0) return 0;\n"
+    "    while (got == 0) {\n"
+    "        while (got < max && rujo_chan_pop(c, p + (size_t)got * c->elem)) got++;\n"
+    "        if (got > 0) {\n"
+    "            rujo_chan_notify(&c->send_seq, &c->send_waiters, got);\n"
+    "            break;\n"
+    "        }\n"
+    "        if (atomic_load(&c->closed)) {\n"
+    "            if (rujo_chan_pop(c, p)) { got = 1; continue; }\n"
+    "            break;\n"
+    "        }\n"
+    "        rujo_chan_park(c, &c->recv_seq, &c->recv_waiters, rujo_chan_can_recv);\n"
+    "    }\n"
+    "    return got;\n"
+    "}\n"
+    "\n"
+    "static void rujo_chan_close(RujoChan* c) {\n"
+    "    atomic_store(&c->closed, 1);\n"
+    "    atomic_fetch_add(&c->recv_seq, 1);\n"
+    "    atomic_fetch_add(&c->send_seq, 1);\n"
+    "    rujo_futex_wake_n(&c->recv_seq, INT_MAX);\n"
+    "    rujo_futex_wake_n(&c->send_seq, INT_MAX);\n"
+    "}\n"
+    "\n"
+    "static inline int rujo_chan_len(RujoChan* c) {\n"
+    "    return (int)(atomic_load(&c->head) - atomic_load(&c->tail));\n"
+    "}\n";
+
+// I/O assíncrono: um laço por thread sobre io_uring (anéis mapeados direto, sem
+// liburing) ou epoll. Cada async fn chamada por io_run/io_spawn é uma tarefa; um
+// await de I/O enfileira a operação e suspende, e o laço a retoma na conclusão.
+// Depende de rujo_array_len (emitido antes).
+static const char* RUNTIME_IO =
+    "#include <errno.h>\n"
+    "#include <fcntl.h>\n"
+    "#include <unistd.h>\n"
+    "#include <time.h>\n"
+    "#include <sys/mman.h>\n"
+    "#include <sys/epoll.h>\n"
+    "#include <sys/socket.h>\n"
+    "#include <sys/syscall.h>\n"
+    "#include <sys/timerfd.h>\n"
+    "#include <netinet/in.h>\n"
+    "#include <netinet/tcp.h>\n"
+    "#include <arpa/inet.h>\n"
+    "#include <linux/io_uring.h>\n"
+    "\n"
+    "enum { RUJO_IO_ACCEPT = 1, RUJO_IO_READ, RUJO_IO_WRITE, RUJO_IO_CONNECT, RUJO_IO_SLEEP };\n"
+    "\n"
+    "// Uma tarefa do laço: o frame da async fn de cima e a operação em andamento\n"
+    "// (no máximo uma por vez: cada await suspende a tarefa inteira)\n"
+    "typedef struct RujoIoTask {\n"
+    "    void* frame;\n"
+    "    bool (*poll)(void*, struct RujoIoTask*);\n"
+    "    void (*drop)(void*);\n"
+    "    int res;\n"
+    "    int op;\n"
+    "    int fd;\n"
+    "    int len;\n"
+    "    void* buf;\n"
+    "    struct sockaddr_in addr;\n"
+    "    struct __kernel_timespec ts;\n"
+    "    struct RujoIoTask* next;\n"
+    "} RujoIoTask;\n"
+    "\n"
+    "#define RUJO_IO_ENTRIES 4096\n"
+    "\n"
+    "typedef struct {\n"
+    "    int uring;\n"
+    "    int ring_fd;\n"
+    "    char* sq_map;\n"
+    "    char* cq_map;\n"
+    "    size_t sq_size, cq_size, sqes_size;\n"
+    "    unsigned *sq_head, *sq_tail, *sq_mask, *sq_array, sq_entries;\n"
+    "    unsigned *cq_head, *cq_tail, *cq_mask;\n"
+    "    struct io_uring_sqe* sqes;\n"
+    "    struct io_uring_cqe* cqes;\n"
+    "    unsigned to_submit;\n"
+    "    int epfd;\n"
+    "    unsigned char* armed;\n"
+    "    int armed_cap;\n"
+    "    RujoIoTask* ready_head;\n"
+    "    RujoIoTask* ready_tail;\n"
+    "    long live;\n"
+    "} RujoIo;\n"
+    "\n"
+    "// Um laço por thread: várias threads com io_run + SO_REUSEPORT escalam por núcleo\n"
+    "RUJO_GLOBAL _Thread_local RujoIo* rujo_io = NULL;\n"
+    "\n"
+    "static void rujo_io_ready(RujoIo* io, RujoIoTask* t) {\n"
+    "    t->next = NULL;\n"
+    "    if (io->ready_tail) io->ready_tail->next = t;\n"
+    "    else io->ready_head = t;\n"
+    "    io->ready_tail = t;\n"
+    "}\n"
+    "\n"
+    "static void rujo_io_nodelay(int fd) {\n"
+    "    int one = 1;\n"
+    "    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));\n"
+    "}\n"
+    "\n"
+    "// io_uring sem liburing: os três mapeamentos do anel e os ponteiros de head/tail\n"
+    "static int rujo_uring_setup(RujoIo* io) {\n"
+    "    struct io_uring_params p;\n"
+    "    memset(&p, 0, sizeof(p));\n"
+    "    int fd = (int)syscall(__NR_io_uring_setup, RUJO_IO_ENTRIES, &p);\n"
+    "    if (fd < 0) return 0;\n"
+    "    io->sq_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);\n"
+    "    io->cq_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);\n"
+    "    int single = (p.features & IORING_FEAT_SINGLE_MMAP) != 0;\n"
+    "    if (single && io->cq_size > io->sq_size) io->sq_size = io->cq_size;\n"
+    "    io->sq_map = mmap(NULL, io->sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);\n"
+    "    if (io->sq_map == MAP_FAILED) { close(fd); return 0; }\n"
+    "    io->cq_map = io->sq_map;\n"
+    "    if (!single) {\n"
+    "        io->cq_map = mmap(NULL, io->cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);\n"
+    "        if (io->cq_map == MAP_FAILED) { munmap(io->sq_map, io->sq_size); close(fd); return 0; }\n"
+    "    }\n"
+    "    io->sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);\n"
+    "    io->sqes = mmap(NULL, io->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);\n"
+    "    if (io->sqes == MAP_FAILED) {\n"
+    "        if (!single) munmap(io->cq_map, io->cq_size);\n"
+    "        munmap(io->sq_map, io->sq_size);\n"
+    "        close(fd);\n"
+    "        return 0;\n"
+    "    }\n"
+    "    io->ring_fd = fd;\n"
+    "    io->sq_head = (unsigned*)(io->sq_map + p.sq_off.head);\n"
+    "    io->sq_tail = (unsigned*)(io->sq_map + p.sq_off.tail);\n"
+    "    io->sq_mask = (unsigned*)(io->sq_map + p.sq_off.ring_mask);\n"
+    "    io->sq_array = (unsigned*)(io->sq_map + p.sq_off.array);\n"
+    "    io->sq_entries = p.sq_entries;\n"
+    "    io->cq_head = (unsigned*)(io->cq_map + p.cq_off.head);\n"
+    "    io->cq_tail = (unsigned*)(io->cq_map + p.cq_off.tail);\n"
+    "    io->cq_mask = (unsigned*)(io->cq_map + p.cq_off.ring_mask);\n"
+    "    io->cqes = (struct io_uring_cqe*)(io->cq_map + p.cq_off.cqes);\n"
+    "    return 1;\n"
+    "}\n"
+    "\n"
+    "// Conclusões viram tarefas prontas; o resultado fica em t->res\n"
+    "static void rujo_uring_reap(RujoIo* io) {\n"
+    "    unsigned head = *io->cq_head;\n"
+    "    unsigned tail = __atomic_load_n(io->cq_tail, __ATOMIC_ACQUIRE);\n"
+    "    for (; head != tail; head++) {\n"
+    "        struct io_uring_cqe* cqe = &io->cqes[head & *io->cq_mask];\n"
+    "        RujoIoTask* t = (RujoIoTask*)(uintptr_t)cqe->user_data;\n"
+    "        t->res = cqe->res;\n"
+    "        rujo_io_ready(io, t);\n"
+    "    }\n"
+    "    __atomic_store_n(io->cq_head, head, __ATOMIC_RELEASE);\n"
+    "}\n"
+    "\n"
+    "// Uma syscall submete tudo que foi enfileirado desde a última (e espera, se wait)\n"
+    "static void rujo_uring_enter(RujoIo* io, unsigned wait) {\n"
+    "    int r = (int)syscall(__NR_io_uring_enter, io->ring_fd, io->to_submit, wait,\n"
+    "                         wait ? IORING_ENTER_GETEVENTS : 0, NULL, 0);\n"
+    "    if (r >= 0) {\n"
+    "        io->to_submit -= (unsigned)r;\n"
+    "        return;\n"
+    "    }\n"
+    "    if (errno == EBUSY || errno == EAGAIN) {\n"
+    "        // Fila de conclusões cheia: esvazia antes de submeter mais\n"
+    "        rujo_uring_reap(io);\n"
+    "        return;\n"
+    "    }\n"
+    "    if (errno != EINTR) {\n"
+    "        perror(\"io_uring_enter\");\n"
+    "        abort();\n"
+    "    }\n"
+    "}\n"
+    "\n"
+    "static void rujo_uring_push(RujoIo* io, RujoIoTask* t, int opcode, int fd, void* addr, unsigned len,\n"
+    "                            unsigned long long off) {\n"
+    "    unsigned tail = *io->sq_tail;\n"
+    "    while (tail - __atomic_load_n(io->sq_head, __ATOMIC_ACQUIRE) >= io->sq_entries) rujo_uring_enter(io, 0);\n"
+    "    unsigned idx = tail & *io->sq_mask;\n"
+    "    struct io_uring_sqe* sqe = &io->sqes[idx];\n"
+    "    memset(sqe, 0, sizeof(*sqe));\n"
+    "    sqe->opcode = (unsigned char)opcode;\n"
+    "    sqe->fd = fd;\n"
+    "    sqe->addr = (unsigned long long)(uintptr_t)addr;\n"
+    "    sqe->len = len;\n"
+    "    sqe->off = off;\n"
+    "    if (opcode == IORING_OP_ACCEPT) sqe->accept_flags = SOCK_NONBLOCK | SOCK_CLOEXEC;\n"
+    "    sqe->user_data = (unsigned long long)(uintptr_t)t;\n"
+    "    io->sq_array[idx] = idx;\n"
+    "    __atomic_store_n(io->sq_tail, tail + 1, __ATOMIC_RELEASE);\n"
+    "    io->to_submit++;\n"
+    "}\n"
+    "\n"
+    "// epoll: um registro por fd, rearmado (EPOLLONESHOT) a cada espera\n"
+    "static void rujo_epoll_arm(RujoIo* io, RujoIoTask* t, int fd, unsigned events) {\n"
+    "    if (fd >= io->armed_cap) {\n"
+    "        int cap = io->armed_cap ? io->armed_cap : 1024;\n"
+    "        while (cap <= fd) cap *= 2;\n"
+    "        io->armed = realloc(io->armed, (size_t)cap);\n"
+    "        memset(io->armed + io->armed_cap, 0, (size_t)(cap - io->armed_cap));\n"
+    "        io->armed_cap = cap;\n"
+    "    }\n"
+    "    struct epoll_event ev;\n"
+    "    ev.events = events | EPOLLONESHOT;\n"
+    "    ev.data.ptr = t;\n"
+    "    int op = io->armed[fd] ? EPOLL_CTL_MOD : EPOLL_CTL_ADD;\n"
+    "    if (epoll_ctl(io->epfd, op, fd, &ev) < 0) {\n"
+    "        // fd reaproveitado depois de um close que não passou por rujo_io_close\n"
+    "        op = errno == ENOENT ? EPOLL_CTL_ADD : EPOLL_CTL_MOD;\n"
+    "        if (epoll_ctl(io->epfd, op, fd, &ev) < 0) {\n"
+    "            perror(\"epoll_ctl\");\n"
+    "            abort();\n"
+    "        }\n"
+    "    }\n"
+    "    io->armed[fd] = 1;\n"
+    "}\n"
+    "\n"
+    "// Tenta a operação sem bloquear: 1 = terminou (t->res pronto), 0 = ainda não\n"
+    "static int rujo_io_try(RujoIoTask* t) {\n"
+    "    int r = 0;\n"
+    "    switch (t->op) {\n"
+    "        case RUJO_IO_ACCEPT:\n"
+    "            r = accept4(t->fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);\n"
+    "            if (r >= 0) rujo_io_nodelay(r);\n"
+    "            break;\n"
+    "        case RUJO_IO_READ:\n"
+    "            r = (int)read(t->fd, t->buf, (size_t)t->len);\n"
+    "            break;\n"
+    "        case RUJO_IO_WRITE:\n"
+    "            r = (int)write(t->fd, t->buf, (size_t)t->len);\n"
+    "            break;\n"
+    "        case RUJO_IO_CONNECT: {\n"
+    "            int err = 0;\n"
+    "            socklen_t n = sizeof(err);\n"
+    "            getsockopt(t->fd, SOL_SOCKET, SO_ERROR, &err, &n);\n"
+    "            if (err) close(t->fd);\n"
+    "            t->res = err ? -err : t->fd;\n"
+    "            return 1;\n"
+    "        }\n"
+    "        case RUJO_IO_SLEEP: {\n"
+    "            uint64_t ticks;\n"
+    "            if (read(t->fd, &ticks, sizeof(ticks)) < 0 && errno == EAGAIN) return 0;\n"
+    "            close(t->fd);\n"
+    "            t->res = 0;\n"
+    "            return 1;\n"
+    "        }\n"
+    "    }\n"
+    "    if (r < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return 0;\n"
+    "    t->res = r < 0 ? -errno : r;\n"
+    "    return 1;\n"
+    "}\n"
+    "\n"
+    "static unsigned rujo_io_events(int op) {\n"
+    "    return op == RUJO_IO_WRITE || op == RUJO_IO_CONNECT ? EPOLLOUT : EPOLLIN;\n"
+    "}\n"
+    "\n"
+    "// Início de uma operação: 1 = já terminou, 0 = a tarefa deve suspender\n"
+    "static int rujo_io_start(RujoIoTask* t, int op, int fd, void* buf, int len) {\n"
+    "    RujoIo* io = rujo_io;\n"
+    "    t->op = op;\n"
+    "    t->fd = fd;\n"
+    "    t->buf = buf;\n"
+    "    t->len = len;\n"
+    "    if (io->uring) {\n"
+    "        int opcode = op == RUJO_IO_ACCEPT ? IORING_OP_ACCEPT : op == RUJO_IO_READ ? IORING_OP_READ : IORING_OP_WRITE;\n"
+    "        rujo_uring_push(io, t, opcode, fd, buf, (unsigned)len, (unsigned long long)-1);\n"
+    "        return 0;\n"
+    "    }\n"
+    "    if (rujo_io_try(t)) return 1;\n"
+    "    rujo_epoll_arm(io, t, fd, rujo_io_events(op));\n"
+    "    return 0;\n"
+    "}\n"
+    "\n"
+    "// Retomada depois de acordar: 1 = resultado pronto, 0 = esperar de novo (epoll)\n"
+    "static int rujo_io_again(RujoIoTask* t) {\n"
+    "    RujoIo* io = rujo_io;\n"
+    "    if (io->uring) {\n"
+    "        if (t->op == RUJO_IO_ACCEPT && t->res >= 0) {\n"
+    "            rujo_io_nodelay(t->res);\n"
+    "        } else if (t->op == RUJO_IO_CONNECT) {\n"
+    "            if (t->res == 0) t->res = t->fd;\n"
+    "            else close(t->fd);\n"
+    "        } else if (t->op == RUJO_IO_SLEEP) {\n"
+    "            t->res = 0;\n"
+    "        }\n"
+    "        return 1;\n"
+    "    }\n"
+    "    if (rujo_io_try(t)) return 1;\n"
+    "    rujo_epoll_arm(io, t, t->fd, rujo_io_events(t->op));\n"
+    "    return 0;\n"
+    "}\n"
+    "\n"
+    "static int rujo_io_accept(RujoIoTask* t, int fd) {\n"
+    "    return rujo_io_start(t, RUJO_IO_ACCEPT, fd, NULL, 0);\n"
+    "}\n"
+    "\n"
+    "static int rujo_io_read(RujoIoTask* t, int fd, uint8_t* buf) {\n"
+    "    return rujo_io_start(t, RUJO_IO_READ, fd, buf, (int)rujo_array_len(buf));\n"
+    "}\n"
+    "\n"
+    "static int rujo_io_write(RujoIoTask* t, int fd, uint8_t* buf, int n) {\n"
+    "    int len = (int)rujo_array_len(buf);\n"
+    "    if (n > len) n = len;\n"
+    "    if (n < 0) n = 0;\n"
+    "    return rujo_io_start(t, RUJO_IO_WRITE, fd, buf, n);\n"
+    "}\n"
+    "\n"
+    "static int rujo_io_connect(RujoIoTask* t, const char* host, int port) {\n"
+    "    memset(&t->addr, 0, sizeof(t->addr));\n"
+    "    t->addr.sin_family = AF_INET;\n"
+    "    t->addr.sin_port = htons((uint16_t)port);\n"
+    "    if (strcmp(host, \"localhost\") == 0) host = \"127.0.0.1\";\n"
+    "    if (inet_pton(AF_INET, host, &t->addr.sin_addr) != 1) {\n"
+    "        t->res = -EINVAL;\n"
+    "        return 1;\n"
+    "    }\n"
+    "    int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);\n"
+    "    if (fd < 0) {\n"
+    "        t->res = -errno;\n"
+    "        return 1;\n"
+    "    }\n"
+    "    rujo_io_nodelay(fd);\n"
+    "    t->op = RUJO_IO_CONNECT;\n"
+    "    t->fd = fd;\n"
+    "    if (rujo_io->uring) {\n"
+    "        rujo_uring_push(rujo_io, t, IORING_OP_CONNECT, fd, &t->addr, 0, sizeof(t->addr));\n"
+    "        return 0;\n"
+    "    }\n"
+    "    if (connect(fd, (struct sockaddr*)&t->addr, sizeof(t->addr)) == 0) {\n"
+    "        t->res = fd;\n"
+    "        return 1;\n"
+    "    }\n"
+    "    if (errno != EINPROGRESS) {\n"
+    "        t->res = -errno;\n"
+    "        close(fd);\n"
+    "        return 1;\n"
+    "    }\n"
+    "    rujo_epoll_arm(rujo_io, t, fd, EPOLLOUT);\n"
+    "    return 0;\n"
+    "}\n"
+    "\n"
+    "static int rujo_io_sleep(RujoIoTask* t, int ms) {\n"
+    "    t->op = RUJO_IO_SLEEP;\n"
+    "    t->res = 0;\n"
+    "    if (ms <= 0) return 1;\n"
+    "    if (rujo_io->uring) {\n"
+    "        t->ts.tv_sec = ms / 1000;\n"
+    "        t->ts.tv_nsec = (long long)(ms % 1000) * 1000000;\n"
+    "        rujo_uring_push(rujo_io, t, IORING_OP_TIMEOUT, -1, &t->ts, 1, 0);\n"
+    "        return 0;\n"
+    "    }\n"
+    "    int fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);\n"
+    "    if (fd < 0) {\n"
+    "        perror(\"timerfd_create\");\n"
+    "        abort();\n"
+    "    }\n"
+    "    struct itimerspec when;\n"
+    "    memset(&when, 0, sizeof(when));\n"
+    "    when.it_value.tv_sec = ms / 1000;\n"
+    "    when.it_value.tv_nsec = (long)(ms % 1000) * 1000000;\n"
+    "    timerfd_settime(fd, 0, &when, NULL);\n"
+    "    t->fd = fd;\n"
+    "    rujo_epoll_arm(rujo_io, t, fd, EPOLLIN);\n"
+    "    return 0;\n"
+    "}\n"
+    "\n"
+    "// Síncronas: não esperam por rede nem disco de forma que valha suspender\n"
+    "static int rujo_tcp_listen(int port) {\n"
+    "    int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);\n"
+    "    if (fd < 0) return -errno;\n"
+    "    int one = 1;\n"
+    "    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));\n"
+    "    setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one));\n"
+    "    struct sockaddr_in a;\n"
+    "    memset(&a, 0, sizeof(a));\n"
+    "    a.sin_family = AF_INET;\n"
+    "    a.sin_port = htons((uint16_t)port);\n"
+    "    a.sin_addr.s_addr = htonl(INADDR_ANY);\n"
+    "    if (bind(fd, (struct sockaddr*)&a, sizeof(a)) < 0 || listen(fd, 4096) < 0) {\n"
+    "        int err = errno;\n"
+    "        close(fd);\n"
+    "        return -err;\n"
+    "    }\n"
+    "    return fd;\n"
+    "}\n"
+    "\n"
+    "static int rujo_file_open(const char* path, const char* mode) {\n"
+    "    int flags = O_RDONLY;\n"
+    "    if (mode[0] == 'w') flags = O_WRONLY | O_CREAT | O_TRUNC;\n"
+    "    else if (mode[0] == 'a') flags = O_WRONLY | O_CREAT | O_APPEND;\n"
+    "    int fd = open(path, flags | O_CLOEXEC, 0644);\n"
+    "    return fd < 0 ? -errno : fd;\n"
+    "}\n"
+    "\n"
+    "static void rujo_io_close(int fd) {\n"
+    "    if (fd < 0) return;\n"
+    "    if (rujo_io && fd < rujo_io->armed_cap) rujo_io->armed[fd] = 0;\n"
+    "    close(fd);\n"
+    "}\n"
+    "\n"
+    "static void rujo_io_spawn(void* frame, bool (*poll)(void*, RujoIoTask*), void (*drop)(void*)) {\n"
+    "    if (!rujo_io) {\n"
+    "        fprintf(stderr, \"io_spawn() fora de io_run()\\n\");\n"
+    "        abort();\n"
+    "    }\n"
+    "    RujoIoTask* t = calloc(1, sizeof(RujoIoTask));\n"
+    "    t->frame = frame;\n"
+    "    t->poll = poll;\n"
+    "    t->drop = drop;\n"
+    "    rujo_io->live++;\n"
+    "    rujo_io_ready(rujo_io, t);\n"
+    "}\n"
+    "\n"
+    "// Espera pelo menos um evento; io_uring submete as operações da rodada na mesma syscall\n"
+    "static void rujo_io_wait(RujoIo* io) {\n"
+    "    if (io->uring) {\n"
+    "        rujo_uring_enter(io, 1);\n"
+    "        rujo_uring_reap(io);\n"
+    "        return;\n"
+    "    }\n"
+    "    struct epoll_event evs[256];\n"
+    "    int n = epoll_wait(io->epfd, evs, 256, -1);\n"
+    "    if (n < 0 && errno != EINTR) {\n"
+    "        perror(\"epoll_wait\");\n"
+    "        abort();\n"
+    "    }\n"
+    "    for (int i = 0; i < n; i++) rujo_io_ready(io, (RujoIoTask*)evs[i].data.ptr);\n"
+    "}\n"
+    "\n"
+    "// Roda a tarefa raiz e tudo que ela disparar com io_spawn até não sobrar nenhuma.\n"
+    "// RUJO_IO=epoll força o backend epoll (também usado se io_uring não existir).\n"
+    "static void rujo_io_run(void* frame, bool (*poll)(void*, RujoIoTask*)) {\n"
+    "    RujoIo* saved = rujo_io;\n"
+    "    RujoIo* io = calloc(1, sizeof(RujoIo));\n"
+    "    const char* backend = getenv(\"RUJO_IO\");\n"
+    "    if (!backend || strcmp(backend, \"epoll\") != 0) io->uring = rujo_uring_setup(io);\n"
+    "    if (!io->uring) {\n"
+    "        io->epfd = epoll_create1(EPOLL_CLOEXEC);\n"
+    "        if (io->epfd < 0) {\n"
+    "            perror(\"epoll_create1\");\n"
+    "            abort();\n"
+    "        }\n"
+    "    }\n"
+    "    rujo_io = io;\n"
+    "\n"
+    "    RujoIoTask root;\n"
+    "    memset(&root, 0, sizeof(root));\n"
+    "    root.frame = frame;\n"
+    "    root.poll = poll;\n"
+    "    io->live = 1;\n"
+    "    rujo_io_ready(io, &root);\n"
+    "    while (io->live > 0) {\n"
+    "        RujoIoTask* t;\n"
+    "        while ((t = io->ready_head)) {\n"
+    "            io->ready_head = t->next;\n"
+    "            if (!io->ready_head) io->ready_tail = NULL;\n"
+    "            if (!t->poll(t->frame, t)) continue;\n"
+    "            io->live--;\n"
+    "            if (t != &root) {\n"
+    "                t->drop(t->frame);\n"
+    "                free(t);\n"
+    "            }\n"
+    "        }\n"
+    "        if (io->live > 0) rujo_io_wait(io);\n"
+    "    }\n"
+    "\n"
+    "    if (io->uring) {\n"
+    "        munmap(io->sqes, io->sqes_size);\n"
+    "        if (io->cq_map != io->sq_map) munmap(io->cq_map, io->cq_size);\n"
+    "        munmap(io->sq_map, io->sq_size);\n"
+    "        close(io->ring_fd);\n"
+    "    } else {\n"
+    "        close(io->epfd);\n"
+    "    }\n"
+    "    free(io->armed);\n"
+    "    free(io);\n"
+    "    rujo_io = saved;\n"
+    "}\n";
+
+// Saída de print(): buffer grande + write(2), formatação de números sem stdio.
+static const char* RUNTIME_PRINT =
+    "#include <unistd.h>\n"
+    "#include <errno.h>\n"
+    "\n"
+    "// Saída de print(): buffer de 64 KB escrito com write(2) no fd 1 quando enche,\n"
+    "// em flush() e na saída do programa. Num terminal cada print vai direto.\n"
+    "#define RUJO_OUT_CAP (64 * 1024)\n"
+    "RUJO_GLOBAL char rujo_out_buf[RUJO_OUT_CAP];\n"
+    "RUJO_GLOBAL size_t rujo_out_len = 0;\n"
+    "RUJO_GLOBAL bool rujo_out_tty = false;\n"
+    "\n"
+    "// Com tarefas, várias threads imprimem: um spinlock curto protege o buffer\n"
+    "#ifdef RUJO_OUT_THREADS\n"
+    "#include <sched.h>\n"
+    "RUJO_GLOBAL char rujo_out_busy = 0;\n"
+    "#define RUJO_OUT_LOCK() while (__atomic_test_and_set(&rujo_out_busy, __ATOMIC_ACQUIRE)) sched_yield()\n"
+    "#define RUJO_OUT_UNLOCK() __atomic_clear(&rujo_out_busy, __ATOMIC_RELEASE)\n"
+    "#else\n"
+    "#define RUJO_OUT_LOCK() ((void)0)\n"
+    "#define RUJO_OUT_UNLOCK() ((void)0)\n"
+    "#endif\n"
+    "\n"
+    "static void rujo_out_write(const char* p, size_t n) {\n"
+    "    while (n > 0) {\n"
+    "        ssize_t w = write(1, p, n);\n"
+    "        if (w < 0) {\n"
+    "            if (errno == EINTR) continue;\n"
+    "            return; // stdout fechado (EPIPE etc.): descarta como o stdio\n"
+    "        }\n"
+    "        p += w;\n"
+    "        n -= (size_t)w;\n"
+    "    }\n"
+    "}\n"
+    "\n"
+    "static void rujo_out_drain(void) {\n"
+    "    rujo_out_write(rujo_out_buf, rujo_out_len);\n"
+    "    rujo_out_len = 0;\n"
+    "}\n"
+    "\n"
+    "static void rujo_out_flush(void) {\n"
+    "    RUJO_OUT_LOCK();\n"
+    "    rujo_out_drain();\n"
+    "    RUJO_OUT_UNLOCK();\n"
+    "}\n"
+    "\n"
+    "static void rujo_out_init(void) {\n"
+    "    rujo_out_tty = isatty(1);\n"
+    "    atexit(rujo_out_flush);\n"
+    "}\n"
+    "\n"
+    "// Acrescenta texto + '\\n' ao buffer (texto maior que o buffer vai direto)\n"
+    "static void rujo_out_line(const char* s, size_t n) {\n"
+    "    RUJO_OUT_LOCK();\n"
+    "    if (__builtin_expect(rujo_out_len + n + 1 > RUJO_OUT_CAP, 0)) {\n"
+    "        rujo_out_drain();\n"
+    "        if (n + 1 > RUJO_OUT_CAP) {\n"
+    "            rujo_out_write(s, n);\n"
+    "            rujo_out_write(\"\\n\", 1);\n"
+    "            RUJO_OUT_UNLOCK();\n"
+    "            return;\n"
+    "        }\n"
+    "    }\n"
+    "    memcpy(rujo_out_buf + rujo_out_len, s, n);\n"
+    "    rujo_out_buf[rujo_out_len + n] = '\\n';\n"
+    "    rujo_out_len += n + 1;\n"
+    "    if (rujo_out_tty) rujo_out_drain();\n"
+    "    RUJO_OUT_UNLOCK();\n"
+    "}\n"
+    "\n"
+    "static const char rujo_digits2[201] =\n"
+    "    \"00010203040506070809101112131415161718192021222324252627282930313233343536373839\"\n"
+    "    \"40414243444546474849505152535455565758596061626364656667686970717273747576777879\"\n"
+    "    \"8081828384858687888990919293949596979899\";\n"
+    "\n"
+    "// Escreve v em decimal terminando em end; devolve o início\n"
+    "static char* rujo_fmt_u64(char* end, uint64_t v) {\n"
+    "    while (v >= 100) {\n"
+    "        end -= 2;\n"
+    "        memcpy(end, rujo_digits2 + (v % 100) * 2, 2);\n"
+    "        v /= 100;\n"
+    "    }\n"
+    "    if (v >= 10) {\n"
+    "        end -= 2;\n"
+    "        memcpy(end, rujo_digits2 + v * 2, 2);\n"
+    "    } else {\n"
+    "        *--end = (char)('0' + v);\n"
+    "    }\n"
+    "    return end;\n"
+    "}\n"
+    "\n"
+    "static void print_long(int64_t x) {\n"
+    "    char buf[24];\n"
+    "    char* end = buf + sizeof(buf);\n"
+    "    uint64_t u = x < 0 ? (uint64_t)0 - (uint64_t)x : (uint64_t)x;\n"
+    "    char* p = rujo_fmt_u64(end, u);\n"
+    "    if (x < 0) *--p = '-';\n"
+    "    rujo_out_line(p, (size_t)(end - p));\n"
+    "}\n"
+    "\n"
+    "static void print_int(int x) { print_long(x); }\n"
+    "\n"
+    "// v * 10^k em double; potências até 10^22 são exatas\n"
+    "static double rujo_scale10(double v, int k) {\n"
+    "    static const double p10[23] = {\n"
+    "        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,\n"
+    "        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22\n"
+    "    };\n"
+    "    if (k >= 0) {\n"
+    "        while (k > 22) { v *= 1e22; k -= 22; }\n"
+    "        return v * p10[k];\n"
+    "    }\n"
+    "    k = -k;\n"
+    "    while (k > 22) { v /= 1e22; k -= 22; }\n"
+    "    return v / p10[k];\n"
+    "}\n"
+    "\n"
+    "// Menor sequência de dígitos que relida volta ao mesmo float. O float cabe\n"
+    "// exato num double e o double tem folga de ~29 bits, então escalar por 10^k\n"
+    "// e reconverter decide certo sem aritmética de precisão múltipla.\n"
+    "static int rujo_float_digits(float x, char* digits, int* exp10) {\n"
+    "    double v = x;\n"
+    "    uint32_t bits;\n"
+    "    memcpy(&bits, &x, sizeof(bits));\n"
+    "    int e2 = (int)((bits >> 23) & 255) - 127;\n"
+    "    int e10 = (e2 * 78913) >> 18; // floor(e2 * log10(2)), pode errar por 1\n"
+    "    while (rujo_scale10(v, -e10) >= 10.0) e10++;\n"
+    "    while (rujo_scale10(v, -e10) < 1.0) e10--;\n"
+    "\n"
+    "    uint64_t m = 0;\n"
+    "    int p;\n"
+    "    for (p = 1; p <= 9; p++) {\n"
+    "        double s = rujo_scale10(v, p - 1 - e10);\n"
+    "        m = (uint64_t)(s + 0.5);\n"
+    "        int e = e10;\n"
+    "        if (m >= (uint64_t)rujo_scale10(1.0, p)) { m /= 10; e++; }\n"
+    "        if ((float)rujo_scale10((double)m, e - p + 1) == x) {\n"
+    "            e10 = e;\n"
+    "            break;\n"
+    "        }\n"
+    "    }\n"
+    "    if (p > 9) p = 9;\n"
+    "    while (p > 1 && m % 10 == 0) { m /= 10; p--; }\n"
+    "    char buf[24];\n"
+    "    char* end = buf + sizeof(buf);\n"
+    "    char* s = rujo_fmt_u64(end, m);\n"
+    "    memcpy(digits, s, (size_t)(end - s));\n"
+    "    *exp10 = e10;\n"
+    "    return (int)(end - s);\n"
+    "}\n"
+    "\n"
+    "// Notação fixa entre 1e-5 e 1e16 (sempre com parte decimal), científica fora\n"
+    "static void print_float(float x) {\n"
+    "    char buf[48];\n"
+    "    char* p = buf;\n"
+    "    if (x != x) {\n"
+    "        rujo_out_line(\"nan\", 3);\n"
+    "        return;\n"
+    "    }\n"
+    "    if (x < 0 || (x == 0 && 1.0f / x < 0)) {\n"
+    "        *p++ = '-';\n"
+    "        x = -x;\n"
+    "    }\n"
+    "    if (x == 0) {\n"
+    "        memcpy(p, \"0.0\", 3);\n"
+    "        rujo_out_line(buf, (size_t)(p - buf) + 3);\n"
+    "        return;\n"
+    "    }\n"
+    "    if (__builtin_isinf(x)) {\n"
+    "        memcpy(p, \"inf\", 3);\n"
+    "        rujo_out_line(buf, (size_t)(p - buf) + 3);\n"
+    "        return;\n"
+    "    }\n"
+    "    char d[12];\n"
+    "    int e;\n"
+    "    int n = rujo_float_digits(x, d, &e);\n"
+    "    if (e >= 16 || e < -5) {\n"
+    "        *p++ = d[0];\n"
+    "        if (n > 1) {\n"
+    "            *p++ = '.';\n"
+    "            memcpy(p, d + 1, (size_t)n - 1);\n"
+    "            p += n - 1;\n"
+    "        }\n"
+    "        *p++ = 'e';\n"
+    "        *p++ = e < 0 ? '-' : '+';\n"
+    "        if (e < 0) e = -e;\n"
+    "        if (e < 10) *p++ = '0';\n"
+    "        char* end = buf + sizeof(buf);\n"
+    "        char* s = rujo_fmt_u64(end, (uint64_t)e);\n"
+    "        memmove(p, s, (size_t)(end - s));\n"
+    "        p += end - s;\n"
+    "    } else if (e >= 0) {\n"
+    "        for (int i = 0; i <= e; i++) *p++ = i < n ? d[i] : '0';\n"
+    "        *p++ = '.';\n"
+    "        if (n > e + 1) {\n"
+    "            memcpy(p, d + e + 1, (size_t)(n - e - 1));\n"
+    "            p += n - e - 1;\n"
+    "        } else {\n"
+    "            *p++ = '0';\n"
+    "        }\n"
+    "    } else {\n"
+    "        *p++ = '0';\n"
+    "        *p++ = '.';\n"
+    "        for (int i = 0; i < -e - 1; i++) *p++ = '0';\n"
+    "        memcpy(p, d, (size_t)n);\n"
+    "        p += n;\n"
+    "    }\n"
+    "    rujo_out_line(buf, (size_t)(p - buf));\n"
+    "}\n"
+    "\n"
+    "static void print_string(const char* x) { rujo_out_line(x, strlen(x)); }\n"
+    "static void print_bool(bool x) { if (x) rujo_out_line(\"true\", 4); else rujo_out_line(\"false\", 5); }\n";
+
+// Arquivos (File.map / File.lines / FileWriter): mmap, leitor de linhas sem cópia e escrita com buffer.
+static const char* RUNTIME_FILES =
+    "#include <fcntl.h>\n"
+    "#include <sys/mman.h>\n"
+    "#include <sys/stat.h>\n"
+    "#include <unistd.h>\n"
+    "#include <errno.h>\n"
+    "\n"
+    "// File.map: o arquivo é mapeado logo depois de uma página anônima que guarda o\n"
+    "// cabeçalho do array, então o resultado é um byte[] comum (índice, len, for-in).\n"
+    "// Só leitura (PROT_READ): o semântico recusa escritas no array.\n"
+    "// rujo_array_free reconhece o cabeçalho (map != 0) e desfaz o mapeamento.\n"
+    "static uint8_t* rujo_file_map_raw(const char* path, const char** err) {\n"
+    "    int fd = open(path, O_RDONLY | O_CLOEXEC);\n"
+    "    if (fd < 0) {\n"
+    "        *err = strerror(errno);\n"
+    "        return NULL;\n"
+    "    }\n"
+    "    struct stat st;\n"
+    "    if (fstat(fd, &st) < 0) {\n"
+    "        *err = strerror(errno);\n"
+    "        close(fd);\n"
+    "        return NULL;\n"
+    "    }\n"
+    "    if (st.st_size == 0) {\n"
+    "        close(fd);\n"
+    "        return rujo_array_new(0, 1);\n"
+    "    }\n"
+    "    size_t page = (size_t)sysconf(_SC_PAGESIZE);\n"
+    "    size_t total = page + (((size_t)st.st_size + page - 1) & ~(page - 1));\n"
+    "    char* base = mmap(NULL, total, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);\n"
+    "    if (base == MAP_FAILED) {\n"
+    "        *err = strerror(errno);\n"
+    "        close(fd);\n"
+    "        return NULL;\n"
+    "    }\n"
+    "    char* data = mmap(base + page, (size_t)st.st_size, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd, 0);\n"
+    "    int saved = errno;\n"
+    "    close(fd);\n"
+    "    if (data == MAP_FAILED) {\n"
+    "        munmap(base, total);\n"
+    "        *err = strerror(saved);\n"
+    "        return NULL;\n"
+    "    }\n"
+    "    madvise(data, (size_t)st.st_size, MADV_SEQUENTIAL);\n"
+    "    RujoArrayHeader* h = (RujoArrayHeader*)data - 1;\n"
+    "    h->len = st.st_size;\n"
+    "    h->map = (int64_t)total;\n"
+    "    return (uint8_t*)data;\n"
+    "}\n"
+    "\n"
+    "static void rujo_array_unmap(void* a) {\n"
+    "    RujoArrayHeader* h = (RujoArrayHeader*)a - 1;\n"
+    "    size_t page = (size_t)sysconf(_SC_PAGESIZE);\n"
+    "    munmap((char*)a - page, (size_t)h->map);\n"
+    "}\n"
+    "\n"
+    "// File.lines: leitura em blocos de 1 MB; cada linha é terminada no próprio\n"
+    "// buffer (o '\\n' vira '\\0'), então o string entregue não é cópia e só vale até\n"
+    "// a próxima iteração. Linhas maiores que o buffer fazem ele crescer.\n"
+    "#define RUJO_LINES_BUF (1 << 20)\n"
+    "typedef struct {\n"
+    "    int fd;\n"
+    "    bool eof;\n"
+    "    char* buf;\n"
+    "    size_t cap;\n"
+    "    size_t start;\n"
+    "    size_t end;\n"
+    "} RujoLines;\n"
+    "\n"
+    "static RujoLines* rujo_lines_open(const char* path, const char** err) {\n"
+    "    int fd = open(path, O_RDONLY | O_CLOEXEC);\n"
+    "    if (fd < 0) {\n"
+    "        *err = strerror(errno);\n"
+    "        return NULL;\n"
+    "    }\n"
+    "    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);\n"
+    "    RujoLines* r = malloc(sizeof(RujoLines));\n"
+    "    r->fd = fd;\n"
+    "    r->eof = false;\n"
+    "    r->cap = RUJO_LINES_BUF;\n"
+    "    r->buf = malloc(r->cap + 1);\n"
+    "    r->start = r->end = 0;\n"
+    "    return r;\n"
+    "}\n"
+    "\n"
+    "static bool rujo_lines_next(void* p, const char** out) {\n"
+    "    RujoLines* r = p;\n"
+    "    for (;;) {\n"
+    "        char* nl = memchr(r->buf + r->start, '\\n', r->end - r->start);\n"
+    "        if (nl) {\n"
+    "            size_t n = (size_t)(nl - (r->buf + r->start));\n"
+    "            if (n > 0 && nl[-1] == '\\r') nl[-1] = '\\0';\n"
+    "            *nl = '\\0';\n"
+    "            *out = r->buf + r->start;\n"
+    "            r->start += n + 1;\n"
+    "            return true;\n"
+    "        }\n"
+    "        if (r->eof) {\n"
+    "            if (r->start == r->end) return false;\n"
+    "            // Última linha sem '\\n': sempre sobra 1 byte para o terminador\n"
+    "            r->buf[r->end] = '\\0';\n"
+    "            *out = r->buf + r->start;\n"
+    "            r->start = r->end;\n"
+    "            return true;\n"
+    "        }\n"
+    "        if (r->start > 0) {\n"
+    "            memmove(r->buf, r->buf + r->start, r->end - r->start);\n"
+    "            r->end -= r->start;\n"
+    "            r->start = 0;\n"
+    "        }\n"
+    "        if (r->end == r->cap) {\n"
+    "            r->cap *= 2;\n"
+    "            r->buf = realloc(r->buf, r->cap + 1);\n"
+    "        }\n"
+    "        ssize_t got = read(r->fd, r->buf + r->end, r->cap - r->end);\n"
+    "        if (got < 0 && errno == EINTR) continue;\n"
+    "        if (got <= 0) r->eof = true;\n"
+    "        else r->end += (size_t)got;\n"
+    "    }\n"
+    "}\n"
+    "\n"
+    "static void rujo_lines_drop(void* p) {\n"
+    "    RujoLines* r = p;\n"
+    "    close(r->fd);\n"
+    "    free(r->buf);\n"
+    "    free(r);\n"
+    "}\n"
+    "\n"
+    "// FileWriter: buffer de 64 KB por arquivo, escrito com write(2) quando enche,\n"
+    "// em flush() e quando o FileWriter sai de escopo (que também fecha o arquivo)\n"
+    "#define RUJO_WRITER_BUF (64 * 1024)\n"
+    "typedef struct {\n"
+    "    int fd;\n"
+    "    size_t len;\n"
+    "    char buf[RUJO_WRITER_BUF];\n"
+    "} RujoWriter;\n"
+    "\n"
+    "typedef struct FileWriter { RujoWriter* h; } FileWriter;\n"
+    "\n"
+    "static RujoWriter* rujo_writer_open(const char* path, bool append, const char** err) {\n"
+    "    int flags = O_WRONLY | O_CREAT | O_CLOEXEC | (append ? O_APPEND : O_TRUNC);\n"
+    "    int fd = open(path, flags, 0644);\n"
+    "    if (fd < 0) {\n"
+    "        *err = strerror(errno);\n"
+    "        return NULL;\n"
+    "    }\n"
+    "    RujoWriter* w = malloc(sizeof(RujoWriter));\n"
+    "    w->fd = fd;\n"
+    "    w->len = 0;\n"
+    "    return w;\n"
+    "}\n"
+    "\n"
+    "static void rujo_writer_raw(int fd, const char* p, size_t n) {\n"
+    "    while (n > 0) {\n"
+    "        ssize_t w = write(fd, p, n);\n"
+    "        if (w < 0) {\n"
+    "            if (errno == EINTR) continue;\n"
+    "            return;\n"
+    "        }\n"
+    "        p += w;\n"
+    "        n -= (size_t)w;\n"
+    "    }\n"
+    "}\n"
+    "\n"
+    "static void rujo_writer_put(RujoWriter* w, const void* p, size_t n) {\n"
+    "    if (__builtin_expect(w->len + n > RUJO_WRITER_BUF, 0)) {\n"
+    "        rujo_writer_raw(w->fd, w->buf, w->len);\n"
+    "        w->len = 0;\n"
+    "        if (n > RUJO_WRITER_BUF) {\n"
+    "            rujo_writer_raw(w->fd, p, n);\n"
+    "            return;\n"
+    "        }\n"
+    "    }\n"
+    "    memcpy(w->buf + w->len, p, n);\n"
+    "    w->len += n;\n"
+    "}\n"
+    "\n"
+    "static void rujo_writer_close(RujoWriter* w) {\n"
+    "    rujo_writer_raw(w->fd, w->buf, w->len);\n"
+    "    close(w->fd);\n"
+    "    free(w);\n"
+    "}\n"
+    "\n"
+    "static void FileWriter_write(FileWriter* w, const char* s) {\n"
+    "    rujo_writer_put(w->h, s, strlen(s));\n"
+    "}\n"
+    "\n"
+    "static void FileWriter_write_line(FileWriter* w, const char* s) {\n"
+    "    rujo_writer_put(w->h, s, strlen(s));\n"
+    "    rujo_writer_put(w->h, \"\\n\", 1);\n"
+    "}\n"
+    "\n"
+    "static void FileWriter_write_bytes(FileWriter* w, uint8_t* b, int n) {\n"
+    "    if (n > rujo_array_len(b)) n = (int)rujo_array_len(b);\n"
+    "    if (n > 0) rujo_writer_put(w->h, b, (size_t)n);\n"
+    "}\n"
+    "\n"
+    "static void FileWriter_flush(FileWriter* w) {\n"
+    "    rujo_writer_raw(w->h->fd, w->h->buf, w->h->len);\n"
+    "    w->h->len = 0;\n"
+    "}\n";
+
+// Map<K, V>: grupos de controle (SSE2), hash e capacidade
+static const char* RUNTIME_MAP =
+    "// Map<K, V>: tabela de endereçamento aberto no estilo Swiss table. Um byte de\n"
+    "// controle por slot: 0x80 vazio, 0xFE apagado, 0..127 ocupado (7 bits do hash).\n"
+    "// Os slots formam grupos alinhados de 16; a busca compara o grupo inteiro de\n"
+    "// uma vez (SSE2) e só olha as chaves dos bytes que bateram.\n"
+    "#define RUJO_MAP_EMPTY ((uint8_t)0x80)\n"
+    "#define RUJO_MAP_DELETED ((uint8_t)0xFE)\n"
+    "#define RUJO_MAP_GROUP 16\n"
+    "\n"
+    "#ifdef __SSE2__\n"
+    "#include <emmintrin.h>\n"
+    "// Bits dos slots do grupo cujo controle é igual a h2\n"
+    "static inline uint32_t rujo_map_match(const uint8_t* g, uint8_t h2) {\n"
+    "    __m128i c = _mm_loadu_si128((const __m128i*)g);\n"
+    "    return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(c, _mm_set1_epi8((char)h2)));\n"
+    "}\n"
+    "// Vazios e apagados têm o bit alto ligado\n"
+    "static inline uint32_t rujo_map_match_free(const uint8_t* g) {\n"
+    "    return (uint32_t)_mm_movemask_epi8(_mm_loadu_si128((const __m128i*)g));\n"
+    "}\n"
+    "#else\n"
+    "static inline uint32_t rujo_map_match(const uint8_t* g, uint8_t h2) {\n"
+    "    uint32_t m = 0;\n"
+    "    for (int i = 0; i < RUJO_MAP_GROUP; i++) m |= (uint32_t)(g[i] == h2) << i;\n"
+    "    return m;\n"
+    "}\n"
+    "static inline uint32_t rujo_map_match_free(const uint8_t* g) {\n"
+    "    uint32_t m = 0;\n"
+    "    for (int i = 0; i < RUJO_MAP_GROUP; i++) m |= (uint32_t)(g[i] >> 7) << i;\n"
+    "    return m;\n"
+    "}\n"
+    "#endif\n"
+    "\n"
+    "static inline uint32_t rujo_map_match_empty(const uint8_t* g) {\n"
+    "    return rujo_map_match(g, RUJO_MAP_EMPTY);\n"
+    "}\n"
+    "\n"
+    "// Multiplicação de 128 bits dobrada: espalha qualquer bit da entrada pelos 64 da saída\n"
+    "static inline uint64_t rujo_hash_mix(uint64_t x) {\n"
+    "    __uint128_t m = (__uint128_t)x * 0x9E3779B97F4A7C15ULL;\n"
+    "    return (uint64_t)(m >> 64) ^ (uint64_t)m;\n"
+    "}\n"
+    "\n"
+    "static inline uint64_t rujo_hash_u64(uint64_t x) {\n"
+    "    return rujo_hash_mix(x ^ 0x2545F4914F6CDD1DULL);\n"
+    "}\n"
+    "\n"
+    "static inline uint64_t rujo_hash_str(const char* s) {\n"
+    "    size_t n = strlen(s);\n"
+    "    uint64_t h = rujo_hash_mix(n ^ 0x2545F4914F6CDD1DULL);\n"
+    "    while (n >= 8) {\n"
+    "        uint64_t w;\n"
+    "        memcpy(&w, s, 8);\n"
+    "        h = rujo_hash_mix(h ^ w);\n"
+    "        s += 8;\n"
+    "        n -= 8;\n"
+    "    }\n"
+    "    uint64_t w = 0;\n"
+    "    memcpy(&w, s, n);\n"
+    "    return rujo_hash_mix(h ^ w ^ ((uint64_t)n << 56));\n"
+    "}\n"
+    "\n"
+    "// Capacidade (potência de 2, mínimo um grupo) que guarda n itens sem passar de 7/8\n"
+    "static inline int rujo_map_capacity(int n) {\n"
+    "    int64_t need = (int64_t)n + (n + 6) / 7;\n"
+    "    int64_t cap = RUJO_MAP_GROUP;\n"
+    "    while (cap < need) cap *= 2;\n"
+    "    return (int)cap;\n"
+    "}\n";
+
+// Relógio (now_ns / cycles), keep e o harness de bench "nome" { ... }
+static const char* RUNTIME_BENCH =
+    "#include <time.h>\n"
+    "#if defined(__x86_64__) || defined(__i386__)\n"
+    "#include <x86intrin.h>\n"
+    "#endif\n"
+    "\n"
+    "static inline int64_t rujo_now_ns(void) {\n"
+    "    struct timespec ts;\n"
+    "    clock_gettime(CLOCK_MONOTONIC, &ts);\n"
+    "    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;\n"
+    "}\n"
+    "\n"
+    "// Contador de ciclos: TSC no x86, contador virtual no ARM64; sem nenhum dos dois, nanossegundos\n"
+    "static inline int64_t rujo_cycles(void) {\n"
+    "#if defined(__x86_64__) || defined(__i386__)\n"
+    "    return (int64_t)__rdtsc();\n"
+    "#elif defined(__aarch64__)\n"
+    "    int64_t v;\n"
+    "    __asm__ volatile(\"mrs %0, cntvct_el0\" : \"=r\"(v));\n"
+    "    return v;\n"
+    "#else\n"
+    "    return rujo_now_ns();\n"
+    "#endif\n"
+    "}\n"
+    "\n"
+    "// keep(x): o valor precisa existir (não é descartado como código morto).\n"
+    "// RUJO_LAUNDER(x): o compilador passa a não saber o valor de x (não tira\n"
+    "// do laço contas que dependem dele)\n"
+    "#define RUJO_KEEP(x) ({ __typeof__(x) _rj_keep = (x); __asm__ volatile(\"\" : : \"r,m\"(_rj_keep) : \"memory\"); })\n"
+    "#define RUJO_LAUNDER(x) __asm__ volatile(\"\" : \"+r,m\"(x) : : \"memory\")\n"
+    "\n"
+    "// bench \"nome\" { ... }: o lote dobra até uma amostra levar RUJO_BENCH_LOTE_NS\n"
+    "// e o aquecimento passar de 1/10 do orçamento; depois coleta amostras até\n"
+    "// RUJO_BENCH_MS (padrão 1000) com pelo menos RUJO_BENCH_MIN amostras\n"
+    "#define RUJO_BENCH_LOTE_NS 1000000\n"
+    "#define RUJO_BENCH_MIN 10\n"
+    "#define RUJO_BENCH_MAX 100000\n"
+    "\n"
+    "typedef struct {\n"
+    "    const char* name;\n"
+    "    int64_t batch;     // iterações por amostra\n"
+    "    int64_t start;     // início do aquecimento e depois das amostras\n"
+    "    int64_t budget;    // ns\n"
+    "    bool warm;\n"
+    "    double* samples;   // ns por iteração\n"
+    "    int count;\n"
+    "    int cap;\n"
+    "} RujoBench;\n"
+    "\n"
+    "typedef struct {\n"
+    "    char* name;\n"
+    "    double median, p99, min, mean;\n"
+    "    int samples;\n"
+    "    int64_t batch;\n"
+    "} RujoBenchResult;\n"
+    "\n"
+    "RUJO_GLOBAL RujoBenchResult* rujo_bench_results = NULL;\n"
+    "RUJO_GLOBAL int rujo_bench_result_count = 0;\n"
+    "\n"
+    "static void rujo_bench_begin(RujoBench* b, const char* name) {\n"
+    "    memset(b, 0, sizeof(*b));\n"
+    "    b->name = name;\n"
+    "    b->batch = 1;\n"
+    "    const char* ms = getenv(\"RUJO_BENCH_MS\");\n"
+    "    b->budget = (ms ? atoll(ms) : 1000) * 1000000;\n"
+    "    b->start = rujo_now_ns();\n"
+    "}\n"
+    "\n"
+    "static bool rujo_bench_next(RujoBench* b) {\n"
+    "    if (!b->warm || b->count < RUJO_BENCH_MIN) return true;\n"
+    "    return b->count < RUJO_BENCH_MAX && rujo_now_ns() - b->start < b->budget;\n"
+    "}\n"
+    "\n"
+    "static void rujo_bench_sample(RujoBench* b, int64_t ns) {\n"
+    "    if (!b->warm) {\n"
+    "        if (ns < RUJO_BENCH_LOTE_NS && b->batch < ((int64_t)1 << 40)) {\n"
+    "            b->batch *= 2;\n"
+    "            return;\n"
+    "        }\n"
+    "        // Lote definido: continua aquecendo (caches, preditor, frequência) sem medir\n"
+    "        if (rujo_now_ns() - b->start < b->budget / 10) return;\n"
+    "        b->warm = true;\n"
+    "        b->start = rujo_now_ns();\n"
+    "        return;\n"
+    "    }\n"
+    "    if (b->count == b->cap) {\n"
+    "        b->cap = b->cap ? b->cap * 2 : 64;\n"
+    "        b->samples = realloc(b->samples, (size_t)b->cap * sizeof(double));\n"
+    "    }\n"
+    "    b->samples[b->count++] = (double)ns / (double)b->batch;\n"
+    "}\n"
+    "\n"
+    "static int rujo_bench_cmp(const void* a, const void* b) {\n"
+    "    double x = *(const double*)a, y = *(const double*)b;\n"
+    "    return (x > y) - (x < y);\n"
+    "}\n"
+    "\n"
+    "// \"12.3 ns\", \"4.56 us\", ...\n"
+    "static int rujo_bench_fmt(char* buf, size_t n, double ns) {\n"
+    "    if (ns < 1e3) return snprintf(buf, n, \"%.2f ns\", ns);\n"
+    "    if (ns < 1e6) return snprintf(buf, n, \"%.2f us\", ns / 1e3);\n"
+    "    if (ns < 1e9) return snprintf(buf, n, \"%.2f ms\", ns / 1e6);\n"
+    "    return snprintf(buf, n, \"%.2f s\", ns / 1e9);\n"
+    "}\n"
+    "\n"
+    "static void rujo_bench_json_escape(FILE* f, const char* s) {\n"
+    "    for (; *s; s++) {\n"
+    "        unsigned char c = (unsigned char)*s;\n"
+    "        if (c == '\"' || c == '\\\\') fprintf(f, \"\\\\%c\", c);\n"
+    "        else if (c < 0x20) fprintf(f, \"\\\\u%04x\", c);\n"
+    "        else fputc(c, f);\n"
+    "    }\n"
+    "}\n"
+    "\n"
+    "// RUJO_BENCH_JSON=arquivo: todos os resultados num JSON na saída do programa\n"
+    "static void rujo_bench_write_json(void) {\n"
+    "    const char* path = getenv(\"RUJO_BENCH_JSON\");\n"
+    "    if (!path) return;\n"
+    "    FILE* f = fopen(path, \"w\");\n"
+    "    if (!f) {\n"
+    "        fprintf(stderr, \"bench: nao foi possivel escrever '%s'\\n\", path);\n"
+    "        return;\n"
+    "    }\n"
+    "    fprintf(f, \"{\\n  \\\"benchmarks\\\": [\");\n"
+    "    for (int i = 0; i < rujo_bench_result_count; i++) {\n"
+    "        RujoBenchResult* r = &rujo_bench_results[i];\n"
+    "        fprintf(f, \"%s\\n    {\\\"name\\\": \\\"\", i ? \",\" : \"\");\n"
+    "        rujo_bench_json_escape(f, r->name);\n"
+    "        fprintf(f, \"\\\", \\\"median_ns\\\": %.3f, \\\"p99_ns\\\": %.3f, \\\"min_ns\\\": %.3f, \\\"mean_ns\\\": %.3f, \"\n"
+    "                   \"\\\"samples\\\": %d, \\\"iters_per_sample\\\": %lld}\",\n"
+    "            r->median, r->p99, r->min, r->mean, r->samples, (long long)r->batch);\n"
+    "    }\n"
+    "    fprintf(f, \"\\n  ]\\n}\\n\");\n"
+    "    fclose(f);\n"
+    "}\n"
+    "\n"
+    "static void rujo_bench_end(RujoBench* b) {\n"
+    "    qsort(b->samples, (size_t)b->count, sizeof(double), rujo_bench_cmp);\n"
+    "    int n = b->count;\n"
+    "    double sum = 0;\n"
+    "    for (int i = 0; i < n; i++) sum += b->samples[i];\n"
+    "    RujoBenchResult r;\n"
+    "    r.name = strdup(b->name);\n"
+    "    r.median = n % 2 ? b->samples[n / 2] : (b->samples[n / 2 - 1] + b->samples[n / 2]) / 2;\n"
+    "    int p99 = (n * 99 + 99) / 100 - 1;\n"
+    "    r.p99 = b->samples[p99 < n ? p99 : n - 1];\n"
+    "    r.min = b->samples[0];\n"
+    "    r.mean = sum / n;\n"
+    "    r.samples = n;\n"
+    "    r.batch = b->batch;\n"
+    "    free(b->samples);\n"
+    "\n"
+    "    if (rujo_bench_result_count == 0) atexit(rujo_bench_write_json);\n"
+    "    rujo_bench_results = realloc(rujo_bench_results, (size_t)(rujo_bench_result_count + 1) * sizeof(r));\n"
+    "    rujo_bench_results[rujo_bench_result_count++] = r;\n"
+    "\n"
+    "    char med[32], p[32], mn[32], line[256];\n"
+    "    rujo_bench_fmt(med, sizeof(med), r.median);\n"
+    "    rujo_bench_fmt(p, sizeof(p), r.p99);\n"
+    "    rujo_bench_fmt(mn, sizeof(mn), r.min);\n"
+    "    int len = snprintf(line, sizeof(line), \"bench %-24s mediana %-11s p99 %-11s min %-11s (%d x %lld)\",\n"
+    "        r.name, med, p, mn, n, (long long)r.batch);\n"
+    "    if (len >= (int)sizeof(line)) len = sizeof(line) - 1;\n"
+    "    rujo_out_line(line, (size_t)len);\n"
+    "}\n";
+
+// Perfil de --instrument: sondas de entrada/saída por thread e relatório na saída
+static const char* RUNTIME_PROFILE =
+    "// --instrument: cada função (e com --instrument-loops cada laço) abre e fecha\n"
+    "// uma sonda. A sonda acha o nó (pai, site) da árvore de chamadas da thread e\n"
+    "// guarda o TSC da entrada; na saída soma o tempo ao nó e ao \"tempo em filhos\"\n"
+    "// do pai. Tudo é local da thread: nenhuma sonda toca memória compartilhada.\n"
+    "typedef struct {\n"
+    "    const char* name;\n"
+    "    const char* file;\n"
+    "    int line;\n"
+    "} RujoProfSite;\n"
+    "\n"
+    "typedef struct {\n"
+    "    int site;\n"
+    "    int parent;\n"
+    "    int child;       // primeiro filho\n"
+    "    int sibling;     // próximo irmão\n"
+    "    int64_t calls;\n"
+    "    int64_t total;   // ciclos\n"
+    "    int64_t inner;   // ciclos gastos nos filhos\n"
+    "} RujoProfNode;\n"
+    "\n"
+    "typedef struct {\n"
+    "    int node;\n"
+    "    bool rec;        // recursão direta: conta a chamada, o tempo fica no nó de fora\n"
+    "    int64_t start;\n"
+    "} RujoProfFrame;\n"
+    "\n"
+    "typedef struct RujoProfThread {\n"
+    "    RujoProfNode* nodes;   // nó 0: raiz da thread\n"
+    "    int count, cap;\n"
+    "    RujoProfFrame* stack;\n"
+    "    int depth, stack_cap;\n"
+    "    int id;\n"
+    "    struct RujoProfThread* next;\n"
+    "} RujoProfThread;\n"
+    "\n"
+    "RUJO_GLOBAL const RujoProfSite* rujo_prof_sites_tab = NULL;\n"
+    "RUJO_GLOBAL int rujo_prof_site_count = 0;\n"
+    "RUJO_GLOBAL RujoProfThread* rujo_prof_threads = NULL;\n"
+    "RUJO_GLOBAL int rujo_prof_thread_ids = 0;\n"
+    "RUJO_GLOBAL _Thread_local RujoProfThread* rujo_prof_self = NULL;\n"
+    "RUJO_GLOBAL int64_t rujo_prof_tsc0, rujo_prof_ns0;\n"
+    "\n"
+    "static RujoProfThread* rujo_prof_thread(void) {\n"
+    "    RujoProfThread* t = calloc(1, sizeof(RujoProfThread));\n"
+    "    t->cap = 64;\n"
+    "    t->nodes = malloc((size_t)t->cap * sizeof(RujoProfNode));\n"
+    "    t->nodes[0] = (RujoProfNode){ -1, -1, -1, -1, 0, 0, 0 };\n"
+    "    t->count = 1;\n"
+    "    t->stack_cap = 64;\n"
+    "    t->stack = malloc((size_t)t->stack_cap * sizeof(RujoProfFrame));\n"
+    "    t->id = __atomic_fetch_add(&rujo_prof_thread_ids, 1, __ATOMIC_RELAXED);\n"
+    "    t->next = __atomic_load_n(&rujo_prof_threads, __ATOMIC_RELAXED);\n"
+    "    while (!__atomic_compare_exchange_n(&rujo_prof_threads, &t->next, t, true, __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {}\n"
+    "    rujo_prof_self = t;\n"
+    "    return t;\n"
+    "}\n"
+    "\n"
+    "// Devolve a profundidade antes da entrada; rujo_prof_exit(d) fecha tudo que\n"
+    "// foi aberto depois dela (um return no meio de um laço não deixa sonda aberta)\n"
+    "static int rujo_prof_enter(int site) {\n"
+    "    RujoProfThread* t = rujo_prof_self;\n"
+    "    if (__builtin_expect(!t, 0)) t = rujo_prof_thread();\n"
+    "    int parent = t->depth ? t->stack[t->depth - 1].node : 0;\n"
+    "    bool rec = t->nodes[parent].site == site;\n"
+    "    int n = rec ? parent : t->nodes[parent].child;\n"
+    "    while (n >= 0 && t->nodes[n].site != site) n = t->nodes[n].sibling;\n"
+    "    if (__builtin_expect(n < 0, 0)) {\n"
+    "        if (t->count == t->cap) {\n"
+    "            t->cap *= 2;\n"
+    "            t->nodes = realloc(t->nodes, (size_t)t->cap * sizeof(RujoProfNode));\n"
+    "        }\n"
+    "        n = t->count++;\n"
+    "        t->nodes[n] = (RujoProfNode){ site, parent, -1, t->nodes[parent].child, 0, 0, 0 };\n"
+    "        t->nodes[parent].child = n;\n"
+    "    }\n"
+    "    if (__builtin_expect(t->depth == t->stack_cap, 0)) {\n"
+    "        t->stack_cap *= 2;\n"
+    "        t->stack = realloc(t->stack, (size_t)t->stack_cap * sizeof(RujoProfFrame));\n"
+    "    }\n"
+    "    int d = t->depth;\n"
+    "    t->stack[d].node = n;\n"
+    "    t->stack[d].rec = rec;\n"
+    "    t->stack[d].start = rujo_cycles();\n"
+    "    t->depth = d + 1;\n"
+    "    return d;\n"
+    "}\n"
+    "\n"
+    "static void rujo_prof_exit(int d) {\n"
+    "    int64_t now = rujo_cycles();\n"
+    "    RujoProfThread* t = rujo_prof_self;\n"
+    "    while (t->depth > d) {\n"
+    "        RujoProfFrame* f = &t->stack[--t->depth];\n"
+    "        RujoProfNode* n = &t->nodes[f->node];\n"
+    "        n->calls++;\n"
+    "        if (f->rec) continue;\n"
+    "        int64_t spent = now - f->start;\n"
+    "        n->total += spent;\n"
+    "        t->nodes[n->parent].inner += spent;\n"
+    "    }\n"
+    "}\n"
+    "\n"
+    "typedef struct {\n"
+    "    int64_t calls, total, self;\n"
+    "} RujoProfFlat;\n"
+    "\n"
+    "// A recursão direta já cai no mesmo nó; a indireta (a -> b -> a) põe o site\n"
+    "// dentro dele mesmo e o total só conta o nó mais externo\n"
+    "static bool rujo_prof_nested(RujoProfThread* t, int n) {\n"
+    "    int site = t->nodes[n].site;\n"
+    "    for (int p = t->nodes[n].parent; p > 0; p = t->nodes[p].parent) {\n"
+    "        if (t->nodes[p].site == site) return true;\n"
+    "    }\n"
+    "    return false;\n"
+    "}\n"
+    "\n"
+    "static double rujo_prof_ms(int64_t cycles, double ns_per_cycle) {\n"
+    "    return (double)cycles * ns_per_cycle / 1e6;\n"
+    "}\n"
+    "\n"
+    "static void rujo_prof_site_name(FILE* f, int site) {\n"
+    "    const RujoProfSite* s = &rujo_prof_sites_tab[site];\n"
+    "    if (s->line > 0) fprintf(f, \"%s (%s:%d)\", s->name, s->file, s->line);\n"
+    "    else fprintf(f, \"%s\", s->name);\n"
+    "}\n"
+    "\n"
+    "RUJO_GLOBAL RujoProfThread* rujo_prof_sorting = NULL;\n"
+    "\n"
+    "static int rujo_prof_by_total(const void* a, const void* b) {\n"
+    "    int64_t x = rujo_prof_sorting->nodes[*(const int*)a].total;\n"
+    "    int64_t y = rujo_prof_sorting->nodes[*(const int*)b].total;\n"
+    "    return (y > x) - (y < x);\n"
+    "}\n"
+    "\n"
+    "// Filhos do mais caro para o mais barato\n"
+    "static void rujo_prof_tree(FILE* f, RujoProfThread* t, int n, int depth, int64_t root, double k) {\n"
+    "    int count = 0;\n"
+    "    for (int c = t->nodes[n].child; c >= 0; c = t->nodes[c].sibling) count++;\n"
+    "    if (count == 0) return;\n"
+    "    int* kids = malloc((size_t)count * sizeof(int));\n"
+    "    count = 0;\n"
+    "    for (int c = t->nodes[n].child; c >= 0; c = t->nodes[c].sibling) kids[count++] = c;\n"
+    "    rujo_prof_sorting = t;\n"
+    "    qsort(kids, (size_t)count, sizeof(int), rujo_prof_by_total);\n"
+    "    for (int i = 0; i < count; i++) {\n"
+    "        int c = kids[i];\n"
+    "        RujoProfNode* x = &t->nodes[c];\n"
+    "        // Nós abaixo de 0,1% do tempo da thread só poluem a árvore\n"
+    "        if (x->total * 1000 < root) continue;\n"
+    "        fprintf(f, \"%6.1f%% %10.3f ms %10.3f ms %10lld  %*s\", 100.0 * (double)x->total / (double)root,\n"
+    "            rujo_prof_ms(x->total, k), rujo_prof_ms(x->total - x->inner, k), (long long)x->calls, depth * 2, \"\");\n"
+    "        rujo_prof_site_name(f, x->site);\n"
+    "        fprintf(f, \"\\n\");\n"
+    "        if (depth < 64) rujo_prof_tree(f, t, c, depth + 1, root, k);\n"
+    "        else if (x->child >= 0) fprintf(f, \"%*s...\\n\", 43 + depth * 2, \"\");\n"
+    "    }\n"
+    "    free(kids);\n"
+    "}\n"
+    "\n"
+    "static int rujo_prof_by_self(const void* a, const void* b) {\n"
+    "    const RujoProfFlat* x = *(const RujoProfFlat* const*)a;\n"
+    "    const RujoProfFlat* y = *(const RujoProfFlat* const*)b;\n"
+    "    return (y->self > x->self) - (y->self < x->self);\n"
+    "}\n"
+    "\n"
+    "// Perfil plano (por site, todas as threads) e árvore de chamadas por thread,\n"
+    "// em stderr ou no arquivo RUJO_PROFILE\n"
+    "static void rujo_prof_dump(void) {\n"
+    "    int64_t tsc1 = rujo_cycles(), ns1 = rujo_now_ns();\n"
+    "    double k = tsc1 > rujo_prof_tsc0 ? (double)(ns1 - rujo_prof_ns0) / (double)(tsc1 - rujo_prof_tsc0) : 1.0;\n"
+    "    if (rujo_prof_self) rujo_prof_exit(0);\n"
+    "\n"
+    "    const char* path = getenv(\"RUJO_PROFILE\");\n"
+    "    FILE* f = path ? fopen(path, \"w\") : stderr;\n"
+    "    if (!f) {\n"
+    "        fprintf(stderr, \"profile: nao foi possivel escrever '%s'\\n\", path);\n"
+    "        return;\n"
+    "    }\n"
+    "    rujo_out_flush();\n"
+    "\n"
+    "    RujoProfFlat* flat = calloc((size_t)rujo_prof_site_count, sizeof(RujoProfFlat));\n"
+    "    int64_t all = 0;\n"
+    "    for (RujoProfThread* t = rujo_prof_threads; t; t = t->next) {\n"
+    "        for (int n = 1; n < t->count; n++) {\n"
+    "            RujoProfNode* x = &t->nodes[n];\n"
+    "            RujoProfFlat* s = &flat[x->site];\n"
+    "            s->calls += x->calls;\n"
+    "            s->self += x->total - x->inner;\n"
+    "            if (!rujo_prof_nested(t, n)) s->total += x->total;\n"
+    "            if (x->parent == 0) all += x->total;\n"
+    "        }\n"
+    "    }\n"
+    "    if (all == 0) all = 1;\n"
+    "\n"
+    "    RujoProfFlat** order = malloc((size_t)rujo_prof_site_count * sizeof(RujoProfFlat*));\n"
+    "    for (int i = 0; i < rujo_prof_site_count; i++) order[i] = &flat[i];\n"
+    "    qsort(order, (size_t)rujo_prof_site_count, sizeof(RujoProfFlat*), rujo_prof_by_self);\n"
+    "\n"
+    "    fprintf(f, \"\\n== perfil plano (todas as threads) ==\\n\");\n"
+    "    fprintf(f, \"%7s %13s %13s %10s  %s\\n\", \"self%\", \"self\", \"total\", \"chamadas\", \"site\");\n"
+    "    for (int i = 0; i < rujo_prof_site_count; i++) {\n"
+    "        RujoProfFlat* s = order[i];\n"
+    "        if (s->calls == 0) continue;\n"
+    "        fprintf(f, \"%6.1f%% %10.3f ms %10.3f ms %10lld  \", 100.0 * (double)s->self / (double)all,\n"
+    "            rujo_prof_ms(s->self, k), rujo_prof_ms(s->total, k), (long long)s->calls);\n"
+    "        rujo_prof_site_name(f, (int)(s - flat));\n"
+    "        fprintf(f, \"\\n\");\n"
+    "    }\n"
+    "\n"
+    "    for (int id = 0; id < rujo_prof_thread_ids; id++) {\n"
+    "        RujoProfThread* t = rujo_prof_threads;\n"
+    "        while (t->id != id) t = t->next;\n"
+    "        int64_t root = 0;\n"
+    "        for (int c = t->nodes[0].child; c >= 0; c = t->nodes[c].sibling) root += t->nodes[c].total;\n"
+    "        if (root == 0) continue;\n"
+    "        fprintf(f, \"\\n== arvore de chamadas (thread %d) ==\\n\", t->id);\n"
+    "        fprintf(f, \"%7s %13s %13s %10s  %s\\n\", \"total%\", \"total\", \"self\", \"chamadas\", \"site\");\n"
+    "        rujo_prof_tree(f, t, 0, 0, root, k);\n"
+    "    }\n"
+    "    if (f != stderr) fclose(f);\n"
+    "    free(order);\n"
+    "    free(flat);\n"
+    "}\n"
+    "\n"
+    "static void rujo_prof_init(const RujoProfSite* sites, int n) {\n"
+    "    rujo_prof_sites_tab = sites;\n"
+    "    rujo_prof_site_count = n;\n"
+    "    rujo_prof_tsc0 = rujo_cycles();\n"
+    "    rujo_prof_ns0 = rujo_now_ns();\n"
+    "    atexit(rujo_prof_dump);\n"
+    "}\n";
+
+void runtime_emit_tasks(FILE* out) {
+    fputs(RUNTIME_TASKS, out);
+    fputs("\n", out);
+}
+
+void runtime_emit_channels(FILE* out) {
+    fputs(RUNTIME_CHANNELS, out);
+    fputs("\n", out);
+}
+
+void runtime_emit_io(FILE* out) {
+    fputs(RUNTIME_IO, out);
+    fputs("\n", out);
+}
+
+void runtime_emit_print(FILE* out) {
+    fputs(RUNTIME_PRINT, out);
+    fputs("\n", out);
+}
+
+void runtime_emit_files(FILE* out) {
+    fputs(RUNTIME_FILES, out);
+    fputs("\n", out);
+}
+
+void runtime_emit_map(FILE* out) {
+    fputs(RUNTIME_MAP, out);
+    fputs("\n", out);
+}
+
+void runtime_emit_bench(FILE* out) {
+    fputs(RUNTIME_BENCH, out);
+    fputs("\n", out);
+}
+
+void runtime_emit_profile(FILE* out) {
+    fputs(RUNTIME_PROFILE, out);
+    fputs("\n", out);
+}
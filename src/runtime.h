@@ -0,0 +1,38 @@
+#ifndef RUJO_RUNTIME_H
+#define RUJO_RUNTIME_H
+
+#include <stdio.h>
+
+// Trechos do runtime emitidos no out.c pelo codegen
+
+// Pool de tarefas (spawn / Task<T>): RujoTask, rujo_spawn, rujo_task_join, rujo_task_done
+// e laços @parallel: rujo_parallel_chunks, rujo_parallel_for
+void runtime_emit_tasks(FILE* out);
+
+// Canais (Channel<T> / SpscChannel<T>): RujoChan e rujo_chan_*. Depende do runtime de tarefas.
+void runtime_emit_channels(FILE* out);
+
+// I/O assíncrono (async fn / await / io_run): RujoIoTask e rujo_io_*, sobre io_uring ou epoll
+void runtime_emit_io(FILE* out);
+
+// Arquivos (File.map / File.lines / File.create / File.append): rujo_file_map_raw,
+// rujo_lines_*, FileWriter e seus métodos. Depende dos helpers de array.
+void runtime_emit_files(FILE* out);
+
+// Map<K, V>: controle em grupos de 16 (rujo_map_match*), rujo_hash_* e rujo_map_capacity.
+// As funções de cada instância são geradas pelo codegen.
+void runtime_emit_map(FILE* out);
+
+// Saída de print()/flush(): print_int, print_long, print_float, print_string, print_bool, rujo_out_flush.
+// Com RUJO_OUT_THREADS definido o buffer é protegido para várias threads.
+void runtime_emit_print(FILE* out);
+
+// Relógio e bench: rujo_now_ns, rujo_cycles, RUJO_KEEP/RUJO_LAUNDER e o harness
+// (RujoBench, rujo_bench_*) com estatísticas e JSON. Depende do runtime de print.
+void runtime_emit_bench(FILE* out);
+
+// Perfil de --instrument: RujoProfSite, rujo_prof_enter/rujo_prof_exit e o
+// relatório plano + árvore de chamadas na saída. Depende do runtime de bench (relógio).
+void runtime_emit_profile(FILE* out);
+
+#endif
@@ -1,82 +1,1625 @@
 #include "semantic.h"
 #include "symbol_table.h"
+#include "utils.h"
+#include "types.h"
+#include "module.h"
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <limits.h>
 
 static int error_count = 0;
 
+// Genéricos: instâncias são verificadas no escopo global, onde o genérico foi declarado
+static Scope* global_scope = NULL;
+static ASTNode* instances = NULL;
+static ASTNode* instances_tail = NULL;
+static int instance_count = 0;
+
+#define MAX_INSTANCES 4096
+
+// Result<T, E>: tipo de retorno da função atual (alvo do ?) e tipo esperado
+// pelo contexto, usado para tipar Ok(...) / Err(...)
+static char* current_fn_return = NULL;
+static char* expected_type = NULL;
+
+// Gerador sendo verificado: tipo dos itens de yield e variáveis do frame
+// (nome -> tipo; um nome só pode ter um tipo, porque vira um campo do frame)
+static char* current_gen_elem = NULL;
+static ASTNode* gen_locals = NULL;
+
+// async fn sendo verificada: tipo do resultado (void incluso) e o único await
+// permitido agora (valor inteiro de declaração, atribuição ou return)
+static char* current_async_ret = NULL;
+static ASTNode* await_slot = NULL;
+
+// Runtimes incluídos no out.c: tarefas (spawn, @parallel, canais), canais e I/O
+static bool uses_tasks = false;
+static bool uses_channels = false;
+static bool uses_maps = false;
+static bool uses_clock = false;
+// bench em verificação: escopo de fora e o nó (coleta as variáveis de fora lidas no corpo)
+static Scope* bench_outer = NULL;
+static ASTNode* bench_node = NULL;
+static bool uses_io = false;
+static bool uses_files = false;
+static bool file_results = false; // Result de File.* já instanciados
+
 void sem_error(char* msg, char* detail) {
     printf("[Erro Semantico] %s: %s\n", msg, detail);
     error_count++;
 }
 
-void check_node(ASTNode* node, Scope* scope);
+// Módulo do item de nível superior em verificação (0 sem módulos)
+static int current_module = 0;
+
+// Uma fn ou class de outro módulo precisa ser pub e o módulo dela importado
+// (instâncias dos genéricos da biblioteca padrão, módulo 0, veem tudo)
+void check_visible(ASTNode* decl) {
+    int owner = decl ? module_of(decl) : 0;
+    if (!owner || !current_module || owner == current_module) return;
+    bool is_pub = decl->type == AST_FN_DECL ? decl->data.fn_decl.is_pub : decl->data.class_decl.is_pub;
+    const char* name = decl->type == AST_FN_DECL ? decl->data.fn_decl.name : decl->data.class_decl.name;
+    char detail[512];
+    snprintf(detail, sizeof(detail), "%s.%s", module_name(owner), name);
+    if (!module_imports(current_module, owner)) sem_error("Modulo nao importado", detail);
+    else if (!is_pub) sem_error("Item nao exportado pelo modulo (falta pub)", detail);
+}
+
+void check_node(ASTNode* node, Scope* scope);
+void use_files(void);
+
+typedef struct {
+    ASTNode* params;
+    ASTNode* args;
+} SubstCtx;
+
+char* subst_mapper(const char* type_name, void* ctx) {
+    SubstCtx* c = (SubstCtx*)ctx;
+    return type_substitute(type_name, c->params, c->args);
+}
+
+// "maior" + <int,float> -> "maior<int,float>"
+char* instance_name(const char* base, ASTNode* args) {
+    size_t len = strlen(base) + 3;
+    for (ASTNode* a = args; a; a = a->next) len += strlen(a->data.ident.name) + 1;
+    char* name = (char*)malloc(len);
+    strcpy(name, base);
+    strcat(name, "<");
+    for (ASTNode* a = args; a; a = a->next) {
+        strcat(name, a->data.ident.name);
+        if (a->next) strcat(name, ",");
+    }
+    strcat(name, ">");
+    return name;
+}
+
+int list_length(ASTNode* node) {
+    int n = 0;
+    while (node) { n++; node = node->next; }
+    return n;
+}
+
+// Clona a declaração genérica com os tipos concretos e a verifica no escopo global
+ASTNode* instantiate(ASTNode* generic, ASTNode* type_params, ASTNode* args, char* name) {
+    if (++instance_count > MAX_INSTANCES) {
+        sem_error("Instanciacao generica infinita", name);
+        return NULL;
+    }
+
+    // A instância vale até o fim do programa: no --stream o item que a pediu é
+    // liberado logo depois de gerado, então ela não entra na região dele
+    Region* item_region = region_activate(NULL);
+    name = rujo_strdup(name);
+
+    SubstCtx ctx = { type_params, args };
+    ASTNode* saved_next = generic->next;
+    generic->next = NULL;
+    ASTNode* inst = ast_clone(generic, subst_mapper, &ctx);
+    generic->next = saved_next;
+
+    if (inst->type == AST_CLASS_DECL) {
+        inst->data.class_decl.name = name;
+        inst->data.class_decl.type_params = NULL;
+    } else {
+        inst->data.fn_decl.name = name;
+        inst->data.fn_decl.type_params = NULL;
+    }
+
+    if (!instances) instances = inst;
+    else instances_tail->next = inst;
+    instances_tail = inst;
+
+    // O corpo da instância vê o que o módulo do genérico vê
+    char* saved_expected = expected_type;
+    char* saved_return = current_fn_return;
+    int saved_module = current_module;
+    expected_type = NULL;
+    current_fn_return = NULL;
+    current_module = module_of(generic);
+    check_node(inst, global_scope);
+    expected_type = saved_expected;
+    current_fn_return = saved_return;
+    current_module = saved_module;
+    region_activate(item_region);
+    return inst;
+}
+
+// Garante que cada tipo genérico concreto usado ("List<int>") tem sua instância
+void resolve_type(const char* type_name) {
+    if (!type_name || !global_scope) return;
+    if (type_is_file_writer(type_name)) use_files();
+
+    char* elem = type_array_elem(type_name);
+    if (elem) {
+        resolve_type(elem);
+        return;
+    }
+
+    int count = type_arg_count(type_name);
+    if (count == 0) return;
+
+    ASTNode* args = NULL;
+    ASTNode* last = NULL;
+    for (int i = 0; i < count; i++) {
+        char* arg = type_arg(type_name, i);
+        resolve_type(arg);
+        ASTNode* a = ast_new_ident(arg);
+        if (!args) args = a;
+        else last->next = a;
+        last = a;
+    }
+
+    Symbol* done = scope_resolve(global_scope, (char*)type_name);
+    if (done) { // já instanciado
+        check_visible(done->decl);
+        return;
+    }
+
+    char* base = type_base(type_name);
+    Symbol* generic = scope_resolve(global_scope, base);
+    if (!generic || generic->kind != SYM_CLASS || !generic->decl || !generic->decl->data.class_decl.type_params) {
+        sem_error("Tipo generico desconhecido", (char*)type_name);
+        return;
+    }
+    check_visible(generic->decl);
+    ASTNode* params = generic->decl->data.class_decl.type_params;
+    if (list_length(params) != count) {
+        sem_error("Numero errado de argumentos de tipo", (char*)type_name);
+        return;
+    }
+    if (strcmp(base, "Result") == 0 && strcmp(args->data.ident.name, "void") == 0) {
+        sem_error("Result<void, E> nao e suportado", (char*)type_name);
+        return;
+    }
+    if (type_is_channel(type_name)) {
+        if (strcmp(args->data.ident.name, "void") == 0) {
+            sem_error("Canal de void nao e suportado", (char*)type_name);
+            return;
+        }
+        // recv() devolve Result<T, string> e recv_batch() uma List<T>
+        char* list = (char*)malloc(strlen(args->data.ident.name) + 7);
+        sprintf(list, "List<%s>", args->data.ident.name);
+        resolve_type(list);
+        char* result = (char*)malloc(strlen(args->data.ident.name) + 16);
+        sprintf(result, "Result<%s,string>", args->data.ident.name);
+        resolve_type(result);
+        uses_tasks = true;
+        uses_channels = true;
+    }
+    if (type_is_map(type_name)) {
+        const char* k = args->data.ident.name;
+        const char* v = args->next->data.ident.name;
+        if (strcmp(k, "int") != 0 && strcmp(k, "byte") != 0 && strcmp(k, "char") != 0 &&
+            strcmp(k, "bool") != 0 && strcmp(k, "string") != 0) {
+            sem_error("Chave de Map deve ser int, byte, char, bool ou string", (char*)type_name);
+            return;
+        }
+        if (strcmp(v, "void") == 0) {
+            sem_error("Map de void nao e suportado", (char*)type_name);
+            return;
+        }
+        // get() devolve Result<V, string>; set_batch() recebe List<K> e List<V>
+        char* result = (char*)malloc(strlen(v) + 16);
+        sprintf(result, "Result<%s,string>", v);
+        resolve_type(result);
+        char* klist = (char*)malloc(strlen(k) + 7);
+        sprintf(klist, "List<%s>", k);
+        resolve_type(klist);
+        char* vlist = (char*)malloc(strlen(v) + 7);
+        sprintf(vlist, "List<%s>", v);
+        resolve_type(vlist);
+        uses_maps = true;
+    }
+    if (type_is_async(type_name)) uses_io = true;
+    if (type_is_gen(type_name) && strcmp(args->data.ident.name, "void") == 0) {
+        sem_error("Gerador de void nao e suportado", (char*)type_name);
+        return;
+    }
+
+    instantiate(generic->decl, params, args, rujo_strdup(type_name));
+}
+
+// Infere o valor dos parâmetros de tipo casando o tipo declarado com o real
+void unify(const char* pattern, const char* actual, ASTNode* params, char** bindings) {
+    if (!pattern || !actual) return;
+
+    int i = 0;
+    for (ASTNode* p = params; p; p = p->next, i++) {
+        if (strcmp(p->data.ident.name, pattern) == 0) {
+            if (!bindings[i]) bindings[i] = (char*)actual;
+            return;
+        }
+    }
+
+    char* pe = type_array_elem(pattern);
+    char* ae = type_array_elem(actual);
+    if (pe && ae) {
+        unify(pe, ae, params, bindings);
+        return;
+    }
+
+    int count = type_arg_count(pattern);
+    if (count > 0 && count == type_arg_count(actual) &&
+        strcmp(type_base(pattern), type_base(actual)) == 0) {
+        for (int k = 0; k < count; k++) {
+            unify(type_arg(pattern, k), type_arg(actual, k), params, bindings);
+        }
+    }
+}
+
+// Chamada a função genérica: resolve os argumentos de tipo e aponta para a instância
+void check_generic_call(ASTNode* node, ASTNode* generic) {
+    ASTNode* params = generic->data.fn_decl.type_params;
+    ASTNode* args = node->data.call.type_args;
+    int count = list_length(params);
+
+    if (!args) {
+        char* bindings[64] = { 0 };
+        if (count > 64) count = 64;
+        ASTNode* fp = generic->data.fn_decl.params;
+        ASTNode* arg = node->data.call.args;
+        while (fp && arg) {
+            unify(fp->data.var_decl.type_name, arg->eval_type, params, bindings);
+            fp = fp->next;
+            arg = arg->next;
+        }
+        ASTNode* last = NULL;
+        for (int i = 0; i < count; i++) {
+            if (!bindings[i]) {
+                sem_error("Nao foi possivel inferir os tipos da chamada generica", node->data.call.name);
+                return;
+            }
+            ASTNode* a = ast_new_ident(bindings[i]);
+            if (!args) args = a;
+            else last->next = a;
+            last = a;
+        }
+        node->data.call.type_args = args;
+    } else if (list_length(args) != count) {
+        sem_error("Numero errado de argumentos de tipo", node->data.call.name);
+        return;
+    }
+
+    for (ASTNode* a = args; a; a = a->next) resolve_type(a->data.ident.name);
+
+    char* name = instance_name(node->data.call.name, args);
+    Symbol* inst = scope_resolve(global_scope, name);
+    if (!inst) {
+        instantiate(generic, params, args, name);
+        inst = scope_resolve(global_scope, name);
+    }
+    node->data.call.name = name;
+    if (inst) node->eval_type = inst->type_name;
+}
+
+// List<T> da biblioteca padrão: vetor contíguo que cresce sob demanda
+ASTNode* builtin_list_decl(void) {
+    ASTNode* props = ast_new_prop_decl("data", "T[]");
+    props->next = ast_new_prop_decl("len", "int");
+    props->next->next = ast_new_prop_decl("cap", "int");
+    ASTNode* cls = ast_new_class_decl("List", props);
+    cls->data.class_decl.type_params = ast_new_ident("T");
+    return cls;
+}
+
+// Map<K, V>: tabela hash (Swiss table); o bloco ctrl/keys/vals é alocado junto
+ASTNode* builtin_map_decl(void) {
+    ASTNode* props = ast_new_prop_decl("ctrl", "byte[]");
+    ASTNode* last = props;
+    last = last->next = ast_new_prop_decl("keys", "K[]");
+    last = last->next = ast_new_prop_decl("vals", "V[]");
+    last = last->next = ast_new_prop_decl("len", "int");
+    last = last->next = ast_new_prop_decl("cap", "int");
+    last->next = ast_new_prop_decl("left", "int");
+    ASTNode* cls = ast_new_class_decl("Map", props);
+    cls->data.class_decl.type_params = ast_new_ident("K");
+    cls->data.class_decl.type_params->next = ast_new_ident("V");
+    return cls;
+}
+
+char* map_method_type(const char* map_type, const char* method) {
+    char* v = type_arg(map_type, 1);
+    if (strcmp(method, "set") == 0 || strcmp(method, "reserve") == 0 ||
+        strcmp(method, "clear") == 0 || strcmp(method, "set_batch") == 0) return "void";
+    if (strcmp(method, "has") == 0 || strcmp(method, "remove") == 0) return "bool";
+    if (strcmp(method, "len") == 0) return "int";
+    if (strcmp(method, "get_or") == 0) return v;
+    if (strcmp(method, "get") == 0) {
+        char* r = (char*)malloc(strlen(v) + 16);
+        sprintf(r, "Result<%s,string>", v);
+        return r;
+    }
+    return NULL;
+}
+
+// Result<T, E>: ok/erro como valor, sem exceções
+ASTNode* builtin_result_decl(void) {
+    ASTNode* props = ast_new_prop_decl("value", "T");
+    props->next = ast_new_prop_decl("error", "E");
+    props->next->next = ast_new_prop_decl("is_ok", "bool");
+    ASTNode* cls = ast_new_class_decl("Result", props);
+    cls->data.class_decl.type_params = ast_new_ident("T");
+    cls->data.class_decl.type_params->next = ast_new_ident("E");
+    return cls;
+}
+
+// Task<T>: handle de uma tarefa criada com spawn
+ASTNode* builtin_task_decl(void) {
+    ASTNode* cls = ast_new_class_decl("Task", ast_new_prop_decl("result", "T"));
+    cls->data.class_decl.type_params = ast_new_ident("T");
+    return cls;
+}
+
+char* task_method_type(const char* task_type, const char* method) {
+    if (strcmp(method, "join") == 0) return type_arg(task_type, 0);
+    if (strcmp(method, "done") == 0) return "bool";
+    return NULL;
+}
+
+// Channel<T> / SpscChannel<T>: fila limitada entre tarefas
+ASTNode* builtin_channel_decl(char* name) {
+    ASTNode* cls = ast_new_class_decl(name, NULL);
+    cls->data.class_decl.type_params = ast_new_ident("T");
+    return cls;
+}
+
+char* channel_method_type(const char* chan_type, const char* method) {
+    char* t = type_arg(chan_type, 0);
+    if (strcmp(method, "send") == 0 || strcmp(method, "send_batch") == 0 ||
+        strcmp(method, "close") == 0) return "void";
+    if (strcmp(method, "try_send") == 0) return "bool";
+    if (strcmp(method, "len") == 0) return "int";
+    if (strcmp(method, "recv") == 0 || strcmp(method, "try_recv") == 0) {
+        char* r = (char*)malloc(strlen(t) + 16);
+        sprintf(r, "Result<%s,string>", t);
+        return r;
+    }
+    if (strcmp(method, "recv_batch") == 0) {
+        char* l = (char*)malloc(strlen(t) + 7);
+        sprintf(l, "List<%s>", t);
+        return l;
+    }
+    return NULL;
+}
+
+// Gen<T>: gerador (função com yield) compilado para uma máquina de estados
+ASTNode* builtin_gen_decl(void) {
+    ASTNode* cls = ast_new_class_decl("Gen", NULL);
+    cls->data.class_decl.type_params = ast_new_ident("T");
+    return cls;
+}
+
+// Async<T>: resultado de uma async fn; await o executa no laço de I/O
+ASTNode* builtin_async_decl(void) {
+    ASTNode* cls = ast_new_class_decl("Async", NULL);
+    cls->data.class_decl.type_params = ast_new_ident("T");
+    return cls;
+}
+
+// Builtins de I/O. Os assíncronos só existem como alvo de await; todos viram
+// chamadas ao runtime (rujo_io_*), que roda sobre io_uring ou epoll
+typedef struct {
+    const char* name;
+    const char* c_name;
+    const char* args[3];
+    int argc;
+    const char* ret;
+    bool async;
+} IoBuiltin;
+
+static const IoBuiltin io_builtins[] = {
+    { "tcp_listen",  "rujo_tcp_listen",  { "int" },                   1, "int",  false },
+    { "file_open",   "rujo_file_open",   { "string", "string" },      2, "int",  false },
+    { "close",       "rujo_io_close",    { "int" },                   1, "void", false },
+    { "accept",      "rujo_io_accept",   { "int" },                   1, "int",  true },
+    { "read",        "rujo_io_read",     { "int", "byte[]" },         2, "int",  true },
+    { "write",       "rujo_io_write",    { "int", "byte[]", "int" },  3, "int",  true },
+    { "tcp_connect", "rujo_io_connect",  { "string", "int" },         2, "int",  true },
+    { "sleep_ms",    "rujo_io_sleep",    { "int" },                   1, "void", true },
+};
+
+const IoBuiltin* find_io_builtin(const char* name) {
+    for (size_t i = 0; i < sizeof(io_builtins) / sizeof(io_builtins[0]); i++) {
+        if (strcmp(io_builtins[i].name, name) == 0) return &io_builtins[i];
+    }
+    return NULL;
+}
+
+// Confere os argumentos e troca o nome pela função do runtime
+void check_builtin_call(ASTNode* call, const IoBuiltin* io, Scope* scope) {
+    if (list_length(call->data.call.args) != io->argc) {
+        sem_error("Numero de argumentos errado", call->data.call.name);
+    }
+    int i = 0;
+    for (ASTNode* arg = call->data.call.args; arg; arg = arg->next, i++) {
+        check_node(arg, scope);
+        if (i < io->argc && arg->eval_type && strcmp(arg->eval_type, io->args[i]) != 0) {
+            sem_error("Tipo de argumento incompativel", arg->eval_type);
+        }
+    }
+    call->eval_type = (char*)io->ret;
+    call->data.call.name = (char*)io->c_name;
+}
+
+void check_io_call(ASTNode* call, const IoBuiltin* io, Scope* scope) {
+    uses_io = true;
+    check_builtin_call(call, io, scope);
+}
+
+// File.map / File.lines / File.create / File.append: funções do runtime de arquivos
+static const IoBuiltin file_builtins[] = {
+    { "map",    "rujo_file_map",    { "string" }, 1, "Result<byte[],string>",      false },
+    { "lines",  "rujo_file_lines",  { "string" }, 1, "Result<Gen<string>,string>", false },
+    { "create", "rujo_file_create", { "string" }, 1, "Result<FileWriter,string>",  false },
+    { "append", "rujo_file_append", { "string" }, 1, "Result<FileWriter,string>",  false },
+};
+
+// Todos os tipos de resultado são instanciados juntos: o codegen emite as
+// quatro funções de uma vez
+void use_files(void) {
+    uses_files = true;
+    if (file_results) return;
+    file_results = true;
+    for (size_t i = 0; i < sizeof(file_builtins) / sizeof(file_builtins[0]); i++) {
+        resolve_type(file_builtins[i].ret);
+    }
+}
+
+// File.x(...) vira a chamada AST_CALL correspondente
+void check_file_call(ASTNode* node, Scope* scope) {
+    const IoBuiltin* f = NULL;
+    for (size_t i = 0; i < sizeof(file_builtins) / sizeof(file_builtins[0]); i++) {
+        if (strcmp(file_builtins[i].name, node->data.method_call.name) == 0) f = &file_builtins[i];
+    }
+    if (!f) {
+        sem_error("Metodo inexistente em File", node->data.method_call.name);
+        return;
+    }
+    use_files();
+    ASTNode* args = node->data.method_call.args;
+    node->type = AST_CALL;
+    node->data.call.name = node->data.method_call.name;
+    node->data.call.args = args;
+    node->data.call.type_args = NULL;
+    check_builtin_call(node, f, scope);
+}
+
+// FileWriter: escrita com buffer num arquivo aberto por File.create/File.append
+char* file_writer_method_type(const char* method) {
+    if (strcmp(method, "write") == 0 || strcmp(method, "write_line") == 0 ||
+        strcmp(method, "write_bytes") == 0 || strcmp(method, "flush") == 0) return "void";
+    return NULL;
+}
+
+// Cada variável do gerador vira um campo do frame. Declarações do mesmo nome
+// em blocos irmãos dividem o campo; uma que esconde outra ainda visível em
+// outer (o escopo de fora do que a declara), ou que muda o tipo, ganha um
+// campo próprio, e ela e os usos dela saem no C com o nome dele (c_name)
+static int gen_renames = 0;
+
+void gen_local(Scope* outer, Symbol* sym, const char* type_name) {
+    if (!sym || (!current_gen_elem && !current_async_ret)) return;
+    char* name = sym->name;
+    for (ASTNode* v = gen_locals; v; v = v->next) {
+        if (strcmp(v->data.ident.name, name) != 0) continue;
+        if (strcmp(v->eval_type, type_name) == 0 && !scope_resolve(outer, name)) return;
+        name = (char*)region_alloc(strlen(sym->name) + 24);
+        sprintf(name, "_rj_%s_%d", sym->name, ++gen_renames);
+        sym->c_name = name;
+        break;
+    }
+    ASTNode* v = ast_new_ident(name);
+    v->eval_type = (char*)type_name;
+    v->next = gen_locals;
+    gen_locals = v;
+}
+
+// Nome da variável no C
+static char* sym_c_name(Symbol* sym) {
+    return sym->c_name ? sym->c_name : sym->name;
+}
+
+char* result_method_type(const char* result_type, const char* method) {
+    if (strcmp(method, "is_ok") == 0 || strcmp(method, "is_err") == 0) return "bool";
+    if (strcmp(method, "unwrap") == 0 || strcmp(method, "unwrap_or") == 0) return type_arg(result_type, 0);
+    if (strcmp(method, "error") == 0) return type_arg(result_type, 1);
+    return NULL;
+}
+
+// Chamadas cujo Result é descartado: o erro precisa ser tratado
+void check_unused_result(ASTNode* stmt) {
+    if ((stmt->type == AST_CALL || stmt->type == AST_METHOD_CALL) && type_is_result(stmt->eval_type)) {
+        sem_error("Result ignorado (trate o erro ou use ?)", stmt->eval_type);
+    }
+}
+
+// Métodos embutidos de List<T>: retorna o tipo de retorno (NULL se não existir)
+char* list_method_type(const char* list_type, const char* method) {
+    if (strcmp(method, "push") == 0 || strcmp(method, "set") == 0 ||
+        strcmp(method, "reserve") == 0 || strcmp(method, "clear") == 0) return "void";
+    if (strcmp(method, "pop") == 0 || strcmp(method, "get") == 0) return type_arg(list_type, 0);
+    if (strcmp(method, "len") == 0) return "int";
+    return NULL;
+}
+
+// --- OWNERSHIP ---
+// Tipos com heap (arrays, List<T> e classes que os contêm) têm semântica de
+// valor: atribuir ou passar adiante copia. O checker acompanha os usos de cada
+// variável; o último uso em posição de move, sem if/laço entre ele e a
+// declaração, vira move (sem cópia). O que não foi movido é liberado ao sair
+// do escopo ou no return. Parâmetros &T são empréstimos: nunca movidos nem liberados.
+
+typedef struct OwnedVar {
+    char* name;
+    char* type_name;
+    int ctrl_depth;        // if/while/for abertos na declaração
+    int region_depth;      // blocos arena abertos na declaração
+    bool borrowed;
+    ASTNode* last_use;
+    int last_use_depth;
+    int last_use_seq;
+    bool last_use_movable;
+    bool moved;
+    int move_seq;
+} OwnedVar;
+
+typedef struct PendingReturn {
+    ASTNode* ret;
+    int seq;
+    OwnedVar** live;
+    int live_count;
+    struct PendingReturn* next;
+} PendingReturn;
+
+static OwnedVar** owned_stack = NULL;
+static int owned_top = 0;
+static int owned_cap = 0;
+static int fn_owned_base = 0;
+static int ctrl_depth = 0;
+static int region_depth = 0;
+static int lines_depth = 0; // Laços sobre linhas de File.lines abertos
+static int use_seq = 0;
+static OwnedVar* last_ident_owned = NULL;
+static PendingReturn* pending_returns = NULL;
+static ASTNode* owned_types = NULL;
+
+// Lugares do tipo Task<T> passados adiante: só podem ser movidos
+typedef struct TaskCopy { ASTNode* node; struct TaskCopy* next; } TaskCopy;
+static TaskCopy* task_copies = NULL;
+static int task_copy_count = 0;
+
+void register_owned_type(const char* type_name) {
+    for (ASTNode* t = owned_types; t; t = t->next) {
+        if (strcmp(t->data.ident.name, type_name) == 0) return;
+    }
+    Region* item_region = region_activate(NULL);
+    ASTNode* t = ast_new_ident((char*)type_name);
+    region_activate(item_region);
+    t->next = owned_types;
+    owned_types = t;
+}
+
+int is_owned_type(const char* type_name) {
+    static int depth = 0;
+    if (!type_name || !global_scope) return 0;
+
+    // Result<T, E>: tem heap se alguma das variantes tiver
+    if (type_is_result(type_name)) {
+        int ok = is_owned_type(type_arg(type_name, 0));
+        int err = is_owned_type(type_arg(type_name, 1));
+        if (ok || err) register_owned_type(type_name);
+        return ok || err;
+    }
+
+    // Task<T>: liberar o handle espera a tarefa terminar
+    // Channel<T>: cada cópia é uma referência; a última libera os itens restantes
+    // Gen<T> / Async<T>: liberar o frame libera o que a função suspensa ainda segurava
+    // FileWriter: liberar escreve o que falta e fecha o arquivo
+    if (type_is_file_writer(type_name)) {
+        register_owned_type(type_name);
+        return 1;
+    }
+    if (type_is_task(type_name) || type_is_channel(type_name) || type_is_gen(type_name) ||
+        type_is_async(type_name)) {
+        is_owned_type(type_arg(type_name, 0));
+        register_owned_type(type_name);
+        return 1;
+    }
+
+    char* elem = type_array_elem(type_name);
+    if (elem || type_is_list(type_name)) {
+        is_owned_type(elem ? elem : type_arg(type_name, 0));
+        register_owned_type(type_name);
+        return 1;
+    }
+    if (type_is_map(type_name)) {
+        is_owned_type(type_arg(type_name, 1));
+        register_owned_type(type_name);
+        return 1;
+    }
+
+    Symbol* cls = scope_resolve(global_scope, (char*)type_name);
+    if (!cls || cls->kind != SYM_CLASS || !cls->members || depth > 32) return 0;
+    // Calculado uma vez por classe: percorrer as props a cada consulta é quadrático
+    if (cls->owned_memo) return cls->owned_memo > 0;
+
+    int owned = 0;
+    depth++;
+    for (Symbol* m = cls->members->symbols; m; m = m->next) {
+        if (m->kind == SYM_PROP && is_owned_type(m->type_name)) owned = 1;
+    }
+    depth--;
+    if (owned) register_owned_type(type_name);
+    cls->owned_memo = owned ? 1 : -1;
+    return owned;
+}
+
+// Valores que carregam um canal (direto, em arrays/listas ou em props)
+int holds_channel(const char* type_name) {
+    static int depth = 0;
+    if (!type_name || !global_scope || depth > 32) return 0;
+    if (type_is_channel(type_name)) return 1;
+    char* elem = type_array_elem(type_name);
+    if (elem) return holds_channel(elem);
+
+    int found = 0;
+    depth++;
+    for (int i = 0; i < type_arg_count(type_name) && !found; i++) {
+        found = holds_channel(type_arg(type_name, i));
+    }
+    Symbol* cls = scope_resolve(global_scope, (char*)type_name);
+    if (!found && cls && cls->kind == SYM_CLASS && cls->members) {
+        for (Symbol* m = cls->members->symbols; m && !found; m = m->next) {
+            if (m->kind == SYM_PROP) found = holds_channel(m->type_name);
+        }
+    }
+    depth--;
+    return found;
+}
+
+void own_declare(Symbol* sym, bool borrowed) {
+    if (!sym || !is_owned_type(sym->type_name)) return;
+    OwnedVar* v = (OwnedVar*)calloc(1, sizeof(OwnedVar));
+    v->name = sym_c_name(sym);
+    v->type_name = sym->type_name;
+    v->ctrl_depth = ctrl_depth;
+    v->region_depth = region_depth;
+    v->borrowed = borrowed;
+    sym->owned = v;
+
+    if (owned_top == owned_cap) {
+        owned_cap = owned_cap ? owned_cap * 2 : 32;
+        owned_stack = realloc(owned_stack, sizeof(OwnedVar*) * owned_cap);
+    }
+    owned_stack[owned_top++] = v;
+}
+
+void own_use(ASTNode* ident, Symbol* sym) {
+    last_ident_owned = NULL;
+    if (!sym || !sym->owned) return;
+    OwnedVar* v = sym->owned;
+    v->last_use = ident;
+    v->last_use_depth = ctrl_depth;
+    v->last_use_seq = ++use_seq;
+    v->last_use_movable = false;
+    last_ident_owned = v;
+}
+
+// Task, Gen, Async e FileWriter (ou um Result com um deles): só movidos
+int is_move_only(const char* type_name) {
+    if (type_is_result(type_name)) {
+        return is_move_only(type_arg(type_name, 0)) || is_move_only(type_arg(type_name, 1));
+    }
+    return type_is_task(type_name) || type_is_gen(type_name) || type_is_async(type_name) ||
+           type_is_file_writer(type_name);
+}
+
+// Valor que vai para outro dono (declaração, atribuição, argumento, return)
+void own_transfer(ASTNode* value) {
+    if (!value || !is_owned_type(value->eval_type)) return;
+    // Temporários (chamadas, new) já pertencem ao destino
+    if (value->type != AST_IDENTIFIER && value->type != AST_ACCESS && value->type != AST_INDEX) return;
+
+    value->ownership = OWN_COPY;
+    if (is_move_only(value->eval_type)) {
+        TaskCopy* c = (TaskCopy*)malloc(sizeof(TaskCopy));
+        c->node = value;
+        c->next = task_copies;
+        task_copies = c;
+        task_copy_count++;
+    }
+    OwnedVar* v = last_ident_owned;
+    // Dentro de uma arena, valores de fora são sempre copiados para a região
+    if (value->type == AST_IDENTIFIER && v && v->last_use == value && !v->borrowed &&
+        v->region_depth == region_depth) {
+        v->last_use_movable = true;
+    }
+}
+
+// Último uso sem desvio entre ele e a declaração: a cópia vira move
+void own_finalize(OwnedVar* v) {
+    if (!v->borrowed && v->last_use && v->last_use_movable && v->last_use_depth == v->ctrl_depth) {
+        v->last_use->ownership = OWN_MOVE;
+        v->moved = true;
+        v->move_seq = v->last_use_seq;
+    }
+}
+
+void add_drop(ASTNode* owner, OwnedVar* v) {
+    ASTNode* d = ast_new_ident(v->name);
+    d->eval_type = v->type_name;
+    if (!owner->drops) {
+        owner->drops = d;
+    } else {
+        ASTNode* last = owner->drops;
+        while (last->next) last = last->next;
+        last->next = d;
+    }
+}
+
+// Fecha as variáveis declaradas a partir de base; as não movidas são liberadas por owner
+void own_close_scope(int base, ASTNode* owner) {
+    for (int i = owned_top - 1; i >= base; i--) {
+        OwnedVar* v = owned_stack[i];
+        own_finalize(v);
+        // Variáveis da arena são liberadas junto com a região
+        if (owner && !v->moved && !v->borrowed && v->region_depth == 0) add_drop(owner, v);
+    }
+    owned_top = base;
+}
+
+// Vive só até o fim da função: vai para a região do item no --stream
+void own_record_return(ASTNode* ret) {
+    PendingReturn* p = (PendingReturn*)region_alloc(sizeof(PendingReturn));
+    memset(p, 0, sizeof(PendingReturn));
+    p->ret = ret;
+    p->seq = ++use_seq;
+    p->live_count = owned_top - fn_owned_base;
+    p->live = (OwnedVar**)region_alloc(sizeof(OwnedVar*) * (p->live_count + 1));
+    for (int i = 0; i < p->live_count; i++) p->live[i] = owned_stack[fn_owned_base + i];
+    p->next = pending_returns;
+    pending_returns = p;
+}
+
+// Ao fim da função: cada return libera o que ainda estava vivo naquele ponto
+void own_resolve_returns(void) {
+    for (PendingReturn* p = pending_returns; p; p = p->next) {
+        for (int i = p->live_count - 1; i >= 0; i--) {
+            OwnedVar* v = p->live[i];
+            if (v->borrowed) continue;
+            if (v->moved && v->move_seq <= p->seq) continue;
+            add_drop(p->ret, v);
+        }
+    }
+    pending_returns = NULL;
+}
+
+// Usa os modos dos parâmetros da declaração chamada (&T empresta, T recebe a posse)
+void own_transfer_args(ASTNode* args, ASTNode* decl) {
+    ASTNode* param = decl ? decl->data.fn_decl.params : NULL;
+    for (ASTNode* arg = args; arg; arg = arg->next) {
+        if (param && !param->data.var_decl.borrowed) own_transfer(arg);
+        if (param) param = param->next;
+    }
+}
+
+// Variável na raiz de um lugar (a, a.x, a[i].y); NULL se não for rastreada (ex: this)
+OwnedVar* place_root(ASTNode* place, Scope* scope) {
+    while (place) {
+        if (place->type == AST_ACCESS) place = place->data.access.object;
+        else if (place->type == AST_INDEX) place = place->data.index.array;
+        else break;
+    }
+    if (!place || place->type != AST_IDENTIFIER) return NULL;
+    Symbol* sym = scope_resolve(scope, place->data.ident.name);
+    return sym ? sym->owned : NULL;
+}
+
+// O lugar pertence a alguém de fora da arena atual?
+int outside_region(ASTNode* place, Scope* scope) {
+    OwnedVar* root = place_root(place, scope);
+    return region_depth > 0 && (!root || root->region_depth < region_depth);
+}
+
+int is_borrowed_place(ASTNode* place, Scope* scope) {
+    OwnedVar* root = place_root(place, scope);
+    return root && root->borrowed;
+}
+
+ASTNode* place_root_ident(ASTNode* place) {
+    while (place && (place->type == AST_ACCESS || place->type == AST_INDEX)) {
+        place = place->type == AST_ACCESS ? place->data.access.object : place->data.index.array;
+    }
+    return place && place->type == AST_IDENTIFIER ? place : NULL;
+}
+
+// Tipos que não guardam ponteiro nenhum: uma linha não vai parar dentro deles
+int is_scalar_type(const char* type_name) {
+    static const char* scalars[] = { "int", "long", "float", "bool", "byte", "char", "void" };
+    for (size_t i = 0; i < sizeof(scalars) / sizeof(scalars[0]); i++) {
+        if (strcmp(type_name, scalars[i]) == 0) return 1;
+    }
+    return 0;
+}
+
+// O gerador pode ser o de File.lines? O handle é marcado onde nasce e segue por
+// variáveis, unwrap/? e Ok/Err. Uma função que devolve Gen<T> é sempre um gerador
+// do programa; o que não dá para rastrear (parâmetro, campo, item de coleção,
+// Result devolvido por outra função) conta como File.lines
+int lines_gen_of(ASTNode* expr, Scope* scope) {
+    if (!expr || !expr->eval_type || !strstr(expr->eval_type, "Gen<string>")) return 0;
+    switch (expr->type) {
+        case AST_CALL:
+            if (strcmp(expr->data.call.name, "Ok") == 0 || strcmp(expr->data.call.name, "Err") == 0) {
+                return lines_gen_of(expr->data.call.args, scope);
+            }
+            return strcmp(expr->data.call.name, "rujo_file_lines") == 0 || !type_is_gen(expr->eval_type);
+        case AST_METHOD_CALL:
+            if (!type_is_result(expr->data.method_call.object->eval_type)) return 1;
+            return lines_gen_of(expr->data.method_call.object, scope) ||
+                   lines_gen_of(expr->data.method_call.args, scope);
+        case AST_TRY:
+            return lines_gen_of(expr->data.try_expr.expr, scope);
+        case AST_IDENTIFIER: {
+            Symbol* sym = scope_resolve(scope, expr->data.ident.name);
+            return !sym || sym->kind != SYM_VAR || sym->lines_gen;
+        }
+        default:
+            return 1;
+    }
+}
+
+// O valor é o byte[] de File.map? O mapeamento é só leitura; o array segue por
+// variáveis, unwrap/? e Ok/Err
+int mapped_of(ASTNode* expr, Scope* scope) {
+    if (!expr) return 0;
+    switch (expr->type) {
+        case AST_CALL:
+            if (strcmp(expr->data.call.name, "Ok") == 0 || strcmp(expr->data.call.name, "Err") == 0) {
+                return mapped_of(expr->data.call.args, scope);
+            }
+            return strcmp(expr->data.call.name, "rujo_file_map") == 0;
+        case AST_METHOD_CALL:
+            return type_is_result(expr->data.method_call.object->eval_type) &&
+                   (mapped_of(expr->data.method_call.object, scope) ||
+                    mapped_of(expr->data.method_call.args, scope));
+        case AST_TRY:
+            return mapped_of(expr->data.try_expr.expr, scope);
+        case AST_IDENTIFIER: {
+            Symbol* sym = scope_resolve(scope, expr->data.ident.name);
+            return sym && sym->kind == SYM_VAR && sym->mapped;
+        }
+        default:
+            return 0;
+    }
+}
+
+// Nível do laço de File.lines cuja linha a expressão carrega (0 se nenhuma).
+// A linha aponta para o buffer do leitor: só vale até a próxima volta. Uma
+// chamada pode devolver a linha que recebeu (ident(s), Ok(l)): o resultado
+// carrega a linha dos argumentos, a menos que o tipo não guarde ponteiros
+int lines_item_of(ASTNode* expr, Scope* scope) {
+    if (!expr) return 0;
+    if (expr->type == AST_CALL || expr->type == AST_METHOD_CALL) {
+        if (!expr->eval_type || is_scalar_type(expr->eval_type)) return 0;
+        int line = expr->type == AST_METHOD_CALL ? lines_item_of(expr->data.method_call.object, scope) : 0;
+        ASTNode* args = expr->type == AST_CALL ? expr->data.call.args : expr->data.method_call.args;
+        for (ASTNode* arg = args; arg; arg = arg->next) {
+            int l = lines_item_of(arg, scope);
+            if (l > line) line = l;
+        }
+        return line;
+    }
+    if (expr->type != AST_IDENTIFIER) return 0;
+    Symbol* sym = scope_resolve(scope, expr->data.ident.name);
+    return sym && sym->kind == SYM_VAR ? sym->lines_item : 0;
+}
+
+void check_line_escape(ASTNode* expr, Scope* scope, char* where) {
+    if (lines_item_of(expr, scope)) {
+        sem_error("Linha de File.lines escaparia do laco (so vale ate a proxima volta)", where);
+    }
+}
+
+// Chamada que recebe uma linha junto com um objeto de fora da volta (o alvo
+// de um método ou outro argumento) pode guardá-la nele, como r.texto = l
+void check_line_call(ASTNode* object, ASTNode* args, Scope* scope, char* where) {
+    int line = 0;
+    for (ASTNode* arg = args; arg; arg = arg->next) {
+        int l = lines_item_of(arg, scope);
+        if (l > line) line = l;
+    }
+    if (!line) return;
+    for (ASTNode* arg = object ? object : args; arg; arg = arg == object ? args : arg->next) {
+        if (!arg->eval_type || is_scalar_type(arg->eval_type) || strcmp(arg->eval_type, "string") == 0) continue;
+        ASTNode* root = place_root_ident(arg);
+        Symbol* sym = root ? scope_resolve(scope, root->data.ident.name) : NULL;
+        if (sym && sym->kind == SYM_VAR && sym->lines_depth < line) {
+            sem_error("Linha de File.lines escaparia do laco (so vale ate a proxima volta)", where);
+            return;
+        }
+    }
+}
+
+// Variável declarada fora do bench em verificação: entra nas entradas do harness
+void bench_note_input(Symbol* sym) {
+    for (Scope* s = bench_outer; s; s = s->parent) {
+        for (Symbol* x = s->symbols; x; x = x->next) {
+            if (x != sym) continue;
+            for (ASTNode* in = bench_node->data.bench.inputs; in; in = in->next) {
+                if (strcmp(in->data.ident.name, sym->name) == 0) return;
+            }
+            ASTNode* in = ast_new_ident(sym->name);
+            in->eval_type = sym->type_name;
+            in->next = bench_node->data.bench.inputs;
+            bench_node->data.bench.inputs = in;
+            return;
+        }
+    }
+}
+
+// Métodos de List que podem (re)alocar o buffer
+int list_grows(const char* method) {
+    return strcmp(method, "push") == 0 || strcmp(method, "reserve") == 0;
+}
+
+// Métodos de Map que podem (re)alocar a tabela
+int map_grows(const char* method) {
+    return strcmp(method, "set") == 0 || strcmp(method, "reserve") == 0 ||
+           strcmp(method, "set_batch") == 0;
+}
+
+// --- @parallel ---
+// for (int i = a; i < b; i = i + 1) cujas iterações são independentes: cada
+// uma só escreve em variáveis próprias, em xs[i] ou em acumuladores de redução
+// (x = x + e, x = x * e, x = x - e, x = min(x, e), x = max(x, e)).
+
+typedef struct ParallelScan {
+    const char* loop_var;
+    ASTNode* locals;       // nomes declarados no corpo
+    ASTNode* reductions;   // AST_BINARY_OP(left = variável, op)
+    ASTNode* written;      // arrays externos escritos em xs[i]
+    int reduction_uses;    // ocorrências explicadas pelas reduções
+    int index_uses;        // ocorrências xs[i] dos arrays escritos
+    const char* name;      // para contar ocorrências
+    int count;
+} ParallelScan;
+
+int name_in(ASTNode* list, const char* name) {
+    for (; list; list = list->next) {
+        ASTNode* n = list->type == AST_BINARY_OP ? list->data.binary_op.left : list;
+        if (strcmp(n->data.ident.name, name) == 0) return 1;
+    }
+    return 0;
+}
+
+int is_ident(ASTNode* node, const char* name) {
+    return node && node->type == AST_IDENTIFIER && strcmp(node->data.ident.name, name) == 0;
+}
+
+void count_ident(ASTNode* node, void* ctx) {
+    ParallelScan* s = (ParallelScan*)ctx;
+    if (is_ident(node, s->name)) s->count++;
+}
+
+int mentions(ASTNode* expr, const char* name) {
+    ParallelScan s = { 0 };
+    s.name = name;
+    // ast_visit segue ->next: isola o nó
+    ASTNode* saved = expr->next;
+    expr->next = NULL;
+    ast_visit(expr, count_ident, &s);
+    expr->next = saved;
+    return s.count;
+}
+
+void collect_locals(ASTNode* node, void* ctx) {
+    ParallelScan* s = (ParallelScan*)ctx;
+    if (node->type == AST_VAR_DECL && !name_in(s->locals, node->data.var_decl.name)) {
+        ASTNode* n = ast_new_ident(node->data.var_decl.name);
+        n->next = s->locals;
+        s->locals = n;
+    }
+}
+
+// x = x + e / x = e + x / x = x * e / x = x - e / x = min(x, e) / x = max(x, e)
+const char* reduction_op(ASTNode* value, const char* x) {
+    if (value->type == AST_BINARY_OP) {
+        const char* op = value->data.binary_op.op;
+        ASTNode* l = value->data.binary_op.left;
+        ASTNode* r = value->data.binary_op.right;
+        if (strcmp(op, "+") == 0 || strcmp(op, "*") == 0) {
+            if (is_ident(l, x) && !mentions(r, x)) return op;
+            if (is_ident(r, x) && !mentions(l, x)) return op;
+        }
+        // Subtrair acumula no mesmo grupo da soma (parcial negativo)
+        if (strcmp(op, "-") == 0 && is_ident(l, x) && !mentions(r, x)) return "+";
+    }
+    if (value->type == AST_CALL && list_length(value->data.call.args) == 2 &&
+        (strcmp(value->data.call.name, "min") == 0 || strcmp(value->data.call.name, "max") == 0)) {
+        ASTNode* a = value->data.call.args;
+        ASTNode* b = a->next;
+        if (is_ident(a, x) && !mentions(b, x)) return value->data.call.name;
+        if (is_ident(b, x) && !mentions(a, x)) return value->data.call.name;
+    }
+    return NULL;
+}
+
+void add_reduction(ParallelScan* s, ASTNode* target, const char* op) {
+    const char* name = target->data.ident.name;
+    for (ASTNode* r = s->reductions; r; r = r->next) {
+        if (strcmp(r->data.binary_op.left->data.ident.name, name) == 0) {
+            if (strcmp(r->data.binary_op.op, op) != 0) {
+                sem_error("Reducao com operadores diferentes no laco paralelo", (char*)name);
+            }
+            s->reduction_uses += 2;
+            return;
+        }
+    }
+    char* type_name = target->eval_type;
+    if (!type_name || (strcmp(type_name, "int") != 0 && strcmp(type_name, "float") != 0)) {
+        sem_error("Reducao paralela so suporta int e float", (char*)name);
+    }
+    ASTNode* var = ast_new_ident((char*)name);
+    var->eval_type = type_name;
+    ASTNode* r = ast_new_binary_op(var, (char*)op, NULL);
+    r->eval_type = type_name;
+    r->next = s->reductions;
+    s->reductions = r;
+    s->reduction_uses += 2;
+}
+
+// Raiz de um lugar externo só pode ser escrita como xs[i] (ou xs[i].campo, em @soa)
+void check_parallel_store(ParallelScan* s, ASTNode* target) {
+    ASTNode* place = target;
+    while (place->type == AST_ACCESS) place = place->data.access.object;
+    if (place->type == AST_INDEX && place->data.index.array->type == AST_IDENTIFIER &&
+        is_ident(place->data.index.index, s->loop_var)) {
+        char* root = place->data.index.array->data.ident.name;
+        if (name_in(s->locals, root)) return;
+        if (!name_in(s->written, root)) {
+            ASTNode* n = ast_new_ident(root);
+            n->next = s->written;
+            s->written = n;
+        }
+        return;
+    }
+    ASTNode* root = place;
+    while (root && root->type != AST_IDENTIFIER) {
+        if (root->type == AST_ACCESS) root = root->data.access.object;
+        else if (root->type == AST_INDEX) root = root->data.index.array;
+        else root = NULL;
+    }
+    if (root && name_in(s->locals, root->data.ident.name)) return;
+    sem_error("Escrita externa cria dependencia entre iteracoes (use xs[i])",
+        root ? root->data.ident.name : "?");
+}
+
+// Variável na raiz de um lugar (a, a.x, a[i].y); NULL se não for um nome
+typedef struct ParamWrites {
+    const char* name;
+    int writes;
+} ParamWrites;
+
+// O corpo escreve no parâmetro? Repassá-lo por &T conta como escrita
+void find_param_writes(ASTNode* node, void* ctx) {
+    ParamWrites* w = (ParamWrites*)ctx;
+    ASTNode* root = NULL;
+    if (node->type == AST_ASSIGN && node->data.assign.target->type != AST_IDENTIFIER) {
+        root = place_root_ident(node->data.assign.target);
+    } else if (node->type == AST_METHOD_CALL) {
+        root = place_root_ident(node->data.method_call.object);
+    } else if (node->type == AST_CALL) {
+        for (ASTNode* arg = node->data.call.args; arg; arg = arg->next) {
+            ASTNode* r = place_root_ident(arg);
+            if (r && strcmp(r->data.ident.name, w->name) == 0) root = r;
+        }
+    }
+    if (root && strcmp(root->data.ident.name, w->name) == 0) w->writes = 1;
+}
+
+// Chamada que recebe por &T um valor de fora do laço e o altera: as iterações
+// escreveriam no mesmo lugar sem que o laço veja a escrita
+void check_parallel_call(ParallelScan* s, ASTNode* args, ASTNode* decl, const char* callee) {
+    ASTNode* param = decl ? decl->data.fn_decl.params : NULL;
+    for (ASTNode* arg = args; arg && param; arg = arg->next, param = param->next) {
+        if (!param->data.var_decl.borrowed) continue;
+        ASTNode* root = place_root_ident(arg);
+        if (root && name_in(s->locals, root->data.ident.name)) continue;
+        ParamWrites w = { param->data.var_decl.name, 0 };
+        ast_visit(decl->data.fn_decl.body, find_param_writes, &w);
+        if (w.writes) {
+            sem_error("Funcao altera o emprestimo &T de fora do laco paralelo", (char*)callee);
+        }
+    }
+}
+
+// O byte[] de File.map não pode ir para um parâmetro em que a função escreve
+void check_mapped_call(ASTNode* args, ASTNode* decl, Scope* scope, char* callee) {
+    ASTNode* param = decl ? decl->data.fn_decl.params : NULL;
+    for (ASTNode* arg = args; arg && param; arg = arg->next, param = param->next) {
+        if (!mapped_of(arg, scope)) continue;
+        ParamWrites w = { param->data.var_decl.name, 0 };
+        ast_visit(decl->data.fn_decl.body, find_param_writes, &w);
+        if (w.writes) sem_error("Array de File.map e so leitura (a funcao escreve nele)", callee);
+    }
+}
+
+void scan_parallel_node(ASTNode* node, void* ctx) {
+    ParallelScan* s = (ParallelScan*)ctx;
+    switch (node->type) {
+        case AST_CALL: {
+            Symbol* fn = scope_resolve(global_scope, node->data.call.name);
+            if (fn && fn->kind == SYM_FUNCTION && fn->decl) {
+                check_parallel_call(s, node->data.call.args, fn->decl, node->data.call.name);
+            }
+            break;
+        }
+
+        case AST_RETURN:
+            sem_error("return dentro de laco paralelo", (char*)s->loop_var);
+            break;
+
+        case AST_ASSIGN: {
+            ASTNode* target = node->data.assign.target;
+            if (target->type != AST_IDENTIFIER) {
+                check_parallel_store(s, target);
+                break;
+            }
+            const char* name = target->data.ident.name;
+            if (strcmp(name, s->loop_var) == 0) {
+                sem_error("Variavel do laco paralelo alterada no corpo", (char*)name);
+            } else if (!name_in(s->locals, name)) {
+                const char* op = reduction_op(node->data.assign.value, name);
+                if (op) add_reduction(s, target, op);
+                else sem_error("Atribuicao a variavel externa cria dependencia entre iteracoes", (char*)name);
+            }
+            break;
+        }
+
+        case AST_METHOD_CALL: {
+            ASTNode* obj = node->data.method_call.object;
+            const char* type_name = obj->eval_type;
+            while (obj && (obj->type == AST_ACCESS || obj->type == AST_INDEX)) {
+                obj = obj->type == AST_ACCESS ? obj->data.access.object : obj->data.index.array;
+            }
+            if (obj && obj->type == AST_IDENTIFIER && name_in(s->locals, obj->data.ident.name)) {
+                Symbol* cls = type_name ? scope_resolve(global_scope, (char*)type_name) : NULL;
+                Symbol* m = cls && cls->kind == SYM_CLASS && cls->members
+                    ? scope_resolve(cls->members, node->data.method_call.name) : NULL;
+                if (m && m->kind == SYM_FUNCTION && m->decl) {
+                    check_parallel_call(s, node->data.method_call.args, m->decl, node->data.method_call.name);
+                }
+                break;
+            }
+            if (!obj || obj->type != AST_IDENTIFIER) break;
+            if (type_is_result(type_name) || type_is_channel(type_name)) break;
+            if (type_is_list(type_name) && (strcmp(node->data.method_call.name, "len") == 0 ||
+                                            strcmp(node->data.method_call.name, "get") == 0)) break;
+            if (type_is_map(type_name) && (strcmp(node->data.method_call.name, "len") == 0 ||
+                                           strcmp(node->data.method_call.name, "get") == 0 ||
+                                           strcmp(node->data.method_call.name, "get_or") == 0 ||
+                                           strcmp(node->data.method_call.name, "has") == 0)) break;
+            sem_error("Metodo de objeto externo pode alterar estado compartilhado no laco paralelo",
+                node->data.method_call.name);
+            break;
+        }
+
+        default:
+            break;
+    }
+}
+
+void count_index_uses(ASTNode* node, void* ctx) {
+    ParallelScan* s = (ParallelScan*)ctx;
+    if (node->type == AST_INDEX && is_ident(node->data.index.array, s->name) &&
+        is_ident(node->data.index.index, s->loop_var)) {
+        s->count++;
+    }
+}
+
+typedef struct CaptureScan {
+    ParallelScan* scan;
+    Scope* scope;
+    ASTNode* captures;
+} CaptureScan;
+
+void collect_captures(ASTNode* node, void* ctx) {
+    CaptureScan* c = (CaptureScan*)ctx;
+    if (node->type != AST_IDENTIFIER) return;
+    const char* name = node->data.ident.name;
+    if (strcmp(name, c->scan->loop_var) == 0 || name_in(c->scan->locals, name) ||
+        name_in(c->scan->reductions, name) || name_in(c->captures, name)) return;
+    Symbol* sym = scope_resolve(c->scope, (char*)name);
+    if (!sym || sym->kind != SYM_VAR) return;
+    ASTNode* n = ast_new_ident((char*)name);
+    n->eval_type = sym->type_name;
+    n->next = c->captures;
+    c->captures = n;
+}
+
+void check_parallel_for(ASTNode* node, Scope* scope) {
+    ASTNode* init = node->data.for_loop.init;
+    ASTNode* cond = node->data.for_loop.condition;
+    ASTNode* step = node->data.for_loop.step;
+
+    int ok = init && init->type == AST_VAR_DECL && strcmp(init->data.var_decl.type_name, "int") == 0 &&
+             init->data.var_decl.value;
+    const char* i = ok ? init->data.var_decl.name : "";
+    ok = ok && cond && cond->type == AST_BINARY_OP && is_ident(cond->data.binary_op.left, i) &&
+         (strcmp(cond->data.binary_op.op, "<") == 0 || strcmp(cond->data.binary_op.op, "<=") == 0);
+    ok = ok && step && step->type == AST_ASSIGN && is_ident(step->data.assign.target, i);
+    if (ok) {
+        ASTNode* v = step->data.assign.value;
+        ok = v->type == AST_BINARY_OP && strcmp(v->data.binary_op.op, "+") == 0 &&
+             is_ident(v->data.binary_op.left, i) && v->data.binary_op.right->type == AST_LITERAL &&
+             v->data.binary_op.right->data.literal.type == LIT_INT &&
+             v->data.binary_op.right->data.literal.int_val == 1;
+    }
+    if (!ok) {
+        sem_error("@parallel exige a forma for (int i = a; i < b; i = i + 1)", "for");
+        return;
+    }
+    if (mentions(cond->data.binary_op.right, i)) {
+        sem_error("Limite do laco paralelo depende da variavel do laco", (char*)i);
+    }
+
+    ParallelScan s = { 0 };
+    s.loop_var = i;
+    ast_visit(node->data.for_loop.body, collect_locals, &s);
+    ast_visit(node->data.for_loop.body, scan_parallel_node, &s);
+
+    // Acumuladores só podem aparecer nas próprias reduções
+    s.count = 0;
+    for (ASTNode* r = s.reductions; r; r = r->next) {
+        s.name = r->data.binary_op.left->data.ident.name;
+        ast_visit(node->data.for_loop.body, count_ident, &s);
+    }
+    if (s.count != s.reduction_uses) {
+        sem_error("Variavel de reducao lida dentro do laco paralelo", "for");
+    }
+    // Os limites são lidos uma vez antes das fatias: o acumulador não pode mudá-los
+    for (ASTNode* r = s.reductions; r; r = r->next) {
+        const char* name = r->data.binary_op.left->data.ident.name;
+        if (mentions(init->data.var_decl.value, name) || mentions(cond->data.binary_op.right, name)) {
+            sem_error("Variavel de reducao usada nos limites do laco paralelo", (char*)name);
+        }
+    }
+
+    // Capturas: tudo que o corpo usa de fora do laço (arrays escritos incluídos)
+    CaptureScan c = { &s, scope, NULL };
+    ast_visit(node->data.for_loop.body, collect_captures, &c);
+
+    // Arrays escritos em xs[i] só podem ser lidos em xs[i]. Um empréstimo &T
+    // pode ser o mesmo array que outra captura do mesmo tipo (f(a, a)): as
+    // duas contam como um array só
+    for (ASTNode* w = s.written; w; w = w->next) {
+        Symbol* ws = scope_resolve(scope, w->data.ident.name);
+        int w_borrowed = ws && ws->owned && ws->owned->borrowed;
+        for (ASTNode* a = c.captures; a; a = a->next) {
+            if (strcmp(a->data.ident.name, w->data.ident.name) != 0) {
+                Symbol* as = scope_resolve(scope, a->data.ident.name);
+                int a_borrowed = as && as->owned && as->owned->borrowed;
+                if (!(w_borrowed || a_borrowed) || !ws || !as || strcmp(ws->type_name, as->type_name) != 0) continue;
+            }
+            s.name = a->data.ident.name;
+            s.count = 0;
+            ast_visit(node->data.for_loop.body, count_ident, &s);
+            int total = s.count;
+            s.count = 0;
+            ast_visit(node->data.for_loop.body, count_index_uses, &s);
+            if (total != s.count) {
+                if (strcmp(a->data.ident.name, w->data.ident.name) == 0) {
+                    sem_error("Array escrito em xs[i] tambem e acessado em outro indice", w->data.ident.name);
+                } else {
+                    sem_error("Emprestimo &T pode ser o mesmo array escrito em xs[i] e e acessado em outro indice",
+                        a->data.ident.name);
+                }
+            }
+        }
+    }
+    node->data.for_loop.captures = c.captures;
+    node->data.for_loop.reductions = s.reductions;
+    uses_tasks = true;
+}
+
+void check_annotations(ASTNode* node) {
+    ASTNode* a = node->annotations;
+    while (a) {
+        char* name = a->data.annotation.name;
+        if (strcmp(name, "soa") == 0) {
+            if (node->type != AST_CLASS_DECL) {
+                sem_error("@soa so pode ser usado em classes", name);
+            }
+        } else if (strcmp(name, "parallel") == 0) {
+            if (node->type != AST_FOR) {
+                sem_error("@parallel so pode ser usado em for", name);
+            }
+        } else {
+            sem_error("Anotacao desconhecida", name);
+        }
+        a = a->next;
+    }
+}
 
 void check_block(ASTNode* block, Scope* parent_scope) {
     Scope* local_scope = scope_new(parent_scope);
+    int owned_base = owned_top;
     ASTNode* stmt = block->data.block.statements;
     while (stmt) {
         check_node(stmt, local_scope);
+        check_unused_result(stmt);
+        stmt = stmt->next;
+    }
+    own_close_scope(owned_base, block);
+}
+
+// Escopo global com os builtins (início do programa inteiro ou do --stream)
+void program_begin(ASTNode* decls) {
+    Scope* global = scope_new(NULL);
+    scope_define(global, "print", "void", SYM_FUNCTION);
+    scope_define(global, "flush", "void", SYM_FUNCTION);
+    global_scope = global;
+    instances = instances_tail = NULL;
+    instance_count = 0;
+    owned_types = NULL;
+    uses_tasks = false;
+    uses_channels = false;
+    uses_maps = false;
+    uses_clock = false;
+    uses_files = false;
+    file_results = false;
+    task_copies = NULL;
+    task_copy_count = 0;
+    owned_top = fn_owned_base = ctrl_depth = region_depth = lines_depth = 0;
+
+    scope_define(global, "List", "class", SYM_CLASS);
+    scope_resolve(global, "List")->decl = builtin_list_decl();
+    scope_define(global, "Map", "class", SYM_CLASS);
+    scope_resolve(global, "Map")->decl = builtin_map_decl();
+    scope_define(global, "Result", "class", SYM_CLASS);
+    scope_resolve(global, "Result")->decl = builtin_result_decl();
+    scope_define(global, "Task", "class", SYM_CLASS);
+    scope_resolve(global, "Task")->decl = builtin_task_decl();
+    scope_define(global, "Channel", "class", SYM_CLASS);
+    scope_resolve(global, "Channel")->decl = builtin_channel_decl("Channel");
+    scope_define(global, "SpscChannel", "class", SYM_CLASS);
+    scope_resolve(global, "SpscChannel")->decl = builtin_channel_decl("SpscChannel");
+    scope_define(global, "Gen", "class", SYM_CLASS);
+    scope_resolve(global, "Gen")->decl = builtin_gen_decl();
+    scope_define(global, "Async", "class", SYM_CLASS);
+    scope_resolve(global, "Async")->decl = builtin_async_decl();
+    scope_define(global, "FileWriter", "class", SYM_CLASS);
+
+    // Genéricos são registrados antes para poderem ser usados em qualquer ordem
+    ASTNode* stmt = decls;
+    while (stmt) {
+        if (stmt->type == AST_CLASS_DECL && stmt->data.class_decl.type_params) {
+            if (!scope_define(global, stmt->data.class_decl.name, "class", SYM_CLASS)) {
+                sem_error("Classe ja definida", stmt->data.class_decl.name);
+            } else {
+                scope_resolve(global, stmt->data.class_decl.name)->decl = stmt;
+            }
+        } else if (stmt->type == AST_FN_DECL) {
+            // Funções também: o ownership precisa dos modos dos parâmetros em qualquer ordem
+            if (!scope_define(global, stmt->data.fn_decl.name, stmt->data.fn_decl.return_type, SYM_FUNCTION)) {
+                sem_error("Funcao ja definida", stmt->data.fn_decl.name);
+            } else {
+                scope_resolve(global, stmt->data.fn_decl.name)->decl = stmt;
+            }
+        }
         stmt = stmt->next;
     }
 }
 
+// Fim do programa: globais não movidos são liberados por program
+void program_end(ASTNode* program) {
+    own_close_scope(0, program);
+
+    for (TaskCopy* c = task_copies; c; c = c->next) {
+        if (c->node->ownership != OWN_COPY) continue;
+        if (type_is_result(c->node->eval_type)) {
+            sem_error("Result com Task, Gen, Async ou FileWriter nao pode ser copiado (so movido)", c->node->eval_type);
+        } else if (type_is_gen(c->node->eval_type)) {
+            sem_error("Gen nao pode ser copiado (so movido)", c->node->eval_type);
+        } else if (type_is_async(c->node->eval_type)) {
+            sem_error("Async nao pode ser copiado (so movido)", c->node->eval_type);
+        } else if (type_is_file_writer(c->node->eval_type)) {
+            sem_error("FileWriter nao pode ser copiado (so movido)", c->node->eval_type);
+        } else {
+            sem_error("Task nao pode ser copiada (so movida)", c->node->eval_type);
+        }
+    }
+}
+
 void check_node(ASTNode* node, Scope* scope) {
     if (!node) return;
 
+    if (node->annotations) check_annotations(node);
+
     switch (node->type) {
         case AST_PROGRAM: {
-            Scope* global = scope_new(NULL);
-            scope_define(global, "print", "void", SYM_FUNCTION);
-            
+            program_begin(node->data.program.statements);
             ASTNode* stmt = node->data.program.statements;
             while (stmt) {
-                check_node(stmt, global);
+                // Os statements soltos são do principal (o último módulo)
+                current_module = module_of(stmt);
+                if (!current_module) current_module = module_count();
+                check_node(stmt, global_scope);
+                check_unused_result(stmt);
                 stmt = stmt->next;
             }
+            program_end(node);
             break;
         }
 
         case AST_VAR_DECL:
-            if (!scope_define(scope, node->data.var_decl.name, node->data.var_decl.type_name, SYM_VAR)) {
+            resolve_type(node->data.var_decl.type_name);
+            if (scope == global_scope) {
+                // O símbolo de uma global fica fora da região do statement (--stream)
+                Region* item_region = region_activate(NULL);
+                node->data.var_decl.name = rujo_strdup(node->data.var_decl.name);
+                node->data.var_decl.type_name = rujo_strdup(node->data.var_decl.type_name);
+                if (!scope_define(scope, node->data.var_decl.name, node->data.var_decl.type_name, SYM_VAR)) {
+                    sem_error("Variavel redeclarada no mesmo escopo", node->data.var_decl.name);
+                }
+                region_activate(item_region);
+            } else if (!scope_define(scope, node->data.var_decl.name, node->data.var_decl.type_name, SYM_VAR)) {
                 sem_error("Variavel redeclarada no mesmo escopo", node->data.var_decl.name);
             }
+            Symbol* var_sym = scope_resolve(scope, node->data.var_decl.name);
+            gen_local(scope->parent, var_sym, node->data.var_decl.type_name);
             if (node->data.var_decl.value) {
+                expected_type = node->data.var_decl.type_name;
+                await_slot = node->data.var_decl.value;
                 check_node(node->data.var_decl.value, scope);
+                await_slot = NULL;
+                expected_type = NULL;
+                own_transfer(node->data.var_decl.value);
             }
+            node->eval_type = node->data.var_decl.type_name;
+            if (var_sym) {
+                var_sym->lines_depth = lines_depth;
+                var_sym->lines_item = lines_item_of(node->data.var_decl.value, scope);
+                var_sym->lines_gen = lines_gen_of(node->data.var_decl.value, scope);
+                var_sym->mapped = mapped_of(node->data.var_decl.value, scope);
+            }
+            own_declare(var_sym, false);
+            if (var_sym && var_sym->c_name) node->data.var_decl.name = var_sym->c_name;
             break;
 
         case AST_CLASS_DECL:
+            // Genéricos só são verificados quando instanciados
+            if (node->data.class_decl.type_params) break;
             if (!scope_define(scope, node->data.class_decl.name, "class", SYM_CLASS)) {
                 sem_error("Classe ja definida", node->data.class_decl.name);
+            } else {
+                scope_resolve(scope, node->data.class_decl.name)->decl = node;
             }
             Scope* class_scope = scope_new(scope);
+            scope_resolve(scope, node->data.class_decl.name)->members = class_scope;
             ASTNode* member = node->data.class_decl.members;
             scope_define(class_scope, "this", node->data.class_decl.name, SYM_VAR);
 
+            // Todas as props antes dos métodos: o memo de is_owned_type só vale
+            // com a classe completa
+            for (; member; member = member->next) {
+                if (member->type != AST_PROP_DECL) continue;
+                resolve_type(member->data.var_decl.type_name);
+                if (!scope_define(class_scope, member->data.var_decl.name, member->data.var_decl.type_name, SYM_PROP)) {
+                    sem_error("Propriedade duplicada", member->data.var_decl.name);
+                }
+            }
+            scope_resolve(scope, node->data.class_decl.name)->owned_memo = 0;
+
+            member = node->data.class_decl.members;
             while (member) {
-                if (member->type == AST_PROP_DECL) {
-                    if (!scope_define(class_scope, member->data.var_decl.name, member->data.var_decl.type_name, SYM_PROP)) {
-                        sem_error("Propriedade duplicada", member->data.var_decl.name);
+                if (member->type == AST_FN_DECL) {
+                    if (member->data.fn_decl.type_params) {
+                        sem_error("Metodos genericos nao sao suportados", member->data.fn_decl.name);
+                    } else {
+                        check_node(member, class_scope);
                     }
                 }
-                else if (member->type == AST_FN_DECL) {
-                    check_node(member, class_scope);
-                }
                 member = member->next;
             }
             break;
 
         case AST_FN_DECL: {
+            if (node->data.fn_decl.type_params) break;
+            resolve_type(node->data.fn_decl.return_type);
+            // Define antes do corpo para permitir recursão
+            if (scope_define(scope, node->data.fn_decl.name, node->data.fn_decl.return_type, SYM_FUNCTION)) {
+                scope_resolve(scope, node->data.fn_decl.name)->decl = node;
+            }
+
+            int saved_base = fn_owned_base;
+            int saved_depth = ctrl_depth;
+            int saved_region = region_depth;
+            int saved_lines = lines_depth;
+            region_depth = lines_depth = 0;
+            PendingReturn* saved_returns = pending_returns;
+            fn_owned_base = owned_top;
+            ctrl_depth = 0;
+            pending_returns = NULL;
+
+            // Função que devolve Gen<T> é um gerador: o corpo roda aos poucos, a cada item
+            // async fn (devolve Async<T>) usa a mesma máquina de estados, suspensa em cada await
+            char* saved_gen = current_gen_elem;
+            char* saved_async = current_async_ret;
+            ASTNode* saved_locals = gen_locals;
+            current_gen_elem = NULL;
+            current_async_ret = NULL;
+            gen_locals = NULL;
+            if (type_is_gen(node->data.fn_decl.return_type)) {
+                if (scope_resolve(scope, "this")) {
+                    sem_error("Gerador precisa ser uma funcao, nao um metodo", node->data.fn_decl.name);
+                }
+                current_gen_elem = type_arg(node->data.fn_decl.return_type, 0);
+            } else if (type_is_async(node->data.fn_decl.return_type)) {
+                if (scope_resolve(scope, "this")) {
+                    sem_error("async fn precisa ser uma funcao, nao um metodo", node->data.fn_decl.name);
+                }
+                current_async_ret = type_arg(node->data.fn_decl.return_type, 0);
+            }
+
             Scope* fn_scope = scope_new(scope);
             ASTNode* param = node->data.fn_decl.params;
             while (param) {
+                resolve_type(param->data.var_decl.type_name);
                 scope_define(fn_scope, param->data.var_decl.name, param->data.var_decl.type_name, SYM_VAR);
+                own_declare(scope_resolve(fn_scope, param->data.var_decl.name), param->data.var_decl.borrowed);
+                // Quem chama pode passar o gerador de File.lines
+                scope_resolve(fn_scope, param->data.var_decl.name)->lines_gen =
+                    strstr(param->data.var_decl.type_name, "Gen<string>") != NULL;
+                if ((current_gen_elem || current_async_ret) && param->data.var_decl.borrowed) {
+                    sem_error("Gerador/async fn nao pode receber emprestimo &T (o frame sobrevive a chamada)",
+                        param->data.var_decl.name);
+                }
+                gen_local(scope, scope_resolve(fn_scope, param->data.var_decl.name), param->data.var_decl.type_name);
                 param = param->next;
             }
+            char* saved_return = current_fn_return;
+            current_fn_return = node->data.fn_decl.return_type;
             if (node->data.fn_decl.body) {
                 check_node(node->data.fn_decl.body, fn_scope);
             }
+            current_fn_return = saved_return;
+            current_gen_elem = saved_gen;
+            current_async_ret = saved_async;
+            gen_locals = saved_locals;
+
+            // Parâmetros com posse são liberados no fim do corpo
+            ASTNode* body = node->data.fn_decl.body;
+            own_close_scope(fn_owned_base, body && body->type == AST_BLOCK ? body : NULL);
+            own_resolve_returns();
+
+            fn_owned_base = saved_base;
+            ctrl_depth = saved_depth;
+            region_depth = saved_region;
+            lines_depth = saved_lines;
+            pending_returns = saved_returns;
             break;
         }
 
@@ -85,12 +1628,142 @@ void check_node(ASTNode* node, Scope* scope) {
             break;
 
         case AST_ASSIGN:
-            check_node(node->data.assign.value, scope);
             check_node(node->data.assign.target, scope);
+            expected_type = node->data.assign.target->eval_type;
+            await_slot = node->data.assign.value;
+            check_node(node->data.assign.value, scope);
+            await_slot = NULL;
+            expected_type = NULL;
+            own_transfer(node->data.assign.value);
+            if (is_owned_type(node->data.assign.value->eval_type)) {
+                if (outside_region(node->data.assign.target, scope)) {
+                    sem_error("Valor alocado na arena escaparia da regiao", "atribuicao");
+                } else if (node->data.assign.target->type != AST_IDENTIFIER &&
+                           is_borrowed_place(node->data.assign.target, scope)) {
+                    sem_error("Emprestimo &T nao pode receber valores com heap", "atribuicao");
+                }
+            }
+            // Uma linha de File.lines só vai para variáveis do próprio laço
+            int line = lines_item_of(node->data.assign.value, scope);
+            if (line) {
+                Symbol* target = node->data.assign.target->type == AST_IDENTIFIER
+                    ? scope_resolve(scope, node->data.assign.target->data.ident.name) : NULL;
+                if (!target || target->kind != SYM_VAR || target->lines_depth < line) {
+                    check_line_escape(node->data.assign.value, scope, "atribuicao");
+                } else if (target->lines_item < line) {
+                    target->lines_item = line;
+                }
+            }
+            int gen_lines = lines_gen_of(node->data.assign.value, scope);
+            int mapped = mapped_of(node->data.assign.value, scope);
+            if (gen_lines || mapped) {
+                ASTNode* root = place_root_ident(node->data.assign.target);
+                Symbol* target = root ? scope_resolve(scope, root->data.ident.name) : NULL;
+                if (target && target->kind == SYM_VAR) {
+                    target->lines_gen |= gen_lines;
+                    target->mapped |= mapped && node->data.assign.target->type == AST_IDENTIFIER;
+                }
+            }
+            // File.map mapeia o arquivo só para leitura
+            if (node->data.assign.target->type == AST_INDEX &&
+                mapped_of(node->data.assign.target->data.index.array, scope)) {
+                sem_error("Array de File.map e so leitura", "atribuicao");
+            }
+            // O alvo é lido (valor antigo liberado) depois do valor: x = f(x) não move x
+            if (node->data.assign.target->type == AST_IDENTIFIER) {
+                own_use(node->data.assign.target, scope_resolve(scope, node->data.assign.target->data.ident.name));
+            }
             break;
 
-        case AST_CALL:
-            if (!scope_resolve(scope, node->data.call.name)) {
+        case AST_CALL: {
+            // Ok(v) / Err(e): o tipo vem do contexto (declaração, atribuição ou return)
+            if (strcmp(node->data.call.name, "Ok") == 0 || strcmp(node->data.call.name, "Err") == 0) {
+                char* target = expected_type;
+                expected_type = NULL;
+                if (!type_is_result(target)) {
+                    sem_error("Ok/Err fora de um contexto Result<T, E>", node->data.call.name);
+                } else if (list_length(node->data.call.args) != 1) {
+                    sem_error("Ok/Err recebem exatamente um argumento", node->data.call.name);
+                }
+                check_node(node->data.call.args, scope);
+                // O valor passa a pertencer ao Result
+                own_transfer(node->data.call.args);
+                node->eval_type = target;
+                break;
+            }
+            expected_type = NULL;
+
+            // min/max embutidos: o tipo é o dos argumentos (float se algum for float)
+            if (strcmp(node->data.call.name, "min") == 0 || strcmp(node->data.call.name, "max") == 0) {
+                for (ASTNode* arg = node->data.call.args; arg; arg = arg->next) check_node(arg, scope);
+                if (list_length(node->data.call.args) != 2) {
+                    sem_error("min/max recebem exatamente dois argumentos", node->data.call.name);
+                    break;
+                }
+                char* a = node->data.call.args->eval_type;
+                char* b = node->data.call.args->next->eval_type;
+                node->eval_type = (a && strcmp(a, "float") == 0) || (b && strcmp(b, "float") == 0) ? "float" : a;
+                break;
+            }
+
+            // sqrt embutido: int ou float, sempre devolve float
+            if (strcmp(node->data.call.name, "sqrt") == 0) {
+                for (ASTNode* arg = node->data.call.args; arg; arg = arg->next) check_node(arg, scope);
+                if (list_length(node->data.call.args) != 1) {
+                    sem_error("sqrt recebe exatamente um argumento", node->data.call.name);
+                    break;
+                }
+                char* a = node->data.call.args->eval_type;
+                if (a && strcmp(a, "int") != 0 && strcmp(a, "float") != 0) sem_error("sqrt espera int ou float", a);
+                node->eval_type = "float";
+                break;
+            }
+
+            // now_ns()/cycles(): relógio monotônico e contador de ciclos (long);
+            // keep(x): x conta como usado, o C não descarta o cálculo
+            if (strcmp(node->data.call.name, "now_ns") == 0 || strcmp(node->data.call.name, "cycles") == 0 ||
+                strcmp(node->data.call.name, "keep") == 0) {
+                for (ASTNode* arg = node->data.call.args; arg; arg = arg->next) check_node(arg, scope);
+                int keep = strcmp(node->data.call.name, "keep") == 0;
+                if (list_length(node->data.call.args) != keep) {
+                    sem_error("Numero de argumentos errado", node->data.call.name);
+                }
+                node->eval_type = keep ? "void" : "long";
+                uses_clock = true;
+                break;
+            }
+
+            Symbol* fn = scope_resolve(scope, node->data.call.name);
+            const IoBuiltin* io = fn ? NULL : find_io_builtin(node->data.call.name);
+            if (io) {
+                if (io->async) sem_error("Operacao de I/O assincrona precisa de await", node->data.call.name);
+                check_io_call(node, io, scope);
+                break;
+            }
+
+            // io_run(a): roda o laço de I/O até a e tudo que ela disparou terminarem
+            // io_spawn(a): dispara uma Async<void> no laço atual, sem esperar
+            bool run = strcmp(node->data.call.name, "io_run") == 0;
+            if (!fn && (run || strcmp(node->data.call.name, "io_spawn") == 0)) {
+                ASTNode* arg = node->data.call.args;
+                if (list_length(arg) != 1) {
+                    sem_error("io_run/io_spawn recebem exatamente um Async", node->data.call.name);
+                    break;
+                }
+                check_node(arg, scope);
+                if (!type_is_async(arg->eval_type) ||
+                    (!run && strcmp(type_arg(arg->eval_type, 0), "void") != 0)) {
+                    sem_error(run ? "io_run espera Async<T>" : "io_spawn espera Async<void>",
+                        arg->eval_type ? arg->eval_type : node->data.call.name);
+                    break;
+                }
+                if (run && current_async_ret) sem_error("io_run dentro de async fn (use await)", "io_run");
+                own_transfer(arg);
+                uses_io = true;
+                node->eval_type = run ? type_arg(arg->eval_type, 0) : "void";
+                break;
+            }
+            if (!fn) {
                 // sem_error("Funcao nao declarada", node->data.call.name);
                 // Comentado pois o sistema de funções soltas ainda não é 100% integrado ao semântico
             }
@@ -99,22 +1772,567 @@ void check_node(ASTNode* node, Scope* scope) {
                 check_node(arg, scope);
                 arg = arg->next;
             }
+            if (fn && fn->kind == SYM_FUNCTION) {
+                check_visible(fn->decl);
+                if (fn->decl && fn->decl->data.fn_decl.type_params) {
+                    check_generic_call(node, fn->decl);
+                } else {
+                    node->eval_type = fn->type_name;
+                }
+                own_transfer_args(node->data.call.args, fn->decl);
+                check_line_call(NULL, node->data.call.args, scope, node->data.call.name);
+                check_mapped_call(node->data.call.args, fn->decl, scope, node->data.call.name);
+            }
             break;
+        }
 
-        case AST_IDENTIFIER:
+        case AST_IDENTIFIER: {
+            Symbol* sym = NULL;
             if (strcmp(node->data.ident.name, "this") == 0) {
-                if (!scope_resolve(scope, "this")) {
+                sym = scope_resolve(scope, "this");
+                if (!sym) {
                      sem_error("Uso de 'this' fora de classe", "this");
                 }
             } else {
-                if (!scope_resolve(scope, node->data.ident.name)) {
+                sym = scope_resolve(scope, node->data.ident.name);
+                if (!sym) {
                     sem_error("Variavel nao declarada", node->data.ident.name);
                 }
             }
+            if (sym) node->eval_type = sym->type_name;
+            if (sym && sym->c_name) node->data.ident.name = sym->c_name;
+            if (sym && bench_node && sym->kind == SYM_VAR) bench_note_input(sym);
+            own_use(node, sym);
             break;
-        
-        case AST_ACCESS:
+        }
+
+        case AST_ACCESS: {
             check_node(node->data.access.object, scope);
+            char* obj_type = node->data.access.object->eval_type;
+            if (!obj_type) break;
+
+            Symbol* cls = scope_resolve(scope, obj_type);
+            if (cls && cls->kind == SYM_CLASS && cls->members) {
+                Symbol* prop = scope_resolve(cls->members, node->data.access.member_name);
+                if (!prop || prop->kind != SYM_PROP) {
+                    sem_error("Propriedade inexistente", node->data.access.member_name);
+                } else {
+                    node->eval_type = prop->type_name;
+                }
+            }
+            break;
+        }
+
+        case AST_INDEX:
+            check_node(node->data.index.array, scope);
+            check_node(node->data.index.index, scope);
+            if (node->data.index.array->eval_type) {
+                char* arr_type = node->data.index.array->eval_type;
+                char* base = type_base(arr_type);
+                if (strcmp(base, "List") == 0) {
+                    node->eval_type = type_arg(arr_type, 0);
+                    break;
+                }
+                node->eval_type = type_array_elem(arr_type);
+                if (!node->eval_type) {
+                    sem_error("Indexacao de valor que nao e array", node->data.index.array->eval_type);
+                }
+            }
+            break;
+
+        case AST_NEW: {
+            expected_type = NULL;
+            char* type_name = node->data.new_obj.type_name;
+            resolve_type(type_name);
+            Symbol* cls = scope_resolve(scope, type_name);
+            if (!cls || cls->kind != SYM_CLASS) {
+                sem_error("Classe nao declarada", type_name);
+            } else {
+                check_visible(cls->decl);
+            }
+            ASTNode* arg = node->data.new_obj.args;
+            while (arg) {
+                check_node(arg, scope);
+                check_line_escape(arg, scope, type_name);
+                arg = arg->next;
+            }
+            if (cls && cls->members) {
+                Symbol* init = scope_resolve(cls->members, "init");
+                if (init) own_transfer_args(node->data.new_obj.args, init->decl);
+                if (init) check_mapped_call(node->data.new_obj.args, init->decl, scope, type_name);
+            }
+            if (type_is_channel(type_name)) {
+                ASTNode* cap = node->data.new_obj.args;
+                if (!cap || cap->next || !cap->eval_type || strcmp(cap->eval_type, "int") != 0) {
+                    sem_error("Canal espera a capacidade (int)", type_name);
+                }
+            }
+            node->eval_type = type_name;
+            break;
+        }
+
+        case AST_METHOD_CALL: {
+            expected_type = NULL;
+            ASTNode* target = node->data.method_call.object;
+            if (target->type == AST_IDENTIFIER && strcmp(target->data.ident.name, "File") == 0 &&
+                !scope_resolve(scope, "File")) {
+                check_file_call(node, scope);
+                break;
+            }
+            check_node(node->data.method_call.object, scope);
+            ASTNode* arg = node->data.method_call.args;
+            while (arg) {
+                check_node(arg, scope);
+                arg = arg->next;
+            }
+
+            char* obj_type = node->data.method_call.object->eval_type;
+            if (!obj_type) break;
+            char* method = node->data.method_call.name;
+
+            if (type_is_result(obj_type)) {
+                node->eval_type = result_method_type(obj_type, method);
+                if (!node->eval_type) sem_error("Metodo inexistente em Result", method);
+                // unwrap/unwrap_or/error tiram o valor de dentro: consomem o Result
+                if (strcmp(method, "is_ok") != 0 && strcmp(method, "is_err") != 0) {
+                    own_transfer(node->data.method_call.object);
+                    own_transfer(node->data.method_call.args);
+                }
+                break;
+            }
+
+            if (type_is_file_writer(obj_type)) {
+                node->eval_type = file_writer_method_type(method);
+                if (!node->eval_type) sem_error("Metodo inexistente em FileWriter", method);
+                break;
+            }
+
+            if (type_is_task(obj_type)) {
+                node->eval_type = task_method_type(obj_type, method);
+                if (!node->eval_type) sem_error("Metodo inexistente em Task", method);
+                break;
+            }
+
+            if (type_is_channel(obj_type)) {
+                node->eval_type = channel_method_type(obj_type, method);
+                if (!node->eval_type) {
+                    sem_error("Metodo inexistente em Channel", method);
+                    break;
+                }
+                char* elem = type_arg(obj_type, 0);
+                ASTNode* value = node->data.method_call.args;
+                if (strcmp(method, "send") == 0 || strcmp(method, "try_send") == 0) {
+                    // O valor passa a pertencer a quem receber
+                    own_transfer(value);
+                    check_line_escape(value, scope, method);
+                    if (is_owned_type(elem) && region_depth > 0) {
+                        sem_error("Valor com heap nao pode ser enviado por canal dentro de uma arena", method);
+                    }
+                } else if (strcmp(method, "send_batch") == 0) {
+                    // Empréstimo: os itens saem da lista, que fica vazia
+                    if (is_owned_type(elem) && region_depth > 0) {
+                        sem_error("Valor com heap nao pode ser enviado por canal dentro de uma arena", method);
+                    }
+                }
+                break;
+            }
+
+            if (type_is_list(obj_type)) {
+                node->eval_type = list_method_type(obj_type, method);
+                if (!node->eval_type) sem_error("Metodo inexistente em List", method);
+                if (list_grows(method) && outside_region(node->data.method_call.object, scope)) {
+                    sem_error("List de fora da arena nao pode crescer dentro da regiao", method);
+                }
+                if (list_grows(method) && is_borrowed_place(node->data.method_call.object, scope)) {
+                    sem_error("Emprestimo &T nao pode crescer", method);
+                }
+                // push/set guardam o valor na lista
+                if (strcmp(method, "push") == 0) {
+                    own_transfer(node->data.method_call.args);
+                    check_line_escape(node->data.method_call.args, scope, method);
+                }
+                if (strcmp(method, "set") == 0 && node->data.method_call.args) {
+                    own_transfer(node->data.method_call.args->next);
+                    check_line_escape(node->data.method_call.args->next, scope, method);
+                }
+                break;
+            }
+
+            if (type_is_map(obj_type)) {
+                node->eval_type = map_method_type(obj_type, method);
+                if (!node->eval_type) sem_error("Metodo inexistente em Map", method);
+                if (map_grows(method) && outside_region(node->data.method_call.object, scope)) {
+                    sem_error("Map de fora da arena nao pode crescer dentro da regiao", method);
+                }
+                if (map_grows(method) && is_borrowed_place(node->data.method_call.object, scope)) {
+                    sem_error("Emprestimo &T nao pode crescer", method);
+                }
+                // set guarda o valor; get_or fica com o padrão (liberado se não for usado)
+                if ((strcmp(method, "set") == 0 || strcmp(method, "get_or") == 0) && node->data.method_call.args) {
+                    own_transfer(node->data.method_call.args->next);
+                }
+                // set guarda também a chave (comparada por conteúdo, mas guardada por ponteiro)
+                if (strcmp(method, "set") == 0) {
+                    for (ASTNode* arg = node->data.method_call.args; arg; arg = arg->next) {
+                        check_line_escape(arg, scope, method);
+                    }
+                }
+                break;
+            }
+
+            Symbol* cls = scope_resolve(scope, obj_type);
+            if (cls && cls->kind == SYM_CLASS && cls->members) {
+                Symbol* m = scope_resolve(cls->members, method);
+                if (!m || m->kind != SYM_FUNCTION) {
+                    sem_error("Metodo inexistente", method);
+                } else {
+                    node->eval_type = m->type_name;
+                    own_transfer_args(node->data.method_call.args, m->decl);
+                    check_line_call(node->data.method_call.object, node->data.method_call.args, scope, method);
+                    check_mapped_call(node->data.method_call.args, m->decl, scope, method);
+                    // O método pode guardar memória da arena dentro do objeto
+                    if (is_owned_type(obj_type) && outside_region(node->data.method_call.object, scope)) {
+                        sem_error("Metodo de objeto de fora da arena nao pode ser chamado na regiao", method);
+                    }
+                }
+            }
+            break;
+        }
+
+        case AST_NEW_ARRAY: {
+            resolve_type(node->data.new_array.elem_type);
+            check_node(node->data.new_array.size, scope);
+            char* elem = node->data.new_array.elem_type;
+            node->eval_type = (char*)malloc(strlen(elem) + 3);
+            sprintf(node->eval_type, "%s[]", elem);
+            break;
+        }
+
+        case AST_LITERAL:
+            switch (node->data.literal.type) {
+                case LIT_INT:    node->eval_type = "int"; break;
+                case LIT_FLOAT:  node->eval_type = "float"; break;
+                case LIT_STRING: node->eval_type = "string"; break;
+                case LIT_BOOL:   node->eval_type = "bool"; break;
+                case LIT_CHAR:   node->eval_type = "char"; break;
+            }
+            break;
+
+        case AST_BINARY_OP: {
+            // a + b + c + ... é profundo à esquerda: a espinha vai numa pilha
+            // explícita e os nós são tipados de dentro para fora
+            ASTSpine spine;
+            ast_spine_init(&spine, node);
+            check_node(spine.items[spine.count - 1]->data.binary_op.left, scope);
+            for (int i = spine.count - 1; i >= 0; i--) {
+                ASTNode* bin = spine.items[i];
+                check_node(bin->data.binary_op.right, scope);
+                char* op = bin->data.binary_op.op;
+                if (strcmp(op, "+") == 0 || strcmp(op, "-") == 0 || strcmp(op, "*") == 0 || strcmp(op, "/") == 0) {
+                    bin->eval_type = bin->data.binary_op.left->eval_type;
+                } else {
+                    bin->eval_type = "bool";
+                }
+            }
+            ast_spine_free(&spine);
+            break;
+        }
+
+        case AST_TYPEOF:
+            check_node(node->data.type_of.expr, scope);
+            node->eval_type = "string";
+            break;
+
+        case AST_RETURN:
+            if (current_gen_elem && node->data.ret.value) {
+                sem_error("Gerador termina com 'return;' (sem valor)", current_fn_return);
+            } else if (current_async_ret) {
+                if (!node->data.ret.value != (strcmp(current_async_ret, "void") == 0)) {
+                    sem_error("return incompativel com o resultado da async fn", current_async_ret);
+                }
+            } else if (!current_gen_elem && !node->data.ret.value && current_fn_return &&
+                       strcmp(current_fn_return, "void") != 0) {
+                sem_error("return sem valor em funcao que retorna", current_fn_return);
+            }
+            expected_type = current_async_ret ? current_async_ret : current_fn_return;
+            await_slot = node->data.ret.value;
+            check_node(node->data.ret.value, scope);
+            await_slot = NULL;
+            expected_type = NULL;
+            own_transfer(node->data.ret.value);
+            check_line_escape(node->data.ret.value, scope, "return");
+            if (region_depth > 0 && node->data.ret.value && is_owned_type(node->data.ret.value->eval_type)) {
+                sem_error("Valor alocado na arena escaparia da regiao", "return");
+            }
+            own_record_return(node);
+            break;
+
+        case AST_TRY: {
+            check_node(node->data.try_expr.expr, scope);
+            own_transfer(node->data.try_expr.expr);
+            char* type_name = node->data.try_expr.expr->eval_type;
+            if (!type_is_result(type_name)) {
+                sem_error("Operador ? exige um Result", type_name ? type_name : "?");
+                break;
+            }
+            if (!type_is_result(current_fn_return)) {
+                sem_error("Operador ? fora de funcao que retorna Result", type_name);
+                break;
+            }
+            char* err = type_arg(type_name, 1);
+            if (strcmp(err, type_arg(current_fn_return, 1)) != 0) {
+                sem_error("Tipo de erro incompativel com o retorno da funcao", type_name);
+            }
+            node->data.try_expr.fn_return_type = current_fn_return;
+            node->eval_type = type_arg(type_name, 0);
+            // O caminho de erro é um return: libera o que está vivo neste ponto
+            own_record_return(node);
+            break;
+        }
+
+        case AST_SPAWN: {
+            // Só dados com dono ou imutáveis cruzam para outra thread:
+            // argumentos com heap são movidos/copiados para a tarefa
+            ASTNode* call = node->data.spawn.call;
+            check_node(call, scope);
+            Symbol* fn = scope_resolve(scope, call->data.call.name);
+            if (!fn || fn->kind != SYM_FUNCTION || !fn->decl) {
+                sem_error("spawn exige uma funcao declarada", call->data.call.name);
+                break;
+            }
+            ASTNode* param = fn->decl->data.fn_decl.params;
+            for (ASTNode* arg = call->data.call.args; arg; arg = arg->next) {
+                if (param && param->data.var_decl.borrowed) {
+                    sem_error("Emprestimo &T nao pode cruzar tarefas", param->data.var_decl.name);
+                }
+                if (region_depth > 0 && is_owned_type(arg->eval_type)) {
+                    sem_error("Valor alocado na arena nao pode ir para outra tarefa", call->data.call.name);
+                }
+                check_line_escape(arg, scope, call->data.call.name);
+                // Quem recebe um canal pode bloquear: a tarefa não roda dentro de um join
+                if (holds_channel(arg->eval_type)) node->data.spawn.blocking = true;
+                if (param) param = param->next;
+            }
+
+            char* ret = call->eval_type ? call->eval_type : "void";
+            char* task = (char*)malloc(strlen(ret) + 8);
+            sprintf(task, "Task<%s>", ret);
+            resolve_type(task);
+            node->eval_type = task;
+            uses_tasks = true;
+            break;
+        }
+
+        case AST_YIELD: {
+            ASTNode* value = node->data.yield.value;
+            if (!current_gen_elem) {
+                sem_error("yield fora de gerador (a funcao deve devolver Gen<T>)", "yield");
+                break;
+            }
+            expected_type = current_gen_elem;
+            check_node(value, scope);
+            expected_type = NULL;
+            if (value->eval_type && strcmp(value->eval_type, current_gen_elem) != 0 &&
+                !(strcmp(current_gen_elem, "float") == 0 && strcmp(value->eval_type, "int") == 0)) {
+                sem_error("Tipo do yield difere do gerador", value->eval_type);
+            }
+            // O item passa a pertencer a quem itera
+            own_transfer(value);
+            check_line_escape(value, scope, "yield");
+            // A região seria liberada enquanto o gerador está suspenso
+            if (region_depth > 0) sem_error("yield dentro de arena", current_fn_return);
+            break;
+        }
+
+        case AST_AWAIT: {
+            ASTNode* expr = node->data.await.expr;
+            bool allowed = node->data.await.stmt || node == await_slot;
+            await_slot = NULL;
+            if (!current_async_ret) {
+                sem_error("await fora de async fn", current_fn_return ? current_fn_return : "await");
+                break;
+            }
+            if (!allowed) {
+                sem_error("await so pode ser o valor inteiro de uma declaracao, atribuicao ou return", "await");
+            }
+            // A região seria liberada enquanto a função está suspensa
+            if (region_depth > 0) sem_error("await dentro de arena", current_fn_return);
+
+            const IoBuiltin* io = expr->type == AST_CALL && !scope_resolve(scope, expr->data.call.name)
+                ? find_io_builtin(expr->data.call.name) : NULL;
+            if (io && io->async) {
+                check_io_call(expr, io, scope);
+                node->data.await.io = true;
+                node->eval_type = (char*)io->ret;
+                break;
+            }
+            check_node(expr, scope);
+            if (!type_is_async(expr->eval_type)) {
+                if (expr->eval_type) sem_error("await espera Async<T> ou uma operacao de I/O", expr->eval_type);
+                break;
+            }
+            // Esperar consome o Async
+            own_transfer(expr);
+            if (expr->type == AST_CALL) node->data.await.async_fn = expr->data.call.name;
+            node->eval_type = type_arg(expr->eval_type, 0);
+            break;
+        }
+
+        case AST_FOR_IN: {
+            ASTNode* source = node->data.for_in.source;
+            check_node(source, scope);
+            char* src = source->eval_type;
+            char* elem = NULL;
+            bool gen = type_is_gen(src);
+            if (gen) {
+                // Iterar consome o gerador
+                elem = type_arg(src, 0);
+                own_transfer(source);
+                if (source->type == AST_CALL) node->data.for_in.gen_fn = source->data.call.name;
+            } else if (type_is_list(src)) {
+                elem = type_arg(src, 0);
+            } else if (type_is_map(src)) {
+                elem = type_arg(src, 0);
+            } else if (src) {
+                elem = type_array_elem(src);
+            }
+            if (!elem) {
+                if (src) sem_error("for-in espera Gen<T>, List<T>, Map<K, V> ou array", src);
+                break;
+            }
+
+            char* var_type = node->data.for_in.var_type;
+            resolve_type(var_type);
+            if (strcmp(var_type, elem) != 0) {
+                sem_error("Tipo da variavel do for-in difere dos itens", var_type);
+            }
+            // for (K k, V v in mapa): chave e valor de cada slot ocupado
+            char* val_type = node->data.for_in.val_type;
+            if (val_type) {
+                resolve_type(val_type);
+                if (!type_is_map(src)) {
+                    sem_error("for-in com chave e valor espera Map<K, V>", src);
+                    break;
+                }
+                if (strcmp(val_type, type_arg(src, 1)) != 0) {
+                    sem_error("Tipo do valor do for-in difere do Map", val_type);
+                }
+            }
+
+            // A variável é nova a cada iteração: itens de um gerador são dela
+            // (liberados no fim da volta); itens de List/array são emprestados
+            Scope* loop_scope = scope_new(scope);
+            int owned_base = owned_top;
+            ctrl_depth++;
+            scope_define(loop_scope, node->data.for_in.var_name, var_type, SYM_VAR);
+            Symbol* item_sym = scope_resolve(loop_scope, node->data.for_in.var_name);
+            if (gen) {
+                gen_local(scope, item_sym, var_type);
+            } else {
+                // Emprestada: o frame não pode liberá-la, então não divide nome com uma dona
+                char* key = (char*)malloc(strlen(var_type) + 2);
+                sprintf(key, "&%s", var_type);
+                gen_local(scope, item_sym, key);
+            }
+            own_declare(item_sym, !gen);
+            if (item_sym->c_name) node->data.for_in.var_name = item_sym->c_name;
+            // Linhas de File.lines apontam para o buffer do leitor e não saem da volta
+            bool lines = gen && strcmp(elem, "string") == 0 && lines_gen_of(source, scope);
+            if (lines) lines_depth++;
+            item_sym->lines_depth = lines_depth;
+            item_sym->lines_item = lines ? lines_depth : 0;
+            item_sym->lines_gen = strstr(var_type, "Gen<string>") != NULL;
+            if (val_type) {
+                scope_define(loop_scope, node->data.for_in.val_name, val_type, SYM_VAR);
+                Symbol* val_sym = scope_resolve(loop_scope, node->data.for_in.val_name);
+                char* key = (char*)malloc(strlen(val_type) + 2);
+                sprintf(key, "&%s", val_type);
+                gen_local(scope, val_sym, key);
+                own_declare(val_sym, true);
+                val_sym->lines_depth = lines_depth;
+                val_sym->lines_gen = strstr(val_type, "Gen<string>") != NULL;
+                if (val_sym->c_name) node->data.for_in.val_name = val_sym->c_name;
+            }
+            check_node(node->data.for_in.body, loop_scope);
+            if (lines) lines_depth--;
+            own_close_scope(owned_base, node);
+            ctrl_depth--;
+            break;
+        }
+
+        case AST_IF:
+            check_node(node->data.if_stmt.condition, scope);
+            ctrl_depth++;
+            check_node(node->data.if_stmt.then_branch, scope);
+            check_node(node->data.if_stmt.else_branch, scope);
+            ctrl_depth--;
+            break;
+
+        case AST_BENCH:
+            // O harness roda no main, onde ficam as variáveis que o corpo lê
+            if (current_fn_return || bench_node) {
+                sem_error("bench so pode ficar no nivel superior do programa", node->data.bench.name);
+                break;
+            }
+            uses_clock = true;
+            bench_outer = scope;
+            bench_node = node;
+            // O corpo repete: valores de fora são copiados, nunca movidos
+            ctrl_depth++;
+            check_node(node->data.bench.body, scope);
+            ctrl_depth--;
+            bench_outer = NULL;
+            bench_node = NULL;
+            break;
+
+        case AST_ARENA:
+            region_depth++;
+            check_node(node->data.arena.body, scope);
+            region_depth--;
+            break;
+
+        case AST_WHILE:
+            ctrl_depth++;
+            check_node(node->data.while_loop.condition, scope);
+            check_node(node->data.while_loop.body, scope);
+            ctrl_depth--;
+            break;
+
+        case AST_FOR: {
+            // A variável do init vive apenas no escopo do for
+            Scope* for_scope = scope_new(scope);
+            int owned_base = owned_top;
+            bool parallel = ast_has_annotation(node, "parallel");
+            if (parallel && (current_gen_elem || current_async_ret)) {
+                sem_error("@parallel dentro de gerador/async fn nao e suportado", current_fn_return);
+                parallel = false;
+            }
+            // O corpo paralelo roda em workers, que alocam fora da arena de quem chamou
+            int saved_region = region_depth;
+            if (parallel) region_depth = 0;
+            // O cabeçalho do for vira uma expressão C: não tem onde suspender
+            ASTNode* init = node->data.for_loop.init;
+            ASTNode* step = node->data.for_loop.step;
+            if ((init && init->type == AST_VAR_DECL && init->data.var_decl.value &&
+                 init->data.var_decl.value->type == AST_AWAIT) ||
+                (step && step->type == AST_ASSIGN && step->data.assign.value->type == AST_AWAIT)) {
+                sem_error("await nao pode ficar no cabecalho do for", current_fn_return);
+            }
+            check_node(node->data.for_loop.init, for_scope);
+            ctrl_depth++;
+            check_node(node->data.for_loop.condition, for_scope);
+            check_node(node->data.for_loop.step, for_scope);
+            check_node(node->data.for_loop.body, for_scope);
+            ctrl_depth--;
+            own_close_scope(owned_base, NULL);
+            region_depth = saved_region;
+            if (parallel) check_parallel_for(node, scope);
+            break;
+        }
+
+        case AST_MODULE:
+        case AST_IMPORT:
+            sem_error("module/import so no nivel superior do arquivo", node->data.module.name);
             break;
 
         default:
@@ -126,4 +2344,84 @@ int semantic_analysis(ASTNode* root) {
     error_count = 0;
     check_node(root, NULL);
     return error_count == 0;
-}
\ No newline at end of file
+}
+
+void semantic_stream_begin(ASTNode* decls) {
+    error_count = 0;
+    program_begin(decls);
+}
+
+int semantic_stream_item(ASTNode* item) {
+    check_node(item, global_scope);
+    check_unused_result(item);
+    return error_count == 0;
+}
+
+int semantic_stream_end(ASTNode* program) {
+    program_end(program);
+    return error_count == 0;
+}
+
+int semantic_use_seq(void) {
+    return use_seq;
+}
+
+// No nível superior a pilha de ownership só tem as globais
+int semantic_last_use_in(int from, int to) {
+    for (int i = 0; i < owned_top; i++) {
+        OwnedVar* v = owned_stack[i];
+        if (v->last_use && v->last_use_seq > from && v->last_use_seq <= to) return 1;
+    }
+    return 0;
+}
+
+void semantic_forget_uses(int from, int to) {
+    for (int i = 0; i < owned_top; i++) {
+        OwnedVar* v = owned_stack[i];
+        if (v->last_use && v->last_use_seq > from && v->last_use_seq <= to) v->last_use = NULL;
+    }
+}
+
+int semantic_copy_checks(void) {
+    return task_copy_count;
+}
+
+ASTNode* semantic_instances(void) {
+    return instances;
+}
+
+ASTNode* semantic_owned_types(void) {
+    return owned_types;
+}
+
+int semantic_uses_tasks(void) {
+    return uses_tasks;
+}
+
+int semantic_uses_clock(void) {
+    return uses_clock;
+}
+
+int semantic_uses_maps(void) {
+    return uses_maps;
+}
+
+int semantic_uses_channels(void) {
+    return uses_channels;
+}
+
+int semantic_uses_io(void) {
+    return uses_io;
+}
+
+int semantic_uses_files(void) {
+    return uses_files;
+}
+
+int semantic_is_owned(const char* type_name) {
+    if (!type_name) return 0;
+    for (ASTNode* t = owned_types; t; t = t->next) {
+        if (strcmp(t->data.ident.name, type_name) == 0) return 1;
+    }
+    return 0;
+}
@@ -7,4 +7,52 @@
 // Retorna 1 se sucesso, 0 se encontrou erros semânticos
 int semantic_analysis(ASTNode* root);
 
+// --stream (stream.c): o programa verificado um item de nível superior por
+// vez. decls tem as classes e as assinaturas das funções, registradas antes
+// como no programa inteiro; no fim as globais não movidas vão para os drops
+// de program. semantic_stream_item/end retornam 1 se não houve erros até ali.
+void semantic_stream_begin(ASTNode* decls);
+int semantic_stream_item(ASTNode* item);
+int semantic_stream_end(ASTNode* program);
+
+// Usos de variáveis com heap são numerados em ordem (semantic_use_seq antes
+// e depois de um item dá o intervalo dele). O último uso de uma global só
+// vira move no fim do programa, então o item que o contém precisa continuar
+// vivo até lá ou até a global ser usada de novo. semantic_forget_uses desiste
+// dos moves no intervalo: esses usos ficam como cópia e a global é liberada no fim.
+int semantic_use_seq(void);
+int semantic_last_use_in(int from, int to);
+void semantic_forget_uses(int from, int to);
+
+// Task/Gen/Async/FileWriter passados adiante até agora: cada um só é
+// validado (move, não cópia) no fim
+int semantic_copy_checks(void);
+
+// Instâncias de genéricos (classes e funções) na ordem em que foram
+// encontradas, já com os tipos concretos. Cada uma aparece uma única vez.
+ASTNode* semantic_instances(void);
+
+// Tipos com heap (arrays, List<T> e classes que os contêm) usados no programa:
+// o codegen gera rujo_drop_* / rujo_clone_* para cada um (lista de AST_IDENTIFIER)
+ASTNode* semantic_owned_types(void);
+int semantic_is_owned(const char* type_name);
+
+// O programa usa spawn: o runtime de tarefas é incluído no binário
+int semantic_uses_tasks(void);
+
+// O programa usa Channel<T> / SpscChannel<T>: inclui o runtime de canais
+int semantic_uses_channels(void);
+
+// O programa usa Map<K, V>: inclui o runtime de tabelas hash
+int semantic_uses_maps(void);
+
+// O programa usa now_ns/cycles/keep ou bench: inclui o relógio e o harness
+int semantic_uses_clock(void);
+
+// O programa usa async fn / io_run: o runtime de I/O (io_uring ou epoll) entra no out.c
+int semantic_uses_io(void);
+
+// O programa usa File.* / FileWriter: inclui o runtime de arquivos (mmap, linhas, escrita)
+int semantic_uses_files(void);
+
 #endif
\ No newline at end of file
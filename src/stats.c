@@ -0,0 +1,233 @@
+#define _XOPEN_SOURCE 700 // clock_gettime, getrusage
+#include "stats.h"
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+int64_t stat_counters[STAT_COUNTERS];
+
+static const char* counter_names[STAT_COUNTERS] = { "lines", "tokens", "nodes", "symbols", "c_bytes" };
+
+// --- Alocações -------------------------------------------------------------
+// Na glibc o malloc do compilador é substituído por um que conta chamadas e
+// bytes vivos (malloc_usable_size) antes de repassar ao da libc. Fora dela as
+// colunas de alocação ficam zeradas.
+// As threads do codegen (--jobs) alocam ao mesmo tempo: contadores atômicos
+static int counting = 0;
+static _Atomic int64_t alloc_count = 0;
+static _Atomic int64_t live_bytes = 0;
+static _Atomic int64_t peak_bytes = 0;
+
+#ifdef __GLIBC__
+#include <malloc.h>
+extern void* __libc_malloc(size_t n);
+extern void* __libc_calloc(size_t n, size_t size);
+extern void* __libc_realloc(void* p, size_t n);
+extern void __libc_free(void* p);
+
+static void note_alloc(void* p) {
+    alloc_count++;
+    live_bytes += (int64_t)malloc_usable_size(p);
+    if (live_bytes > peak_bytes) peak_bytes = live_bytes;
+}
+
+void* malloc(size_t n) {
+    void* p = __libc_malloc(n);
+    if (counting && p) note_alloc(p);
+    return p;
+}
+
+void* calloc(size_t n, size_t size) {
+    void* p = __libc_calloc(n, size);
+    if (counting && p) note_alloc(p);
+    return p;
+}
+
+void* realloc(void* p, size_t n) {
+    if (!counting) return __libc_realloc(p, n);
+    int64_t old = p ? (int64_t)malloc_usable_size(p) : 0;
+    void* q = __libc_realloc(p, n);
+    if (!q) return NULL;
+    if (!p) alloc_count++;
+    live_bytes += (int64_t)malloc_usable_size(q) - old;
+    if (live_bytes > peak_bytes) peak_bytes = live_bytes;
+    return q;
+}
+
+void free(void* p) {
+    if (counting && p) live_bytes -= (int64_t)malloc_usable_size(p);
+    __libc_free(p);
+}
+#endif
+
+void stats_enable(void) {
+    counting = 1;
+}
+
+// --- Relógio ---------------------------------------------------------------
+static int64_t wall_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+#ifndef _WIN32
+static int64_t tv_ns(struct timeval tv) {
+    return (int64_t)tv.tv_sec * 1000000000 + (int64_t)tv.tv_usec * 1000;
+}
+#endif
+
+// CPU do compilador mais a dos filhos já esperados (o gcc roda via system)
+static int64_t cpu_now(void) {
+#ifdef _WIN32
+    return (int64_t)clock() * (1000000000 / CLOCKS_PER_SEC);
+#else
+    struct rusage self, kids;
+    getrusage(RUSAGE_SELF, &self);
+    getrusage(RUSAGE_CHILDREN, &kids);
+    return tv_ns(self.ru_utime) + tv_ns(self.ru_stime) + tv_ns(kids.ru_utime) + tv_ns(kids.ru_stime);
+#endif
+}
+
+void stat_timer_start(StatTimer* t) {
+    t->wall_ns = wall_now();
+    t->cpu_ns = cpu_now();
+}
+
+StatTimer stat_timer_elapsed(const StatTimer* t) {
+    StatTimer e;
+    e.wall_ns = wall_now() - t->wall_ns;
+    e.cpu_ns = cpu_now() - t->cpu_ns;
+    return e;
+}
+
+// Pico de memória residente do compilador e do maior filho, em KB
+static void max_rss(int64_t* self_kb, int64_t* kids_kb) {
+#ifdef _WIN32
+    *self_kb = *kids_kb = 0;
+#else
+    struct rusage r;
+    getrusage(RUSAGE_SELF, &r);
+    *self_kb = r.ru_maxrss;
+    getrusage(RUSAGE_CHILDREN, &r);
+    *kids_kb = r.ru_maxrss;
+#endif
+}
+
+// --- Fases -----------------------------------------------------------------
+typedef struct {
+    const char* name;
+    StatTimer time;      // durante a fase: início; depois: duração
+    int64_t allocs;
+    int64_t peak;        // pico de heap da fase (bytes vivos)
+    int child;
+} Phase;
+
+#define MAX_PHASES 16
+static Phase phases[MAX_PHASES];
+static int phase_count = 0;
+static int phase_open = 0;
+
+void phase_begin(const char* name) {
+    if (phase_open) phase_end();
+    if (phase_count == MAX_PHASES) return;
+    Phase* p = &phases[phase_count];
+    p->name = name;
+    p->allocs = alloc_count;
+    p->child = 0;
+    // O pico da fase parte do que já estava vivo quando ela começou
+    peak_bytes = live_bytes;
+    stat_timer_start(&p->time);
+    phase_open = 1;
+}
+
+void phase_begin_child(const char* name) {
+    phase_begin(name);
+    if (phase_open) phases[phase_count].child = 1;
+}
+
+void phase_end(void) {
+    if (!phase_open) return;
+    Phase* p = &phases[phase_count++];
+    p->time = stat_timer_elapsed(&p->time);
+    p->allocs = alloc_count - p->allocs;
+    p->peak = peak_bytes;
+    if (p->child) {
+        int64_t self_kb, kids_kb;
+        max_rss(&self_kb, &kids_kb);
+        p->peak = kids_kb * 1024;
+    }
+    phase_open = 0;
+}
+
+static void fmt_bytes(char* buf, size_t n, int64_t b) {
+    if (b < 1024) snprintf(buf, n, "%lld B", (long long)b);
+    else if (b < 1024 * 1024) snprintf(buf, n, "%.1f KB", b / 1024.0);
+    else snprintf(buf, n, "%.1f MB", b / (1024.0 * 1024.0));
+}
+
+static double lines_per_s(const Phase* p) {
+    return p->time.wall_ns > 0 ? (double)stat_counters[STAT_LINES] * 1e9 / (double)p->time.wall_ns : 0;
+}
+
+void stats_report(FILE* out) {
+    if (phase_open) phase_end();
+    fprintf(out, "\n== tempo por fase (%lld linhas, %lld tokens, %lld nos, %lld simbolos, %lld bytes de C) ==\n",
+        (long long)stat_counters[STAT_LINES], (long long)stat_counters[STAT_TOKENS],
+        (long long)stat_counters[STAT_NODES], (long long)stat_counters[STAT_SYMBOLS],
+        (long long)stat_counters[STAT_C_BYTES]);
+    fprintf(out, "%-10s %12s %12s %10s %11s %13s\n", "fase", "parede", "cpu", "alocacoes", "pico heap", "linhas/s");
+    StatTimer total = { 0, 0 };
+    for (int i = 0; i < phase_count; i++) {
+        Phase* p = &phases[i];
+        char peak[32];
+        fmt_bytes(peak, sizeof(peak), p->peak);
+        fprintf(out, "%-10s %9.3f ms %9.3f ms %10lld %11s %13.0f\n", p->name, p->time.wall_ns / 1e6,
+            p->time.cpu_ns / 1e6, (long long)p->allocs, peak, lines_per_s(p));
+        total.wall_ns += p->time.wall_ns;
+        total.cpu_ns += p->time.cpu_ns;
+    }
+    fprintf(out, "%-10s %9.3f ms %9.3f ms\n", "total", total.wall_ns / 1e6, total.cpu_ns / 1e6);
+    int64_t self_kb, kids_kb;
+    max_rss(&self_kb, &kids_kb);
+    fprintf(out, "RSS maximo: compilador %.1f MB, gcc %.1f MB\n", self_kb / 1024.0, kids_kb / 1024.0);
+}
+
+static void json_string(FILE* f, const char* s) {
+    fputc('"', f);
+    for (; *s; s++) {
+        unsigned char c = (unsigned char)*s;
+        if (c == '"' || c == '\\') fprintf(f, "\\%c", c);
+        else if (c < 0x20) fprintf(f, "\\u%04x", c);
+        else fputc(c, f);
+    }
+    fputc('"', f);
+}
+
+int stats_write_json(const char* path, const char* source) {
+    if (phase_open) phase_end();
+    FILE* f = fopen(path, "w");
+    if (!f) return 0;
+    fprintf(f, "{\n  \"file\": ");
+    json_string(f, source);
+    for (int c = 0; c < STAT_COUNTERS; c++) {
+        fprintf(f, ",\n  \"%s\": %lld", counter_names[c], (long long)stat_counters[c]);
+    }
+    fprintf(f, ",\n  \"phases\": [");
+    for (int i = 0; i < phase_count; i++) {
+        Phase* p = &phases[i];
+        fprintf(f, "%s\n    {\"name\": ", i ? "," : "");
+        json_string(f, p->name);
+        fprintf(f, ", \"wall_ms\": %.3f, \"cpu_ms\": %.3f, \"allocs\": %lld, \"peak_heap_bytes\": %lld, "
+                   "\"lines_per_s\": %.0f}",
+            p->time.wall_ns / 1e6, p->time.cpu_ns / 1e6, (long long)p->allocs, (long long)p->peak, lines_per_s(p));
+    }
+    int64_t self_kb, kids_kb;
+    max_rss(&self_kb, &kids_kb);
+    fprintf(f, "\n  ],\n  \"max_rss_kb\": %lld,\n  \"gcc_max_rss_kb\": %lld\n}\n", (long long)self_kb, (long long)kids_kb);
+    fclose(f);
+    return 1;
+}
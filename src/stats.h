@@ -0,0 +1,49 @@
+#ifndef RUJO_STATS_H
+#define RUJO_STATS_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+// Medição do próprio compilador (--time-report). Cada fase registra tempo de
+// parede, CPU (incluindo processos filhos, ex: gcc), alocações e pico de heap;
+// os contadores somam o volume de trabalho (tokens, nós, símbolos...).
+
+typedef enum {
+    STAT_LINES,     // linhas do .rj
+    STAT_TOKENS,
+    STAT_NODES,     // nós da AST criados
+    STAT_SYMBOLS,   // símbolos definidos nos escopos
+    STAT_C_BYTES,   // tamanho do C gerado
+    STAT_COUNTERS
+} StatCounter;
+
+extern int64_t stat_counters[STAT_COUNTERS];
+
+static inline void stat_add(StatCounter c, int64_t n) {
+    stat_counters[c] += n;
+}
+
+// Relógio de uma medida: parede e CPU do processo (e dos filhos)
+typedef struct {
+    int64_t wall_ns;
+    int64_t cpu_ns;
+} StatTimer;
+
+void stat_timer_start(StatTimer* t);
+// Tempo desde o start (o timer não muda)
+StatTimer stat_timer_elapsed(const StatTimer* t);
+
+// Liga a contagem de alocações do compilador (só glibc)
+void stats_enable(void);
+
+// Fases em sequência: phase_begin fecha a anterior se ainda aberta
+void phase_begin(const char* name);
+// Fase que roda outro processo (gcc): o pico é o RSS máximo dos filhos
+void phase_begin_child(const char* name);
+void phase_end(void);
+
+// Tabela em out / JSON em path (0 se não conseguiu escrever)
+void stats_report(FILE* out);
+int stats_write_json(const char* path, const char* source);
+
+#endif
@@ -0,0 +1,220 @@
+#include "stream.h"
+#include "lexer.h"
+#include "parser.h"
+#include "semantic.h"
+#include "codegen.h"
+#include "types.h"
+#include "utils.h"
+#include "stats.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+// rujo --stream: em vez de montar a AST do programa inteiro, o fonte é lido
+// duas vezes, um item de nível superior por vez, cada um na sua região.
+//   1. declarações: guarda só as classes, as funções genéricas e as
+//      assinaturas das outras funções (o que o resto do programa precisa ver
+//      antes, como no programa inteiro) e libera o resto
+//   2. cada item é verificado e gerado assim que sai do parser e a região é
+//      liberada; as funções vão para um arquivo de corpos e os statements
+//      soltos para um do main
+// No fim o out.c é montado: cabeçalho (que depende do programa todo),
+// geradores e async fn, corpos e main. Ficam na memória até o fim só as
+// declarações, as instâncias de genéricos, os geradores/async fn (o frame é
+// montado a partir do programa todo), os itens com spawn ou @parallel (os
+// thunks saem no cabeçalho) e os que passam Task/Gen/Async/FileWriter adiante
+// (o move é validado no fim).
+
+// Statements do main esperando para serem gerados: o último uso de uma
+// global só vira move no fim, então o statement que o tem espera até a
+// global ser usada de novo. Com mais de STREAM_HOLD na fila o da frente
+// desiste do move (o uso fica como cópia e a global é liberada no fim).
+#define STREAM_HOLD 256
+
+typedef struct {
+    ASTNode* stmt;
+    Region* region;
+    int from, to;   // usos numerados no statement (semantic_use_seq)
+    bool pinned;    // a região fica até o fim
+    bool copies;    // passou Task/Gen/Async/FileWriter adiante: não desiste do move
+} Pending;
+
+static Pending* pending = NULL;
+static int pending_head = 0, pending_count = 0, pending_cap = 0;
+
+static void pending_push(Pending p) {
+    if (pending_head > 0 && pending_head + pending_count == pending_cap) {
+        memmove(pending, pending + pending_head, sizeof(Pending) * (size_t)pending_count);
+        pending_head = 0;
+    }
+    if (pending_count == pending_cap) {
+        pending_cap = pending_cap ? pending_cap * 2 : 64;
+        pending = realloc(pending, sizeof(Pending) * (size_t)pending_cap);
+    }
+    pending[pending_head + pending_count++] = p;
+}
+
+// Gera (se não houve erros) e libera os statements da frente que já podem sair
+static void pending_flush(FILE* main_part, bool ok) {
+    while (pending_count > 0) {
+        Pending* p = &pending[pending_head];
+        if (semantic_last_use_in(p->from, p->to)) {
+            if (pending_count <= STREAM_HOLD || p->copies) return;
+            semantic_forget_uses(p->from, p->to);
+        }
+        if (ok) {
+            region_activate(p->region);
+            codegen_stream_stmt(p->stmt, main_part);
+            region_activate(NULL);
+        }
+        if (!p->pinned) region_free(p->region);
+        pending_head++;
+        pending_count--;
+    }
+}
+
+// spawn e @parallel: os thunks e os corpos das fatias saem no cabeçalho
+static void find_pinned(ASTNode* node, void* ctx) {
+    if (node->type == AST_SPAWN || (node->type == AST_FOR && ast_has_annotation(node, "parallel"))) {
+        *(bool*)ctx = true;
+    }
+}
+
+static bool is_generator(ASTNode* item) {
+    return item->type == AST_FN_DECL &&
+           (type_is_gen(item->data.fn_decl.return_type) || type_is_async(item->data.fn_decl.return_type));
+}
+
+// Item guardado do primeiro passo (NULL se não for declaração)
+static ASTNode* declaration_of(ASTNode* item) {
+    if (item->type == AST_CLASS_DECL || (item->type == AST_FN_DECL && item->data.fn_decl.type_params)) {
+        return ast_clone(item, NULL, NULL);
+    }
+    if (item->type != AST_FN_DECL) return NULL;
+    ASTNode* body = item->data.fn_decl.body;
+    item->data.fn_decl.body = NULL;
+    ASTNode* sig = ast_clone(item, NULL, NULL);
+    item->data.fn_decl.body = body;
+    return sig;
+}
+
+int stream_compile(const char* filename, FILE* out) {
+    size_t length;
+    const char* source = map_file(filename, &length);
+    if (!source) exit(1);
+    Lexer l;
+
+    phase_begin("declaracoes");
+    lexer_init_len(&l, source, length);
+    parser_init(&l);
+    ASTNode* decls = NULL;
+    ASTNode* decls_tail = NULL;
+    while (1) {
+        map_file_release(source, parser_offset(&l));
+        Region* region = region_new();
+        region_activate(region);
+        ASTNode* item = parser_next_decl(&l);
+        region_activate(NULL);
+        // Um arquivo só: module é aceito (e ignorado), import não
+        if (item && item->type == AST_IMPORT) {
+            printf("Erro: --stream nao suporta import (linha %d)\n", item->line);
+            exit(1);
+        }
+        ASTNode* decl = item ? declaration_of(item) : NULL;
+        region_free(region);
+        if (!item) break;
+        if (!decl) continue;
+        if (!decls) decls = decl;
+        else decls_tail->next = decl;
+        decls_tail = decl;
+    }
+    stat_add(STAT_LINES, l.line - (length > 0 && source[length - 1] == '\n'));
+
+    phase_begin("stream");
+    semantic_stream_begin(decls);
+    codegen_stream_begin(decls);
+    FILE* bodies = tmpfile();
+    FILE* main_part = tmpfile();
+    if (!bodies || !main_part) {
+        printf("Erro: Nao foi possivel criar os arquivos temporarios do --stream\n");
+        exit(1);
+    }
+    ASTNode* deferred = NULL;
+    ASTNode* deferred_tail = NULL;
+    ASTNode* decl = decls;
+    bool ok = true;
+
+    lexer_init_len(&l, source, length);
+    parser_init(&l);
+    while (1) {
+        map_file_release(source, parser_offset(&l));
+        Region* region = region_new();
+        region_activate(region);
+        ASTNode* item = parser_next_decl(&l);
+        region_activate(NULL);
+        if (!item || item->type == AST_MODULE) {
+            region_free(region);
+            if (!item) break;
+            continue;
+        }
+
+        // Classes e funções genéricas: vale a cópia do primeiro passo, para
+        // onde o escopo global e as instâncias já apontam
+        if (item->type == AST_CLASS_DECL || (item->type == AST_FN_DECL && item->data.fn_decl.type_params)) {
+            region_free(region);
+            item = decl;
+            decl = decl->next;
+            ok = semantic_stream_item(item) && ok;
+            if (ok) codegen_stream_item(item, bodies);
+            continue;
+        }
+        if (item->type == AST_FN_DECL) decl = decl->next;
+
+        int from = semantic_use_seq();
+        int copies = semantic_copy_checks();
+        region_activate(region);
+        ok = semantic_stream_item(item) && ok;
+        region_activate(NULL);
+        int to = semantic_use_seq();
+        bool pinned = semantic_copy_checks() != copies;
+        ast_visit(item, find_pinned, &pinned);
+
+        if (item->type != AST_FN_DECL) {
+            Pending p = { item, region, from, to, pinned, semantic_copy_checks() != copies };
+            pending_push(p);
+            pending_flush(main_part, ok);
+        } else if (is_generator(item)) {
+            // O frame depende do programa todo: gerado no fim
+            if (!deferred) deferred = item;
+            else deferred_tail->next = item;
+            deferred_tail = item;
+        } else {
+            if (ok) {
+                region_activate(region);
+                codegen_stream_item(item, bodies);
+                region_activate(NULL);
+            }
+            // Uma função que usa uma global por último ainda pode ter o move marcado no fim
+            if (!pinned && !semantic_last_use_in(from, to)) region_free(region);
+        }
+    }
+
+    phase_begin("montagem");
+    ASTNode* program = ast_new_program(NULL);
+    ok = semantic_stream_end(program) && ok;
+    if (!ok) return 0;
+
+    // O que ficou na fila vai para o fim do main, já com os moves decididos
+    ASTNode* rest = NULL;
+    ASTNode* rest_tail = NULL;
+    for (int i = 0; i < pending_count; i++) {
+        ASTNode* stmt = pending[pending_head + i].stmt;
+        if (!rest) rest = stmt;
+        else rest_tail->next = stmt;
+        rest_tail = stmt;
+    }
+    codegen_stream_finish(deferred, rest, program->drops, bodies, main_part, out);
+    fclose(bodies);
+    fclose(main_part);
+    return 1;
+}
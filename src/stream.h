@@ -0,0 +1,10 @@
+#ifndef RUJO_STREAM_H
+#define RUJO_STREAM_H
+
+#include <stdio.h>
+
+// --stream: compila o .rj um item de nível superior por vez e escreve o C em
+// out. Retorna 0 se houve erros semânticos (out fica vazio).
+int stream_compile(const char* filename, FILE* out);
+
+#endif
@@ -1,16 +1,22 @@
 #include "symbol_table.h"
+#include "stats.h"
+#include "utils.h"
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
 
 Scope* scope_new(Scope* parent) {
-    Scope* s = (Scope*)malloc(sizeof(Scope));
+    Scope* s = (Scope*)region_alloc(sizeof(Scope));
     s->parent = parent;
     s->symbols = NULL;
     s->level = parent ? parent->level + 1 : 0;
+    s->count = 0;
+    s->buckets = NULL;
+    s->bucket_count = 0;
     return s;
 }
 
+// Só para escopos criados sem região ativa (os de uma região saem com ela)
 void scope_free(Scope* scope) {
     Symbol* current = scope->symbols;
     while (current) {
@@ -18,35 +24,81 @@ void scope_free(Scope* scope) {
         free(current);
         current = next;
     }
+    free(scope->buckets);
     free(scope);
 }
 
-int scope_define(Scope* scope, char* name, char* type, SymbolKind kind) {
-    Symbol* s = scope->symbols;
+// Escopos grandes (o global com milhares de funções, classes com muitos
+// membros) ganham um índice por hash; até SCOPE_INDEX_MIN símbolos a lista basta
+#define SCOPE_INDEX_MIN 32
+
+static unsigned symbol_hash(const char* name) {
+    unsigned h = 2166136261u;
+    for (; *name; name++) h = (h ^ (unsigned char)*name) * 16777619u;
+    return h;
+}
+
+// O índice fica no malloc mesmo com uma região ativa (cresce com realloc)
+static void scope_index(Scope* scope) {
+    free(scope->buckets);
+    scope->bucket_count = scope->bucket_count ? scope->bucket_count * 2 : SCOPE_INDEX_MIN * 2;
+    scope->buckets = (Symbol**)calloc((size_t)scope->bucket_count, sizeof(Symbol*));
+    for (Symbol* s = scope->symbols; s; s = s->next) {
+        unsigned b = symbol_hash(s->name) & (unsigned)(scope->bucket_count - 1);
+        s->bucket_next = scope->buckets[b];
+        scope->buckets[b] = s;
+    }
+}
+
+static Symbol* scope_find(Scope* scope, const char* name) {
+    Symbol* s = scope->buckets
+        ? scope->buckets[symbol_hash(name) & (unsigned)(scope->bucket_count - 1)]
+        : scope->symbols;
     while (s) {
         if (strcmp(s->name, name) == 0) {
-            return 0; 
+            return s;
         }
-        s = s->next;
+        s = scope->buckets ? s->bucket_next : s->next;
+    }
+    return NULL;
+}
+
+int scope_define(Scope* scope, char* name, char* type, SymbolKind kind) {
+    if (scope_find(scope, name)) {
+        return 0; 
     }
 
-    Symbol* new_sym = (Symbol*)malloc(sizeof(Symbol));
+    Symbol* new_sym = (Symbol*)region_alloc(sizeof(Symbol));
     new_sym->name = name; 
     new_sym->type_name = type;
     new_sym->kind = kind;
+    new_sym->members = NULL;
+    new_sym->decl = NULL;
+    new_sym->owned = NULL;
+    new_sym->owned_memo = 0;
+    new_sym->c_name = NULL;
+    new_sym->lines_depth = 0;
+    new_sym->lines_item = 0;
+    new_sym->lines_gen = 0;
+    new_sym->mapped = 0;
     
     new_sym->next = scope->symbols;
     scope->symbols = new_sym;
+    if (++scope->count >= SCOPE_INDEX_MIN && scope->count > scope->bucket_count) {
+        scope_index(scope);
+    } else if (scope->buckets) {
+        unsigned b = symbol_hash(name) & (unsigned)(scope->bucket_count - 1);
+        new_sym->bucket_next = scope->buckets[b];
+        scope->buckets[b] = new_sym;
+    }
+    stat_add(STAT_SYMBOLS, 1);
     return 1; 
 }
 
 Symbol* scope_resolve(Scope* scope, char* name) {
-    Symbol* s = scope->symbols;
-    while (s) {
-        if (strcmp(s->name, name) == 0) {
-            return s;
-        }
-        s = s->next;
+    Symbol* s = scope_find(scope, name);
+    if (s) {
+        return s;
     }
 
     if (scope->parent) {
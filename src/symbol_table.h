@@ -8,17 +8,33 @@ typedef enum {
     SYM_FUNCTION
 } SymbolKind;
 
+struct ASTNode;
+struct OwnedVar;
+
 typedef struct Symbol {
     char* name;
     char* type_name; // "int", "string", "Heroi"
     SymbolKind kind;
+    struct Scope* members; // Classes: escopo com props e métodos
+    struct ASTNode* decl;  // Funções e genéricos: declaração
+    struct OwnedVar* owned; // Variáveis com heap: estado de ownership
+    int owned_memo;        // Classes: 1 com heap, -1 sem, 0 ainda não calculado
+    char* c_name;          // Nome no C, se outro (variável renomeada no gerador)
+    int lines_depth;       // Laços de File.lines abertos na declaração
+    int lines_item;        // Guarda uma linha de File.lines: nível do laço dela (0 se não)
+    int lines_gen;         // Pode guardar o gerador de File.lines
+    int mapped;            // Guarda o byte[] de File.map (só leitura)
     struct Symbol* next; // Lista ligada (colisões ou lista simples)
+    struct Symbol* bucket_next; // Mesmo balde do índice do escopo
 } Symbol;
 
 typedef struct Scope {
     struct Scope* parent; // Escopo pai (para subir a escada na busca)
     Symbol* symbols;      // Lista de símbolos deste escopo
     int level;            // Debug: nível de indentação
+    int count;
+    Symbol** buckets;     // Índice por hash (NULL em escopos pequenos)
+    int bucket_count;
 } Scope;
 
 // API
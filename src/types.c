@@ -0,0 +1,164 @@
+#include "types.h"
+#include "utils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+char* type_array_elem(const char* type_name) {
+    if (!type_name) return NULL;
+    size_t len = strlen(type_name);
+    if (len < 3 || strcmp(type_name + len - 2, "[]") != 0) return NULL;
+    return rujo_strndup(type_name, len - 2);
+}
+
+char* type_base(const char* type_name) {
+    const char* lt = strchr(type_name, '<');
+    if (!lt) return rujo_strdup(type_name);
+    return rujo_strndup(type_name, lt - type_name);
+}
+
+int type_is_list(const char* type_name) {
+    return type_name && strncmp(type_name, "List<", 5) == 0;
+}
+
+int type_is_map(const char* type_name) {
+    return type_name && strncmp(type_name, "Map<", 4) == 0;
+}
+
+int type_is_result(const char* type_name) {
+    return type_name && strncmp(type_name, "Result<", 7) == 0;
+}
+
+int type_is_task(const char* type_name) {
+    return type_name && strncmp(type_name, "Task<", 5) == 0;
+}
+
+int type_is_gen(const char* type_name) {
+    return type_name && strncmp(type_name, "Gen<", 4) == 0;
+}
+
+int type_is_async(const char* type_name) {
+    return type_name && strncmp(type_name, "Async<", 6) == 0;
+}
+
+int type_is_file_writer(const char* type_name) {
+    return type_name && strcmp(type_name, "FileWriter") == 0;
+}
+
+int type_is_channel(const char* type_name) {
+    return type_name && (strncmp(type_name, "Channel<", 8) == 0 || strncmp(type_name, "SpscChannel<", 12) == 0);
+}
+
+// Percorre os argumentos de nível superior entre < >
+static const char* next_arg(const char* p, const char** end) {
+    int depth = 0;
+    const char* q = p;
+    while (*q) {
+        if (*q == '<') depth++;
+        else if (*q == '>') {
+            if (depth == 0) break;
+            depth--;
+        } else if (*q == ',' && depth == 0) break;
+        q++;
+    }
+    *end = q;
+    return p;
+}
+
+int type_arg_count(const char* type_name) {
+    const char* p = strchr(type_name, '<');
+    if (!p) return 0;
+    int count = 0;
+    p++;
+    while (*p && *p != '>') {
+        const char* end;
+        next_arg(p, &end);
+        count++;
+        p = (*end == ',') ? end + 1 : end;
+    }
+    return count;
+}
+
+char* type_arg(const char* type_name, int index) {
+    const char* p = strchr(type_name, '<');
+    if (!p) return NULL;
+    p++;
+    for (int i = 0; *p && *p != '>'; i++) {
+        const char* end;
+        next_arg(p, &end);
+        if (i == index) return rujo_strndup(p, end - p);
+        p = (*end == ',') ? end + 1 : end;
+    }
+    return NULL;
+}
+
+char* type_mangle(const char* type_name) {
+    char* elem = type_array_elem(type_name);
+    if (elem) {
+        char* inner = type_mangle(elem);
+        char* out = (char*)malloc(strlen(inner) + 5);
+        strcpy(out, inner);
+        strcat(out, "_arr");
+        return out;
+    }
+
+    int count = type_arg_count(type_name);
+    if (count == 0) return rujo_strdup(type_name);
+
+    char* base = type_base(type_name);
+    size_t cap = strlen(type_name) * 2 + 16;
+    char* out = (char*)malloc(cap);
+    snprintf(out, cap, "%s_%d", base, count);
+    for (int i = 0; i < count; i++) {
+        char* m = type_mangle(type_arg(type_name, i));
+        size_t need = strlen(out) + strlen(m) + 2;
+        if (need > cap) {
+            cap = need * 2;
+            out = (char*)realloc(out, cap);
+        }
+        strcat(out, "_");
+        strcat(out, m);
+    }
+    return out;
+}
+
+char* type_substitute(const char* type_name, ASTNode* params, ASTNode* args) {
+    size_t cap = strlen(type_name) + 64;
+    char* out = (char*)malloc(cap);
+    size_t len = 0;
+    const char* p = type_name;
+
+    while (*p) {
+        const char* piece = p;
+        size_t piece_len = 1;
+        if (isalpha((unsigned char)*p) || *p == '_') {
+            while (isalnum((unsigned char)p[piece_len]) || p[piece_len] == '_') piece_len++;
+            // Identificador: troca se for um dos parâmetros
+            ASTNode* param = params;
+            ASTNode* arg = args;
+            while (param && arg) {
+                if (strlen(param->data.ident.name) == piece_len &&
+                    strncmp(param->data.ident.name, p, piece_len) == 0) {
+                    piece = arg->data.ident.name;
+                    break;
+                }
+                param = param->next;
+                arg = arg->next;
+            }
+            p += piece_len;
+            if (piece != p - piece_len) piece_len = strlen(piece);
+        } else {
+            p++;
+        }
+
+        if (len + piece_len + 1 > cap) {
+            cap = (len + piece_len + 1) * 2;
+            out = (char*)realloc(out, cap);
+        }
+        memcpy(out + len, piece, piece_len);
+        len += piece_len;
+    }
+    out[len] = '\0';
+    return out;
+}
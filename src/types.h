@@ -0,0 +1,34 @@
+#ifndef RUJO_TYPES_H
+#define RUJO_TYPES_H
+
+#include "ast.h"
+
+// Tipos são strings canônicas: "int", "Heroi", "int[]", "List<int>", "Pair<int,float>"
+
+// "T[]" -> "T" (NULL se não for array)
+char* type_array_elem(const char* type_name);
+
+// "List<int>" -> "List" (cópia do próprio nome se não for genérico)
+char* type_base(const char* type_name);
+
+// Argumentos de um tipo genérico: "Pair<int,float>" -> 2 / "int" / "float"
+int type_arg_count(const char* type_name);
+char* type_arg(const char* type_name, int index);
+
+// Tipos genéricos da biblioteca padrão
+int type_is_list(const char* type_name);
+int type_is_map(const char* type_name);
+int type_is_result(const char* type_name);
+int type_is_task(const char* type_name);
+int type_is_channel(const char* type_name); // Channel<T> ou SpscChannel<T>
+int type_is_gen(const char* type_name);
+int type_is_async(const char* type_name);
+int type_is_file_writer(const char* type_name);
+
+// Nome C determinístico de uma instância: "Pair<int,List<float>>" -> "Pair_2_int_List_1_float"
+char* type_mangle(const char* type_name);
+
+// Troca cada parâmetro (lista de AST_IDENTIFIER) pelo argumento correspondente
+char* type_substitute(const char* type_name, ASTNode* params, ASTNode* args);
+
+#endif
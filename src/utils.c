@@ -1,16 +1,36 @@
+#define _DEFAULT_SOURCE // madvise
 #include "utils.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 char* rujo_strndup(const char* s, size_t n) {
-    char* d = (char*)malloc(n + 1);
+    char* d = (char*)region_alloc(n + 1);
     if (!d) return NULL;
     strncpy(d, s, n);
     d[n] = '\0';
     return d;
 }
 
+// strdup não faz parte do C11; sem protótipo o ponteiro é truncado em 64 bits
+char* rujo_strdup(const char* s) {
+    return rujo_strndup(s, strlen(s));
+}
+
+uint64_t hash_bytes(uint64_t h, const char* s, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        h ^= (unsigned char)s[i];
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
 char* read_file(const char* path) {
     FILE* file = fopen(path, "rb");
     if (!file) {
@@ -34,4 +54,114 @@ char* read_file(const char* path) {
     fclose(file);
 
     return buffer;
-}
\ No newline at end of file
+}
+#ifndef _WIN32
+const char* map_file(const char* path, size_t* length) {
+    int fd = open(path, O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        printf("Erro: Nao foi possivel abrir o arquivo '%s'.\n", path);
+        if (fd >= 0) close(fd);
+        return NULL;
+    }
+    *length = (size_t)st.st_size;
+    if (*length == 0) {
+        close(fd);
+        return "";
+    }
+    void* data = mmap(NULL, *length, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        printf("Erro: Nao foi possivel mapear o arquivo '%s'.\n", path);
+        return NULL;
+    }
+    madvise(data, *length, MADV_SEQUENTIAL);
+    return (const char*)data;
+}
+
+void map_file_release(const char* data, size_t upto) {
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    upto -= upto % page;
+    if (upto > 0) madvise((void*)data, upto, MADV_DONTNEED);
+}
+#else
+const char* map_file(const char* path, size_t* length) {
+    char* data = read_file(path);
+    if (data) *length = strlen(data);
+    return data;
+}
+
+void map_file_release(const char* data, size_t upto) {
+    (void)data;
+    (void)upto;
+}
+#endif
+
+// Blocos de 16 KB (pedidos maiores ganham um bloco só deles); os blocos de
+// regiões liberadas ficam num cache para a próxima
+#define REGION_BLOCK (16 * 1024)
+
+typedef struct RegionBlock {
+    struct RegionBlock* next;
+    size_t cap;
+    size_t used;
+    size_t _pad;
+} RegionBlock;
+
+struct Region {
+    RegionBlock* head;
+};
+
+// Por thread: as threads do codegen (--jobs) não têm região e usam o malloc
+static _Thread_local Region* active_region = NULL;
+static RegionBlock* block_cache = NULL;
+
+Region* region_new(void) {
+    return (Region*)calloc(1, sizeof(Region));
+}
+
+void region_free(Region* r) {
+    if (!r) return;
+    if (active_region == r) active_region = NULL;
+    RegionBlock* b = r->head;
+    while (b) {
+        RegionBlock* next = b->next;
+        if (b->cap == REGION_BLOCK) {
+            b->next = block_cache;
+            block_cache = b;
+        } else {
+            free(b);
+        }
+        b = next;
+    }
+    free(r);
+}
+
+Region* region_activate(Region* r) {
+    Region* prev = active_region;
+    active_region = r;
+    return prev;
+}
+
+void* region_alloc(size_t n) {
+    if (!active_region) return malloc(n);
+    n = (n + 15) & ~(size_t)15;
+    RegionBlock* b = active_region->head;
+    if (!b || b->used + n > b->cap) {
+        if (n <= REGION_BLOCK && block_cache) {
+            b = block_cache;
+            block_cache = b->next;
+        } else {
+            size_t cap = n > REGION_BLOCK ? n : REGION_BLOCK;
+            b = (RegionBlock*)malloc(sizeof(RegionBlock) + cap);
+            if (!b) return NULL;
+            b->cap = cap;
+        }
+        b->used = 0;
+        b->next = active_region->head;
+        active_region->head = b;
+    }
+    void* p = (char*)(b + 1) + b->used;
+    b->used += n;
+    return p;
+}
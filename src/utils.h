@@ -2,8 +2,30 @@
 #define RUJO_UTILS_H
 
 #include <stddef.h>
+#include <stdint.h>
 
 char* read_file(const char* filename);
 char* rujo_strndup(const char* s, size_t n);
+char* rujo_strdup(const char* s);
 
-#endif
\ No newline at end of file
+// FNV-1a de 64 bits; h é HASH_SEED ou o hash anterior (para encadear)
+#define HASH_SEED 14695981039346656037ULL
+uint64_t hash_bytes(uint64_t h, const char* s, size_t n);
+
+// Fonte mapeado na memória (sem '\0' no fim: o lexer usa o tamanho). As
+// páginas antes de upto já lidas podem ser devolvidas ao sistema; se forem
+// tocadas de novo, voltam do arquivo. Fora do POSIX é o read_file.
+const char* map_file(const char* filename, size_t* length);
+void map_file_release(const char* data, size_t upto);
+
+// Região: blocos liberados de uma vez. Com uma região ativa, nós da AST,
+// strings e símbolos vêm dela em vez do malloc (rujo build --stream libera
+// cada item de nível superior depois de gerá-lo). Sem região, region_alloc é
+// o malloc. region_activate devolve a região que estava ativa.
+typedef struct Region Region;
+Region* region_new(void);
+void region_free(Region* r);
+Region* region_activate(Region* r);
+void* region_alloc(size_t n);
+
+#endif
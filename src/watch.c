@@ -0,0 +1,376 @@
+#define _XOPEN_SOURCE 700 // realpath, sigaction, kill, dprintf
+#include "watch.h"
+#include "lexer.h"
+#include "parser.h"
+#include "module.h"
+#include "utils.h"
+#include "stats.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#ifdef __linux__
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/inotify.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+// rujo watch: um processo fica no laço esperando mudanças nos .rj e cada build
+// roda num filho (fork), que segue o caminho normal do main. O filho herda a
+// memória do watch, então as árvores dos arquivos que não mudaram já estão lá
+// (cópia na escrita: o semântico pode alterá-las à vontade); os outros passam
+// pelo lexer e pelo parser no filho. O semântico e o codegen rodam inteiros
+// a cada build, com o estado global limpo, e os .o dos módulos que não mudaram
+// vêm do cache em .rujo/. Um erro no build (exit no parser, no semântico...)
+// derruba só o filho.
+//
+// O filho conta ao watch, por um pipe, cada arquivo que passou pelo parser
+// (hash do texto e caminho). O watch lê o arquivo de novo e, se o hash bater,
+// faz o parse ele mesmo (o mesmo texto acabou de passar sem erro) e guarda a
+// árvore numa região própria, liberada quando o inotify avisa que o arquivo
+// mudou. Uma mudança durante o build (ou com o programa rodando, no --run)
+// mata o grupo de processos do filho e começa outro build.
+
+// Árvores guardadas pelo watch, cada uma na sua região
+typedef struct {
+    char* path;
+    ASTNode* tree; // NULL: mudou desde o último parse
+    Region* region;
+} Parsed;
+
+static Parsed* parsed = NULL;
+static int parsed_count = 0;
+static int report_fd = -1; // No filho: o pipe para o watch
+
+const char* watch_main_file(const char* path) {
+    struct stat st;
+    if (stat(path, &st) != 0 || !S_ISDIR(st.st_mode)) return path;
+    size_t n = strlen(path);
+    char* file = (char*)malloc(n + 9);
+    sprintf(file, "%s%smain.rj", path, n && path[n - 1] == '/' ? "" : "/");
+    return file;
+}
+
+static Parsed* find_parsed(const char* path) {
+    for (int i = 0; i < parsed_count; i++) {
+        if (strcmp(parsed[i].path, path) == 0) return &parsed[i];
+    }
+    return NULL;
+}
+
+static ASTNode* parse_source(const char* source) {
+    Lexer l;
+    lexer_init(&l, source);
+    parser_init(&l);
+    return parser_parse_program(&l);
+}
+
+ASTNode* watch_parse(const char* path) {
+    Parsed* p = find_parsed(path);
+    if (p && p->tree) return p->tree;
+
+    char* source = read_file(path);
+    if (!source) exit(1);
+    int64_t lines = *source ? 1 : 0;
+    for (const char* c = source; *c; c++) lines += *c == '\n' && c[1];
+    stat_add(STAT_LINES, lines);
+    ASTNode* root = parse_source(source);
+#ifdef __linux__
+    if (report_fd >= 0) {
+        dprintf(report_fd, "%016llx %s\n", (unsigned long long)hash_bytes(HASH_SEED, source, strlen(source)), path);
+    }
+#endif
+    free(source);
+    return root;
+}
+
+#ifdef __linux__
+// Sem eventos por QUIET_MS: o editor terminou de salvar
+#define QUIET_MS 30
+
+typedef struct {
+    int wd;
+    char* dir;
+} Watched;
+
+static Watched* watched = NULL;
+static int watched_count = 0;
+static int inotify_fd = -1;
+static char* base_dir = NULL;
+static volatile sig_atomic_t stop = 0;
+
+static void on_signal(int sig) {
+    (void)sig;
+    stop = 1;
+}
+
+static char* join_path(const char* dir, const char* name) {
+    char* path = (char*)malloc(strlen(dir) + strlen(name) + 2);
+    sprintf(path, "%s/%s", dir, name);
+    return path;
+}
+
+// dir e os subdiretórios, menos os ocultos (como o .rujo)
+static void watch_dir(const char* dir) {
+    int wd = inotify_add_watch(inotify_fd, dir, IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_CREATE | IN_DELETE);
+    if (wd < 0) return;
+    for (int i = 0; i < watched_count; i++) {
+        if (watched[i].wd == wd) return;
+    }
+    watched = (Watched*)realloc(watched, sizeof(Watched) * (size_t)(watched_count + 1));
+    watched[watched_count].wd = wd;
+    watched[watched_count].dir = (char*)malloc(strlen(dir) + 1);
+    strcpy(watched[watched_count].dir, dir);
+    watched_count++;
+
+    DIR* d = opendir(dir);
+    if (!d) return;
+    struct dirent* entry;
+    while ((entry = readdir(d)) != NULL) {
+        if (entry->d_name[0] == '.') continue;
+        char* path = join_path(dir, entry->d_name);
+        struct stat st;
+        if (stat(path, &st) == 0 && S_ISDIR(st.st_mode)) watch_dir(path);
+        free(path);
+    }
+    closedir(d);
+}
+
+static const char* watched_dir(int wd) {
+    for (int i = 0; i < watched_count; i++) {
+        if (watched[i].wd == wd) return watched[i].dir;
+    }
+    return NULL;
+}
+
+static void forget(Parsed* p) {
+    if (!p->tree) return;
+    region_free(p->region);
+    p->region = NULL;
+    p->tree = NULL;
+}
+
+// Lê os eventos até passar QUIET_MS sem nenhum e esquece as árvores dos .rj
+// que mudaram. Retorna 0 se nenhum .rj mudou (os nomes vão para a tela)
+static int read_changes(void) {
+    char** names = NULL;
+    int count = 0;
+    int lost = 0;
+    struct pollfd quiet = { inotify_fd, POLLIN, 0 };
+    do {
+        union {
+            struct inotify_event event;
+            char bytes[4096];
+        } buf;
+        ssize_t len = read(inotify_fd, &buf, sizeof(buf));
+        if (len <= 0) break;
+        for (char* at = buf.bytes; at < buf.bytes + len;) {
+            struct inotify_event* ev = (struct inotify_event*)at;
+            at += sizeof(struct inotify_event) + ev->len;
+            if (ev->mask & IN_Q_OVERFLOW) {
+                // Eventos perdidos: tudo pode ter mudado
+                for (int i = 0; i < parsed_count; i++) forget(&parsed[i]);
+                lost = 1;
+                continue;
+            }
+            const char* dir = watched_dir(ev->wd);
+            if (!dir || !ev->len) continue;
+            char* path = join_path(dir, ev->name);
+            if (ev->mask & IN_ISDIR) {
+                if ((ev->mask & (IN_CREATE | IN_MOVED_TO)) && ev->name[0] != '.') watch_dir(path);
+                free(path);
+                continue;
+            }
+            size_t n = strlen(ev->name);
+            if (n < 3 || strcmp(ev->name + n - 3, ".rj") != 0) {
+                free(path);
+                continue;
+            }
+            Parsed* p = find_parsed(path);
+            if (p) forget(p);
+            int seen = 0;
+            for (int i = 0; i < count; i++) seen |= strcmp(names[i], path) == 0;
+            if (seen) {
+                free(path);
+                continue;
+            }
+            names = (char**)realloc(names, sizeof(char*) * (size_t)(count + 1));
+            names[count++] = path;
+        }
+    } while (poll(&quiet, 1, QUIET_MS) > 0);
+
+    if (count) {
+        printf("[watch] Mudou:");
+        size_t prefix = strlen(base_dir) + 1;
+        for (int i = 0; i < count; i++) printf(" %s", names[i] + prefix);
+        printf("\n");
+    }
+    if (lost) printf("[watch] Eventos perdidos: relendo todos os arquivos\n");
+    for (int i = 0; i < count; i++) free(names[i]);
+    free(names);
+    return count + lost;
+}
+
+// Guarda as árvores dos arquivos que o filho passou pelo parser (linhas
+// "hash caminho"). Só entra o texto com o mesmo hash: o arquivo pode ter mudado
+// de novo depois que o filho o leu
+static void keep_parsed(char* report, size_t len) {
+    char* line = report;
+    char* end;
+    while ((end = memchr(line, '\n', len - (size_t)(line - report))) != NULL) {
+        *end = '\0';
+        char* path = NULL;
+        unsigned long long hash = strtoull(line, &path, 16);
+        line = end + 1;
+        if (*path++ != ' ' || access(path, R_OK) != 0) continue;
+        char* source = read_file(path);
+        if (!source) continue;
+        if (hash_bytes(HASH_SEED, source, strlen(source)) == hash) {
+            Parsed* p = find_parsed(path);
+            if (!p) {
+                parsed = (Parsed*)realloc(parsed, sizeof(Parsed) * (size_t)(parsed_count + 1));
+                p = &parsed[parsed_count++];
+                p->path = (char*)malloc(strlen(path) + 1);
+                strcpy(p->path, path);
+                p->tree = NULL;
+            }
+            forget(p);
+            p->region = region_new();
+            Region* prev = region_activate(p->region);
+            p->tree = parse_source(source);
+            region_activate(prev);
+        }
+        free(source);
+    }
+}
+
+// Começa um build: retorna 0 no filho, o pid no watch (-1 se não deu)
+static pid_t start_build(int* report) {
+    int fds[2];
+    if (pipe(fds) != 0) return -1;
+    fflush(stdout);
+    fflush(stderr);
+    pid_t pid = fork();
+    if (pid == 0) {
+        // Grupo próprio: uma mudança mata o build junto com o gcc ou o programa
+        setpgid(0, 0);
+        signal(SIGINT, SIG_DFL);
+        signal(SIGTERM, SIG_DFL);
+        close(fds[0]);
+        close(inotify_fd);
+        fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+        report_fd = fds[1];
+        module_set_reader(watch_parse);
+        return 0;
+    }
+    close(fds[1]);
+    if (pid < 0) {
+        close(fds[0]);
+        return -1;
+    }
+    setpgid(pid, pid);
+    *report = fds[0];
+    return pid;
+}
+
+void watch_loop(const char* filename) {
+    char* root = realpath(filename, NULL);
+    if (!root) {
+        printf("Erro: Nao foi possivel abrir o arquivo '%s'.\n", filename);
+        exit(1);
+    }
+    base_dir = (char*)malloc(strlen(root) + 1);
+    strcpy(base_dir, root);
+    *strrchr(base_dir, '/') = '\0';
+    free(root);
+
+    inotify_fd = inotify_init1(IN_CLOEXEC);
+    if (inotify_fd < 0) {
+        printf("Erro: Nao foi possivel iniciar o inotify\n");
+        exit(1);
+    }
+    watch_dir(base_dir);
+
+    // Sem SA_RESTART: o poll volta com EINTR e o laço vê o stop
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = on_signal;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+
+    printf("[watch] Observando os .rj de '%s' (Ctrl+C para sair)\n", base_dir);
+    char* report = NULL;
+    size_t report_len = 0;
+    size_t report_cap = 0;
+    int report_pipe = -1;
+    pid_t child = 0;
+    int rebuild = 1;
+    StatTimer timer;
+    while (!stop) {
+        if (rebuild && !child) {
+            rebuild = 0;
+            stat_timer_start(&timer);
+            child = start_build(&report_pipe);
+            if (child == 0) return;
+            if (child < 0) {
+                printf("Erro: Nao foi possivel criar o processo do build\n");
+                exit(1);
+            }
+        }
+
+        struct pollfd fds[2] = { { inotify_fd, POLLIN, 0 }, { report_pipe, POLLIN, 0 } };
+        if (poll(fds, child ? 2 : 1, -1) < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        if ((fds[0].revents & POLLIN) && read_changes()) {
+            rebuild = 1;
+            // O build (ou o programa) que está rodando já não vale
+            if (child) kill(-child, SIGTERM);
+        }
+        if (child && (fds[1].revents & (POLLIN | POLLHUP))) {
+            if (report_len + 4096 > report_cap) {
+                report_cap = report_cap * 2 + 4096;
+                report = (char*)realloc(report, report_cap);
+            }
+            ssize_t n = read(report_pipe, report + report_len, 4096);
+            if (n > 0) {
+                report_len += (size_t)n;
+                continue;
+            }
+            // EOF: o filho terminou (o pipe não passa para o gcc nem o programa)
+            close(report_pipe);
+            int status;
+            waitpid(child, &status, 0);
+            child = 0;
+            keep_parsed(report, report_len);
+            report_len = 0;
+            if (rebuild) continue;
+            double ms = (double)stat_timer_elapsed(&timer).wall_ns / 1e6;
+            if (WIFEXITED(status) && WEXITSTATUS(status) == 0) {
+                printf("[watch] Pronto em %.0f ms. Esperando mudancas...\n", ms);
+            } else {
+                printf("[watch] Falhou (%.0f ms). Esperando mudancas...\n", ms);
+            }
+            fflush(stdout);
+        }
+    }
+    if (child) {
+        kill(-child, SIGTERM);
+        waitpid(child, NULL, 0);
+    }
+    exit(0);
+}
+#else
+void watch_loop(const char* filename) {
+    (void)filename;
+    printf("Erro: rujo watch usa o inotify e so funciona no Linux\n");
+    exit(1);
+}
+#endif
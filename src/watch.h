@@ -0,0 +1,19 @@
+#ifndef RUJO_WATCH_H
+#define RUJO_WATCH_H
+
+#include "ast.h"
+
+// rujo watch: o arquivo principal de path (um diretório: o main.rj dele)
+const char* watch_main_file(const char* path);
+
+// Observa (inotify) os .rj do diretório de filename e refaz o build a cada
+// mudança, cada um num processo filho. Só volta no filho, que segue o build
+// normal do main; o processo do watch fica no laço até SIGINT/SIGTERM.
+void watch_loop(const char* filename);
+
+// No filho: o AST_PROGRAM de path. Os arquivos que não mudaram desde o último
+// build vêm prontos do processo do watch; os outros passam pelo lexer e pelo
+// parser aqui, e o watch guarda a árvore para os próximos builds
+ASTNode* watch_parse(const char* path);
+
+#endif